@@ -0,0 +1,112 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <cstdint>
+
+#include "media_pipeline/core/interfaces/i_byte_writer.h"
+
+namespace media_pipeline::core {
+    using interfaces::IByteWriter;
+
+    struct AsyncFileWriterOptions {
+        size_t blockSize = 1 << 20;                 // Bytes per block, rounded up to kBlockAlignment
+        int blockCount = 3;                         // 2 = double, 3 = triple buffering
+        std::chrono::milliseconds syncInterval{ 0 };// Periodic fdatasync/FlushFileBuffers, 0 = only on Close
+        uint64_t preallocateBytes = 0;              // Reserve disk space up front without growing the file
+    };
+
+    struct AsyncFileWriterStats {
+        size_t queueDepth = 0;              // Blocks waiting for or in a write
+        uint64_t bytesWritten = 0;
+        uint64_t writes = 0;
+        uint64_t producerStalls = 0;        // Times Write waited for a free block
+        double averageWriteMicros = 0.0;
+        double maxWriteMicros = 0.0;
+    };
+
+    // Moves file I/O off the pipeline threads. Write copies into the current
+    // block of a small ring of aligned blocks; full blocks are written by a
+    // background thread with pwrite (io_uring when built with
+    // MEDIA_PIPELINE_USE_IO_URING, WriteFile on Windows), so a slow disk or
+    // sync only stalls the producer once every block is in flight.
+    //
+    // Errors from the background thread are rethrown by the next call on the
+    // producer side.
+    class AsyncFileWriter : public IByteWriter {
+    public:
+        static constexpr size_t kBlockAlignment = 4096;
+
+        AsyncFileWriter(AsyncFileWriterOptions options = {});
+        ~AsyncFileWriter();
+
+        void Open(const std::string& path);
+        bool IsOpen() const override;
+        void Write(const void* data, size_t size) override;
+        void Flush() override;
+
+        // Waits until everything written so far is on disk
+        void Sync();
+        void Close();
+
+        // Safe to call from any thread
+        AsyncFileWriterStats GetStats() const;
+
+    private:
+        struct AlignedDeleter {
+            void operator()(uint8_t* block) const;
+        };
+
+        struct UringState;
+
+        struct Block {
+            std::unique_ptr<uint8_t, AlignedDeleter> data;
+            size_t used = 0;
+            uint64_t offset = 0;
+        };
+
+        void WriterLoop();
+        void WriteBlocks(const std::vector<int>& indices);
+        // Synchronous write of the block from byte done to the end
+        void WriteRange(const Block& block, size_t done);
+        void SubmitCurrent();
+        void AcquireBlock();
+        void ThrowIfFailed();
+        void SyncFile();
+
+        AsyncFileWriterOptions options;
+        std::vector<Block> blocks;
+
+#ifdef _WIN32
+        void* handle;
+#else
+        int fd;
+#endif
+        std::unique_ptr<UringState> uring;
+        std::thread writerThread;
+        mutable std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<int> pending;
+        std::vector<int> freeBlocks;
+        int current;
+        int inFlight;
+        bool isStopping;
+        bool syncRequested;
+        std::exception_ptr error;
+        uint64_t nextOffset;
+        std::chrono::steady_clock::time_point lastSync;
+
+        std::atomic<uint64_t> bytesWritten;
+        std::atomic<uint64_t> writes;
+        std::atomic<uint64_t> producerStalls;
+        std::atomic<uint64_t> totalWriteMicros;
+        std::atomic<uint64_t> maxWriteMicros;
+    };
+}
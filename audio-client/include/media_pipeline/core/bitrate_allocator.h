@@ -0,0 +1,49 @@
+#pragma once
+#include <vector>
+#include <mutex>
+
+#include "media_pipeline/core/interfaces/i_bitrate_controllable.h"
+
+namespace media_pipeline::core {
+    using interfaces::IBitrateControllable;
+
+    // Splits one target send rate, usually a CongestionController's, between
+    // the encoders sharing the link. Every stream gets its minimum first;
+    // what is left goes to the streams in the order they were added, each
+    // up to its maximum. Add audio before video and audio keeps its rate
+    // while video absorbs the changes.
+    //
+    // A stream added before the first SetTotalBitrate is given its minimum
+    // straight away, so an encoder that picks its rate control mode when it
+    // opens (HevcProcessor) knows it is being steered.
+    //
+    // An encoder is only told about a new rate once it moves more than 5%,
+    // or hits its minimum or maximum, so small estimate wobbles don't keep
+    // reconfiguring it. Thread safe; streams must outlive the allocator or
+    // be removed first.
+    class BitrateAllocator {
+    public:
+        void AddStream(IBitrateControllable& stream, int minKbps, int maxKbps);
+        void RemoveStream(IBitrateControllable& stream);
+
+        void SetTotalBitrate(int kbps);
+
+        // Latest share handed to the stream, 0 if it isn't registered
+        int GetAllocation(const IBitrateControllable& stream) const;
+
+    private:
+        struct Stream {
+            IBitrateControllable* encoder;
+            int minKbps;
+            int maxKbps;
+            int allocatedKbps;
+            int appliedKbps;            // Last value passed to the encoder, 0 before the first
+        };
+
+        void Allocate();
+
+        mutable std::mutex mutex;
+        std::vector<Stream> streams;
+        int totalKbps = 0;
+    };
+}
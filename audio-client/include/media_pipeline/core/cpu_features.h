@@ -0,0 +1,32 @@
+#pragma once
+
+// Architecture detection for the SIMD kernels used by the video stages.
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define MEDIA_PIPELINE_X86 1
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define MEDIA_PIPELINE_NEON 1
+#endif
+
+// MSVC allows any intrinsic in any function, GCC/Clang need the target
+// attribute so AVX2 kernels can live next to SSE2 code without /arch flags.
+#if defined(MEDIA_PIPELINE_X86) && !defined(_MSC_VER)
+#define MEDIA_PIPELINE_TARGET_SSE2 __attribute__((target("sse2")))
+#define MEDIA_PIPELINE_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define MEDIA_PIPELINE_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define MEDIA_PIPELINE_TARGET_SSE2
+#define MEDIA_PIPELINE_TARGET_SSSE3
+#define MEDIA_PIPELINE_TARGET_AVX2
+#endif
+
+namespace media_pipeline::core::cpu {
+	struct Features {
+		bool sse2 = false;
+		bool ssse3 = false;
+		bool avx2 = false;
+		bool neon = false;
+	};
+
+	// Detected once on first call, cheap to query from hot loops afterwards
+	const Features& GetFeatures();
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+namespace media_pipeline::core::interfaces {
+	// Encoders whose output rate can change while they run, for a
+	// congestion controller to steer. SetTargetBitrate may be called from
+	// any thread; the encoder picks the new target up before its next frame.
+	class IBitrateControllable {
+	public:
+		virtual ~IBitrateControllable() = default;
+
+		virtual void SetTargetBitrate(int kbps) = 0;
+		virtual int GetTargetBitrate() const = 0;
+	};
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <cstddef>
+
+namespace media_pipeline::core::interfaces {
+	// Sequential byte output used by the file formats. Write may buffer, Flush
+	// hands everything written so far on without waiting for it to land.
+	class IByteWriter {
+	public:
+		virtual ~IByteWriter() = default;
+		virtual bool IsOpen() const = 0;
+		virtual void Write(const void* data, size_t size) = 0;
+		virtual void Flush() = 0;
+	};
+}
@@ -1,4 +1,6 @@
 #pragma once
+#include <vector>
+
 #include "media_pipeline/core/interfaces/i_media_component.h"
 #include "media_pipeline/core/media_data.h"
 
@@ -6,5 +8,13 @@ namespace media_pipeline::core::interfaces {
 	class IMediaProcessor : public IMediaComponent {
 	public:
 		virtual MediaData ProcessMediaData(const MediaData& input) = 0;
+
+		// Processors that fan one input out into several packets (simulcast layers)
+		// override this. The pipeline pushes every returned packet downstream.
+		virtual std::vector<MediaData> ProcessMediaDataMulti(const MediaData& input) {
+			std::vector<MediaData> outputs;
+			outputs.push_back(ProcessMediaData(input));
+			return outputs;
+		}
 	};
 }
@@ -0,0 +1,89 @@
+#pragma once
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <queue>
+#include <vector>
+#include <chrono>
+#include <utility>
+#include <cstdint>
+
+#include "media_pipeline/core/media_data.h"
+#include "media_pipeline/core/media_queue.h"
+
+namespace media_pipeline::core {
+	struct InterleavingOptions {
+		uint64_t reorderWindow = 500000000ull;		// Timestamp span (ns) held back waiting for other streams
+		std::chrono::milliseconds maxWait{ 200 };	// Longest a packet waits for a stream with nothing queued
+		size_t maxQueuedPackets = 1024;				// Across all streams, emitted early beyond this
+		size_t expectedStreams = 0;					// Streams to wait for before they first show up, 0 = only those seen
+	};
+
+	struct InterleavingStats {
+		uint64_t packetsOut = 0;
+		uint64_t forcedByWait = 0;		// Emitted while a stream was empty, after maxWait
+		uint64_t forcedByWindow = 0;	// Emitted while a stream was empty, span or count limit hit
+		uint64_t latePackets = 0;		// Older than a packet already emitted, passed through as is
+		size_t queuedPackets = 0;
+		// Timestamp distance (ms) between each packet and the last packet
+		// emitted for a different stream
+		double averageDistanceMs = 0.0;
+		double maxDistanceMs = 0.0;
+	};
+
+	// Drop in MediaQueue for muxers that merges streams by timestamp. Every
+	// stream (media type and simulcast layer) gets its own FIFO and a
+	// min-heap over the stream heads picks the oldest packet once every
+	// stream has one queued. A stream that stalls only holds the others back
+	// for maxWait, or until the queued packets span reorderWindow.
+	//
+	// Parameter set packets pass straight through, they must reach the muxer
+	// before the frames they describe. End of stream drains what is queued
+	// in timestamp order first.
+	class InterleavingQueue : public MediaQueue {
+	public:
+		InterleavingQueue(InterleavingOptions options = {});
+		void Push(MediaData data) override;
+		MediaData Pop() override;
+
+		InterleavingStats GetStats() const;
+
+	private:
+		using Clock = std::chrono::steady_clock;
+
+		struct Entry {
+			MediaData data;
+			Clock::time_point arrival;
+		};
+
+		struct Stream {
+			std::deque<Entry> packets;
+			bool hasEmitted = false;
+			uint64_t lastEmitted = 0;
+		};
+
+		// Heap of (head timestamp, stream index), one entry per non-empty stream
+		using HeadEntry = std::pair<uint64_t, size_t>;
+
+		size_t StreamIndex(const MediaData& data);
+		MediaData PopOldest();
+		bool ShouldWaitFor(Clock::time_point now, Clock::time_point& deadline);
+
+		InterleavingOptions options;
+		mutable std::mutex interleaveMutex;
+		std::condition_variable interleaveCv;
+
+		std::vector<Stream> streams;
+		std::map<std::pair<int, int>, size_t> streamIndices;
+		std::priority_queue<HeadEntry, std::vector<HeadEntry>, std::greater<HeadEntry>> heads;
+		std::deque<MediaData> passThrough;
+		size_t queuedPackets;
+		bool endOfStream;
+
+		InterleavingStats stats;
+		uint64_t maxTimestampOut;
+		double distanceSumMs;
+		uint64_t distanceSamples;
+	};
+}
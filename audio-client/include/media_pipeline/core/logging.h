@@ -0,0 +1,61 @@
+#pragma once
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <mutex>
+
+// Build with -DMEDIA_PIPELINE_LOG_LEVEL=0 for trace output. Messages below the
+// level are removed at compile time, including the formatting of their
+// arguments, so per-packet logging costs nothing in normal builds.
+#ifndef MEDIA_PIPELINE_LOG_LEVEL
+#define MEDIA_PIPELINE_LOG_LEVEL 2
+#endif
+
+namespace media_pipeline::core::logging {
+	enum class Level {
+		Trace = 0,
+		Debug = 1,
+		Info = 2,
+		Warning = 3,
+		Error = 4
+	};
+
+	constexpr Level kCompiledLevel = static_cast<Level>(MEDIA_PIPELINE_LOG_LEVEL);
+
+	constexpr bool IsEnabled(Level level) {
+		return static_cast<int>(level) >= static_cast<int>(kCompiledLevel);
+	}
+
+	inline const char* LevelName(Level level) {
+		switch (level) {
+		case Level::Trace: return "trace";
+		case Level::Debug: return "debug";
+		case Level::Info: return "info";
+		case Level::Warning: return "warning";
+		default: return "error";
+		}
+	}
+
+	// Whole lines only, so output from different pipeline threads doesn't interleave
+	inline void Write(Level level, const std::string& message) {
+		static std::mutex mutex;
+		std::lock_guard<std::mutex> lock(mutex);
+		std::ostream& out = level >= Level::Warning ? std::cerr : std::cout;
+		out << "[" << LevelName(level) << "] " << message << '\n';
+	}
+}
+
+#define MEDIA_LOG(level, expr) \
+	do { \
+		if constexpr (::media_pipeline::core::logging::IsEnabled(level)) { \
+			std::ostringstream logStream; \
+			logStream << expr; \
+			::media_pipeline::core::logging::Write(level, logStream.str()); \
+		} \
+	} while (0)
+
+#define MEDIA_LOG_TRACE(expr) MEDIA_LOG(::media_pipeline::core::logging::Level::Trace, expr)
+#define MEDIA_LOG_DEBUG(expr) MEDIA_LOG(::media_pipeline::core::logging::Level::Debug, expr)
+#define MEDIA_LOG_INFO(expr) MEDIA_LOG(::media_pipeline::core::logging::Level::Info, expr)
+#define MEDIA_LOG_WARNING(expr) MEDIA_LOG(::media_pipeline::core::logging::Level::Warning, expr)
+#define MEDIA_LOG_ERROR(expr) MEDIA_LOG(::media_pipeline::core::logging::Level::Error, expr)
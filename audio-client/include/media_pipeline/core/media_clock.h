@@ -0,0 +1,75 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+namespace media_pipeline::core {
+    // Length of one tick in seconds, num / den
+    struct TimeBase {
+        int64_t num;
+        int64_t den;
+    };
+
+    constexpr TimeBase kNanoseconds{ 1, 1000000000 };    // MediaData::timestamp
+    constexpr TimeBase kMicroseconds{ 1, 1000000 };
+    constexpr TimeBase kMilliseconds{ 1, 1000 };
+    constexpr TimeBase kHundredNanoseconds{ 1, 10000000 };  // Media Foundation, WASAPI QPC positions
+    constexpr TimeBase kMpegTicks{ 1, 90000 };          // MP4 video, RTP video
+
+    // value in `from` ticks to `to` ticks, rounded to nearest. Split so the
+    // intermediate product doesn't overflow for realistic time bases.
+    int64_t Rescale(int64_t value, TimeBase from, TimeBase to);
+
+    // The pipeline-wide clock. Every MediaData::timestamp is nanoseconds on
+    // this clock, taken at capture, so latency anywhere downstream is simply
+    // Now() - timestamp. Monotonic; zero is the first time it is read.
+    class MediaClock {
+    public:
+        static uint64_t Now();
+    };
+
+    // Maps a device clock (an audio sample counter, a camera's sample times)
+    // onto the media clock. Each observation pairs a device time with the
+    // media clock time the data was captured at; a least squares line over a
+    // sliding window gives offset and rate, so callback scheduling jitter
+    // stays out of timestamps and the rate is the device's drift.
+    //
+    // Comparing DriftPpm of the audio and video sources gives how fast the
+    // two drift apart. Thread safe, observations and lookups usually come
+    // from different threads.
+    class ClockDriftEstimator {
+    public:
+        explicit ClockDriftEstimator(size_t windowSize = 500);
+
+        void AddObservation(int64_t deviceNanos, int64_t mediaNanos);
+
+        // Identity until the first observation
+        int64_t ToMediaClock(int64_t deviceNanos) const;
+
+        // Device clock speed relative to the media clock, 0 until the
+        // observations span kMinFitSeconds
+        double DriftPpm() const;
+
+    private:
+        void Fit();
+
+        // A shorter window can't tell drift from jitter
+        static constexpr double kMinFitSeconds = 2.0;
+        // Beyond this the fit is wrong (a device reset), not drift
+        static constexpr double kMaxDriftPpm = 1000.0;
+
+        struct Observation {
+            double device;      // Seconds since the first observation
+            double media;
+        };
+
+        mutable std::mutex mutex;
+        size_t windowSize;
+        std::deque<Observation> observations;
+        bool hasOrigin;
+        int64_t deviceOrigin;
+        int64_t mediaOrigin;
+        double rate;            // Media seconds per device second
+        double offset;          // Media seconds at device origin
+    };
+}
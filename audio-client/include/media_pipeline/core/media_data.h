@@ -25,23 +25,33 @@ namespace media_pipeline::core {
 		int height;
 		enum class PixelFormat {
 			YUV420P,
+			NV12,
+			YUY2,
+			UYVY,
 			RGB24,
 			BGR24,
 			THEORA,
 			THEORA_HEADERS,
 			HEVC,
-			HEVC_HEADERS
+			HEVC_HEADERS,
+			H264,
+			H264_HEADERS,
+			VP8,
+			VP9
 		} format;
 
 		float frameRate;
 		bool isKeyFrame;
 		uint64_t granulepos = 0;
+		int stride = 0;		// Bytes per row of the first plane, 0 when rows are tightly packed
+		int temporalLayerId = 0;	// Temporal scalability layer, higher layers can be dropped
 	};
 
 	struct MediaData {
 		std::vector<uint8_t> data;
-		uint64_t timestamp;
+		uint64_t timestamp = 0;		// Nanoseconds on core::MediaClock, set at capture
 		bool isEndOfStream = false;
+		int layerId = 0;	// Simulcast layer, 0 for single layer streams
 		enum class Type { Audio, Video } type;
 		std::variant<AudioFormat, VideoFormat> format;
 
@@ -1,5 +1,6 @@
 #pragma once
 #include <mutex>
+#include <condition_variable>
 #include <queue>
 
 #include "media_pipeline/core/media_data.h"
@@ -7,8 +8,9 @@
 namespace media_pipeline::core {
 	class MediaQueue {
 	public:
-		void Push(MediaData data);
-		MediaData Pop();
+		virtual ~MediaQueue() = default;
+		virtual void Push(MediaData data);
+		virtual MediaData Pop();
 		std::queue<MediaData> queue;
 
 	private:
@@ -0,0 +1,25 @@
+#pragma once
+#include <memory>
+#include <vector>
+
+#include "media_pipeline/core/interfaces/i_media_processor.h"
+#include "media_pipeline/core/interfaces/i_media_component.h"
+#include "media_pipeline/core/media_data.h"
+
+namespace media_pipeline::core {
+    using core::interfaces::IMediaProcessor;
+
+    // Runs several processors back to back inside one pipeline processor thread,
+    // e.g. pixel format conversion in front of an encoder.
+    class ProcessorChain : public IMediaProcessor {
+    public:
+        ProcessorChain(std::vector<std::shared_ptr<IMediaProcessor>> processors);
+        void Start() override;
+        void Stop() override;
+        MediaData ProcessMediaData(const MediaData& input) override;
+        std::vector<MediaData> ProcessMediaDataMulti(const MediaData& input) override;
+
+    private:
+        std::vector<std::shared_ptr<IMediaProcessor>> processors;
+    };
+}
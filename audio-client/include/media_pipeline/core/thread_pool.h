@@ -0,0 +1,50 @@
+#pragma once
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <queue>
+#include <vector>
+#include <functional>
+#include <future>
+#include <memory>
+#include <atomic>
+
+namespace media_pipeline::core {
+    // Fixed size worker pool shared by the video stages (slice scaling,
+    // simulcast encodes). Submit queues one task, ParallelFor splits an index
+    // range across the workers and the calling thread.
+    class ThreadPool {
+    public:
+        explicit ThreadPool(size_t threadCount = 0);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        template <typename F>
+        std::future<std::invoke_result_t<F>> Submit(F&& task) {
+            using Result = std::invoke_result_t<F>;
+            auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+            std::future<Result> result = packaged->get_future();
+            Enqueue([packaged]() { (*packaged)(); });
+            return result;
+        }
+
+        // Runs body(0) .. body(count - 1) and returns once all of them finished.
+        // The caller works on the range as well, so it is safe to call from
+        // inside a pool task without deadlocking.
+        void ParallelFor(int count, const std::function<void(int)>& body);
+
+        size_t Size() const { return workers.size(); }
+
+    private:
+        void Enqueue(std::function<void()> task);
+        void WorkerLoop();
+
+        std::vector<std::thread> workers;
+        std::queue<std::function<void()>> tasks;
+        std::mutex mutex;
+        std::condition_variable cv;
+        bool isStopping;
+    };
+}
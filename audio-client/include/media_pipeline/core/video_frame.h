@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+namespace media_pipeline::core {
+	// Plane layout of a tightly packed I420 (YUV420P) buffer. Chroma planes are
+	// rounded up so odd frame sizes keep their last column and row.
+	struct I420Layout {
+		int width;
+		int height;
+		int chromaWidth;
+		int chromaHeight;
+
+		static I420Layout ForSize(int width, int height) {
+			return { width, height, (width + 1) / 2, (height + 1) / 2 };
+		}
+
+		size_t LumaSize() const { return static_cast<size_t>(width) * height; }
+		size_t ChromaSize() const { return static_cast<size_t>(chromaWidth) * chromaHeight; }
+		size_t TotalSize() const { return LumaSize() + 2 * ChromaSize(); }
+		size_t UOffset() const { return LumaSize(); }
+		size_t VOffset() const { return LumaSize() + ChromaSize(); }
+	};
+
+	// Non-owning view over three planes, used by the conversion and scaling kernels
+	struct PlaneView {
+		uint8_t* data;
+		int stride;
+	};
+
+	struct I420View {
+		PlaneView y;
+		PlaneView u;
+		PlaneView v;
+		int width;
+		int height;
+
+		static I420View FromBuffer(uint8_t* base, const I420Layout& layout) {
+			return {
+				{ base, layout.width },
+				{ base + layout.UOffset(), layout.chromaWidth },
+				{ base + layout.VOffset(), layout.chromaWidth },
+				layout.width,
+				layout.height
+			};
+		}
+	};
+}
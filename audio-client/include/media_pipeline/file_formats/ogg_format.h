@@ -1,33 +1,40 @@
 #pragma once
 #include <ogg/ogg.h>
 
+#include "media_pipeline/file_formats/ogg_page_writer.h"
 #include "media_pipeline/core/interfaces/i_file_format.h"
 #include "media_pipeline/core/media_data.h"
 
 namespace media_pipeline::file_formats {
 	using media_pipeline::core::interfaces::IFileFormat;
+	using media_pipeline::core::interfaces::IByteWriter;
 	using media_pipeline::core::MediaData;
 
 	class OggFileFormat : public IFileFormat {
 		static constexpr int OPUS_PRESKIP = 312;
 
 	public:
-		OggFileFormat();
+		OggFileFormat(OggFlushPolicy flushPolicy = {});
 		~OggFileFormat();
-		void WriteHeader(std::ofstream& file) override;
-		void WriteData(std::ofstream& file, const MediaData& data) override;
-		void WriteAudioData(std::ofstream& file, const MediaData& data);
-		void WriteVideoData(std::ofstream& file, const MediaData& data);
-		void Finalize(std::ofstream& file) override;
-		void WriteTheoraHeaders(std::ofstream& file, const MediaData& data);
+		void WriteHeader(IByteWriter& file) override;
+		void WriteData(IByteWriter& file, const MediaData& data) override;
+		void WriteAudioData(IByteWriter& file, const MediaData& data);
+		void WriteVideoData(IByteWriter& file, const MediaData& data);
+		void Finalize(IByteWriter& file) override;
+		void WriteTheoraHeaders(IByteWriter& file, const MediaData& data);
+
+		// Writes every buffered page to the file regardless of the flush policy
+		void Flush(IByteWriter& file);
 
 	private:
-		void WriteOggPages(std::ofstream& file, ogg_stream_state& stream);
-		void FlushOggPages(std::ofstream& file, ogg_stream_state& stream);
-		void WriteOpusHead(std::ofstream& file);
-		void WriteOpusTags(std::ofstream& file);
+		void WriteOggPages(IByteWriter& file, ogg_stream_state& stream);
+		void FlushOggPages(IByteWriter& file, ogg_stream_state& stream);
+		void ForceOggPages(ogg_stream_state& stream);
+		void WriteOpusHead(IByteWriter& file);
+		void WriteOpusTags(IByteWriter& file);
 		ogg_packet GenerateEmptyPacket();
 
+		OggPageWriter pageWriter;
 		bool headersSet = false;
 		ogg_int64_t audioPacketNo;
 		ogg_int64_t audioGranulePos;
@@ -0,0 +1,38 @@
+#pragma once
+#include <vector>
+#include <chrono>
+#include <cstdint>
+
+#include <ogg/ogg.h>
+
+#include "media_pipeline/core/interfaces/i_byte_writer.h"
+
+namespace media_pipeline::file_formats {
+	using media_pipeline::core::interfaces::IByteWriter;
+
+	struct OggFlushPolicy {
+		size_t maxBufferedBytes = 1 << 20;			// Write to the file once this much is buffered
+		std::chrono::milliseconds maxDelay{ 1000 };	// ... or once the oldest buffered page is this old
+		bool flushOnKeyframe = false;				// Start keyframes on a new page and write them out immediately
+	};
+
+	// Collects finished Ogg pages in one large buffer and hands them to the file
+	// in a single write once the flush policy says so, instead of a write and
+	// flush per page.
+	class OggPageWriter {
+	public:
+		OggPageWriter(OggFlushPolicy policy = {});
+
+		void Append(const ogg_page& page);
+		bool ShouldFlush() const;
+		void Flush(IByteWriter& file);
+
+		size_t BufferedBytes() const { return buffer.size(); }
+		const OggFlushPolicy& Policy() const { return policy; }
+
+	private:
+		OggFlushPolicy policy;
+		std::vector<uint8_t> buffer;
+		std::chrono::steady_clock::time_point firstPageTime;
+	};
+}
@@ -7,33 +7,68 @@
 #include "core/interfaces/i_media_processor.h"
 #include "core/interfaces/i_media_sink.h"
 #include "core/interfaces/i_file_format.h"
+#include "core/interfaces/i_byte_writer.h"
+#include "core/interfaces/i_bitrate_controllable.h"
 #include "core/media_data.h"
+#include "core/video_frame.h"
 #include "core/media_queue.h"
+#include "core/interleaving_queue.h"
 #include "core/pipeline.h"
+#include "core/processor_chain.h"
+#include "core/thread_pool.h"
+#include "core/logging.h"
+#include "core/async_file_writer.h"
+#include "core/media_clock.h"
+#include "core/bitrate_allocator.h"
 
 // ----- Public components -----
 // File Formats
 #include "file_formats/mp3_format.h"
 #include "file_formats/ogg_format.h"
+#include "file_formats/ogg_page_writer.h"
 
 // Processors
 #include "processors/audio/mp3_processor.h"
 #include "processors/audio/opus_processor.h"
 #include "processors/video/theora_processor.h"
 #include "processors/video/hevc_processor.h"
+#include "processors/video/h264_processor.h"
+#include "processors/video/vpx_processor.h"
+#include "processors/video/pixel_format_converter.h"
+#include "processors/video/video_scaler.h"
+#include "processors/video/simulcast_processor.h"
+#include "processors/video/static_frame_detector.h"
 
 // Sources
 #include "sources/audio/portaudio_source.h"
 #include "sources/audio/wasapi_source.h"
+#include "sources/audio/rtp_opus_source.h"
 #include "sources/video/wmf_source.h"
 
+// Networking
+#include "net/socket.h"
+#include "net/poller.h"
+#include "net/rtp.h"
+#include "net/rtp_hevc.h"
+#include "net/rtcp.h"
+#include "net/rtp_history.h"
+#include "net/rtp_session.h"
+#include "net/congestion_controller.h"
+#include "net/relay_protocol.h"
+#include "net/udp_fanout.h"
+#include "net/wire_protocol.h"
+
 // Sinks
 #include "sinks/general/file_sink.h"
 #include "sinks/general/muxer_sink.h"
 #include "sinks/general/network_sink.h"
+#include "sinks/general/segmenter_sink.h"
+#include "sinks/audio/rtp_opus_sink.h"
+#include "sinks/video/rtp_hevc_sink.h"
 
 namespace media_pipeline {
 	using core::interfaces::IFileFormat;
+	using core::interfaces::IByteWriter;
 	using core::interfaces::IMediaComponent;
 	using core::interfaces::IMediaProcessor;
 	using core::interfaces::IMediaSink;
@@ -43,5 +78,15 @@ namespace media_pipeline {
 	using core::VideoFormat;
 	using core::MediaData;
 	using core::MediaPipeline;
+	using core::ProcessorChain;
+	using core::ThreadPool;
+	using core::AsyncFileWriter;
+	using core::AsyncFileWriterOptions;
 	using core::MediaQueue;
+	using core::InterleavingQueue;
+	using core::InterleavingOptions;
+	using core::InterleavingStats;
+	using core::MediaClock;
+	using core::ClockDriftEstimator;
+	using core::TimeBase;
 }
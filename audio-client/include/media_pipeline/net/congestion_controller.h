@@ -0,0 +1,178 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+namespace media_pipeline::net {
+    struct CongestionControllerOptions {
+        int minBitrateKbps = 50;
+        int maxBitrateKbps = 8000;
+        int startBitrateKbps = 600;
+    };
+
+    // One packet of a feedback report, matched with its send record
+    struct PacketResult {
+        uint64_t sendTime = 0;          // Media clock, ns
+        int64_t arrivalTime = 0;        // Receiver clock, ns; only differences are used
+        size_t size = 0;                // Bytes on the wire
+        bool isReceived = false;
+    };
+
+    enum class BandwidthUsage {
+        Normal,
+        Underusing,
+        Overusing
+    };
+
+    struct CongestionStats {
+        int targetBitrateKbps = 0;
+        int delayBasedKbps = 0;
+        int lossBasedKbps = 0;
+        int acknowledgedKbps = 0;       // Received rate over the last half second, 0 until known
+        double queueDelayMs = 0.0;      // One-way delay above the lowest of the last 10 s
+        double trend = 0.0;             // Queuing delay trend, scaled like the threshold
+        double threshold = 0.0;
+        double lossFraction = 0.0;      // Latest loss window, 0 to 1
+        BandwidthUsage usage = BandwidthUsage::Normal;
+        uint64_t overuseEvents = 0;
+    };
+
+    // Google congestion control (draft-ietf-rmcat-gcc-02) on the sender.
+    //
+    // Delay based part: sent packets are grouped into 5 ms bursts, and the
+    // change in one-way delay between consecutive groups is accumulated
+    // into a queuing delay estimate. A least squares trendline over the
+    // last 20 groups tells whether a queue is building; compared against
+    // an adaptive threshold it gives overuse, normal or underuse. Two
+    // faster signals catch a link that slows down under the controller: a
+    // queue delay over 50 ms that is still growing, and a burst (a frame)
+    // arriving spread out to under 70% of the target rate.
+    //
+    // On overuse the rate backs off to 85% of the link capacity, measured
+    // from that burst spread or the last 100 ms of arrivals, and further,
+    // down to 20%, when the queue projected to the present needs draining;
+    // once it has drained the rate returns to 85%. On underuse (the queue
+    // is draining) it holds. Otherwise it grows 40% a second while nothing
+    // is queued, 8% with a standing queue, and 5% or a packet per round
+    // trip once close to the capacity that last caused overuse.
+    //
+    // Loss based part: above 10% loss over a window the rate drops by half
+    // the loss fraction; below 2% it grows back 5% a window until it meets
+    // the delay based estimate, or at once if the queue has emptied. The
+    // target is the smaller of the two, clamped to the configured range.
+    //
+    // Fed by RtpSenderSession from congestion control feedback; one
+    // controller may sit behind several sessions. Thread safe. The
+    // observer runs on the thread that delivered the feedback.
+    class CongestionController {
+    public:
+        explicit CongestionController(CongestionControllerOptions options = {});
+
+        // Results from one feedback report, in sequence order
+        void OnPacketFeedback(const PacketResult* results, size_t count, uint64_t now);
+        void OnRoundTripTime(double rttMs);
+
+        int TargetBitrateKbps() const;
+        CongestionStats GetStats() const;
+
+        // Called with the new target whenever it changes
+        void SetObserver(std::function<void(int kbps)> observer);
+
+    private:
+        struct PacketGroup {
+            uint64_t firstSendTime = 0;
+            uint64_t lastSendTime = 0;
+            int64_t firstArrivalTime = 0;
+            int64_t lastArrivalTime = 0;
+            size_t size = 0;
+            size_t firstSize = 0;
+            size_t packetCount = 0;
+            bool isEmpty = true;
+        };
+
+        struct TrendSample {
+            double arrivalMs;
+            double smoothedDelayMs;
+        };
+
+        struct Arrival {
+            int64_t time;
+            size_t size;
+        };
+
+        struct DelaySample {
+            int64_t time;               // Arrival, receiver clock
+            int64_t delay;              // Arrival minus send time, clock offset included
+        };
+
+        void AddToGroup(const PacketResult& result, uint64_t now);
+        void OnGroupDelta(double sendDeltaMs, double arrivalDeltaMs, double arrivalMs, uint64_t now);
+        void Detect(double sendDeltaMs, uint64_t now);
+        void UpdateThreshold(double modifiedTrend, uint64_t now);
+        void UpdateAcknowledgedRate(int64_t arrivalTime, size_t size);
+        void UpdateBaseDelay(const PacketResult& result);
+        void UpdateQueueDelay(const PacketResult& result);
+        void UpdateBurstRate();
+        void DetectSlowBurst();
+        double LinkCapacity() const;    // 0 until measured
+        double ProjectedQueueDelayMs(double capacity, uint64_t now) const;
+        double DeliveryRate() const;
+        void UpdateDelayBasedRate(uint64_t now);
+        void UpdateLossBasedRate(uint64_t now);
+
+        CongestionControllerOptions options;
+
+        mutable std::mutex mutex;
+        PacketGroup current;
+        PacketGroup previous;
+        bool hasPrevious;
+        int64_t firstArrivalTime;
+        bool hasFirstArrival;
+
+        // Trendline estimator
+        std::deque<TrendSample> trendSamples;
+        double accumulatedDelayMs;
+        double smoothedDelayMs;
+        size_t deltaCount;
+        double trend;
+        double previousTrend;
+
+        // Overuse detector
+        double threshold;
+        uint64_t lastThresholdUpdate;
+        double timeOverUsingMs;
+        int overuseCounter;
+        BandwidthUsage usage;
+
+        // Rate controllers
+        std::deque<Arrival> arrivals;
+        size_t arrivalBytes;            // Sum over arrivals
+        std::deque<DelaySample> baseDelays; // Increasing, minimum in front
+        double queueDelayMs;            // At the first packet of the latest group
+        double previousQueueDelayMs;    // The group before
+        uint64_t queueDelaySendTime;    // Send time of the packet queueDelayMs was measured on
+        double burstBps;                // Arrival rate within the latest burst, 0 until known
+        int64_t burstArrivalTime;
+        double acknowledgedBps;
+        double delayBasedBps;
+        double lossBasedBps;
+        double maxRateAverageBps;       // Link capacity at recent overuse, 0 if none
+        double maxRateVariance;
+        double resumeBps;               // Rate to return to once a deep backoff has drained the queue, 0 if none
+        uint64_t lastRateUpdate;
+        uint64_t lastDecrease;
+        double rttMs;
+
+        size_t lossWindowPackets;
+        size_t lossWindowLost;
+        uint64_t lastLossUpdate;
+        double lossFraction;
+        bool isLossLimited;             // Cut by loss and not yet back up to the delay based estimate
+
+        int target;
+        uint64_t overuseEvents;
+        std::function<void(int)> observer;
+    };
+}
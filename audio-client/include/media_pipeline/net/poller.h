@@ -0,0 +1,50 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+#include "media_pipeline/net/socket.h"
+
+namespace media_pipeline::net {
+    enum PollFlags : uint32_t {
+        kPollReadable = 1,
+        kPollWritable = 2
+    };
+
+    struct PollEvent {
+        SocketHandle handle;
+        bool readable;
+        bool writable;
+        bool hangup;        // Peer closed or the socket failed, the next call on it tells which
+    };
+
+    // Readiness notification for many sockets. epoll on Linux, poll (WSAPoll
+    // on Windows) elsewhere. Level triggered: a socket is reported for as
+    // long as it stays readable or writable, so only register interest in
+    // writability while there is something to send. Not thread safe.
+    class Poller {
+    public:
+        Poller();
+        ~Poller();
+        Poller(const Poller&) = delete;
+        Poller& operator=(const Poller&) = delete;
+
+        void Add(SocketHandle handle, uint32_t flags);
+        void Modify(SocketHandle handle, uint32_t flags);
+        void Remove(SocketHandle handle);
+
+        // Fills events with the ready sockets and returns how many there
+        // are, 0 on timeout. A negative timeout waits indefinitely.
+        size_t Wait(std::vector<PollEvent>& events, int timeoutMs);
+
+    private:
+#ifdef __linux__
+        int epollFd;
+#else
+        struct Entry {
+            SocketHandle handle;
+            uint32_t flags;
+        };
+        std::vector<Entry> entries;
+#endif
+    };
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+namespace media_pipeline::net {
+    // Framing shared by NetworkSink and the relay server: every message is a
+    // 4 byte little endian payload size followed by the payload.
+    //
+    // A relay client's first message is a join naming a channel and what the
+    // client does in it. After that, every message a publisher sends is
+    // forwarded, size prefix included, to the channel's other subscribers.
+    // The relay looks no further than the size; NetworkSink's media frames
+    // (wire_protocol.h) begin with it.
+    constexpr size_t kRelayFrameHeaderSize = 4;
+
+    constexpr uint32_t kRelayJoinMagic = 0x4E494F4A;   // "JOIN" on the wire
+    constexpr size_t kRelayJoinSize = 9;                // Magic, channel, roles
+
+    enum RelayRole : uint8_t {
+        kRelayPublish = 1,
+        kRelaySubscribe = 2
+    };
+
+    struct RelayJoin {
+        uint32_t channel = 0;
+        uint8_t roles = 0;          // RelayRole bits
+    };
+
+    inline void WriteRelayU32(uint8_t* out, uint32_t value) {
+        out[0] = static_cast<uint8_t>(value);
+        out[1] = static_cast<uint8_t>(value >> 8);
+        out[2] = static_cast<uint8_t>(value >> 16);
+        out[3] = static_cast<uint8_t>(value >> 24);
+    }
+
+    inline uint32_t ReadRelayU32(const uint8_t* data) {
+        return static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8) |
+            (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24);
+    }
+
+    // Writes the whole join message, size prefix included
+    constexpr size_t kRelayJoinMessageSize = kRelayFrameHeaderSize + kRelayJoinSize;
+
+    inline size_t WriteRelayJoin(uint8_t* out, const RelayJoin& join) {
+        WriteRelayU32(out, static_cast<uint32_t>(kRelayJoinSize));
+        WriteRelayU32(out + 4, kRelayJoinMagic);
+        WriteRelayU32(out + 8, join.channel);
+        out[12] = join.roles;
+        return kRelayJoinMessageSize;
+    }
+
+    // Parses a join payload (size prefix already stripped)
+    inline bool ParseRelayJoin(const uint8_t* payload, size_t size, RelayJoin& join) {
+        if (size != kRelayJoinSize || ReadRelayU32(payload) != kRelayJoinMagic) return false;
+        join.channel = ReadRelayU32(payload + 4);
+        join.roles = payload[8];
+        return (join.roles & (kRelayPublish | kRelaySubscribe)) != 0 &&
+            (join.roles & ~(kRelayPublish | kRelaySubscribe)) == 0;
+    }
+}
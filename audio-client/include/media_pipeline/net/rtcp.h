@@ -0,0 +1,91 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace media_pipeline::net {
+    // RTCP packet types (RFC 3550 12.1, RFC 4585 6.1)
+    constexpr uint8_t kRtcpSenderReport = 200;
+    constexpr uint8_t kRtcpReceiverReport = 201;
+    constexpr uint8_t kRtcpTransportFeedback = 205;
+    constexpr uint8_t kRtcpNackFormat = 1;          // Generic NACK, FMT of a transport feedback packet
+    constexpr uint8_t kRtcpCongestionFormat = 11;   // Congestion control feedback (RFC 8888)
+
+    // Largest compound packet the sessions build
+    constexpr size_t kRtcpMaxPacketSize = 1200;
+
+    // RTCP shares the RTP port (RFC 5761); its packet types fall in a range
+    // no RTP payload type with or without the marker bit can take
+    inline bool IsRtcpPacket(const uint8_t* data, size_t size) {
+        return size >= 8 && (data[0] >> 6) == 2 && data[1] >= 192 && data[1] <= 223;
+    }
+
+    struct RtcpSenderInfo {
+        uint64_t ntpTimestamp = 0;
+        uint32_t rtpTimestamp = 0;      // Same instant on the RTP clock
+        uint32_t packetCount = 0;
+        uint32_t octetCount = 0;        // Payload bytes
+    };
+
+    struct RtcpReportBlock {
+        uint32_t ssrc = 0;                      // Source the block reports on
+        uint8_t fractionLost = 0;               // Since the previous report, in 1/256
+        int32_t cumulativeLost = 0;             // 24 bit signed on the wire
+        uint32_t highestSequence = 0;           // Extended with the wraparound count
+        uint32_t jitter = 0;                    // RTP clock units
+        uint32_t lastSenderReport = 0;          // Compact NTP time of the latest SR, 0 if none yet
+        uint32_t delaySinceLastSenderReport = 0;    // 1/65536 s
+    };
+
+    // One packet of a congestion control feedback report
+    struct RtcpPacketArrival {
+        uint16_t sequenceNumber = 0;
+        bool isReceived = false;
+        uint16_t arrivalOffset = 0;     // Before the report timestamp, in 1/1024 s
+    };
+
+    // What one compound packet carried, vectors are reused across calls
+    struct RtcpFeedback {
+        bool hasSenderInfo = false;
+        uint32_t senderSsrc = 0;
+        RtcpSenderInfo senderInfo;
+        std::vector<RtcpReportBlock> reports;
+        std::vector<uint16_t> nacks;    // Sequence numbers asked for again
+        std::vector<RtcpPacketArrival> arrivals;
+        uint32_t arrivalReportTime = 0; // Compact NTP time of the receiver's clock the offsets count back from
+    };
+
+    // Parses a compound packet, skipping packet types it doesn't know.
+    // False if the lengths don't add up.
+    bool ParseRtcp(const uint8_t* data, size_t size, RtcpFeedback& feedback);
+
+    // The writers return the bytes written, 0 if out is too small
+    size_t WriteSenderReport(uint8_t* out, size_t capacity, uint32_t ssrc, const RtcpSenderInfo& info);
+    size_t WriteReceiverReport(uint8_t* out, size_t capacity, uint32_t ssrc, const RtcpReportBlock& block);
+
+    // Generic NACK (RFC 4585 6.2.1) for sequence numbers in ascending
+    // order, packed into PID/BLP pairs. Pairs that don't fit are left out;
+    // sequencesWritten gets how many of the sequence numbers made it.
+    size_t WriteNack(uint8_t* out, size_t capacity, uint32_t senderSsrc, uint32_t mediaSsrc,
+        const uint16_t* sequences, size_t count, size_t* sequencesWritten = nullptr);
+
+    constexpr size_t kRtcpMaxCongestionReports = 512;
+
+    // Largest arrival offset a report can carry, about 8 s
+    constexpr uint16_t kRtcpMaxArrivalOffset = 0x1FFE;
+
+    // Congestion control feedback (RFC 8888) for one media stream: whether
+    // each of count packets from beginSequence arrived, and when, relative
+    // to reportTime. At most kRtcpMaxCongestionReports packets fit.
+    size_t WriteCongestionFeedback(uint8_t* out, size_t capacity, uint32_t senderSsrc, uint32_t mediaSsrc,
+        uint16_t beginSequence, const RtcpPacketArrival* arrivals, size_t count, uint32_t reportTime);
+
+    // 64 bit NTP format for a media clock time. Both ends only compare
+    // times they produced themselves, so the epoch doesn't matter.
+    uint64_t NtpFromNanos(uint64_t nanos);
+
+    // Middle 32 bits, 1/65536 s resolution, as LSR and DLSR carry them
+    inline uint32_t CompactNtp(uint64_t ntp) {
+        return static_cast<uint32_t>(ntp >> 16);
+    }
+}
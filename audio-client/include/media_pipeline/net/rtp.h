@@ -0,0 +1,77 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+namespace media_pipeline::net {
+    // Fixed RTP header (RFC 3550), no CSRCs or extension on the send side
+    constexpr size_t kRtpHeaderSize = 12;
+
+    // Largest RTP packet sent, leaves room for IPv4/IPv6 and UDP headers in
+    // a 1280 byte path MTU
+    constexpr size_t kRtpMaxPacketSize = 1200;
+
+    struct RtpHeader {
+        bool marker = false;
+        uint8_t payloadType = 0;
+        uint16_t sequenceNumber = 0;
+        uint32_t timestamp = 0;
+        uint32_t ssrc = 0;
+    };
+
+    // What the receiver reported back over RTCP, for encoders to adapt
+    // their bitrate and key frame interval to
+    struct RtpFeedbackStats {
+        double fractionLost = 0.0;          // Latest receiver report, 0 to 1
+        uint64_t cumulativeLost = 0;
+        double jitterMs = 0.0;              // Interarrival jitter (RFC 3550 6.4.1)
+        double rttMs = 0.0;                 // From LSR/DLSR, 0 until the first report that echoes a sender report
+        uint64_t reportsReceived = 0;
+        uint64_t nacksReceived = 0;         // Sequence numbers asked for again
+        uint64_t packetsRetransmitted = 0;
+        uint64_t retransmissionMisses = 0;  // NACKed packets no longer in the history
+        uint64_t retransmissionsSkipped = 0; // NACKed again before the last resend could arrive
+    };
+
+    // Counters kept by the RTP sinks
+    struct RtpSinkStats {
+        uint64_t packetsSent = 0;
+        uint64_t bytesSent = 0;         // RTP headers included
+        uint64_t packetsDropped = 0;    // Socket buffer full or packet too large
+        RtpFeedbackStats feedback;
+    };
+
+    // Counters kept by the RTP receivers
+    struct RtpSourceStats {
+        uint64_t packetsReceived = 0;
+        uint64_t bytesReceived = 0;
+        uint64_t packetsLost = 0;       // Never arrived, or arrived after their turn was skipped
+        uint64_t packetsLate = 0;       // Arrived after their turn, dropped
+        uint64_t packetsInvalid = 0;    // Not RTP, wrong payload type or another SSRC
+        uint64_t packetsRecovered = 0;  // Retransmissions that filled a gap in time
+        uint64_t nacksSent = 0;         // Sequence numbers asked for again
+        double fractionLost = 0.0;      // Over the latest report interval, 0 to 1
+        double jitterMs = 0.0;
+        double rttMs = 0.0;             // NACK to retransmission, 0 until one was measured
+    };
+
+    // Writes the 12 byte header at out
+    void WriteRtpHeader(uint8_t* out, const RtpHeader& header);
+
+    // Parses the header of a received packet, skipping CSRCs and a header
+    // extension and removing padding. False if it isn't RTP version 2 or
+    // the lengths don't add up.
+    bool ParseRtpHeader(const uint8_t* data, size_t size, RtpHeader& header,
+        size_t& payloadOffset, size_t& payloadSize);
+
+    // Wraparound aware comparisons for 16 bit sequence numbers
+    inline int16_t SequenceDistance(uint16_t from, uint16_t to) {
+        return static_cast<int16_t>(static_cast<uint16_t>(to - from));
+    }
+
+    inline bool SequenceNewer(uint16_t candidate, uint16_t reference) {
+        return SequenceDistance(reference, candidate) > 0;
+    }
+
+    // Random SSRC, sequence number and timestamp origins (RFC 3550 5.1)
+    uint32_t RandomRtpValue();
+}
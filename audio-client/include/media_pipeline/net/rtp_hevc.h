@@ -0,0 +1,126 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <deque>
+
+#include "media_pipeline/net/socket.h"
+#include "media_pipeline/net/rtp.h"
+#include "media_pipeline/processors/video/nal_units.h"
+
+namespace media_pipeline::net {
+    // One packet from HevcRtpPayloader as gather slices: the RTP header and
+    // payload headers in the payloader, the NAL bytes in the access unit
+    struct RtpPacketView {
+        const IoSlice* slices;
+        size_t sliceCount;
+        size_t size;
+    };
+
+    // Splits Annex-B HEVC access units into RTP packets (RFC 7798).
+    //
+    // NAL units that fit go out as single NAL unit packets. Runs of small
+    // units, typically VPS/SPS/PPS and SEI, share one aggregation packet
+    // (AP). Units larger than the packet size are cut into fragmentation
+    // units (FU). The marker bit goes on the last packet of the access unit.
+    //
+    // Nothing is copied: each packet is a list of slices over the caller's
+    // buffer plus the few header bytes, ready for Socket::SendVectored. The
+    // views stay valid until the next Packetize call and as long as the
+    // access unit buffer does. Buffers are kept across calls, so steady
+    // state packetization doesn't allocate.
+    class HevcRtpPayloader {
+    public:
+        HevcRtpPayloader(uint8_t payloadType, uint32_t ssrc, uint16_t firstSequenceNumber,
+            size_t maxPacketSize = kRtpMaxPacketSize);
+
+        // Packetizes one access unit, returns the number of packets.
+        // endOfAccessUnit false leaves the marker off, for parameter sets
+        // sent ahead of a frame with the same timestamp.
+        size_t Packetize(const uint8_t* accessUnit, size_t size, uint32_t timestamp,
+            bool endOfAccessUnit = true);
+
+        size_t PacketCount() const { return packets.size(); }
+        const RtpPacketView& Packet(size_t index) const { return packets[index]; }
+
+        uint32_t Ssrc() const { return ssrc; }
+        uint16_t NextSequenceNumber() const { return sequenceNumber; }
+
+    private:
+        uint8_t* BeginPacket(uint32_t timestamp, size_t headerSize);
+        void AddSlice(const void* data, size_t size);
+        void EmitSingle(const processors::video::nal::NalUnit& unit, uint32_t timestamp);
+        void EmitAggregate(size_t first, size_t count, uint32_t timestamp);
+        void EmitFragments(const processors::video::nal::NalUnit& unit, uint32_t timestamp);
+
+        uint8_t payloadType;
+        uint32_t ssrc;
+        uint16_t sequenceNumber;
+        size_t maxPacketSize;
+
+        std::vector<processors::video::nal::NalUnit> units;
+        std::vector<uint8_t> headerArena;   // Sized before each access unit, never grows while slices point into it
+        size_t arenaUsed;
+        uint8_t* lastHeader;                // RTP header of the latest packet, gets the marker bit
+        std::vector<IoSlice> slices;
+        std::vector<RtpPacketView> packets;
+        std::vector<size_t> packetStarts;   // First slice of each packet, pointers are fixed up at the end
+    };
+
+    struct HevcAccessUnit {
+        std::vector<uint8_t> data;      // Annex-B with 4 byte start codes
+        uint32_t timestamp = 0;         // RTP timestamp, 90 kHz
+        bool isComplete = true;         // False if a packet of it was lost
+        bool isKeyFrame = false;        // Holds an IRAP picture
+    };
+
+    struct HevcDepayloaderStats {
+        uint64_t packetsReceived = 0;
+        uint64_t packetsLost = 0;           // Sequence gaps
+        uint64_t packetsLate = 0;           // Older than one already processed, dropped
+        uint64_t packetsInvalid = 0;        // Malformed payload or unsupported packet type
+        uint64_t accessUnits = 0;
+        uint64_t accessUnitsIncomplete = 0;
+    };
+
+    // Rebuilds Annex-B access units from RTP packets produced by any RFC 7798
+    // sender that doesn't interleave (sprop-max-don-diff 0).
+    //
+    // An access unit ends at the marker bit, or when a packet with another
+    // timestamp arrives if the marker was lost. Sequence gaps mark the
+    // access units they may belong to as incomplete, and a fragmented NAL
+    // unit missing a piece is left out instead of being passed on
+    // truncated. Whether an incomplete access unit is decoded or skipped
+    // until the next key frame is the caller's choice.
+    class HevcRtpDepayloader {
+    public:
+        // Feeds one packet's payload, in arrival order. The caller has
+        // already checked SSRC and payload type.
+        void Push(const RtpHeader& header, const uint8_t* payload, size_t size);
+
+        // Takes the oldest finished access unit. The buffer previously in
+        // out is recycled for later access units.
+        bool Pop(HevcAccessUnit& out);
+
+        const HevcDepayloaderStats& Stats() const { return stats; }
+
+    private:
+        void BeginAccessUnit(uint32_t timestamp, bool isComplete);
+        void FinishAccessUnit();
+        void AppendNalUnit(const uint8_t* data, size_t size);
+        void HandleFragment(const uint8_t* payload, size_t size);
+        void DiscardFragment();
+
+        bool hasSequence = false;
+        uint16_t lastSequence = 0;
+
+        bool hasCurrent = false;
+        HevcAccessUnit current;
+        bool fragmentOpen = false;
+        size_t fragmentStart = 0;       // Where the open fragmented NAL unit begins in current.data
+
+        std::deque<HevcAccessUnit> ready;
+        std::vector<std::vector<uint8_t>> spareBuffers;
+        HevcDepayloaderStats stats;
+    };
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include "media_pipeline/net/socket.h"
+#include "media_pipeline/net/rtp.h"
+
+namespace media_pipeline::net {
+    // Copies of recently sent RTP packets, kept to answer NACKs.
+    //
+    // The arena is allocated once: capacity slots of kRtpMaxPacketSize
+    // bytes, capacity a power of two. A packet's slot is its sequence
+    // number modulo the capacity, so storing overwrites the packet sent
+    // capacity packets earlier and a lookup is one index and a compare.
+    // Packets older than maxAge aren't served even if still present; by
+    // then the receiver has given up on them.
+    class RtpPacketHistory {
+    public:
+        RtpPacketHistory(size_t capacity = 1024, uint64_t maxAgeNanos = 1000000000);
+
+        // Packets larger than kRtpMaxPacketSize aren't kept
+        void Store(uint16_t sequenceNumber, const IoSlice* slices, size_t count, uint64_t now);
+
+        // The stored packet, or nullptr if it was never stored, has been
+        // overwritten or is too old
+        const uint8_t* Find(uint16_t sequenceNumber, uint64_t now, size_t& size) const;
+
+        // Records a resend of the packet, unless there was one within
+        // minInterval: an answer to the first NACK may still be queued on
+        // the way, and sending it again only lengthens that queue
+        bool MarkResent(uint16_t sequenceNumber, uint64_t now, uint64_t minInterval);
+
+        // When the packet was stored and its size, regardless of age, for
+        // matching congestion feedback to what was sent. False if it was
+        // never stored or has been overwritten.
+        bool GetSendInfo(uint16_t sequenceNumber, uint64_t& sentAt, size_t& size) const;
+
+        size_t Capacity() const { return slots.size(); }
+
+    private:
+        struct Slot {
+            uint64_t sentAt = 0;
+            uint64_t resentAt = 0;          // 0 until the first resend
+            uint32_t size = 0;
+            uint16_t sequenceNumber = 0;
+            bool isUsed = false;
+        };
+
+        std::vector<uint8_t> arena;
+        std::vector<Slot> slots;
+        size_t mask;
+        uint64_t maxAge;
+    };
+}
@@ -0,0 +1,204 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <mutex>
+#include <memory>
+#include <vector>
+
+#include "media_pipeline/net/socket.h"
+#include "media_pipeline/net/rtp.h"
+#include "media_pipeline/net/rtcp.h"
+#include "media_pipeline/net/rtp_history.h"
+#include "media_pipeline/net/congestion_controller.h"
+#include "media_pipeline/core/bitrate_allocator.h"
+
+namespace media_pipeline::net {
+    struct RtpSenderSessionOptions {
+        size_t historyPackets = 1024;       // Arena of historyPackets * kRtpMaxPacketSize bytes
+        std::chrono::milliseconds historyAge{ 1000 };
+        std::chrono::milliseconds reportInterval{ 1000 };
+        // Receives the congestion control feedback matched against the
+        // history; shared when audio and video go over the same link
+        std::shared_ptr<CongestionController> congestionController = nullptr;
+        // Splits the controller's target between the encoders registered
+        // with it; sessions sharing a controller share this too
+        std::shared_ptr<core::BitrateAllocator> bitrateAllocator = nullptr;
+    };
+
+    // Sender side RTCP for one RTP stream. Keeps sent packets in an
+    // RtpPacketHistory and answers NACKs by sending the original packet
+    // again, sequence number unchanged, which the receiver's reorder buffer
+    // slots into its gap, at most once per round trip and queue delay.
+    // Sends sender reports and turns the receiver's reports into
+    // RtpFeedbackStats. Congestion control feedback is paired with the
+    // send times in the history and passed to the controller,
+    // whose target goes to the bitrate allocator from construction on.
+    //
+    // RTCP travels on the RTP socket (rtcp-mux). Not thread safe apart
+    // from GetStats: call OnPacketSent and Service from the sending thread.
+    class RtpSenderSession {
+    public:
+        RtpSenderSession(uint32_t ssrc, uint32_t clockRate, RtpSenderSessionOptions options = {});
+
+        // Records a packet handed to the socket, whether or not it fitted
+        // in the send buffer; a dropped one can still be recovered by NACK
+        void OnPacketSent(uint16_t sequenceNumber, uint32_t rtpTimestamp,
+            const IoSlice* slices, size_t count, uint64_t now);
+
+        // Reads the RTCP waiting on the socket, retransmits what it asks
+        // for and sends a sender report when one is due. The socket is the
+        // connected, non-blocking one the media goes out on.
+        void Service(Socket& socket, uint64_t now);
+
+        RtpFeedbackStats GetStats() const;
+
+    private:
+        void HandleRtcp(Socket& socket, const uint8_t* data, size_t size, uint64_t now);
+        void HandleArrivals(uint64_t now);
+        uint64_t ResendInterval() const;
+
+        uint32_t ssrc;
+        uint32_t clockRate;
+        RtpSenderSessionOptions options;
+        RtpPacketHistory history;
+        RtcpFeedback feedback;
+        uint8_t buffer[kRtcpMaxPacketSize];
+
+        bool hasSent;
+        uint32_t lastRtpTimestamp;
+        uint64_t lastSentAt;
+        uint32_t packetCount;
+        uint32_t octetCount;
+        uint64_t nextReportAt;
+
+        std::vector<PacketResult> packetResults;
+        bool hasReportTime;
+        uint64_t reportTime;                // Receiver's compact NTP time, extended past its wraparound
+
+        mutable std::mutex statsMutex;
+        RtpFeedbackStats stats;
+    };
+
+    struct RtpReceiverSessionOptions {
+        // How long packets behind a gap wait for a retransmission before the
+        // gap is given up on. Only streams that lose a packet wait at all.
+        // 0 sends no NACKs and passes packets on as they arrive.
+        std::chrono::milliseconds maxRecoveryDelay{ 200 };
+        int maxNackRetries = 3;
+        std::chrono::milliseconds reportInterval{ 1000 };
+        size_t reorderPackets = 512;        // Arena of reorderPackets * 1500 bytes
+        // Congestion control feedback for the sender's rate control,
+        // 0 sends none
+        std::chrono::milliseconds congestionFeedbackInterval{ 50 };
+    };
+
+    // Receiver side RTCP for one RTP stream, between the socket and a
+    // depayloader. Packets go in as they arrive and come out in sequence
+    // order. Gaps are NACKed right away, again after about a round trip,
+    // and held for at most maxRecoveryDelay. Receiver reports carry loss
+    // and jitter back to the sender, with LSR/DLSR for its RTT. Every
+    // congestionFeedbackInterval the arrival times of the packets since the
+    // previous one go back as RFC 8888 feedback.
+    //
+    // Held packets live in a fixed arena indexed by sequence number.
+    // Not thread safe apart from GetStats.
+    class RtpReceiverSession {
+    public:
+        RtpReceiverSession(uint32_t clockRate, RtpReceiverSessionOptions options = {});
+
+        // A whole RTP datagram of the stream, header already checked
+        void Insert(const RtpHeader& header, const uint8_t* packet, size_t size, uint64_t arrival);
+
+        // Next packet in sequence order once it is there or its
+        // predecessors were given up on. The pointer stays valid until the
+        // next Insert.
+        bool Pop(uint64_t now, const uint8_t*& packet, size_t& size);
+
+        // RTCP from the sender, for its sender reports
+        void OnRtcp(const uint8_t* data, size_t size, uint64_t arrival);
+
+        // Writes the receiver report, NACK and congestion feedback due now
+        // as one compound packet, returns its size or 0 when nothing is due
+        size_t BuildFeedback(uint8_t* out, size_t capacity, uint64_t now);
+
+        RtpSourceStats GetStats() const;
+
+    private:
+        struct Slot {
+            uint64_t arrival = 0;
+            uint32_t size = 0;
+            uint16_t sequenceNumber = 0;
+            bool isHeld = false;
+        };
+
+        struct ArrivalRecord {
+            uint64_t arrival = 0;
+            uint16_t sequenceNumber = 0;
+            bool isSet = false;
+        };
+
+        struct Missing {
+            uint16_t sequenceNumber;
+            uint64_t nextNackAt;
+            uint64_t lastNackAt;
+            int retries;
+        };
+
+        void Reset(uint16_t sequenceNumber);
+        void TrackArrival(const RtpHeader& header, uint64_t arrival);
+        void AddMissing(uint16_t first, uint16_t count, uint64_t now);
+        void RemoveMissing(uint16_t sequenceNumber, uint64_t now);
+        uint64_t NackRetryInterval() const;
+        void RecordArrival(uint16_t sequenceNumber, uint64_t arrival);
+        size_t WriteReport(uint8_t* out, size_t capacity, uint64_t now);
+        size_t WriteArrivals(uint8_t* out, size_t capacity, uint64_t now);
+
+        static constexpr size_t kSlotSize = 1500;
+        static constexpr size_t kMaxMissing = 256;
+        static constexpr size_t kArrivalLogSize = 1024;    // Power of two, above kRtcpMaxCongestionReports
+
+        uint32_t clockRate;
+        RtpReceiverSessionOptions options;
+        uint32_t ssrc;                      // Our own, for the reports
+        uint32_t mediaSsrc;
+
+        std::vector<uint8_t> arena;
+        std::vector<Slot> slots;
+        size_t mask;
+        size_t heldCount;
+        bool hasExpected;
+        uint16_t expected;                  // Next sequence number Pop hands out
+
+        // RFC 3550 A.1 and A.8
+        uint16_t maxSequence;
+        uint64_t extendedBase;
+        uint64_t extendedMax;
+        uint64_t receivedCount;
+        uint64_t expectedPrior;
+        uint64_t receivedPrior;
+        double lastTransit;
+        double jitter;                      // RTP clock units
+        uint8_t fractionLost;
+
+        uint64_t lastSenderReport;          // NTP time of the latest SR, 0 if none yet
+        uint64_t lastSenderReportArrival;
+        uint64_t nextReportAt;
+
+        std::vector<Missing> missing;       // Ascending by sequence number, capacity kMaxMissing
+        std::vector<uint16_t> nackList;
+        RtcpFeedback feedback;
+
+        // Arrivals not yet reported, [arrivalBegin, arrivalEnd)
+        std::vector<ArrivalRecord> arrivalLog;
+        std::vector<RtcpPacketArrival> arrivalReports;
+        bool hasArrivals;
+        uint16_t arrivalBegin;
+        uint16_t arrivalEnd;
+        uint64_t nextCongestionFeedbackAt;
+
+        double rttNanos;
+        mutable std::mutex statsMutex;
+        RtpSourceStats stats;
+    };
+}
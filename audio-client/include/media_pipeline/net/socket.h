@@ -0,0 +1,147 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+namespace media_pipeline::net {
+#ifdef _WIN32
+    using SocketHandle = uintptr_t;             // SOCKET, without pulling in WinSock2.h
+    constexpr SocketHandle kInvalidSocket = ~static_cast<SocketHandle>(0);
+#else
+    using SocketHandle = int;
+    constexpr SocketHandle kInvalidSocket = -1;
+#endif
+
+    // One buffer of a vectored send
+    struct IoSlice {
+        const void* data;
+        size_t size;
+    };
+
+    // Address of a datagram's sender, room for sockaddr_in or sockaddr_in6
+    struct SocketAddress {
+        alignas(8) uint8_t storage[28] = {};
+        uint32_t length = 0;
+    };
+
+    // IPv4 address:port for sends on an unconnected UDP socket
+    SocketAddress ResolveSocketAddress(const std::string& address, uint16_t port);
+
+    // One entry of a batched datagram send. With segmentSize set, data is
+    // a run of datagrams of that size for the same destination (the last
+    // may be shorter), which the kernel splits itself (UDP_SEGMENT, GSO).
+    struct OutgoingDatagram {
+        const void* data;
+        size_t size;
+        const SocketAddress* destination;   // nullptr on a connected socket
+        uint16_t segmentSize = 0;
+    };
+
+    // One receive slot of a batched datagram receive
+    struct Datagram {
+        uint8_t* data;
+        size_t capacity;
+        size_t size;            // Set by ReceiveBatch
+        SocketAddress source;   // Set by ReceiveBatch
+    };
+
+    // Winsock needs WSAStartup before any socket call; keep one of these
+    // alive for as long as sockets are used. Reference counted, no-op
+    // elsewhere.
+    class SocketRuntime {
+    public:
+        SocketRuntime();
+        ~SocketRuntime();
+        SocketRuntime(const SocketRuntime&) = delete;
+        SocketRuntime& operator=(const SocketRuntime&) = delete;
+    };
+
+    // Owns one socket handle. Errors throw std::runtime_error; a send or
+    // receive that would block on a non-blocking socket is not an error and
+    // is reported through the return value instead.
+    class Socket {
+    public:
+        Socket();
+        explicit Socket(SocketHandle handle);
+        ~Socket();
+        Socket(Socket&& other) noexcept;
+        Socket& operator=(Socket&& other) noexcept;
+        Socket(const Socket&) = delete;
+        Socket& operator=(const Socket&) = delete;
+
+        // Blocking connect, switch to non-blocking afterwards if wanted
+        static Socket ConnectTcp(const std::string& address, uint16_t port);
+        // Port 0 picks a free port, see LocalPort
+        static Socket ListenTcp(const std::string& address, uint16_t port, int backlog = 16);
+
+        // UDP socket bound to address:port, port 0 picks a free one
+        static Socket OpenUdp(const std::string& address = "0.0.0.0", uint16_t port = 0);
+
+        // Invalid socket when no connection is pending on a non-blocking listener
+        Socket Accept();
+
+        // Sets the default peer of a UDP socket, sends then need no address
+        // and datagrams from other peers are filtered out
+        void Connect(const std::string& address, uint16_t port);
+
+        void SetNonBlocking(bool enabled);
+        void SetNoDelay(bool enabled);
+        // Caps the bytes queued in the kernel but not yet sent (TCP_NOTSENT_LOWAT):
+        // sends beyond it would block, so data waits where the sender can
+        // still reorder or drop it. No-op where the option doesn't exist.
+        void SetUnsentLowWatermark(int bytes);
+        void SetSendBufferSize(int bytes);
+        int SendBufferSize() const;
+        void SetReceiveBufferSize(int bytes);
+        uint16_t LocalPort() const;
+
+        // Sends the slices in order with a single system call (sendmsg or
+        // WSASend). Returns the bytes sent, which may end inside any slice;
+        // 0 when a non-blocking socket is full.
+        size_t SendVectored(const IoSlice* slices, size_t count);
+        size_t Send(const void* data, size_t size);
+
+        // Bytes received, 0 when the peer closed, -1 when a non-blocking
+        // socket has nothing to read
+        ptrdiff_t Receive(void* buffer, size_t size);
+
+        // Datagram to an address taken from a received one, for replies on
+        // an unconnected UDP socket. 0 when a non-blocking socket is full.
+        size_t SendTo(const void* data, size_t size, const SocketAddress& address);
+        // Receive that also reports the sender
+        ptrdiff_t ReceiveFrom(void* buffer, size_t size, SocketAddress& source);
+
+        // Receives up to count datagrams with one recvmmsg on Linux (a loop
+        // elsewhere, which needs a non-blocking socket) and returns how many
+        // were waiting, possibly 0. Datagrams longer than their slot are
+        // truncated.
+        size_t ReceiveBatch(Datagram* datagrams, size_t count);
+
+        // Sends up to kMaxBatch datagrams with one sendmmsg on Linux (a loop
+        // elsewhere) and returns how many were dealt with; fewer than asked
+        // only when a non-blocking socket is full. A datagram the kernel
+        // refuses on its own (unreachable destination, too large) is
+        // skipped rather than failing the ones behind it, so when accepted
+        // is given, accepted[i] says whether datagram i actually went out.
+        size_t SendBatch(const OutgoingDatagram* datagrams, size_t count, bool* accepted = nullptr);
+        // Whether this kernel takes segmented OutgoingDatagrams (4.18 and
+        // later); it refuses them otherwise. Builds without UDP_SEGMENT
+        // split them into separate sends instead.
+        bool SupportsSegmentation() const;
+
+        void Close();
+        bool IsOpen() const { return handle != kInvalidSocket; }
+        SocketHandle Handle() const { return handle; }
+
+        // Most slices one SendVectored call takes (the IOV_MAX floor)
+        static constexpr size_t kMaxSlices = 64;
+        // Most datagrams one SendBatch call takes
+        static constexpr size_t kMaxBatch = 256;
+        // Most segments and bytes in one segmented OutgoingDatagram
+        static constexpr size_t kMaxSegments = 64;
+        static constexpr size_t kMaxSegmentedSize = 65000;
+
+    private:
+        SocketHandle handle;
+    };
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+#include "media_pipeline/net/socket.h"
+#include "media_pipeline/net/rtp.h"
+
+namespace media_pipeline::net {
+    struct UdpFanoutOptions {
+        size_t maxPackets = 64;             // Queued between flushes
+        size_t maxPacketSize = kRtpMaxPacketSize;
+        bool useSegmentation = true;        // UDP_SEGMENT where the socket supports it
+    };
+
+    struct UdpFanoutStats {
+        uint64_t packetsQueued = 0;
+        uint64_t datagramsSent = 0;         // One per packet and destination
+        uint64_t bytesSent = 0;
+        uint64_t datagramsDropped = 0;      // Socket full at flush time, or refused by the kernel
+        uint64_t sendCalls = 0;             // SendBatch calls, each one sendmmsg on Linux
+    };
+
+    // Sends every queued packet to every destination, for one sender fanned
+    // out to many listeners on one unconnected UDP socket.
+    //
+    // Packets are copied once, back to back, into an arena allocated up
+    // front and reused after every flush; the datagram list is kept across
+    // flushes too, so nothing is allocated per packet once it has grown to
+    // the fan-out. A flush hands the kernel up to Socket::kMaxBatch
+    // datagrams per sendmmsg, across destinations. When several packets
+    // are queued, each destination instead gets them as one segmented
+    // (GSO) datagram per run of equally sized packets, so a video frame
+    // costs one entry per listener rather than one per RTP packet.
+    //
+    // Datagrams a non-blocking socket has no room for are dropped, as live
+    // media would rather lose a packet than queue behind it. Not thread
+    // safe apart from GetStats.
+    class UdpFanout {
+    public:
+        explicit UdpFanout(UdpFanoutOptions options = {});
+
+        void AddDestination(const SocketAddress& destination);
+        void RemoveDestination(const SocketAddress& destination);
+        size_t DestinationCount() const { return destinations.size(); }
+
+        // Copies the packet into the arena. False when maxPackets are
+        // already queued or it is larger than maxPacketSize; flush first.
+        bool Queue(const IoSlice* slices, size_t count);
+        size_t QueuedPackets() const { return packets.size(); }
+
+        // Sends what's queued to every destination and empties the queue.
+        // Returns the datagrams sent.
+        size_t Flush(Socket& socket);
+
+        UdpFanoutStats GetStats() const;
+
+    private:
+        struct Packet {
+            size_t offset;
+            size_t size;
+        };
+
+        void BuildSegmented();
+        void BuildPerPacket();
+
+        UdpFanoutOptions options;
+        std::vector<uint8_t> arena;
+        size_t used;
+        std::vector<Packet> packets;
+        std::vector<SocketAddress> destinations;
+
+        std::vector<OutgoingDatagram> outgoing;
+        std::vector<uint16_t> outgoingSegments;     // Datagrams each outgoing entry stands for
+        bool checkedSegmentation;
+        bool canSegment;
+
+        mutable std::mutex statsMutex;
+        UdpFanoutStats stats;
+    };
+}
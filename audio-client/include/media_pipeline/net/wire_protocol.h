@@ -0,0 +1,280 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#include "media_pipeline/net/relay_protocol.h"
+
+namespace media_pipeline::net {
+    // Media frames as NetworkSink sends them, inside the relay framing so a
+    // relay forwards them untouched. Every field is fixed-layout little
+    // endian and read straight from the receive buffer:
+    //
+    //   0  u32 frame size, bytes after this field (the relay size prefix)
+    //   4  u8  version
+    //   5  u8  header size from offset 4, extensions included
+    //   6  u8  media type (WireMediaType)
+    //   7  u8  codec (WireCodec)
+    //   8  u16 stream id, one connection multiplexes any number of streams
+    //  10  u16 flags (WireFlag bits)
+    //  12  u32 sequence number, per stream, +1 per frame
+    //  16  u64 timestamp, nanoseconds on the sender's media clock
+    //  24  extensions: u8 id, u8 size, value; then the payload
+    //
+    // New fields only ever come as extensions, which readers skip when
+    // they don't know them. Changing the fixed header bumps the version,
+    // and frames of another version are rejected as invalid.
+    //
+    // A large frame may be split into fragments, so a sender can put other
+    // streams' frames in between. Each fragment is a frame of its own with
+    // the same header and a fragment extension; only the first carries the
+    // other extensions. WireFragmentAssembler puts them back together.
+    constexpr uint8_t kWireVersion = 1;
+    constexpr size_t kWireFixedHeaderSize = 20;        // Without the size prefix
+    constexpr size_t kWireHeaderSize = kRelayFrameHeaderSize + kWireFixedHeaderSize;
+    constexpr size_t kWireMaxExtensionsSize = 255 - kWireFixedHeaderSize;
+    constexpr size_t kWireMaxFrameSize = 1 << 24;
+
+    enum class WireMediaType : uint8_t {
+        Audio = 0,
+        Video = 1,
+        Data = 2
+    };
+
+    enum class WireCodec : uint8_t {
+        Unknown = 0,
+        Opus = 1,
+        Aac = 2,
+        Mp3 = 3,
+        PcmS16 = 4,
+        PcmF32 = 5,
+        Hevc = 16,
+        H264 = 17,
+        Vp8 = 18,
+        Vp9 = 19,
+        Theora = 20
+    };
+
+    enum WireFlag : uint16_t {
+        kWireKeyFrame = 1,
+        kWireEndOfStream = 2,          // Last frame of the stream, payload may be empty
+        kWireDtx = 4,                  // Discontinuous transmission, the payload only fills silence
+        kWireCodecConfig = 8           // Parameter sets or other decoder setup, not media
+    };
+
+    enum WireExtension : uint8_t {
+        kWireExtAudioFormat = 1,       // u32 sample rate, u8 channels
+        kWireExtVideoFormat = 2,       // u16 width, u16 height
+        kWireExtLayers = 3,            // u8 simulcast layer, u8 temporal layer
+        kWireExtFragment = 4           // u32 payload offset of this fragment, u32 payload size of the frame
+    };
+
+    struct WireHeader {
+        WireMediaType mediaType = WireMediaType::Audio;
+        WireCodec codec = WireCodec::Unknown;
+        uint16_t streamId = 0;
+        uint16_t flags = 0;
+        uint32_t sequence = 0;
+        uint64_t timestamp = 0;
+    };
+
+    // A parsed frame; the pointers point into the buffer it was parsed from
+    struct WireFrame {
+        WireHeader header;
+        const uint8_t* extensions = nullptr;
+        size_t extensionsSize = 0;
+        const uint8_t* payload = nullptr;
+        size_t payloadSize = 0;
+        size_t frameSize = 0;           // Bytes the frame took, size prefix included
+    };
+
+    enum class WireParseResult {
+        Ok,
+        NeedMore,                       // The frame isn't complete yet
+        Invalid                         // Not a frame of this version, or too large
+    };
+
+    inline void WriteWireU16(uint8_t* out, uint16_t value) {
+        out[0] = static_cast<uint8_t>(value);
+        out[1] = static_cast<uint8_t>(value >> 8);
+    }
+
+    inline uint16_t ReadWireU16(const uint8_t* data) {
+        return static_cast<uint16_t>(data[0] | (data[1] << 8));
+    }
+
+    inline void WriteWireU64(uint8_t* out, uint64_t value) {
+        WriteRelayU32(out, static_cast<uint32_t>(value));
+        WriteRelayU32(out + 4, static_cast<uint32_t>(value >> 32));
+    }
+
+    inline uint64_t ReadWireU64(const uint8_t* data) {
+        return static_cast<uint64_t>(ReadRelayU32(data)) | (static_cast<uint64_t>(ReadRelayU32(data + 4)) << 32);
+    }
+
+    // Writes the size prefix and the fixed header. extensionsSize bytes of
+    // extensions (WriteWireExtension) follow at out + kWireHeaderSize, then
+    // the payload. Returns kWireHeaderSize.
+    inline size_t WriteWireHeader(uint8_t* out, const WireHeader& header, size_t extensionsSize, size_t payloadSize) {
+        WriteRelayU32(out, static_cast<uint32_t>(kWireFixedHeaderSize + extensionsSize + payloadSize));
+        out[4] = kWireVersion;
+        out[5] = static_cast<uint8_t>(kWireFixedHeaderSize + extensionsSize);
+        out[6] = static_cast<uint8_t>(header.mediaType);
+        out[7] = static_cast<uint8_t>(header.codec);
+        WriteWireU16(out + 8, header.streamId);
+        WriteWireU16(out + 10, header.flags);
+        WriteRelayU32(out + 12, header.sequence);
+        WriteWireU64(out + 16, header.timestamp);
+        return kWireHeaderSize;
+    }
+
+    // Returns the bytes written, 2 + size
+    inline size_t WriteWireExtension(uint8_t* out, uint8_t id, const void* value, uint8_t size) {
+        out[0] = id;
+        out[1] = size;
+        std::memcpy(out + 2, value, size);
+        return 2 + static_cast<size_t>(size);
+    }
+
+    // Parses the frame at the start of data without copying anything. Only
+    // the framing is checked, the header checks folded into one branch;
+    // extensions are bounds checked as they are looked up, and unknown
+    // media types and codecs are left to the reader. Safe on any input.
+    inline WireParseResult ParseWireFrame(const uint8_t* data, size_t size, WireFrame& frame,
+        size_t maxFrameSize = kWireMaxFrameSize) {
+        if (size < kRelayFrameHeaderSize) return WireParseResult::NeedMore;
+        size_t length = ReadRelayU32(data);
+        if (length > maxFrameSize || length < kWireFixedHeaderSize) return WireParseResult::Invalid;
+        if (size - kRelayFrameHeaderSize < length) return WireParseResult::NeedMore;
+
+        const uint8_t* body = data + kRelayFrameHeaderSize;
+        size_t headerSize = body[1];
+        bool valid = (body[0] == kWireVersion) & (headerSize >= kWireFixedHeaderSize) & (headerSize <= length);
+        if (!valid) return WireParseResult::Invalid;
+
+        frame.header.mediaType = static_cast<WireMediaType>(body[2]);
+        frame.header.codec = static_cast<WireCodec>(body[3]);
+        frame.header.streamId = ReadWireU16(body + 4);
+        frame.header.flags = ReadWireU16(body + 6);
+        frame.header.sequence = ReadRelayU32(body + 8);
+        frame.header.timestamp = ReadWireU64(body + 12);
+        frame.extensions = body + kWireFixedHeaderSize;
+        frame.extensionsSize = headerSize - kWireFixedHeaderSize;
+        frame.payload = body + headerSize;
+        frame.payloadSize = length - headerSize;
+        frame.frameSize = kRelayFrameHeaderSize + length;
+        return WireParseResult::Ok;
+    }
+
+    // The first extension with this id. False when there is none, or the
+    // extensions run past their end before it.
+    inline bool FindWireExtension(const WireFrame& frame, uint8_t id, const uint8_t*& value, size_t& size) {
+        size_t offset = 0;
+        while (frame.extensionsSize - offset >= 2) {
+            size_t extensionSize = frame.extensions[offset + 1];
+            if (frame.extensionsSize - offset - 2 < extensionSize) return false;
+            if (frame.extensions[offset] == id) {
+                value = frame.extensions + offset + 2;
+                size = extensionSize;
+                return true;
+            }
+            offset += 2 + extensionSize;
+        }
+        return false;
+    }
+
+    constexpr size_t kWireFragmentExtensionSize = 2 + 8;
+
+    // Returns the bytes written, kWireFragmentExtensionSize
+    inline size_t WriteWireFragment(uint8_t* out, uint32_t offset, uint32_t frameSize) {
+        uint8_t value[8];
+        WriteRelayU32(value, offset);
+        WriteRelayU32(value + 4, frameSize);
+        return WriteWireExtension(out, kWireExtFragment, value, sizeof(value));
+    }
+
+    // False when the frame isn't a fragment
+    inline bool ReadWireFragment(const WireFrame& frame, uint32_t& offset, uint32_t& frameSize) {
+        const uint8_t* value;
+        size_t size;
+        if (!FindWireExtension(frame, kWireExtFragment, value, size) || size < 8) return false;
+        offset = ReadRelayU32(value);
+        frameSize = ReadRelayU32(value + 4);
+        return true;
+    }
+
+    // Reassembles one stream's fragmented frames. Fragments of a stream
+    // arrive in order on a connection, so each one either continues the
+    // frame in progress or starts a new one; anything else (a fragment lost
+    // to a relay dropping frames, joining mid-frame) discards the frame.
+    struct WireFragmentAssembler {
+        // True when frame holds a whole frame: the input itself when it
+        // isn't a fragment, otherwise the reassembled frame with the first
+        // fragment's extensions, valid until the next call
+        bool Add(const WireFrame& input, WireFrame& frame) {
+            uint32_t offset;
+            uint32_t frameSize;
+            if (!ReadWireFragment(input, offset, frameSize)) {
+                inProgress = false;
+                frame = input;
+                return true;
+            }
+
+            if (offset == 0) {
+                inProgress = frameSize <= kWireMaxFrameSize;
+                header = input.header;
+                extensions.assign(input.extensions, input.extensions + input.extensionsSize);
+                payload.clear();
+                payload.reserve(frameSize);
+            }
+            else if (!inProgress || input.header.sequence != header.sequence || offset != payload.size()) {
+                inProgress = false;
+                discarded++;
+                return false;
+            }
+            if (!inProgress || input.payloadSize > frameSize - offset) {
+                inProgress = false;
+                discarded++;
+                return false;
+            }
+            payload.insert(payload.end(), input.payload, input.payload + input.payloadSize);
+            if (payload.size() < frameSize) return false;
+
+            inProgress = false;
+            frame.header = header;
+            frame.extensions = extensions.data();
+            frame.extensionsSize = extensions.size();
+            frame.payload = payload.data();
+            frame.payloadSize = payload.size();
+            frame.frameSize = input.frameSize;
+            return true;
+        }
+
+        WireHeader header;
+        std::vector<uint8_t> extensions;
+        std::vector<uint8_t> payload;
+        bool inProgress = false;
+        uint64_t discarded = 0;         // Fragments thrown away
+    };
+
+    // Per-stream sequence tracking on the receiving side
+    struct WireStreamState {
+        bool hasSequence = false;
+        uint32_t expected = 0;
+        uint64_t lost = 0;
+        uint64_t received = 0;
+
+        // Returns the frames missing right before this one. A sequence
+        // number behind the expected one (a restarted sender) resyncs.
+        uint32_t Track(uint32_t sequence) {
+            uint32_t gap = hasSequence ? sequence - expected : 0;
+            if (gap >= 0x80000000u) gap = 0;
+            hasSequence = true;
+            expected = sequence + 1;
+            lost += gap;
+            received++;
+            return gap;
+        }
+    };
+}
@@ -1,15 +1,21 @@
 #pragma once
+#include <atomic>
+
 #include "opus/opus.h"
 
 #include "media_pipeline/core/interfaces/i_media_processor.h"
 #include "media_pipeline/core/interfaces/i_media_component.h"
+#include "media_pipeline/core/interfaces/i_bitrate_controllable.h"
 #include "media_pipeline/core/media_data.h"
 
 namespace media_pipeline::processors::audio {
 	using core::interfaces::IMediaProcessor;
+	using core::interfaces::IBitrateControllable;
 	using core::MediaData;
 
-	class OpusProcessor : public IMediaProcessor {
+	// Bitrate in kbps. SetTargetBitrate takes effect at the next packet;
+	// Opus switches rate between frames without a glitch.
+	class OpusProcessor : public IMediaProcessor, public IBitrateControllable {
 	public:
 		OpusProcessor(int bitrate = 128,
 			int inputSampleRate = 48000,
@@ -20,10 +26,14 @@ namespace media_pipeline::processors::audio {
 		void Stop() override;
 		MediaData ProcessMediaData(const MediaData& input) override;
 
+		void SetTargetBitrate(int kbps) override;
+		int GetTargetBitrate() const override;
+
 	private:
 		OpusEncoder* encoder;
 
 		int bitrate;
+		std::atomic<int> targetBitrate;
 		int inputSampleRate;
 		int channels;
 		int frameSize;
@@ -0,0 +1,17 @@
+#pragma once
+#include <cstdint>
+
+#include "media_pipeline/processors/video/pixel_format_kernels.h"
+
+namespace media_pipeline::processors::video::kernels {
+	// Width of the column blocks AccumulateRowBlockSad sums into
+	constexpr int kSadBlockWidth = 16;
+
+	// Adds the sum of absolute differences between rows a and b to one counter
+	// per kSadBlockWidth pixel column block. blockSums holds
+	// (width + kSadBlockWidth - 1) / kSadBlockWidth entries, the last block
+	// may be narrower. Calling it for every row of a block stripe gives
+	// per-block SADs.
+	void AccumulateRowBlockSad(const uint8_t* a, const uint8_t* b, int width,
+		uint32_t* blockSums, Isa isa);
+}
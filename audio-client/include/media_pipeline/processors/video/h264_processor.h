@@ -0,0 +1,64 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include <atomic>
+#include <vector>
+
+#include <x264.h>
+
+#include "media_pipeline/core/interfaces/i_media_processor.h"
+#include "media_pipeline/core/interfaces/i_media_component.h"
+#include "media_pipeline/core/interfaces/i_bitrate_controllable.h"
+#include "media_pipeline/core/media_data.h"
+
+namespace media_pipeline::processors::video {
+    using core::MediaData;
+    using core::VideoFormat;
+    using core::interfaces::IMediaProcessor;
+    using core::interfaces::IBitrateControllable;
+
+    struct H264Settings {
+        std::string preset = "veryfast";    // ultrafast for the lowest CPU use
+        std::string profile = "high";       // baseline for the oldest decoders
+        int bitrateKbps = 1500;
+        int vbvBufferMs = 500;              // Shorter buffer, smoother bitrate
+        int threads = 0;                    // 0 lets x264 decide
+        bool slicedThreads = true;          // Slices instead of frame threads, no added latency
+        bool intraRefresh = false;          // Rolling intra column instead of IDR frames
+        int keyframeInterval = 250;         // -1 for keyframes on request only
+    };
+
+    // H.264 encoder on libx264, tuned for zero latency. Like HevcProcessor the
+    // first call returns the parameter sets as H264_HEADERS instead of a frame;
+    // every later call returns one H264 frame. Both are Annex-B, which network
+    // sinks send as is and MkvMuxer rewrites to AVCC. When x264 holds a frame
+    // back (frame threads) ProcessMediaData returns an empty H264 packet and
+    // ProcessMediaDataMulti, which the pipeline uses, returns nothing.
+    //
+    // A raw input frame marked isKeyFrame becomes an IDR frame, or starts a new
+    // intra refresh cycle when intraRefresh is on.
+    //
+    // SetTargetBitrate moves the average bitrate and the VBV with it through
+    // x264_encoder_reconfig, between frames.
+    class H264Processor : public IMediaProcessor, public IBitrateControllable {
+    public:
+        H264Processor(H264Settings settings = {});
+        ~H264Processor();
+        void Start() override;
+        void Stop() override;
+        MediaData ProcessMediaData(const MediaData& input) override;
+        std::vector<MediaData> ProcessMediaDataMulti(const MediaData& input) override;
+
+        void SetTargetBitrate(int kbps) override;
+        int GetTargetBitrate() const override;
+
+    private:
+        void InitializeEncoder(const VideoFormat& format);
+        void SetRateControl(x264_param_t& param) const;
+
+        H264Settings settings;
+        std::atomic<int> targetBitrate;
+        bool isInitialized;
+        x264_t* encoder;
+    };
+}
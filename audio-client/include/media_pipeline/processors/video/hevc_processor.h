@@ -1,26 +1,52 @@
 #pragma once
+#include <atomic>
+
 #include <x265.h>
 
 #include "media_pipeline/core/interfaces/i_media_processor.h"
 #include "media_pipeline/core/interfaces/i_media_component.h"
+#include "media_pipeline/core/interfaces/i_bitrate_controllable.h"
 #include "media_pipeline/core/media_data.h"
 
 namespace media_pipeline::processors::video {
     using core::MediaData;
     using core::VideoFormat;
     using core::interfaces::IMediaProcessor;
+    using core::interfaces::IBitrateControllable;
 
-    class HevcProcessor : public IMediaProcessor {
+    // A raw input frame with isKeyFrame set is encoded as an IDR picture, which
+    // lets simulcast layers cut their GOPs on the same frame. keyframeInterval
+    // -1 disables automatic keyframes (and scene cuts) entirely.
+    //
+    // bitrateKbps 0 encodes at constant quality (CRF 23), for recording.
+    // Otherwise, or when SetTargetBitrate is called before the first frame
+    // (adding the encoder to a BitrateAllocator does), the encoder opens in
+    // average bitrate mode capped by a 500 ms VBV, and later targets are
+    // applied live through x265_encoder_reconfig. x265 can't enable the VBV
+    // on an open encoder and reopening it would change the parameter sets
+    // mid-stream, so targets that arrive after a CRF start are ignored.
+    class HevcProcessor : public IMediaProcessor, public IBitrateControllable {
     public:
-        HevcProcessor();
+        HevcProcessor(int keyframeInterval = 250, bool sceneCutDetection = true, int bitrateKbps = 0);
         ~HevcProcessor();
         void Start() override;
         void Stop() override;
         MediaData ProcessMediaData(const MediaData& input) override;
 
+        void SetTargetBitrate(int kbps) override;
+        int GetTargetBitrate() const override;
+
     private:
         void InitializeEncoder(const MediaData& firstFrame);
+        void OpenEncoder();
+        MediaData EncoderHeaders(const MediaData& input);
+        void SetRateControl(int kbps);
 
+        int keyframeInterval;
+        bool sceneCutDetection;
+        std::atomic<int> targetBitrate;
+        int appliedBitrate;             // 0 in CRF mode
+        bool ignoredTarget;             // Warned about a target after a CRF start
         bool isInitialized;
         x265_encoder* encoder;
         x265_param* param;
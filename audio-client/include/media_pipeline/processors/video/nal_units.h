@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace media_pipeline::processors::video::nal {
+	// One NAL unit inside a larger buffer, without its start code
+	struct NalUnit {
+		const uint8_t* data;
+		size_t size;
+	};
+
+	// H.264 nal_unit_type values the muxers care about
+	constexpr uint8_t kH264Sps = 7;
+	constexpr uint8_t kH264Pps = 8;
+
+	inline uint8_t H264Type(const NalUnit& unit) {
+		return unit.data[0] & 0x1F;
+	}
+
+	// HEVC nal_unit_type values the muxers care about
+	constexpr uint8_t kHevcVps = 32;
+	constexpr uint8_t kHevcSps = 33;
+	constexpr uint8_t kHevcPps = 34;
+
+	inline uint8_t HevcType(const NalUnit& unit) {
+		return (unit.data[0] >> 1) & 0x3F;
+	}
+
+	// Splits an Annex-B stream (00 00 01 or 00 00 00 01 start codes) into NAL units
+	std::vector<NalUnit> SplitAnnexB(const uint8_t* data, size_t size);
+
+	// Same, into a caller owned vector so per frame callers keep its capacity
+	void SplitAnnexB(const uint8_t* data, size_t size, std::vector<NalUnit>& units);
+
+	// Rewrites Annex-B as 4 byte big endian length prefixed NAL units (AVCC/HVCC
+	// sample format used by Matroska and MP4)
+	std::vector<uint8_t> AnnexBToLengthPrefixed(const uint8_t* data, size_t size);
+
+	// AVCDecoderConfigurationRecord (Matroska CodecPrivate for V_MPEG4/ISO/AVC)
+	// built from Annex-B SPS/PPS headers, with 4 byte NAL lengths
+	std::vector<uint8_t> BuildAvcDecoderConfig(const uint8_t* headers, size_t size);
+
+	// HEVCDecoderConfigurationRecord (hvcC, Matroska CodecPrivate for
+	// V_MPEGH/ISO/HEVC) built from Annex-B VPS/SPS/PPS headers
+	std::vector<uint8_t> BuildHevcDecoderConfig(const uint8_t* headers, size_t size);
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include "media_pipeline/core/interfaces/i_media_processor.h"
+#include "media_pipeline/core/interfaces/i_media_component.h"
+#include "media_pipeline/core/media_data.h"
+#include "media_pipeline/processors/video/pixel_format_kernels.h"
+
+namespace media_pipeline::processors::video {
+    using core::MediaData;
+    using core::VideoFormat;
+    using core::interfaces::IMediaProcessor;
+
+    // Converts raw camera frames (YUY2, UYVY, NV12, RGB24, BGR24) into the planar
+    // YUV420P the encoders expect. With halveResolution the conversion also does a
+    // 2:1 box downscale in the same pass.
+    class PixelFormatConverter : public IMediaProcessor {
+    public:
+        PixelFormatConverter(bool halveResolution = false);
+        void Start() override;
+        void Stop() override;
+        MediaData ProcessMediaData(const MediaData& input) override;
+
+    private:
+        int SourceStride(const VideoFormat& format) const;
+
+        bool halveResolution;
+        kernels::Isa isa;
+    };
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+
+#include "media_pipeline/core/video_frame.h"
+
+namespace media_pipeline::processors::video::kernels {
+	using core::I420View;
+
+	enum class Isa {
+		Scalar,
+		Sse2,
+		Ssse3,
+		Avx2,
+		Neon
+	};
+
+	// Best instruction set available on this machine
+	Isa SelectIsa();
+
+	// Full resolution conversions to planar I420. Source strides are in bytes and
+	// may include padding; dst.width/dst.height give the picture size.
+	void Yuy2ToI420(const uint8_t* src, int srcStride, const I420View& dst, Isa isa);
+	void UyvyToI420(const uint8_t* src, int srcStride, const I420View& dst, Isa isa);
+	void Nv12ToI420(const uint8_t* srcY, int srcStrideY,
+		const uint8_t* srcUV, int srcStrideUV,
+		const I420View& dst, Isa isa);
+	void Rgb24ToI420(const uint8_t* src, int srcStride, const I420View& dst, bool isBgr, Isa isa);
+
+	// Conversion fused with a 2:1 box downscale in both directions, so half size
+	// output never materializes the full size I420 frame. The source is
+	// converted a few rows at a time with the kernels above and each strip is
+	// halved straight away; chroma is the 2x2 average of the full size chroma.
+	// dst is the output size and srcWidth/srcHeight the source picture size.
+	void Yuy2ToI420Half(const uint8_t* src, int srcStride, int srcWidth, int srcHeight, const I420View& dst, Isa isa);
+	void UyvyToI420Half(const uint8_t* src, int srcStride, int srcWidth, int srcHeight, const I420View& dst, Isa isa);
+	void Nv12ToI420Half(const uint8_t* srcY, int srcStrideY,
+		const uint8_t* srcUV, int srcStrideUV,
+		int srcWidth, int srcHeight, const I420View& dst, Isa isa);
+	void Rgb24ToI420Half(const uint8_t* src, int srcStride, int srcWidth, int srcHeight,
+		const I420View& dst, bool isBgr, Isa isa);
+	void I420ToI420Half(const I420View& src, const I420View& dst, Isa isa);
+
+	// Plane by plane copy, used to drop row padding from I420 input
+	void I420ToI420Copy(const I420View& src, const I420View& dst);
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "media_pipeline/processors/video/pixel_format_kernels.h"
+
+namespace media_pipeline::processors::video::kernels {
+	enum class ScaleMode {
+		Box,		// Area average, best for integer and large downscales
+		Bilinear,
+		Bicubic		// Catmull-Rom
+	};
+
+	// Fixed point filter for one dimension. Output position i reads `taps`
+	// consecutive source samples starting at starts[i], with weights that sum
+	// to 1 << kFilterBits. Edge samples are folded into the window so no
+	// index ever leaves the source.
+	struct ScaleFilter {
+		static constexpr int kFilterBits = 14;
+
+		static constexpr int kPaddedTaps = 8;
+
+		int taps = 0;
+		std::vector<int> starts;
+		std::vector<int16_t> weights;
+
+		// Weights zero padded to kPaddedTaps per output for the SIMD horizontal
+		// pass, empty when the filter is wider than that
+		std::vector<int16_t> paddedWeights;
+	};
+
+	ScaleFilter BuildScaleFilter(int srcSize, int dstSize, ScaleMode mode);
+
+	// Scales output rows [rowBegin, rowEnd) of one plane. Each call is
+	// independent so slices of a plane can run on different threads.
+	void ScalePlaneRows(const uint8_t* src, int srcStride, int srcWidth,
+		uint8_t* dst, int dstStride, int dstWidth,
+		const ScaleFilter& horizontal, const ScaleFilter& vertical,
+		int rowBegin, int rowEnd, Isa isa);
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+
+#include "media_pipeline/core/interfaces/i_media_processor.h"
+#include "media_pipeline/core/interfaces/i_media_component.h"
+#include "media_pipeline/core/media_data.h"
+#include "media_pipeline/core/thread_pool.h"
+#include "media_pipeline/processors/video/video_scaler.h"
+
+namespace media_pipeline::processors::video {
+    using core::MediaData;
+    using core::ThreadPool;
+    using core::interfaces::IMediaProcessor;
+
+    // Encodes one YUV420P frame into several resolutions at once. The frame is
+    // scaled to every layer size, then each layer's encoder runs in parallel on
+    // the shared thread pool. All packets of a frame carry their layer index
+    // in MediaData::layerId (0 = first size passed in), and all but header
+    // packets carry the input timestamp.
+    //
+    // Keyframes are decided here rather than by the encoders: every
+    // keyframeInterval frames, or after RequestKeyFrame, all layers get a raw
+    // frame marked isKeyFrame so they switch GOPs on the same picture.
+    class SimulcastProcessor : public IMediaProcessor {
+    public:
+        // Builds the encoder for one layer. It must honour isKeyFrame on raw
+        // input and never insert keyframes on its own.
+        using EncoderFactory = std::function<std::shared_ptr<IMediaProcessor>(int layerId, const ScaledSize& size)>;
+
+        SimulcastProcessor(std::vector<ScaledSize> layerSizes,
+            int keyframeInterval = 120,
+            EncoderFactory encoderFactory = nullptr,
+            std::shared_ptr<ThreadPool> pool = nullptr,
+            ScaleMode scaleMode = ScaleMode::Bilinear);
+        void Start() override;
+        void Stop() override;
+
+        // Single output pipelines get the first layer only
+        MediaData ProcessMediaData(const MediaData& input) override;
+        std::vector<MediaData> ProcessMediaDataMulti(const MediaData& input) override;
+
+        // Forces an aligned keyframe on the next frame, e.g. when a receiver
+        // switches layers. Safe to call from any thread.
+        void RequestKeyFrame();
+
+        size_t LayerCount() const { return encoders.size(); }
+
+    private:
+        std::shared_ptr<ThreadPool> pool;
+        VideoScaler scaler;
+        std::vector<std::shared_ptr<IMediaProcessor>> encoders;
+        int keyframeInterval;
+        uint64_t frameIndex;
+        std::atomic<bool> keyFrameRequested;
+    };
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <vector>
+#include <atomic>
+#include <cstdint>
+
+#include "media_pipeline/core/interfaces/i_media_processor.h"
+#include "media_pipeline/core/interfaces/i_media_component.h"
+#include "media_pipeline/core/media_data.h"
+#include "media_pipeline/processors/video/pixel_format_kernels.h"
+
+namespace media_pipeline::processors::video {
+    using core::MediaData;
+    using core::VideoFormat;
+    using core::interfaces::IMediaProcessor;
+
+    struct StaticFrameStats {
+        uint64_t framesIn = 0;
+        uint64_t framesSkipped = 0;
+
+        double SkipRate() const {
+            return framesIn ? static_cast<double>(framesSkipped) / framesIn : 0.0;
+        }
+    };
+
+    // Drops raw frames that barely differ from the last frame let through, so
+    // static scenes don't pay for an encode every frame. The Y plane is split
+    // into 16x16 blocks and a frame counts as changed once any block's mean
+    // absolute difference exceeds changeThreshold, so a small moving cursor
+    // still gets through. rowStep > 1 only compares every rowStep-th row.
+    //
+    // A frame always passes after minRefreshFrames skipped ones, when it is
+    // marked isKeyFrame, or when the size changes. Compares YUV420P and NV12
+    // frames; any other format passes through unchecked, so put it after
+    // PixelFormatConverter for cameras that deliver packed YUV or RGB.
+    // Dropping needs the multi output path; ProcessMediaData alone can only
+    // pass frames through.
+    class StaticFrameDetector : public IMediaProcessor {
+    public:
+        StaticFrameDetector(double changeThreshold = 2.0, int minRefreshFrames = 30, int rowStep = 2);
+        void Start() override;
+        void Stop() override;
+        MediaData ProcessMediaData(const MediaData& input) override;
+        std::vector<MediaData> ProcessMediaDataMulti(const MediaData& input) override;
+
+        // Safe to call from any thread
+        StaticFrameStats GetStats() const;
+
+    private:
+        bool IsStatic(const MediaData& input);
+        void KeepReference(const MediaData& input);
+
+        double changeThreshold;
+        int minRefreshFrames;
+        int rowStep;
+        kernels::Isa isa;
+
+        std::vector<uint8_t> reference;     // Tightly packed Y plane of the last passed frame
+        int referenceWidth;
+        int referenceHeight;
+        int framesSinceRefresh;
+        std::vector<uint32_t> blockSums;
+
+        std::atomic<uint64_t> framesIn;
+        std::atomic<uint64_t> framesSkipped;
+    };
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <memory>
+#include <vector>
+
+#include "media_pipeline/core/interfaces/i_media_processor.h"
+#include "media_pipeline/core/interfaces/i_media_component.h"
+#include "media_pipeline/core/media_data.h"
+#include "media_pipeline/core/thread_pool.h"
+#include "media_pipeline/processors/video/scaler_kernels.h"
+
+namespace media_pipeline::processors::video {
+    using core::MediaData;
+    using core::ThreadPool;
+    using core::interfaces::IMediaProcessor;
+    using kernels::ScaleMode;
+
+    struct ScaledSize {
+        int width;
+        int height;
+    };
+
+    // Resizes YUV420P frames to one or more output sizes. Every plane of every
+    // output is cut into row slices that run in parallel on the thread pool.
+    // As a pipeline processor it scales to and emits the first output size
+    // only; ScaleAll returns every size from a single input frame (simulcast
+    // layers).
+    class VideoScaler : public IMediaProcessor {
+    public:
+        VideoScaler(std::vector<ScaledSize> outputSizes,
+            ScaleMode mode = ScaleMode::Bilinear,
+            std::shared_ptr<ThreadPool> pool = nullptr);
+        void Start() override;
+        void Stop() override;
+        MediaData ProcessMediaData(const MediaData& input) override;
+        std::vector<MediaData> ScaleAll(const MediaData& input);
+
+    private:
+        struct Layer {
+            ScaledSize size;
+            kernels::ScaleFilter lumaX;
+            kernels::ScaleFilter lumaY;
+            kernels::ScaleFilter chromaX;
+            kernels::ScaleFilter chromaY;
+        };
+
+        void PrepareFilters(int sourceWidth, int sourceHeight);
+        // The first layerCount output sizes
+        std::vector<MediaData> Scale(const MediaData& input, size_t layerCount);
+
+        static constexpr int kSliceRows = 32;
+
+        std::vector<Layer> layers;
+        ScaleMode mode;
+        std::shared_ptr<ThreadPool> pool;
+        kernels::Isa isa;
+        int filterWidth;
+        int filterHeight;
+    };
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <cstdint>
+#include <atomic>
+
+#include <vpx/vpx_encoder.h>
+
+#include "media_pipeline/core/interfaces/i_media_processor.h"
+#include "media_pipeline/core/interfaces/i_media_component.h"
+#include "media_pipeline/core/interfaces/i_bitrate_controllable.h"
+#include "media_pipeline/core/media_data.h"
+
+namespace media_pipeline::processors::video {
+    using core::MediaData;
+    using core::VideoFormat;
+    using core::interfaces::IMediaProcessor;
+    using core::interfaces::IBitrateControllable;
+
+    enum class VpxCodec {
+        VP8,
+        VP9
+    };
+
+    struct VpxSettings {
+        VpxCodec codec = VpxCodec::VP8;
+        int bitrateKbps = 800;
+        int cpuUsed = 8;                // Speed, VP8 accepts -16..16, VP9 realtime 5..9
+        int threads = 0;                // 0 uses every core
+        bool rowMultithreading = true;  // VP9 only
+        int tileColumnsLog2 = 2;        // VP9 only, capped by the encoder for small frames
+        bool errorResilient = true;     // Lets decoders recover from lost frames
+        int temporalLayers = 1;         // 1, 2 or 3
+        int keyframeInterval = 300;     // -1 for keyframes on request only
+    };
+
+    // Real-time VP8/VP9 encoder. Runs with the realtime deadline and no lag, so
+    // every input frame comes out as one packet carrying the input timestamp.
+    // There are no codec headers, the first output is already a keyframe.
+    //
+    // With temporal layers the usual 0-1 / 0-2-1-2 reference patterns are used
+    // and the layer of each packet is reported in temporalLayerId; dropping the
+    // highest layers halves the frame rate without breaking decoding.
+    //
+    // SetTargetBitrate reapplies the configuration with the new CBR target,
+    // the temporal layers keeping their shares of it.
+    class VpxProcessor : public IMediaProcessor, public IBitrateControllable {
+    public:
+        VpxProcessor(VpxSettings settings = {});
+        ~VpxProcessor();
+        void Start() override;
+        void Stop() override;
+        MediaData ProcessMediaData(const MediaData& input) override;
+
+        void SetTargetBitrate(int kbps) override;
+        int GetTargetBitrate() const override;
+
+    private:
+        void InitializeEncoder(const VideoFormat& format);
+        void ConfigureTemporalLayers(vpx_codec_enc_cfg_t& config);
+        vpx_enc_frame_flags_t TemporalLayerFlags(int& layerId) const;
+
+        VpxSettings settings;
+        std::atomic<int> targetBitrate;
+        vpx_codec_ctx_t codec;
+        vpx_codec_enc_cfg_t config;
+        bool isInitialized;
+        int64_t frameIndex;
+    };
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <string>
+#include <mutex>
+#include <cstdint>
+
+#include "media_pipeline/core/interfaces/i_media_sink.h"
+#include "media_pipeline/core/interfaces/i_media_component.h"
+#include "media_pipeline/core/media_data.h"
+#include "media_pipeline/net/socket.h"
+#include "media_pipeline/net/rtp.h"
+#include "media_pipeline/net/rtp_session.h"
+
+namespace media_pipeline::sinks::audio {
+	using core::interfaces::IMediaSink;
+	using core::MediaData;
+	using net::RtpSinkStats;
+
+	struct RtpOpusSinkOptions {
+		std::string address = "127.0.0.1";
+		uint16_t port = 5004;
+		uint8_t payloadType = 111;		// Dynamic, agreed out of band
+		uint32_t ssrc = 0;				// 0 picks a random one
+		int sendBufferBytes = 0;		// SO_SNDBUF, 0 keeps the system default
+		net::RtpSenderSessionOptions feedback{ 64 };	// A second of 20 ms packets in the history
+	};
+
+	// Sends OpusProcessor output as RTP over UDP (RFC 7587), one Opus packet
+	// per datagram, so a lost packet costs one frame instead of stalling
+	// everything behind it as on TCP.
+	//
+	// The RTP clock is always 48 kHz whatever the encoder's input rate. The
+	// marker bit is set on the first packet of the stream. The header is
+	// built in a preallocated buffer and sent together with the payload,
+	// straight out of the MediaData, by one vectored send: nothing is copied
+	// or allocated per packet. Sending happens on the calling thread; UDP
+	// sends don't wait for the peer.
+	//
+	// RTCP from the receiver is read on the same socket after every packet:
+	// NACKed packets are resent from the history and receiver reports end
+	// up in GetStats().feedback.
+	class RtpOpusSink : public IMediaSink {
+	public:
+		RtpOpusSink(RtpOpusSinkOptions options = {});
+		~RtpOpusSink();
+
+		void Start() override;
+		void Stop() override;
+		void ConsumeMediaData(const MediaData& data) override;
+
+		RtpSinkStats GetStats() const;
+		uint32_t Ssrc() const { return ssrc; }
+
+	private:
+		RtpOpusSinkOptions options;
+		net::SocketRuntime runtime;
+		net::Socket socket;
+
+		uint8_t header[net::kRtpHeaderSize];
+		uint32_t ssrc;
+		net::RtpSenderSession session;
+		uint16_t sequenceNumber;
+		uint32_t rtpTimestamp;
+		bool isFirstPacket;
+
+		mutable std::mutex statsMutex;
+		RtpSinkStats stats;
+	};
+}
@@ -1,28 +1,198 @@
 #pragma once
 #include <string>
-
-#include <WinSock2.h>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <exception>
+#include <cstdint>
 
 #include "media_pipeline/core/interfaces/i_media_sink.h"
 #include "media_pipeline/core/interfaces/i_media_component.h"
 #include "media_pipeline/core/media_data.h"
+#include "media_pipeline/net/socket.h"
+#include "media_pipeline/net/wire_protocol.h"
 
 namespace media_pipeline::sinks::general {
 	using core::interfaces::IMediaSink;
 	using core::MediaData;
 
+	enum class NetworkSchedule {
+		AudioFirst,				// Audio goes ahead of any video, video streams share the rest evenly
+		WeightedFair			// All streams share the bytes, audio with audioWeight times a video stream's share
+	};
+
+	struct NetworkSinkOptions {
+		std::string address = "127.0.0.1";
+		uint16_t port = 12345;
+		bool noDelay = true;					// TCP_NODELAY, packets leave as soon as they are queued
+		int sendBufferBytes = 0;				// SO_SNDBUF, 0 keeps the system default
+		size_t maxQueuedBytes = 4 << 20;		// Oldest unsent packets are dropped beyond this
+		std::chrono::milliseconds maxQueueDelay{ 500 };	// Unsent packets older than this are dropped, 0 never
+		uint32_t relayChannel = 0;				// Nonzero: joins this relay server channel as a publisher
+		bool legacyFraming = false;				// Bare size prefixed payloads, for receivers without wire_protocol.h
+		size_t maxFragmentBytes = 4096;			// Larger frames go out in fragments other streams can pass, 0 never splits
+		NetworkSchedule schedule = NetworkSchedule::AudioFirst;
+		uint32_t audioWeight = 4;
+		int unsentLowWatermark = 16 * 1024;		// Unsent bytes the kernel may hold (TCP_NOTSENT_LOWAT), 0 no limit
+	};
+
+	struct NetworkStreamStats {
+		uint16_t streamId = 0;
+		MediaData::Type type = MediaData::Type::Audio;
+		int layerId = 0;
+		uint64_t packetsSent = 0;			// Whole frames, however many fragments they took
+		uint64_t packetsDropped = 0;
+		size_t queuedPackets = 0;
+		size_t queuedBytes = 0;
+		double averageQueueDelayMs = 0.0;
+		double maxQueueDelayMs = 0.0;
+	};
+
+	struct NetworkSinkStats {
+		uint64_t bytesSent = 0;				// Headers included
+		uint64_t packetsSent = 0;
+		uint64_t packetsDropped = 0;
+		uint64_t bytesDropped = 0;
+		uint64_t sendStalls = 0;			// Times the socket buffer was full
+		uint64_t fragmentsSent = 0;
+		size_t queuedPackets = 0;
+		size_t queuedBytes = 0;
+		double averageQueueDelayMs = 0.0;	// From ConsumeMediaData until the last byte went out
+		double maxQueueDelayMs = 0.0;
+		std::vector<NetworkStreamStats> streams;	// By stream id
+	};
+
+	// Streams media frames over TCP in the wire_protocol.h format: every
+	// packet carries its stream id, media type, codec, per-stream sequence
+	// number, timestamp and keyframe/DTX/config flags. Audio and video, and
+	// each simulcast layer, get a stream of their own on first sight, so
+	// one connection carries all of them. Format extensions go with a
+	// stream's first frame, every keyframe and any format change; end of
+	// stream is sent as an empty frame per stream. Opus payloads go out
+	// without OpusProcessor's frame count prefix, as bare Opus packets.
+	//
+	// ConsumeMediaData only queues, each stream in a queue of its own. A
+	// sender thread picks packets across the queues and writes header and
+	// payload of as many as the socket takes with one vectored send on a
+	// non-blocking socket, waiting for writability (epoll on Linux) when it
+	// is full. The pick is by priority, then deficit round robin in bytes
+	// within a priority: with AudioFirst an audio packet waits for at most
+	// the one fragment being sent, not for a keyframe queued ahead of it.
+	// Frames above maxFragmentBytes are split so there is a point to pass
+	// them at. What the kernel holds unsent is out of reach of the
+	// scheduler, hence the low watermark.
+	//
+	// The queues are bounded in bytes and age. Live media that can't be sent
+	// in time is worth less than the media behind it, so when either bound is
+	// exceeded the oldest frames that haven't started sending are dropped,
+	// video before audio with AudioFirst. A frame that has started is always
+	// finished, the stream never tears.
+	//
+	// With relayChannel set, the first message is a relay join (see
+	// relay_protocol.h), so the same stream can feed a relay server.
+	//
+	// Errors from the sender thread are rethrown by the next call.
 	class NetworkSink : public IMediaSink {
 	public:
-		NetworkSink(const std::string& address, USHORT port);
+		NetworkSink(const std::string& address = "127.0.0.1", uint16_t port = 12345);
+		NetworkSink(NetworkSinkOptions options);
 		~NetworkSink();
 
 		void Start() override;
 		void Stop() override;
 		void ConsumeMediaData(const MediaData& data) override;
 
+		// Safe to call from any thread
+		NetworkSinkStats GetStats() const;
+
 	private:
-		SOCKET sock;
-		USHORT serverPort;
-		std::string serverAddress;
+		// One wire frame: a whole media frame or a fragment of one
+		struct OutboundPacket {
+			uint8_t header[net::kWireHeaderSize + net::kWireMaxExtensionsSize];
+			size_t headerSize = 0;
+			std::vector<uint8_t> payload;
+			std::chrono::steady_clock::time_point queuedAt;		// Of the media frame
+			bool startsFrame = true;
+			bool endsFrame = true;
+
+			size_t Size() const { return headerSize + payload.size(); }
+		};
+
+		// Sender side of one stream
+		struct SendQueue {
+			std::deque<OutboundPacket> packets;
+			MediaData::Type type;
+			int layerId;
+			int priority;			// 0 goes first
+			size_t quantum;			// Bytes per round robin turn
+			size_t deficit;
+			size_t queuedBytes;
+			size_t queuedFrames;
+			uint64_t packetsSent;
+			uint64_t packetsDropped;
+			double totalQueueDelayMs;
+			double maxQueueDelayMs;
+		};
+
+		struct ScheduleCursor {
+			size_t next;			// Packets of the queue already picked
+			size_t deficit;
+		};
+
+		static constexpr int kPriorities = 2;
+
+		struct StreamState {
+			MediaData::Type type;
+			int layerId;
+			uint16_t id;
+			uint32_t sequence;
+			int formatA;			// Sample rate or width of the last format extension
+			int formatB;			// Channels or height
+		};
+
+		StreamState& FindStream(const MediaData& data);
+		void BuildPackets(const MediaData& data, StreamState& stream, std::vector<OutboundPacket>& packets);
+		void BuildEndOfStream(StreamState& stream, OutboundPacket& packet);
+		void Enqueue(const StreamState& stream, std::vector<OutboundPacket>& packets);
+		void SenderLoop();
+		bool SendQueued();
+		int NextStream(std::vector<ScheduleCursor>& cursors, size_t* roundRobin) const;
+		void ResetCursors(std::vector<ScheduleCursor>& cursors) const;
+		void CompleteFront(size_t stream, std::chrono::steady_clock::time_point now);
+		size_t FirstDroppable(size_t stream) const;
+		void DropFrame(size_t stream, size_t index);
+		bool DropOldest(size_t keepStream, size_t keepFrom);
+		void DropStale(std::chrono::steady_clock::time_point now);
+		void ThrowIfFailed();
+
+		NetworkSinkOptions options;
+		std::vector<StreamState> streams;		// Producer side only
+		std::vector<OutboundPacket> building;	// Producer side only, reused
+		net::SocketRuntime runtime;
+		net::Socket socket;
+
+		std::thread senderThread;
+		mutable std::mutex mutex;
+		std::condition_variable cv;
+		std::vector<SendQueue> queues;		// By stream id
+		size_t queuedBytes;
+		int currentStream;			// Stream whose front packet is partly sent, -1 none
+		size_t frontOffset;			// Bytes of that packet already sent
+		size_t roundRobin[kPriorities];
+		std::vector<ScheduleCursor> planCursors;	// Sender thread scratch
+		bool isStopping;
+		std::exception_ptr error;
+
+		uint64_t bytesSent;
+		uint64_t packetsSent;
+		uint64_t packetsDropped;
+		uint64_t bytesDropped;
+		uint64_t sendStalls;
+		uint64_t fragmentsSent;
+		double totalQueueDelayMs;
+		double maxQueueDelayMs;
 	};
 }
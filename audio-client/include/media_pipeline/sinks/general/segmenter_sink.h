@@ -0,0 +1,103 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <fstream>
+#include <chrono>
+#include <cstdint>
+
+#include "media_pipeline/core/interfaces/i_media_sink.h"
+#include "media_pipeline/core/interfaces/i_media_component.h"
+#include "media_pipeline/core/media_data.h"
+
+namespace media_pipeline::sinks::general {
+	using core::interfaces::IMediaSink;
+	using core::MediaData;
+
+	struct SegmenterOptions {
+		std::string directory = "stream";
+		std::string baseName = "stream";
+		double targetDuration = 4.0;	// Seconds, segments are cut at the next keyframe after this
+		size_t windowSize = 6;			// Segments listed in the manifests, 0 keeps every segment
+		size_t expiredSegmentGrace = 2;	// Segments kept on disk after leaving the window, for slow clients
+		bool writeHls = true;			// fMP4 only
+		bool writeDash = true;
+	};
+
+	// Turns the chunk stream of Fmp4Muxer or LiveMkvMuxer into numbered
+	// segments and HLS/DASH manifests in a directory, for a plain static file
+	// server. The first chunk must be the init segment. A new segment starts
+	// at the first keyframe chunk once the current one reaches the target
+	// duration (any cluster start for audio only WebM).
+	//
+	// Segments are written under a temporary name and renamed when complete,
+	// manifests are written to a temporary file and renamed over the old one,
+	// so readers never see partial files. All file work happens on a
+	// background thread; ConsumeMediaData only queues. Errors from that
+	// thread are rethrown by the next call.
+	class SegmenterSink : public IMediaSink {
+	public:
+		SegmenterSink(SegmenterOptions options = {});
+		~SegmenterSink();
+		void Start() override;
+		void Stop() override;
+		void ConsumeMediaData(const MediaData& data) override;
+
+	private:
+		struct Job {
+			enum class Kind { Init, Append, Close, Finish } kind;
+			std::vector<uint8_t> data;
+			uint64_t index = 0;
+			double start = 0.0;		// Seconds, stream time of the segment's first chunk
+			double duration = 0.0;
+		};
+
+		struct Segment {
+			uint64_t index;
+			double start;
+			double duration;
+			uint64_t bytes;
+		};
+
+		void Enqueue(Job job);
+		void IoLoop();
+		void RunJob(Job& job);
+		void WriteManifests(bool isFinal);
+		void WriteHls(bool isFinal);
+		void WriteDash(bool isFinal);
+		void ReplaceFile(const std::string& name, const std::string& contents);
+		std::string SegmentName(uint64_t index) const;
+		std::string PathFor(const std::string& name) const;
+		void ThrowIfFailed();
+
+		SegmenterOptions options;
+
+		// Producer side
+		bool hasInit;
+		bool hasVideo;
+		bool isWebm;
+		uint64_t segmentIndex;
+		uint64_t segmentStart;		// ns
+		uint64_t lastTimestamp;
+		uint64_t lastChunkGap;
+
+		std::thread ioThread;
+		std::mutex mutex;
+		std::condition_variable cv;
+		std::deque<Job> jobs;
+		bool isStopping;
+		std::exception_ptr error;
+
+		// I/O thread side
+		std::ofstream segmentFile;
+		std::deque<Segment> segments;
+		std::deque<uint64_t> expiredSegments;
+		std::string codecs;
+		std::chrono::system_clock::time_point availabilityStart;
+		double totalDuration;
+	};
+}
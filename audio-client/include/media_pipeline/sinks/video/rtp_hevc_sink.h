@@ -0,0 +1,70 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <mutex>
+#include <cstdint>
+
+#include "media_pipeline/core/interfaces/i_media_sink.h"
+#include "media_pipeline/core/interfaces/i_media_component.h"
+#include "media_pipeline/core/media_data.h"
+#include "media_pipeline/net/socket.h"
+#include "media_pipeline/net/rtp.h"
+#include "media_pipeline/net/rtp_hevc.h"
+#include "media_pipeline/net/rtp_session.h"
+
+namespace media_pipeline::sinks::video {
+	using core::interfaces::IMediaSink;
+	using core::MediaData;
+	using net::RtpSinkStats;
+
+	struct RtpHevcSinkOptions {
+		std::string address = "127.0.0.1";
+		uint16_t port = 5006;
+		uint8_t payloadType = 96;		// Dynamic, agreed out of band
+		uint32_t ssrc = 0;				// 0 picks a random one
+		int sendBufferBytes = 0;		// SO_SNDBUF, 0 keeps the system default
+		size_t maxPacketSize = net::kRtpMaxPacketSize;
+		net::RtpSenderSessionOptions feedback;
+	};
+
+	// Sends HevcProcessor output as RTP over UDP (RFC 7798) through
+	// HevcRtpPayloader. The VPS/SPS/PPS from the HEVC_HEADERS packet are
+	// repeated ahead of every key frame, in one aggregation packet, so a
+	// receiver joining late or recovering from loss can start decoding there.
+	//
+	// Timestamps are the frames' media clock times on the 90 kHz RTP clock.
+	// Each packet is one vectored send straight from the encoder output;
+	// packets the socket buffer can't take are dropped and counted, but
+	// still go into the retransmission history. RTCP from the receiver is
+	// read after every frame: NACKs are answered from the history and
+	// receiver reports end up in GetStats().feedback.
+	class RtpHevcSink : public IMediaSink {
+	public:
+		RtpHevcSink(RtpHevcSinkOptions options = {});
+		~RtpHevcSink();
+
+		void Start() override;
+		void Stop() override;
+		void ConsumeMediaData(const MediaData& data) override;
+
+		RtpSinkStats GetStats() const;
+		uint32_t Ssrc() const { return payloader.Ssrc(); }
+
+	private:
+		void SendPackets(uint32_t rtpTimestamp, uint64_t now);
+
+		RtpHevcSinkOptions options;
+		net::SocketRuntime runtime;
+		net::Socket socket;
+		net::HevcRtpPayloader payloader;
+		net::RtpSenderSession session;
+
+		std::vector<uint8_t> parameterSets;
+		uint32_t timestampOrigin;
+		bool hasFirstTimestamp;
+		uint64_t firstTimestamp;
+
+		mutable std::mutex statsMutex;
+		RtpSinkStats stats;
+	};
+}
@@ -1,16 +1,20 @@
 #pragma once
 #include <mutex>
+#include <array>
+#include <atomic>
 
 #include <portaudio.h>
 
 #include "media_pipeline/core/interfaces/i_media_source.h"
 #include "media_pipeline/core/interfaces/i_media_component.h"
 #include "media_pipeline/core/media_data.h"
+#include "media_pipeline/core/media_clock.h"
 
 namespace media_pipeline::sources::audio {
     using core::interfaces::IMediaSource;
     using core::MediaData;
     using core::AudioFormat;
+    using core::ClockDriftEstimator;
 
     class PortaudioSource : public IMediaSource {
     public:
@@ -23,6 +27,9 @@ namespace media_pipeline::sources::audio {
         void Start() override;
         void Stop() override;
         MediaData GetMediaData() override;
+
+        // Capture clock speed relative to the media clock
+        double ClockDriftPpm() const;
     private:
         const size_t preferredBufferFrames = 480;
 
@@ -34,6 +41,7 @@ namespace media_pipeline::sources::audio {
             PaStreamCallbackFlags statusFlags,
             void* userData);
 
+        void DrainCaptureObservations();
         void DumpDeviceInfo(const PaDeviceInfo* info);
         PaSampleFormat GetPaFormat(AudioFormat::SampleFormat format);
         void HandleFloat32Input(const float* inputBuffer, unsigned long framesPerBuffer);
@@ -49,6 +57,24 @@ namespace media_pipeline::sources::audio {
         size_t readPos;
         std::mutex bufferMutex;
 
+        // Sample counters are the device clock, mapped onto the media clock
+        // through callback capture times
+        uint64_t framesCaptured;
+        uint64_t framesRead;
+        ClockDriftEstimator captureClock;
+
+        // The callback only records capture times here, without locking or
+        // allocating; GetMediaData feeds them to captureClock. One writer,
+        // one reader, observations are dropped while the slots are full.
+        struct CaptureObservation {
+            int64_t deviceNanos;
+            int64_t mediaNanos;
+        };
+        static constexpr size_t kObservationSlots = 64;
+        std::array<CaptureObservation, kObservationSlots> observations;
+        std::atomic<size_t> observationsWritten;
+        std::atomic<size_t> observationsRead;
+
         // Audio input device settings
         unsigned int deviceSampleRate;
         unsigned int deviceChannels;
@@ -0,0 +1,97 @@
+#pragma once
+#include <string>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <memory>
+#include <cstdint>
+
+#include "media_pipeline/core/interfaces/i_media_source.h"
+#include "media_pipeline/core/interfaces/i_media_component.h"
+#include "media_pipeline/core/media_data.h"
+#include "media_pipeline/core/media_clock.h"
+#include "media_pipeline/net/socket.h"
+#include "media_pipeline/net/poller.h"
+#include "media_pipeline/net/rtp.h"
+#include "media_pipeline/net/rtp_session.h"
+
+namespace media_pipeline::sources::audio {
+	using core::interfaces::IMediaSource;
+	using core::MediaData;
+	using core::ClockDriftEstimator;
+	using net::RtpSourceStats;
+
+	struct RtpOpusSourceOptions {
+		std::string address = "0.0.0.0";
+		uint16_t port = 5004;
+		uint8_t payloadType = 111;
+		int sampleRate = 48000;			// Rate the frame count prefix is expressed in, as OpusProcessor writes it
+		int channels = 2;
+		int receiveBufferBytes = 0;		// SO_RCVBUF, 0 keeps the system default
+		// No waiting for retransmissions by default: Opus conceals a lost
+		// packet better than a stall would. Receiver reports are sent either way.
+		net::RtpReceiverSessionOptions feedback{ std::chrono::milliseconds(0), 3, std::chrono::milliseconds(1000), 64 };
+	};
+
+	// Receives RTP Opus (RFC 7587) and hands out packets in the format
+	// OpusProcessor produces, so the existing decoders and muxers take them
+	// unchanged. The first SSRC heard is locked onto.
+	//
+	// Datagrams are read in batches (recvmmsg on Linux) into a preallocated
+	// slot arena and go through an RtpReceiverSession, which puts them in
+	// sequence order and sends receiver reports, plus NACKs if
+	// feedback.maxRecoveryDelay allows waiting for retransmissions, back to
+	// the sender's address. A packet whose turn has passed is dropped, the
+	// decoder has already concealed it. Timestamps map the RTP clock onto
+	// the media clock through a drift estimator fed with arrival times, so
+	// network jitter stays out of them.
+	//
+	// GetMediaData waits up to a few milliseconds for a packet and returns
+	// empty MediaData when none came.
+	class RtpOpusSource : public IMediaSource {
+	public:
+		RtpOpusSource(RtpOpusSourceOptions options = {});
+		~RtpOpusSource();
+
+		void Start() override;
+		void Stop() override;
+		MediaData GetMediaData() override;
+
+		RtpSourceStats GetStats() const;
+		uint16_t LocalPort() const;
+
+	private:
+		void ReceivePending();
+		void HandlePacket(const net::Datagram& datagram, uint64_t arrival);
+		void DeliverPacket(const uint8_t* data, size_t size);
+		void SendFeedback(uint64_t now);
+
+		static constexpr size_t kBatchSize = 32;
+		static constexpr size_t kSlotSize = 1500;
+		static constexpr int kReceiveWaitMs = 5;
+
+		RtpOpusSourceOptions options;
+		net::SocketRuntime runtime;
+		net::Socket socket;
+		std::unique_ptr<net::Poller> poller;
+		std::vector<net::PollEvent> events;
+
+		std::vector<uint8_t> slotArena;
+		net::Datagram slots[kBatchSize];
+		std::deque<MediaData> ready;
+
+		net::RtpReceiverSession session;
+		net::SocketAddress senderAddress;
+		uint8_t feedbackBuffer[net::kRtcpMaxPacketSize];
+
+		bool hasSsrc;
+		uint32_t ssrc;
+		bool hasTimestamp;
+		uint64_t extendedTimestamp;		// RTP timestamp with wraparounds counted
+		uint32_t lastTimestamp;
+		ClockDriftEstimator senderClock;
+
+		mutable std::mutex statsMutex;
+		RtpSourceStats stats;			// Counters the session doesn't keep
+	};
+}
@@ -6,10 +6,12 @@
 #include "media_pipeline/core/interfaces/i_media_component.h"
 #include "media_pipeline/core/interfaces/i_media_source.h"
 #include "media_pipeline/core/media_data.h"
+#include "media_pipeline/core/media_clock.h"
 
 namespace media_pipeline::sources::audio {
 	using core::interfaces::IMediaSource;
 	using core::MediaData;
+	using core::ClockDriftEstimator;
 
 	class WasapiSource : public IMediaSource {
 	public:
@@ -19,6 +21,9 @@ namespace media_pipeline::sources::audio {
 		void Stop() override;
 		MediaData GetMediaData() override;
 
+		// Capture clock speed relative to the media clock
+		double ClockDriftPpm() const;
+
 	private:
 		bool Initialize();
 		void CleanupCOM();
@@ -33,5 +38,9 @@ namespace media_pipeline::sources::audio {
 		IAudioCaptureClient* pCaptureClient;
 
 		UINT32 bufferFrameSize;
+
+		// Device position is the device clock, QPC capture times place it on
+		// the media clock
+		ClockDriftEstimator captureClock;
 	};
 }
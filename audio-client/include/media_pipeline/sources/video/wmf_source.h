@@ -11,10 +11,13 @@
 #include "media_pipeline/core/interfaces/i_media_source.h"
 #include "media_pipeline/core/interfaces/i_media_component.h"
 #include "media_pipeline/core/media_data.h"
+#include "media_pipeline/core/media_clock.h"
 
 namespace media_pipeline::sources::video {
 	using core::interfaces::IMediaSource;
 	using core::MediaData;
+	using core::VideoFormat;
+	using core::ClockDriftEstimator;
 
 	class WmfSource : public IMediaSource {
 	public:
@@ -24,6 +27,9 @@ namespace media_pipeline::sources::video {
 		void Stop() override;
 		MediaData GetMediaData() override;
 
+		// Camera clock speed relative to the media clock
+		double ClockDriftPpm() const;
+
 	private:
 		IMFSourceReader* pReader;
 		bool isInitialized;
@@ -31,5 +37,10 @@ namespace media_pipeline::sources::video {
 		UINT32 height;
 		float frameRate;
 		GUID subtype;
+		VideoFormat::PixelFormat pixelFormat;
+		LONG stride;
+
+		// Sample times are on the camera clock, fitted against read times
+		ClockDriftEstimator captureClock;
 	};
 }
@@ -0,0 +1,115 @@
+#pragma once
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <deque>
+#include <vector>
+#include <optional>
+
+#include <media_pipeline/media_pipeline.h>
+
+#include "muxing/interfaces/i_muxer.h"
+#include "muxing/mp4_box_writer.h"
+
+using namespace media_pipeline;
+
+struct Fmp4Options {
+	// Media time per fragment in ns. 0 puts every frame in a fragment of
+	// its own (CMAF chunks for chunked transfer).
+	uint64_t fragmentDuration = 500000000ull;
+
+	// Cut a fragment before every video keyframe so segments can start there
+	bool fragmentAtKeyframes = true;
+};
+
+// Fragmented MP4 (CMAF) for low latency HLS/DASH. HEVC or H.264 video and
+// Opus or AAC audio; other codecs are dropped with a warning.
+//
+// The first chunk sent to the output sink is the init segment (ftyp, moov
+// with empty sample tables and mvex), also available from InitSegment().
+// Every further chunk is one moof/mdat fragment. A fragment with video is
+// typed as video with the format of its first frame, so isKeyFrame tells a
+// segmenter where a new segment may begin.
+//
+// The encoders run without B-frames (zerolatency), so decode order is
+// presentation order and no composition offsets are written. Timestamps
+// are nanoseconds; decode times are relative to the first packet.
+class Fmp4Muxer : public IMuxer {
+public:
+	Fmp4Muxer(std::shared_ptr<MediaQueue> mediaQueue, std::shared_ptr<IMediaSink> output, Fmp4Options options = {});
+	~Fmp4Muxer();
+	void Start() override;
+	void Stop() override;
+	void MuxerLoop() override;
+	void handleAudioData(const MediaData& data, const AudioFormat& format) override;
+	void handleVideoData(const MediaData& data, const VideoFormat& format) override;
+
+	// Empty until the tracks are known
+	std::vector<uint8_t> InitSegment() const;
+
+private:
+	struct Sample {
+		uint64_t decodeTime;		// Track timescale
+		uint32_t nominalDuration;	// Used for the last sample of a fragment
+		uint32_t size;
+		bool isSync;
+	};
+
+	struct Track {
+		uint32_t trackId = 0;		// 0 when the stream has no track
+		uint32_t timescale = 0;
+		std::vector<uint8_t> codecConfig;
+		std::vector<Sample> samples;
+		std::vector<uint8_t> sampleData;	// Payload of the track not written in place, appended to mdat last
+	};
+
+	void Mux(const MediaData& data);
+	void WriteInitSegment();
+	void WriteVideoTrack();
+	void WriteAudioTrack();
+	void AddSample(const MediaData& data);
+	bool WritesInPlace(const Track& track) const;
+	std::vector<uint8_t>& SamplePayload(Track& track);
+	void WriteFragment();
+	uint64_t RelativeTimestamp(const MediaData& data);
+
+	static constexpr uint32_t kVideoTimescale = 90000;
+	static constexpr uint32_t kOpusTimescale = 48000;
+	static constexpr size_t kMaxPendingPackets = 256;
+	static constexpr size_t kInitialFragmentHeader = 512;
+
+	std::shared_ptr<MediaQueue> mediaQueue;
+	std::shared_ptr<IMediaSink> output;
+	Fmp4Options options;
+	std::thread muxerThread;
+	std::atomic<bool> isRunning{ false };
+	bool headersSet;
+
+	std::optional<VideoFormat> videoFormat;
+	std::optional<AudioFormat> audioFormat;
+	bool droppedVideo;
+	bool droppedAudio;
+	Track video;
+	Track audio;
+
+	Mp4BoxWriter box;
+	// The next fragment chunk. Samples of the video track (the audio track
+	// without video) go straight into its mdat payload behind fragmentHeader
+	// bytes kept free for moof and the mdat header. WriteFragment fills them
+	// in, moving the payload only when the moof size changed since the last
+	// fragment, which is also the guess for the next one.
+	std::vector<uint8_t> fragment;
+	size_t fragmentHeader;
+	uint32_t sequenceNumber;
+	uint64_t fragmentStart;
+	// Formats of the first video and audio sample, the fragment chunk is typed after them
+	std::optional<VideoFormat> fragmentVideoFormat;
+	std::optional<AudioFormat> fragmentAudioFormat;
+
+	mutable std::mutex initSegmentMutex;
+	std::vector<uint8_t> initSegment;
+
+	std::deque<MediaData> pendingPackets;
+	std::optional<uint64_t> firstTimestamp;
+};
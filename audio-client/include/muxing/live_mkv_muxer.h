@@ -0,0 +1,89 @@
+#pragma once
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <deque>
+#include <vector>
+#include <optional>
+
+#include <ebml/MemIOCallback.h>
+#include <matroska/KaxTracks.h>
+#include <matroska/KaxCluster.h>
+
+#include <media_pipeline/media_pipeline.h>
+
+#include "muxing/interfaces/i_muxer.h"
+#include "muxing/mkv_tracks.h"
+
+using namespace media_pipeline;
+
+// Live Matroska/WebM for relays, pipes and sockets. Nothing is ever
+// rewritten: the Segment and Clusters have unknown sizes, blocks are
+// SimpleBlocks and there are no Cues or SeekHead, so the output can be
+// consumed while it is produced.
+//
+// Output goes to any byte sink as MediaData chunks, one per block, sent as
+// soon as the block is muxed. The first chunk is the initialization segment
+// (EBML header, Segment header, Info, Tracks with CodecPrivate), which
+// InitSegment() also returns for late joiners. When there is a video track
+// every Cluster, the first one included, opens with a video keyframe, so a
+// late joiner gets the init segment and then everything from the next chunk
+// where IsClusterStart() is true. Packets before the first keyframe are
+// dropped.
+//
+// DocType is "webm" when only VP8/VP9 and Opus are muxed, "matroska"
+// otherwise. Timestamps are nanoseconds, relative to the first packet.
+class LiveMkvMuxer : public IMuxer {
+public:
+	LiveMkvMuxer(std::shared_ptr<MediaQueue> mediaQueue, std::shared_ptr<IMediaSink> output);
+	~LiveMkvMuxer();
+	void Start() override;
+	void Stop() override;
+	void MuxerLoop() override;
+	void handleAudioData(const MediaData& data, const AudioFormat& format) override;
+	void handleVideoData(const MediaData& data, const VideoFormat& format) override;
+
+	// Empty until the tracks are known
+	std::vector<uint8_t> InitSegment() const;
+
+	// True for chunks that begin with a Cluster, where a late joiner can start
+	static bool IsClusterStart(const MediaData& chunk);
+
+private:
+	void Mux(const MediaData& data);
+	void WriteInitSegment();
+	void WritePacket(const MediaData& data);
+	void StartCluster(uint64_t timestamp);
+	void EmitChunk(const MediaData& source, uint64_t timestamp);
+	uint64_t RelativeTimestamp(const MediaData& data);
+
+	// Audio only streams have no keyframes to align to
+	static constexpr uint64_t kAudioClusterDuration = 1000000000ull;
+	// Block timestamps are 16-bit offsets from the cluster (32.7s at 1ms
+	// resolution). Video clusters can only be cut at a keyframe, so blocks
+	// further out than this are dropped until the next one arrives.
+	static constexpr uint64_t kMaxClusterDuration = 30000000000ull;
+	static constexpr size_t kMaxPendingPackets = 256;
+
+	std::shared_ptr<MediaQueue> mediaQueue;
+	std::shared_ptr<IMediaSink> output;
+	std::thread muxerThread;
+	std::atomic<bool> isRunning{ false };
+	bool headersSet;
+
+	MkvTrackSetup trackSetup;
+	std::unique_ptr<libmatroska::KaxTracks> tracks;
+	std::unique_ptr<libmatroska::KaxCluster> cluster;
+	uint64_t clusterTimestamp;
+
+	// Bytes rendered since the last chunk was emitted
+	libebml::MemIOCallback chunkBuffer;
+
+	mutable std::mutex initSegmentMutex;
+	std::vector<uint8_t> initSegment;
+
+	std::deque<MediaData> pendingPackets;
+	std::optional<uint64_t> firstTimestamp;
+	uint64_t timestampScale;
+};
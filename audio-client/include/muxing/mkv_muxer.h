@@ -1,13 +1,16 @@
 #pragma once
 #include <memory>
-#include <fstream>
 #include <atomic>
 #include <thread>
+#include <string>
+#include <deque>
+#include <vector>
+#include <optional>
 
 #include <ebml/EbmlHead.h>
 #include <ebml/EbmlStream.h>
 #include <ebml/EbmlVoid.h>
-#include <ebml/MemIOCallback.h>
+#include <ebml/StdIOCallback.h>
 #include <matroska/KaxSegment.h>
 #include <matroska/KaxTracks.h>
 #include <matroska/KaxCluster.h>
@@ -20,39 +23,64 @@
 #include <media_pipeline/media_pipeline.h>
 
 #include "muxing/interfaces/i_muxer.h"
+#include "muxing/mkv_tracks.h"
 
 using namespace media_pipeline;
 
+// Streams Matroska straight to disk. Clusters are written and freed as soon
+// as they are complete, so memory stays bounded by one cluster however long
+// the recording runs. Space for the SeekHead is reserved after the segment
+// header and filled in on Stop, together with the duration and segment size.
+//
+// Timestamps are nanoseconds, relative to the first packet. Tracks are
+// written once the first audio and video packets (or the video headers)
+// arrived; packets seen before that are held back.
 class MkvMuxer : public IMuxer {
 public:
-	MkvMuxer(std::shared_ptr<MediaQueue> mediaQueue);
+	MkvMuxer(std::shared_ptr<MediaQueue> mediaQueue, const std::string& filePath = "test.mkv");
 	~MkvMuxer();
 	void Start() override;
 	void Stop() override;
 	void MuxerLoop() override;
-	void handleAudioData(const MediaData& data, const AudioFormat& format);
-	void handleVideoData(const MediaData& data, const VideoFormat& format);
-	void handleAudioData(const MediaData& data, libmatroska::KaxCluster* cluster);
-	void handleVideoData(const MediaData& data, libmatroska::KaxCluster* cluster);
+	void handleAudioData(const MediaData& data, const AudioFormat& format) override;
+	void handleVideoData(const MediaData& data, const VideoFormat& format) override;
 
 private:
-	void InitializeMkvStructure();
-	void WriteEbmlHeader();
+	void WriteFileHeader();
+	void WriteTracks();
+	void Mux(const MediaData& data);
+	void WritePacket(const MediaData& data);
+	void StartCluster(uint64_t timestamp);
+	void FinishCluster();
 	void FinalizeMkvFile();
+	uint64_t RelativeTimestamp(const MediaData& data);
+
+	static constexpr uint64_t kMinClusterDuration = 1000000000ull;	// Clusters start at the next keyframe after 1s
+	static constexpr uint64_t kMaxClusterDuration = 5000000000ull;	// ... or unconditionally after 5s
+	static constexpr size_t kMaxPendingPackets = 256;
 
 	std::shared_ptr<MediaQueue> mediaQueue;
-	libebml::MemIOCallback outputFile;
+	std::string filePath;
+	std::unique_ptr<libebml::StdIOCallback> outputFile;
 	std::thread muxerThread;
 	std::atomic<bool> isRunning{ false };
-	std::atomic<bool> headersSet{ false };
+	bool headersSet;
 
-	libmatroska::KaxSegment* segment;
-	std::unique_ptr<libmatroska::KaxTrackEntry> videoTrack;
-	std::unique_ptr<libmatroska::KaxTrackEntry> audioTrack;
-	std::unique_ptr<libmatroska::KaxTracks> tracks;
+	std::unique_ptr<libmatroska::KaxSegment> segment;
+	libmatroska::KaxInfo* info;
+	libmatroska::KaxTracks* tracks;
+	libmatroska::KaxCues* cues;
+	std::unique_ptr<libmatroska::KaxSeekHead> seekHead;
+	std::unique_ptr<libebml::EbmlVoid> seekHeadSpace;
 
-	uint8_t videoTrackNumber;
-	uint8_t audioTrackNumber;
-	uint64_t timestampScale;
+	std::unique_ptr<libmatroska::KaxCluster> cluster;
+	std::vector<libmatroska::KaxSimpleBlock*> clusterKeyframes;
+	uint64_t clusterTimestamp;
+
+	MkvTrackSetup trackSetup;
+	std::deque<MediaData> pendingPackets;
+
+	std::optional<uint64_t> firstTimestamp;
 	uint64_t lastTimestamp;
+	uint64_t timestampScale;
 };
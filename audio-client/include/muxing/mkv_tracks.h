@@ -0,0 +1,50 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include <matroska/KaxTracks.h>
+
+#include <media_pipeline/media_pipeline.h>
+
+using namespace media_pipeline;
+
+// Codec setup for Matroska tracks, learned from the first packets of each
+// stream. Shared by MkvMuxer and LiveMkvMuxer.
+class MkvTrackSetup {
+public:
+	// Records the stream format until the tracks are added. Returns false
+	// for packets that only carry codec setup (parameter sets), which are
+	// not frames and must not be written as blocks.
+	bool Observe(const MediaData& data);
+
+	bool HasVideo() const { return videoFormat.has_value(); }
+	bool HasAudio() const { return audioFormat.has_value(); }
+	const std::optional<VideoFormat>& StreamVideoFormat() const { return videoFormat; }
+	const std::optional<AudioFormat>& StreamAudioFormat() const { return audioFormat; }
+
+	// True when every codec is allowed in WebM (VP8/VP9, Opus)
+	bool IsWebmCompatible() const;
+
+	// Adds a TrackEntry per stream seen so far, video first. Streams that
+	// show up later have no track and their packets are dropped.
+	void AddTracks(libmatroska::KaxTracks& tracks, uint64_t timestampScale);
+
+	libmatroska::KaxTrackEntry* VideoTrack() const { return videoTrack; }
+	libmatroska::KaxTrackEntry* AudioTrack() const { return audioTrack; }
+	libmatroska::KaxTrackEntry* TrackFor(const MediaData& data) const;
+
+private:
+	std::optional<VideoFormat> videoFormat;
+	std::optional<AudioFormat> audioFormat;
+	std::vector<uint8_t> videoCodecPrivate;
+	libmatroska::KaxTrackEntry* videoTrack = nullptr;
+	libmatroska::KaxTrackEntry* audioTrack = nullptr;
+	bool tracksAdded = false;
+};
+
+// Frame bytes as Matroska stores them: Opus without the frame count prefix,
+// H.264 and HEVC as length prefixed NAL units (converted into scratch). Size is 0
+// when there is nothing to write.
+std::pair<const uint8_t*, size_t> MkvFramePayload(const MediaData& data, std::vector<uint8_t>& scratch);
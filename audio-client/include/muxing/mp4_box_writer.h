@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Writes ISO BMFF boxes into one growing buffer. A box header goes out with
+// a placeholder size that EndBox patches in place, so nested boxes never
+// need buffers of their own. Reserve the expected total up front and a
+// whole fragment is assembled without reallocating.
+class Mp4BoxWriter {
+public:
+	void Reserve(size_t bytes) { buffer.reserve(bytes); }
+	void Clear() { buffer.clear(); }	// Keeps the capacity for the next fragment
+
+	// Both return the box start to hand to EndBox
+	size_t BeginBox(const char* type);
+	size_t BeginFullBox(const char* type, uint8_t version, uint32_t flags);
+	void EndBox(size_t boxStart);
+
+	void U8(uint8_t value) { buffer.push_back(value); }
+	void U16(uint16_t value);
+	void U24(uint32_t value);
+	void U32(uint32_t value);
+	void U64(uint64_t value);
+	void FourCc(const char* type);
+	void Zeros(size_t count);
+	void Bytes(const uint8_t* data, size_t size);
+	void Bytes(const std::vector<uint8_t>& data) { Bytes(data.data(), data.size()); }
+
+	// For fields only known later, like trun data offsets
+	void PatchU8(size_t position, uint8_t value) { buffer[position] = value; }
+	void PatchU32(size_t position, uint32_t value);
+
+	size_t Position() const { return buffer.size(); }
+	const std::vector<uint8_t>& Data() const { return buffer; }
+
+private:
+	std::vector<uint8_t> buffer;
+};
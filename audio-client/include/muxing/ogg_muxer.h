@@ -1,8 +1,8 @@
 #pragma once
 #include <memory>
 #include <thread>
-#include <fstream>
 #include <atomic>
+#include <string>
 
 #include <media_pipeline/media_pipeline.h>
 #include <ogg/ogg.h>
@@ -14,7 +14,7 @@ using namespace media_pipeline;
 
 class OggMuxer : public IMuxer {
 public:
-	OggMuxer(std::shared_ptr<MediaQueue> mediaQueue);
+	OggMuxer(std::shared_ptr<MediaQueue> mediaQueue, const std::string& filePath = "test.ogg");
 	~OggMuxer();
 	void Start() override;
 	void Stop() override;
@@ -25,11 +25,12 @@ public:
 private:
 	std::shared_ptr<MediaQueue> mediaQueue;
 	std::shared_ptr<std::ostream> output;
+	std::string filePath;
 	std::atomic<bool> isRunning{false};
 	std::thread muxerThread;
 
 	file_formats::OggFileFormat oggFormat;
-	std::ofstream outputFile;
+	AsyncFileWriter outputFile;
 
 	ogg_int64_t packetNo;
 	ogg_int64_t granulePos;
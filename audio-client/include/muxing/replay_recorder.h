@@ -0,0 +1,117 @@
+#pragma once
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <deque>
+#include <vector>
+#include <string>
+#include <variant>
+#include <exception>
+
+#include <media_pipeline/media_pipeline.h>
+
+using namespace media_pipeline;
+
+struct ReplayOptions {
+	uint64_t maxDuration = 60000000000ull;		// ns of media kept
+	size_t maxBytes = 256 * 1024 * 1024;		// Slab memory; the newest segment is always kept, even if larger
+	size_t slabSize = 4 * 1024 * 1024;			// Packets larger than a slab get one of their own
+
+	// Audio only streams have no keyframes, segments are cut every this many ns instead
+	uint64_t audioSegmentDuration = 1000000000ull;
+};
+
+enum class ReplayFormat {
+	Ogg,
+	Matroska
+};
+
+// Instant replay: a sink that keeps the last few seconds of encoded packets
+// in memory and writes them to a file on request, through the regular
+// muxers, without disturbing capture.
+//
+// Payloads are appended back to back into large slabs; each packet is a
+// small record pointing into one. The ring is segmented at video keyframes
+// (or at fixed intervals for audio only streams) and evicted a whole
+// segment at a time, so the buffer always begins where a decoder can start.
+// The latest parameter set packets are kept outside the ring and replayed
+// first.
+//
+// SaveReplay snapshots the records and shares the slabs they point into
+// with a background thread, so saving copies nothing up front and capture
+// carries on. The muxer pulls packets out of the snapshot one at a time,
+// so only the packet being written is ever copied. Slabs evicted while a
+// save runs stay alive until it finishes. Errors from the save thread are
+// rethrown by the next call.
+class ReplayRecorder : public IMediaSink {
+public:
+	ReplayRecorder(ReplayOptions options = {});
+	~ReplayRecorder();
+	void Start() override;
+	void Stop() override;
+	void ConsumeMediaData(const MediaData& data) override;
+
+	// Starts writing the buffered media to filePath. Returns false when a
+	// save is still running.
+	bool SaveReplay(const std::string& filePath, ReplayFormat format);
+	void WaitForSave();
+
+	uint64_t BufferedDuration() const;
+	size_t BufferedBytes() const;
+
+private:
+	struct Slab {
+		std::unique_ptr<uint8_t[]> data;
+		size_t capacity;
+		size_t used;
+	};
+
+	struct Packet {
+		uint64_t slab;			// Absolute slab number, slabs.front() is firstSlab
+		size_t offset;
+		size_t size;
+		uint64_t timestamp;
+		int layerId;
+		MediaData::Type type;
+		std::variant<AudioFormat, VideoFormat> format;
+	};
+
+	struct Snapshot {
+		std::vector<MediaData> parameterSets;
+		std::vector<Packet> packets;
+		std::deque<std::shared_ptr<Slab>> slabs;
+		uint64_t firstSlab;
+	};
+
+	// Muxer input that copies a packet out of the slabs only when popped
+	class SnapshotQueue;
+
+	static bool IsParameterSet(const MediaData& data);
+	void KeepParameterSet(const MediaData& data);
+	void Append(const MediaData& data, bool isSegmentStart);
+	void Evict();
+	std::shared_ptr<Slab> SlabFor(size_t size);
+	void SaveLoop(Snapshot snapshot, std::string filePath, ReplayFormat format);
+	void ThrowIfFailed();
+
+	ReplayOptions options;
+
+	mutable std::mutex mutex;
+	std::deque<std::shared_ptr<Slab>> slabs;
+	uint64_t firstSlab;
+	size_t slabBytes;
+	std::shared_ptr<Slab> spareSlab;		// Last evicted slab, reused instead of allocating
+
+	std::deque<Packet> packets;
+	uint64_t firstPacket;					// Absolute number of packets.front()
+	std::deque<uint64_t> segmentStarts;		// Absolute packet numbers
+	std::vector<MediaData> parameterSets;
+	bool hasVideo;
+	uint64_t lastTimestamp;
+	uint64_t lastSegmentTimestamp;
+
+	std::thread saveThread;
+	std::atomic<bool> isSaving{ false };
+	std::exception_ptr error;
+};
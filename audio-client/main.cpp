@@ -11,7 +11,10 @@ using namespace media_pipeline;
 
 int main() {
     try {
-        auto muxerQueue = std::make_shared<MediaQueue>();
+        // Audio and video are merged by timestamp before they reach the muxer
+        InterleavingOptions interleaving;
+        interleaving.expectedStreams = 2;
+        auto muxerQueue = std::make_shared<InterleavingQueue>(interleaving);
 
         auto audio_source = std::make_shared<sources::audio::PortaudioSource>(44100, 1);
         //audio_source->Start();
@@ -28,7 +31,15 @@ int main() {
         );
 
         auto video_source = std::make_shared<sources::video::WmfSource>();
-        auto video_processor = std::make_shared<processors::video::HevcProcessor>();
+        // Cameras that only offer packed formats are converted to YUV420P before
+        // encoding; the static frame check compares the converted luma plane
+        auto video_processor = std::make_shared<ProcessorChain>(
+            std::vector<std::shared_ptr<IMediaProcessor>>{
+                std::make_shared<processors::video::PixelFormatConverter>(),
+                std::make_shared<processors::video::StaticFrameDetector>(),
+                std::make_shared<processors::video::HevcProcessor>()
+            }
+        );
         auto video_sink = std::make_shared<sinks::general::MuxerSink>(muxerQueue);
         auto video_pipeline = std::make_shared<MediaPipeline>(
             video_source,
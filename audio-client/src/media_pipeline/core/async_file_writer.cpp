@@ -0,0 +1,430 @@
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+#ifdef MEDIA_PIPELINE_USE_IO_URING
+#include <liburing.h>
+#endif
+
+#include "media_pipeline/core/async_file_writer.h"
+#include "media_pipeline/core/logging.h"
+
+namespace media_pipeline::core {
+    namespace {
+        uint64_t ElapsedMicros(std::chrono::steady_clock::time_point start) {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count());
+        }
+
+        uint8_t* AllocateAligned(size_t size) {
+#ifdef _WIN32
+            void* block = _aligned_malloc(size, AsyncFileWriter::kBlockAlignment);
+#else
+            void* block = nullptr;
+            if (posix_memalign(&block, AsyncFileWriter::kBlockAlignment, size) != 0) block = nullptr;
+#endif
+            if (!block) throw std::bad_alloc();
+            return static_cast<uint8_t*>(block);
+        }
+    }
+
+#ifdef MEDIA_PIPELINE_USE_IO_URING
+    struct AsyncFileWriter::UringState {
+        io_uring ring;
+    };
+#else
+    struct AsyncFileWriter::UringState {};
+#endif
+
+    void AsyncFileWriter::AlignedDeleter::operator()(uint8_t* block) const {
+#ifdef _WIN32
+        _aligned_free(block);
+#else
+        std::free(block);
+#endif
+    }
+
+    AsyncFileWriter::AsyncFileWriter(AsyncFileWriterOptions options)
+        : options(options)
+#ifdef _WIN32
+        , handle(INVALID_HANDLE_VALUE)
+#else
+        , fd(-1)
+#endif
+        , current(-1)
+        , inFlight(0)
+        , isStopping(false)
+        , syncRequested(false)
+        , nextOffset(0)
+        , bytesWritten(0)
+        , writes(0)
+        , producerStalls(0)
+        , totalWriteMicros(0)
+        , maxWriteMicros(0) {
+        this->options.blockCount = std::max(2, options.blockCount);
+        this->options.blockSize = std::max<size_t>(kBlockAlignment,
+            (options.blockSize + kBlockAlignment - 1) / kBlockAlignment * kBlockAlignment);
+
+        blocks.resize(this->options.blockCount);
+        for (Block& block : blocks) {
+            block.data.reset(AllocateAligned(this->options.blockSize));
+        }
+    }
+
+    AsyncFileWriter::~AsyncFileWriter() {
+        try {
+            Close();
+        }
+        catch (const std::exception& e) {
+            MEDIA_LOG_ERROR("<AsyncFileWriter> Error closing: " << e.what());
+        }
+    }
+
+    void AsyncFileWriter::Open(const std::string& path) {
+        if (IsOpen()) {
+            throw std::runtime_error("AsyncFileWriter is already open");
+        }
+
+#ifdef _WIN32
+        handle = CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+            CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (handle == INVALID_HANDLE_VALUE) {
+            throw std::runtime_error("Failed to open output file " + path);
+        }
+        if (options.preallocateBytes > 0) {
+            // Reserves clusters, the end of file stays where it is
+            FILE_ALLOCATION_INFO allocation = {};
+            allocation.AllocationSize.QuadPart = static_cast<LONGLONG>(options.preallocateBytes);
+            SetFileInformationByHandle(handle, FileAllocationInfo, &allocation, sizeof(allocation));
+        }
+#else
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            throw std::runtime_error("Failed to open output file " + path);
+        }
+#ifdef __linux__
+        if (options.preallocateBytes > 0) {
+            // Best effort, not every filesystem supports it
+            fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(options.preallocateBytes));
+        }
+#endif
+#endif
+
+#ifdef MEDIA_PIPELINE_USE_IO_URING
+        uring = std::make_unique<UringState>();
+        if (io_uring_queue_init(static_cast<unsigned>(blocks.size()), &uring->ring, 0) < 0) {
+            uring.reset();  // Kernel without io_uring, fall back to pwrite
+        }
+#endif
+
+        pending.clear();
+        freeBlocks.clear();
+        for (int i = 0; i < static_cast<int>(blocks.size()); i++) {
+            blocks[i].used = 0;
+            freeBlocks.push_back(i);
+        }
+        current = -1;
+        inFlight = 0;
+        isStopping = false;
+        syncRequested = false;
+        error = nullptr;
+        nextOffset = 0;
+        lastSync = std::chrono::steady_clock::now();
+
+        writerThread = std::thread(&AsyncFileWriter::WriterLoop, this);
+    }
+
+    bool AsyncFileWriter::IsOpen() const {
+#ifdef _WIN32
+        return handle != INVALID_HANDLE_VALUE;
+#else
+        return fd >= 0;
+#endif
+    }
+
+    void AsyncFileWriter::Write(const void* data, size_t size) {
+        if (!IsOpen()) throw std::runtime_error("file not open");
+        ThrowIfFailed();
+
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        while (size > 0) {
+            if (current < 0) AcquireBlock();
+
+            Block& block = blocks[current];
+            size_t chunk = std::min(size, options.blockSize - block.used);
+            std::memcpy(block.data.get() + block.used, bytes, chunk);
+            block.used += chunk;
+            bytes += chunk;
+            size -= chunk;
+
+            if (block.used == options.blockSize) SubmitCurrent();
+        }
+    }
+
+    void AsyncFileWriter::Flush() {
+        if (!IsOpen()) return;
+        ThrowIfFailed();
+        SubmitCurrent();
+    }
+
+    void AsyncFileWriter::Sync() {
+        if (!IsOpen()) return;
+        SubmitCurrent();
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            syncRequested = true;
+            cv.notify_all();
+            cv.wait(lock, [this] { return !syncRequested; });
+        }
+        ThrowIfFailed();
+    }
+
+    void AsyncFileWriter::Close() {
+        if (!IsOpen()) return;
+
+        std::exception_ptr closeError;
+        try {
+            Sync();
+        }
+        catch (...) {
+            closeError = std::current_exception();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            isStopping = true;
+        }
+        cv.notify_all();
+        if (writerThread.joinable()) writerThread.join();
+
+#ifdef MEDIA_PIPELINE_USE_IO_URING
+        if (uring) {
+            io_uring_queue_exit(&uring->ring);
+            uring.reset();
+        }
+#endif
+#ifdef _WIN32
+        CloseHandle(handle);
+        handle = INVALID_HANDLE_VALUE;
+#else
+        ::close(fd);
+        fd = -1;
+#endif
+        if (closeError) std::rethrow_exception(closeError);
+    }
+
+    AsyncFileWriterStats AsyncFileWriter::GetStats() const {
+        AsyncFileWriterStats stats;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stats.queueDepth = pending.size() + inFlight;
+        }
+        stats.bytesWritten = bytesWritten.load();
+        stats.writes = writes.load();
+        stats.producerStalls = producerStalls.load();
+        stats.averageWriteMicros = stats.writes
+            ? static_cast<double>(totalWriteMicros.load()) / stats.writes
+            : 0.0;
+        stats.maxWriteMicros = static_cast<double>(maxWriteMicros.load());
+        return stats;
+    }
+
+    void AsyncFileWriter::AcquireBlock() {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (freeBlocks.empty()) {
+            // Every block is queued or being written, the disk is behind
+            producerStalls++;
+            cv.wait(lock, [this] { return !freeBlocks.empty(); });
+        }
+        current = freeBlocks.back();
+        freeBlocks.pop_back();
+        blocks[current].used = 0;
+    }
+
+    void AsyncFileWriter::SubmitCurrent() {
+        if (current < 0 || blocks[current].used == 0) return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            blocks[current].offset = nextOffset;
+            nextOffset += blocks[current].used;
+            pending.push_back(current);
+        }
+        current = -1;
+        cv.notify_all();
+    }
+
+    void AsyncFileWriter::ThrowIfFailed() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (error) std::rethrow_exception(error);
+    }
+
+    void AsyncFileWriter::WriterLoop() {
+        while (true) {
+            std::vector<int> batch;
+            bool doSync = false;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [this] { return isStopping || syncRequested || !pending.empty(); });
+                if (!pending.empty()) {
+                    batch.assign(pending.begin(), pending.end());
+                    pending.clear();
+                    inFlight = static_cast<int>(batch.size());
+                }
+                else if (syncRequested) {
+                    doSync = true;
+                }
+                else {
+                    return;
+                }
+            }
+
+            std::exception_ptr failure;
+            try {
+                if (doSync) {
+                    SyncFile();
+                }
+                else {
+                    WriteBlocks(batch);
+                    if (options.syncInterval.count() > 0 &&
+                        std::chrono::steady_clock::now() - lastSync >= options.syncInterval) {
+                        SyncFile();
+                    }
+                }
+            }
+            catch (...) {
+                failure = std::current_exception();
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (int index : batch) {
+                    blocks[index].used = 0;
+                    freeBlocks.push_back(index);
+                }
+                inFlight = 0;
+                if (doSync) syncRequested = false;
+                if (failure && !error) error = failure;
+            }
+            cv.notify_all();
+        }
+    }
+
+    void AsyncFileWriter::WriteBlocks(const std::vector<int>& indices) {
+        auto start = std::chrono::steady_clock::now();
+
+#ifdef MEDIA_PIPELINE_USE_IO_URING
+        if (uring) {
+            // All queued blocks go out in one submission
+            size_t queued = 0;
+            for (int index : indices) {
+                io_uring_sqe* sqe = io_uring_get_sqe(&uring->ring);
+                if (!sqe) break;
+                io_uring_prep_write(sqe, fd, blocks[index].data.get(),
+                    static_cast<unsigned>(blocks[index].used), blocks[index].offset);
+                io_uring_sqe_set_data(sqe, &blocks[index]);
+                queued++;
+            }
+            int submitted = queued > 0 ? io_uring_submit(&uring->ring) : 0;
+
+            std::vector<bool> isWritten(blocks.size(), false);
+            for (int i = 0; i < submitted; i++) {
+                io_uring_cqe* cqe;
+                if (io_uring_wait_cqe(&uring->ring, &cqe) < 0) {
+                    throw std::runtime_error("io_uring wait failed");
+                }
+                Block* block = static_cast<Block*>(io_uring_cqe_get_data(cqe));
+                int result = cqe->res;
+                io_uring_cqe_seen(&uring->ring, cqe);
+                if (result < 0) {
+                    throw std::runtime_error(std::string("Failed to write file: ") + std::strerror(-result));
+                }
+                // Short writes are rare, finish them synchronously
+                WriteRange(*block, static_cast<size_t>(result));
+                isWritten[block - blocks.data()] = true;
+                bytesWritten += block->used;
+            }
+
+            if (submitted < static_cast<int>(indices.size())) {
+                // Entries a failed or partial submit left in the ring would go
+                // out again with the next one, so the ring is dropped and the
+                // rest of the blocks, now and later, are written with pwrite
+                MEDIA_LOG_WARNING("<AsyncFileWriter> io_uring took " << std::max(submitted, 0) << " of "
+                    << indices.size() << " writes" << (submitted < 0 ? std::string(": ") + std::strerror(-submitted) : "")
+                    << ", falling back to pwrite");
+                io_uring_queue_exit(&uring->ring);
+                uring.reset();
+                for (int index : indices) {
+                    if (isWritten[index]) continue;
+                    WriteRange(blocks[index], 0);
+                    bytesWritten += blocks[index].used;
+                }
+            }
+        }
+        else
+#endif
+        {
+            for (int index : indices) {
+                WriteRange(blocks[index], 0);
+                bytesWritten += blocks[index].used;
+            }
+        }
+
+        uint64_t micros = ElapsedMicros(start);
+        writes += indices.size();
+        totalWriteMicros += micros * indices.size();
+        uint64_t previous = maxWriteMicros.load();
+        while (micros > previous && !maxWriteMicros.compare_exchange_weak(previous, micros)) {}
+    }
+
+    void AsyncFileWriter::WriteRange(const Block& block, size_t done) {
+        while (done < block.used) {
+#ifdef _WIN32
+            OVERLAPPED position = {};
+            uint64_t offset = block.offset + done;
+            position.Offset = static_cast<DWORD>(offset);
+            position.OffsetHigh = static_cast<DWORD>(offset >> 32);
+            DWORD written = 0;
+            if (!WriteFile(handle, block.data.get() + done,
+                static_cast<DWORD>(block.used - done), &written, &position) || written == 0) {
+                throw std::runtime_error("Failed to write file");
+            }
+#else
+            ssize_t written = pwrite(fd, block.data.get() + done, block.used - done,
+                static_cast<off_t>(block.offset + done));
+            if (written < 0 && errno == EINTR) continue;
+            if (written <= 0) {
+                throw std::runtime_error(std::string("Failed to write file: ") + std::strerror(errno));
+            }
+#endif
+            done += static_cast<size_t>(written);
+        }
+    }
+
+    void AsyncFileWriter::SyncFile() {
+#ifdef _WIN32
+        bool ok = FlushFileBuffers(handle) != 0;
+#elif defined(__APPLE__)
+        bool ok = fsync(fd) == 0;
+#else
+        bool ok = fdatasync(fd) == 0;
+#endif
+        lastSync = std::chrono::steady_clock::now();
+        if (!ok) {
+            throw std::runtime_error("Failed to sync file to disk");
+        }
+    }
+}
@@ -0,0 +1,67 @@
+#include <vector>
+#include <mutex>
+#include <algorithm>
+#include <cstdlib>
+
+#include "media_pipeline/core/bitrate_allocator.h"
+
+namespace media_pipeline::core {
+    namespace {
+        // Changes smaller than this, in percent, aren't passed on
+        constexpr int kMinChangePercent = 5;
+    }
+
+    void BitrateAllocator::AddStream(IBitrateControllable& stream, int minKbps, int maxKbps) {
+        std::lock_guard<std::mutex> lock(mutex);
+        streams.push_back({ &stream, minKbps, std::max(minKbps, maxKbps), 0, 0 });
+        Allocate();
+    }
+
+    void BitrateAllocator::RemoveStream(IBitrateControllable& stream) {
+        std::lock_guard<std::mutex> lock(mutex);
+        streams.erase(std::remove_if(streams.begin(), streams.end(),
+            [&stream](const Stream& entry) { return entry.encoder == &stream; }), streams.end());
+        if (totalKbps > 0) Allocate();
+    }
+
+    void BitrateAllocator::SetTotalBitrate(int kbps) {
+        std::lock_guard<std::mutex> lock(mutex);
+        totalKbps = kbps;
+        Allocate();
+    }
+
+    int BitrateAllocator::GetAllocation(const IBitrateControllable& stream) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const Stream& entry : streams) {
+            if (entry.encoder == &stream) return entry.allocatedKbps;
+        }
+        return 0;
+    }
+
+    void BitrateAllocator::Allocate() {
+        // Minimums are granted even when they add up to more than the total;
+        // below them the streams aren't worth sending
+        int remaining = totalKbps;
+        for (Stream& stream : streams) {
+            stream.allocatedKbps = stream.minKbps;
+            remaining -= stream.minKbps;
+        }
+        for (Stream& stream : streams) {
+            if (remaining <= 0) break;
+            int extra = std::min(remaining, stream.maxKbps - stream.minKbps);
+            stream.allocatedKbps += extra;
+            remaining -= extra;
+        }
+
+        for (Stream& stream : streams) {
+            int change = std::abs(stream.allocatedKbps - stream.appliedKbps);
+            bool isAtLimit = stream.allocatedKbps == stream.minKbps || stream.allocatedKbps == stream.maxKbps;
+            if (stream.appliedKbps != 0 && change * 100 <= stream.appliedKbps * kMinChangePercent
+                && !(isAtLimit && change > 0)) {
+                continue;
+            }
+            stream.appliedKbps = stream.allocatedKbps;
+            stream.encoder->SetTargetBitrate(stream.allocatedKbps);
+        }
+    }
+}
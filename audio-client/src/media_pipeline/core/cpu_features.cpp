@@ -0,0 +1,64 @@
+#include <cstdint>
+
+#include "media_pipeline/core/cpu_features.h"
+
+#if defined(MEDIA_PIPELINE_X86)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace media_pipeline::core::cpu {
+#if defined(MEDIA_PIPELINE_X86)
+	static void Cpuid(int leaf, int subleaf, uint32_t regs[4]) {
+#if defined(_MSC_VER)
+		int info[4];
+		__cpuidex(info, leaf, subleaf);
+		for (int i = 0; i < 4; i++) regs[i] = static_cast<uint32_t>(info[i]);
+#else
+		__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+	}
+
+	static uint64_t ReadXcr0() {
+#if defined(_MSC_VER)
+		return _xgetbv(0);
+#else
+		uint32_t eax, edx;
+		__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+		return (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+	}
+#endif
+
+	static Features Detect() {
+		Features features;
+#if defined(MEDIA_PIPELINE_X86)
+		uint32_t regs[4];
+		Cpuid(0, 0, regs);
+		uint32_t maxLeaf = regs[0];
+
+		Cpuid(1, 0, regs);
+		features.sse2 = (regs[3] & (1u << 26)) != 0;
+		features.ssse3 = (regs[2] & (1u << 9)) != 0;
+
+		// AVX2 needs the OS to save YMM state as well as the CPU bit
+		bool osxsave = (regs[2] & (1u << 27)) != 0;
+		bool ymmEnabled = osxsave && (ReadXcr0() & 0x6) == 0x6;
+		if (maxLeaf >= 7 && ymmEnabled) {
+			Cpuid(7, 0, regs);
+			features.avx2 = (regs[1] & (1u << 5)) != 0;
+		}
+#elif defined(MEDIA_PIPELINE_NEON)
+		features.neon = true;
+#endif
+		return features;
+	}
+
+	const Features& GetFeatures() {
+		static const Features features = Detect();
+		return features;
+	}
+}
@@ -0,0 +1,167 @@
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <queue>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <utility>
+
+#include "media_pipeline/core/interleaving_queue.h"
+#include "media_pipeline/core/media_queue.h"
+#include "media_pipeline/core/media_data.h"
+
+namespace media_pipeline::core {
+    namespace {
+        constexpr double kNanosPerMilli = 1e6;
+
+        bool IsParameterSets(const MediaData& data) {
+            if (data.type != MediaData::Type::Video) return false;
+            VideoFormat::PixelFormat format = data.getVideoFormat().format;
+            return format == VideoFormat::PixelFormat::HEVC_HEADERS ||
+                format == VideoFormat::PixelFormat::H264_HEADERS ||
+                format == VideoFormat::PixelFormat::THEORA_HEADERS;
+        }
+    }
+
+    InterleavingQueue::InterleavingQueue(InterleavingOptions options)
+        : options(options)
+        , queuedPackets(0)
+        , endOfStream(false)
+        , maxTimestampOut(0)
+        , distanceSumMs(0.0)
+        , distanceSamples(0) {
+    }
+
+    size_t InterleavingQueue::StreamIndex(const MediaData& data) {
+        std::pair<int, int> key(static_cast<int>(data.type), data.layerId);
+        auto found = streamIndices.find(key);
+        if (found != streamIndices.end()) return found->second;
+
+        streams.emplace_back();
+        streamIndices.emplace(key, streams.size() - 1);
+        return streams.size() - 1;
+    }
+
+    void InterleavingQueue::Push(MediaData data) {
+        {
+            std::lock_guard<std::mutex> lock(interleaveMutex);
+            if (data.isEndOfStream) {
+                endOfStream = true;
+            }
+            else if (IsParameterSets(data)) {
+                passThrough.push_back(std::move(data));
+            }
+            else {
+                size_t index = StreamIndex(data);
+                Stream& stream = streams[index];
+                if (stream.packets.empty()) {
+                    heads.emplace(data.timestamp, index);
+                }
+                stream.packets.push_back({ std::move(data), Clock::now() });
+                queuedPackets++;
+            }
+        }
+        interleaveCv.notify_one();
+    }
+
+    bool InterleavingQueue::ShouldWaitFor(Clock::time_point now, Clock::time_point& deadline) {
+        // Every stream has a packet, the heap top is safe to emit
+        if (heads.size() >= std::max(streams.size(), options.expectedStreams)) return false;
+
+        if (queuedPackets >= options.maxQueuedPackets) {
+            stats.forcedByWindow++;
+            return false;
+        }
+
+        uint64_t newest = 0;
+        Clock::time_point oldestArrival = now;
+        for (const Stream& stream : streams) {
+            if (stream.packets.empty()) continue;
+            newest = std::max(newest, stream.packets.back().data.timestamp);
+            oldestArrival = std::min(oldestArrival, stream.packets.front().arrival);
+        }
+        uint64_t oldest = heads.top().first;
+        if (newest > oldest && newest - oldest >= options.reorderWindow) {
+            stats.forcedByWindow++;
+            return false;
+        }
+
+        deadline = oldestArrival + options.maxWait;
+        if (now >= deadline) {
+            stats.forcedByWait++;
+            return false;
+        }
+        return true;
+    }
+
+    MediaData InterleavingQueue::Pop() {
+        std::unique_lock<std::mutex> lock(interleaveMutex);
+        while (true) {
+            if (!passThrough.empty()) {
+                MediaData data = std::move(passThrough.front());
+                passThrough.pop_front();
+                return data;
+            }
+
+            if (!heads.empty()) {
+                Clock::time_point deadline;
+                if (endOfStream || !ShouldWaitFor(Clock::now(), deadline)) {
+                    return PopOldest();
+                }
+                interleaveCv.wait_until(lock, deadline);
+                continue;
+            }
+
+            if (endOfStream) {
+                endOfStream = false;
+                MediaData data;
+                data.isEndOfStream = true;
+                return data;
+            }
+            interleaveCv.wait(lock);
+        }
+    }
+
+    MediaData InterleavingQueue::PopOldest() {
+        size_t index = heads.top().second;
+        heads.pop();
+
+        Stream& stream = streams[index];
+        MediaData data = std::move(stream.packets.front().data);
+        stream.packets.pop_front();
+        queuedPackets--;
+        if (!stream.packets.empty()) {
+            heads.emplace(stream.packets.front().data.timestamp, index);
+        }
+
+        // Distance to the latest packet of any other stream
+        uint64_t timestamp = data.timestamp;
+        for (size_t other = 0; other < streams.size(); other++) {
+            if (other == index || !streams[other].hasEmitted) continue;
+            uint64_t last = streams[other].lastEmitted;
+            double distanceMs = (timestamp > last ? timestamp - last : last - timestamp) / kNanosPerMilli;
+            distanceSumMs += distanceMs;
+            distanceSamples++;
+            stats.maxDistanceMs = std::max(stats.maxDistanceMs, distanceMs);
+        }
+        stream.hasEmitted = true;
+        stream.lastEmitted = timestamp;
+
+        if (stats.packetsOut > 0 && timestamp < maxTimestampOut) {
+            stats.latePackets++;
+        }
+        maxTimestampOut = std::max(maxTimestampOut, timestamp);
+        stats.packetsOut++;
+        return data;
+    }
+
+    InterleavingStats InterleavingQueue::GetStats() const {
+        std::lock_guard<std::mutex> lock(interleaveMutex);
+        InterleavingStats current = stats;
+        current.queuedPackets = queuedPackets;
+        current.averageDistanceMs = distanceSamples > 0 ? distanceSumMs / distanceSamples : 0.0;
+        return current;
+    }
+}
@@ -0,0 +1,101 @@
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+
+#include "media_pipeline/core/media_clock.h"
+
+namespace media_pipeline::core {
+    int64_t Rescale(int64_t value, TimeBase from, TimeBase to) {
+        int64_t numerator = from.num * to.den;
+        int64_t denominator = from.den * to.num;
+        if (numerator == denominator) return value;
+
+        bool negative = value < 0;
+        uint64_t magnitude = negative ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+        uint64_t n = static_cast<uint64_t>(numerator);
+        uint64_t d = static_cast<uint64_t>(denominator);
+
+        uint64_t whole = magnitude / d;
+        uint64_t remainder = magnitude % d;
+        uint64_t result = whole * n + (remainder * n + d / 2) / d;
+        return negative ? -static_cast<int64_t>(result) : static_cast<int64_t>(result);
+    }
+
+    uint64_t MediaClock::Now() {
+        static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count());
+    }
+
+    ClockDriftEstimator::ClockDriftEstimator(size_t windowSize)
+        : windowSize(windowSize < 2 ? 2 : windowSize)
+        , hasOrigin(false)
+        , deviceOrigin(0)
+        , mediaOrigin(0)
+        , rate(1.0)
+        , offset(0.0) {
+    }
+
+    void ClockDriftEstimator::AddObservation(int64_t deviceNanos, int64_t mediaNanos) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!hasOrigin) {
+            hasOrigin = true;
+            deviceOrigin = deviceNanos;
+            mediaOrigin = mediaNanos;
+        }
+
+        observations.push_back({ (deviceNanos - deviceOrigin) / 1e9, (mediaNanos - mediaOrigin) / 1e9 });
+        if (observations.size() > windowSize) {
+            observations.pop_front();
+        }
+        Fit();
+    }
+
+    void ClockDriftEstimator::Fit() {
+        double count = static_cast<double>(observations.size());
+        double meanDevice = 0.0;
+        double meanMedia = 0.0;
+        for (const Observation& observation : observations) {
+            meanDevice += observation.device;
+            meanMedia += observation.media;
+        }
+        meanDevice /= count;
+        meanMedia /= count;
+
+        double covariance = 0.0;
+        double variance = 0.0;
+        for (const Observation& observation : observations) {
+            double deviceDelta = observation.device - meanDevice;
+            covariance += deviceDelta * (observation.media - meanMedia);
+            variance += deviceDelta * deviceDelta;
+        }
+
+        double span = observations.back().device - observations.front().device;
+        double slope = 1.0;
+        if (span >= kMinFitSeconds && variance > 0.0) {
+            slope = covariance / variance;
+            if (std::abs(slope - 1.0) * 1e6 > kMaxDriftPpm) {
+                slope = 1.0;
+            }
+        }
+        rate = slope;
+        offset = meanMedia - slope * meanDevice;
+    }
+
+    int64_t ClockDriftEstimator::ToMediaClock(int64_t deviceNanos) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!hasOrigin) return deviceNanos;
+
+        double device = (deviceNanos - deviceOrigin) / 1e9;
+        double media = offset + rate * device;
+        return mediaOrigin + static_cast<int64_t>(std::llround(media * 1e9));
+    }
+
+    double ClockDriftEstimator::DriftPpm() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return (rate - 1.0) * 1e6;
+    }
+}
@@ -79,8 +79,9 @@ namespace media_pipeline::core {
                 processedQueue.Push(std::move(data));
                 break;
             }
-            MediaData processed = processor->ProcessMediaData(data);
-            processedQueue.Push(std::move(processed));
+            for (MediaData& processed : processor->ProcessMediaDataMulti(data)) {
+                processedQueue.Push(std::move(processed));
+            }
         }
     }
 
@@ -0,0 +1,54 @@
+#include <memory>
+#include <vector>
+#include <stdexcept>
+
+#include "media_pipeline/core/processor_chain.h"
+#include "media_pipeline/core/interfaces/i_media_processor.h"
+#include "media_pipeline/core/media_data.h"
+
+namespace media_pipeline::core {
+    using core::interfaces::IMediaProcessor;
+    using core::MediaData;
+
+    ProcessorChain::ProcessorChain(std::vector<std::shared_ptr<IMediaProcessor>> processors)
+        : processors(std::move(processors)) {
+        if (this->processors.empty()) {
+            throw std::runtime_error("ProcessorChain needs at least one processor");
+        }
+    }
+
+    void ProcessorChain::Start() {
+        for (auto& processor : processors) {
+            processor->Start();
+        }
+    }
+
+    void ProcessorChain::Stop() {
+        for (auto& processor : processors) {
+            processor->Stop();
+        }
+    }
+
+    MediaData ProcessorChain::ProcessMediaData(const MediaData& input) {
+        MediaData current = processors.front()->ProcessMediaData(input);
+        for (size_t i = 1; i < processors.size(); i++) {
+            current = processors[i]->ProcessMediaData(current);
+        }
+        return current;
+    }
+
+    std::vector<MediaData> ProcessorChain::ProcessMediaDataMulti(const MediaData& input) {
+        // Each stage may fan out, later stages run once per packet it produced
+        std::vector<MediaData> current = processors.front()->ProcessMediaDataMulti(input);
+        for (size_t i = 1; i < processors.size(); i++) {
+            std::vector<MediaData> next;
+            for (const MediaData& packet : current) {
+                for (MediaData& output : processors[i]->ProcessMediaDataMulti(packet)) {
+                    next.push_back(std::move(output));
+                }
+            }
+            current = std::move(next);
+        }
+        return current;
+    }
+}
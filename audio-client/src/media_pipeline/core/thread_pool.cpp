@@ -0,0 +1,104 @@
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <exception>
+
+#include "media_pipeline/core/thread_pool.h"
+
+namespace media_pipeline::core {
+    ThreadPool::ThreadPool(size_t threadCount)
+        : isStopping(false) {
+        if (threadCount == 0) {
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+        workers.reserve(threadCount);
+        for (size_t i = 0; i < threadCount; i++) {
+            workers.emplace_back(&ThreadPool::WorkerLoop, this);
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            isStopping = true;
+        }
+        cv.notify_all();
+        for (auto& worker : workers) {
+            if (worker.joinable()) worker.join();
+        }
+    }
+
+    void ThreadPool::Enqueue(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push(std::move(task));
+        }
+        cv.notify_one();
+    }
+
+    void ThreadPool::WorkerLoop() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [this] { return isStopping || !tasks.empty(); });
+                if (isStopping && tasks.empty()) return;
+                task = std::move(tasks.front());
+                tasks.pop();
+            }
+            task();
+        }
+    }
+
+    void ThreadPool::ParallelFor(int count, const std::function<void(int)>& body) {
+        if (count <= 0) return;
+        if (count == 1) {
+            body(0);
+            return;
+        }
+
+        // Shared between the caller and helpers, helpers may outlive this call
+        // if they are dequeued after all indices were claimed
+        struct State {
+            std::atomic<int> next{ 0 };
+            std::atomic<int> done{ 0 };
+            std::mutex mutex;
+            std::condition_variable cv;
+            std::exception_ptr error;
+        };
+        auto state = std::make_shared<State>();
+
+        auto runIndices = [state, &body, count]() {
+            int index;
+            while ((index = state->next.fetch_add(1)) < count) {
+                try {
+                    body(index);
+                }
+                catch (...) {
+                    // Keep the first failure, it is rethrown on the calling thread
+                    std::lock_guard<std::mutex> lock(state->mutex);
+                    if (!state->error) state->error = std::current_exception();
+                }
+                if (state->done.fetch_add(1) + 1 == count) {
+                    std::lock_guard<std::mutex> lock(state->mutex);
+                    state->cv.notify_all();
+                }
+            }
+        };
+
+        int helpers = std::min(static_cast<int>(workers.size()), count - 1);
+        for (int i = 0; i < helpers; i++) {
+            // Helpers only touch body while indices remain, which the caller waits for
+            Enqueue(runIndices);
+        }
+        runIndices();
+
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->cv.wait(lock, [&state, count] { return state->done.load() == count; });
+        if (state->error) std::rethrow_exception(state->error);
+    }
+}
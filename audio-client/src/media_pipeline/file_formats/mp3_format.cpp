@@ -1,14 +1,14 @@
-#include <fstream>
 #include <iostream>
 
 #include "media_pipeline/file_formats/mp3_format.h"
 #include "media_pipeline/core/interfaces/i_file_format.h"
 #include "media_pipeline/core/media_data.h"
+#include "media_pipeline/core/logging.h"
 
 namespace media_pipeline::file_formats {
     using core::MediaData;
 
-    void Mp3FileFormat::WriteHeader(std::ofstream& file) {
+    void Mp3FileFormat::WriteHeader(IByteWriter& file) {
         //const char id3Header[]{
         //    'I', 'D', '3',          // ID3 identifier
         //    0x03, 0x00,             // Version 2.3.0
@@ -19,15 +19,14 @@ namespace media_pipeline::file_formats {
         //file.write(id3Header, sizeof(id3Header));
     }
 
-    void Mp3FileFormat::WriteData(std::ofstream& file, const MediaData& data) {
-        std::cout << "Writing data " << data.data.size() << " to file" << std::endl;
+    void Mp3FileFormat::WriteData(IByteWriter& file, const MediaData& data) {
+        MEDIA_LOG_TRACE("Writing " << data.data.size() << " bytes of MP3 data");
 
-        if (!file.is_open()) throw std::runtime_error("MP3 file not open");
-        file.write(reinterpret_cast<const char*>(data.data.data()),
-            data.data.size());
+        if (!file.IsOpen()) throw std::runtime_error("MP3 file not open");
+        file.Write(data.data.data(), data.data.size());
     }
 
-    void Mp3FileFormat::Finalize(std::ofstream& file) {
+    void Mp3FileFormat::Finalize(IByteWriter& file) {
         // Not necessary for MP3 file
     }
 }
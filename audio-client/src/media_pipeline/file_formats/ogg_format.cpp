@@ -1,9 +1,12 @@
 #include <iostream>
 #include <stdexcept>
+#include <cstring>
 
 #include <ogg/ogg.h>
 
 #include "media_pipeline/file_formats/ogg_format.h"
+#include "media_pipeline/file_formats/ogg_page_writer.h"
+#include "media_pipeline/core/logging.h"
 #include "media_pipeline/core/interfaces/i_file_format.h"
 #include "media_pipeline/core/media_data.h"
 
@@ -11,8 +14,9 @@ namespace media_pipeline::file_formats {
     using core::VideoFormat;
     using core::MediaData;
 
-    OggFileFormat::OggFileFormat()
-        : audioPacketNo(0)
+    OggFileFormat::OggFileFormat(OggFlushPolicy flushPolicy)
+        : pageWriter(flushPolicy)
+        , audioPacketNo(0)
         , audioGranulePos(0)
         , videoPacketNo(0)
         , videoGranulePos(0)
@@ -37,54 +41,38 @@ namespace media_pipeline::file_formats {
         }
     }
 
-    void OggFileFormat::WriteOggPages(std::ofstream& file, ogg_stream_state& stream) {
+    void OggFileFormat::WriteOggPages(IByteWriter& file, ogg_stream_state& stream) {
+        // Only complete pages, libogg decides when one is full
         ogg_page oggPage;
-        int pageCount = 0;
         while (ogg_stream_pageout(&stream, &oggPage) > 0) {
-            //std::cout << "Writing page " << pageCount << ":" << std::endl;
-            //std::cout << "  Header size: " << oggPage.header_len << std::endl;
-            //std::cout << "  Body size: " << oggPage.body_len << std::endl;
-            //std::cout << "  Header: ";
-            //for (int i = 0; i < oggPage.header_len; i++) {
-            //    printf("%02x ", oggPage.header[i]);
-            //}
-            //std::cout << std::endl;
-            //std::cout << "  Body: ";
-            //for (int i = 0; i < oggPage.body_len; i++) {
-            //    printf("%02x ", oggPage.body[i]);
-            //}
-            //std::cout << std::endl;
-
-            file.write(reinterpret_cast<const char*>(oggPage.header),
-                oggPage.header_len);
-            file.write(reinterpret_cast<const char*>(oggPage.body),
-                oggPage.body_len);
-
-
-            if (&stream == &audioStream) {
-                static int audioPageNo = 0;
-                std::cout << "wrote audio page number " << ++audioPageNo << std::endl;
-            }
+            pageWriter.Append(oggPage);
+            MEDIA_LOG_TRACE("Ogg page " << ogg_page_pageno(&oggPage) << " of stream "
+                << ogg_page_serialno(&oggPage) << ", " << oggPage.header_len + oggPage.body_len << " bytes");
+        }
+        if (pageWriter.ShouldFlush()) {
+            pageWriter.Flush(file);
         }
     }
 
-    void OggFileFormat::FlushOggPages(std::ofstream& file, ogg_stream_state& stream) {
+    void OggFileFormat::ForceOggPages(ogg_stream_state& stream) {
         ogg_page oggPage;
-        int pageCount = 0;
         while (ogg_stream_flush(&stream, &oggPage) > 0) {
-            file.write(reinterpret_cast<const char*>(oggPage.header),
-                oggPage.header_len);
-            file.write(reinterpret_cast<const char*>(oggPage.body),
-                oggPage.body_len);
-            file.flush();
+            pageWriter.Append(oggPage);
         }
-        //if (&stream == &videoStream) {
-        //    std::cout << "wrote frame number " << videoPacketNo << std::endl;
-        //}
     }
 
-    void OggFileFormat::WriteVideoData(std::ofstream& file, const MediaData& data) {
-        if (!file.is_open()) throw std::runtime_error("file not open");
+    void OggFileFormat::FlushOggPages(IByteWriter& file, ogg_stream_state& stream) {
+        // Headers have to sit on their own pages and reach the file before any data
+        ForceOggPages(stream);
+        pageWriter.Flush(file);
+    }
+
+    void OggFileFormat::Flush(IByteWriter& file) {
+        pageWriter.Flush(file);
+    }
+
+    void OggFileFormat::WriteVideoData(IByteWriter& file, const MediaData& data) {
+        if (!file.IsOpen()) throw std::runtime_error("file not open");
 
         if (headersSet) {
             const VideoFormat& format = data.getVideoFormat();
@@ -97,15 +85,27 @@ namespace media_pipeline::file_formats {
             oggData.granulepos = format.granulepos;
             oggData.packetno = videoPacketNo++;
 
+            // A keyframe starting its own page lets players seek straight to it
+            bool keyframeFlush = format.isKeyFrame && pageWriter.Policy().flushOnKeyframe;
+            if (keyframeFlush) {
+                ForceOggPages(videoStream);
+            }
+
             if (ogg_stream_packetin(&videoStream, &oggData) != 0) {
                 throw std::runtime_error("Failed to insert video data into Ogg stream");
             }
-            FlushOggPages(file, videoStream);
+
+            if (keyframeFlush) {
+                FlushOggPages(file, videoStream);
+            }
+            else {
+                WriteOggPages(file, videoStream);
+            }
         }
     }
 
-    void OggFileFormat::WriteAudioData(std::ofstream& file, const MediaData& data) {
-        if (!file.is_open()) throw std::runtime_error("file not open");
+    void OggFileFormat::WriteAudioData(IByteWriter& file, const MediaData& data) {
+        if (!file.IsOpen()) throw std::runtime_error("file not open");
 
         if (headersSet) {
             uint32_t frameCount;
@@ -135,8 +135,8 @@ namespace media_pipeline::file_formats {
         }
     }
 
-    void OggFileFormat::WriteData(std::ofstream& file, const MediaData& data) {
-        if (!file.is_open()) throw std::runtime_error(" file not open");
+    void OggFileFormat::WriteData(IByteWriter& file, const MediaData& data) {
+        if (!file.IsOpen()) throw std::runtime_error(" file not open");
 
         if (data.type == MediaData::Type::Audio) {
             WriteAudioData(file, data);
@@ -146,7 +146,7 @@ namespace media_pipeline::file_formats {
         }
     }
 
-    void OggFileFormat::Finalize(std::ofstream& file) {
+    void OggFileFormat::Finalize(IByteWriter& file) {
         // Mark last audio packet as end of stream
         ogg_packet lastAudioPacket;
         lastAudioPacket.e_o_s = 1;  // Set end of stream flag
@@ -171,12 +171,12 @@ namespace media_pipeline::file_formats {
         ogg_stream_clear(&videoStream);
     }
 
-    void OggFileFormat::WriteHeader(std::ofstream& file) {
+    void OggFileFormat::WriteHeader(IByteWriter& file) {
         // Opus headers are written along with Theora Headers for correct ordering
         // All written in WriteTheoraHeaders
     }
 
-    void OggFileFormat::WriteOpusHead(std::ofstream& file) {
+    void OggFileFormat::WriteOpusHead(IByteWriter& file) {
         // OpusHead Packet 
         unsigned char header[19] = {
             'O', 'p', 'u', 's', 'H', 'e', 'a', 'd',   // Magic Signature
@@ -202,7 +202,7 @@ namespace media_pipeline::file_formats {
         FlushOggPages(file, audioStream);
     }
 
-    void OggFileFormat::WriteOpusTags(std::ofstream& file) {
+    void OggFileFormat::WriteOpusTags(IByteWriter& file) {
         // OpusTags Packet
         const char* vendor = "MyEncoder";
         size_t vendorLen = strlen(vendor);
@@ -254,7 +254,7 @@ namespace media_pipeline::file_formats {
         return emptyPacket;
     }
 
-    void OggFileFormat::WriteTheoraHeaders(std::ofstream& file, const MediaData& data) {
+    void OggFileFormat::WriteTheoraHeaders(IByteWriter& file, const MediaData& data) {
         const uint8_t* currentPos = data.data.data();
         size_t remainingSize = data.data.size();
         WriteOpusHead(file);
@@ -0,0 +1,36 @@
+#include <stdexcept>
+#include <chrono>
+
+#include <ogg/ogg.h>
+
+#include "media_pipeline/file_formats/ogg_page_writer.h"
+
+namespace media_pipeline::file_formats {
+	OggPageWriter::OggPageWriter(OggFlushPolicy policy)
+		: policy(policy) {
+		buffer.reserve(policy.maxBufferedBytes + 64 * 1024);
+	}
+
+	void OggPageWriter::Append(const ogg_page& page) {
+		if (buffer.empty()) {
+			firstPageTime = std::chrono::steady_clock::now();
+		}
+		buffer.insert(buffer.end(), page.header, page.header + page.header_len);
+		buffer.insert(buffer.end(), page.body, page.body + page.body_len);
+	}
+
+	bool OggPageWriter::ShouldFlush() const {
+		if (buffer.empty()) return false;
+		if (buffer.size() >= policy.maxBufferedBytes) return true;
+		return std::chrono::steady_clock::now() - firstPageTime >= policy.maxDelay;
+	}
+
+	void OggPageWriter::Flush(IByteWriter& file) {
+		if (buffer.empty()) return;
+		if (!file.IsOpen()) throw std::runtime_error("file not open");
+
+		file.Write(buffer.data(), buffer.size());
+		file.Flush();
+		buffer.clear();
+	}
+}
@@ -0,0 +1,455 @@
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <algorithm>
+#include <functional>
+#include <mutex>
+
+#include "media_pipeline/net/congestion_controller.h"
+
+namespace media_pipeline::net {
+    namespace {
+        constexpr double kNanosPerMs = 1e6;
+        constexpr uint64_t kGroupLength = 5000000;              // Packets sent within 5 ms form a group
+        constexpr size_t kTrendWindow = 20;
+        constexpr double kTrendSmoothing = 0.9;
+        constexpr double kThresholdGain = 4.0;
+        constexpr size_t kMaxDeltaCount = 60;
+        constexpr double kOveruseTimeMs = 10.0;
+        constexpr double kThresholdUp = 0.0087;
+        constexpr double kThresholdDown = 0.039;
+        constexpr double kMinThreshold = 6.0;
+        constexpr double kMaxThreshold = 600.0;
+        constexpr int64_t kAcknowledgedWindow = 500000000;
+        constexpr int64_t kMinAcknowledgedSpan = 150000000;
+        constexpr int64_t kDeliveryWindow = 100000000;
+        constexpr int64_t kMinDeliverySpan = 20000000;
+        constexpr int64_t kBaseDelayWindow = 10000000000;
+        constexpr double kBackoffFactor = 0.85;
+        constexpr double kMinBackoffFactor = 0.2;
+        constexpr double kDrainTimeMs = 300.0;
+        constexpr double kEmptyQueueMs = 10.0;
+        constexpr double kOveruseQueueMs = 50.0;
+        constexpr size_t kMinBurstPackets = 4;
+        constexpr double kSlowBurstRatio = 0.7;
+        constexpr double kMaxQueueGrowthMs = 1000.0;
+        constexpr double kIncreasePerSecond = 1.08;
+        constexpr double kEmptyQueueIncreasePerSecond = 1.4;
+        constexpr double kAdditiveIncreasePerSecond = 0.05;
+        constexpr double kPacketBits = 1200 * 8;
+        constexpr size_t kLossWindowPackets = 20;
+        constexpr uint64_t kLossWindowLength = 200000000;
+        constexpr double kHighLoss = 0.10;
+        constexpr double kLowLoss = 0.02;
+    }
+
+    CongestionController::CongestionController(CongestionControllerOptions options)
+        : options(options)
+        , hasPrevious(false)
+        , firstArrivalTime(0)
+        , hasFirstArrival(false)
+        , accumulatedDelayMs(0)
+        , smoothedDelayMs(0)
+        , deltaCount(0)
+        , trend(0)
+        , previousTrend(0)
+        , threshold(12.5)
+        , lastThresholdUpdate(0)
+        , timeOverUsingMs(-1)
+        , overuseCounter(0)
+        , usage(BandwidthUsage::Normal)
+        , arrivalBytes(0)
+        , queueDelayMs(0)
+        , previousQueueDelayMs(0)
+        , queueDelaySendTime(0)
+        , burstBps(0)
+        , burstArrivalTime(0)
+        , acknowledgedBps(0)
+        , delayBasedBps(options.startBitrateKbps * 1000.0)
+        , lossBasedBps(options.startBitrateKbps * 1000.0)
+        , maxRateAverageBps(0)
+        , maxRateVariance(0.4)
+        , resumeBps(0)
+        , lastRateUpdate(0)
+        , lastDecrease(0)
+        , rttMs(0)
+        , lossWindowPackets(0)
+        , lossWindowLost(0)
+        , lastLossUpdate(0)
+        , lossFraction(0)
+        , isLossLimited(false)
+        , target(std::clamp(options.startBitrateKbps, options.minBitrateKbps, options.maxBitrateKbps))
+        , overuseEvents(0) {
+    }
+
+    void CongestionController::OnPacketFeedback(const PacketResult* results, size_t count, uint64_t now) {
+        std::function<void(int)> notify;
+        int notifyKbps = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (size_t i = 0; i < count; i++) {
+                const PacketResult& result = results[i];
+                lossWindowPackets++;
+                if (!result.isReceived) {
+                    lossWindowLost++;
+                    continue;
+                }
+                UpdateAcknowledgedRate(result.arrivalTime, result.size);
+                UpdateBaseDelay(result);
+                AddToGroup(result, now);
+            }
+            DetectSlowBurst();
+            UpdateLossBasedRate(now);
+            UpdateDelayBasedRate(now);
+            if (!isLossLimited) lossBasedBps = delayBasedBps;
+
+            double bps = std::min(delayBasedBps, lossBasedBps);
+            int kbps = std::clamp(static_cast<int>(bps / 1000.0), options.minBitrateKbps, options.maxBitrateKbps);
+            if (kbps != target) {
+                target = kbps;
+                notify = observer;
+                notifyKbps = kbps;
+            }
+        }
+        if (notify) notify(notifyKbps);
+    }
+
+    void CongestionController::OnRoundTripTime(double rtt) {
+        std::lock_guard<std::mutex> lock(mutex);
+        rttMs = rtt;
+    }
+
+    void CongestionController::AddToGroup(const PacketResult& result, uint64_t now) {
+        if (!hasFirstArrival) {
+            hasFirstArrival = true;
+            firstArrivalTime = result.arrivalTime;
+        }
+        if (current.isEmpty) {
+            UpdateQueueDelay(result);
+            current.firstSendTime = current.lastSendTime = result.sendTime;
+            current.firstArrivalTime = current.lastArrivalTime = result.arrivalTime;
+            current.size = current.firstSize = result.size;
+            current.packetCount = 1;
+            current.isEmpty = false;
+            return;
+        }
+        // Packets of another session sharing the controller, reported out
+        // of send order, only count towards the acknowledged rate
+        if (result.sendTime < current.firstSendTime) return;
+
+        if (result.sendTime - current.firstSendTime <= kGroupLength) {
+            current.lastSendTime = std::max(current.lastSendTime, result.sendTime);
+            current.lastArrivalTime = std::max(current.lastArrivalTime, result.arrivalTime);
+            current.size += result.size;
+            current.packetCount++;
+            UpdateBurstRate();
+            return;
+        }
+
+        if (hasPrevious) {
+            double sendDeltaMs = (current.lastSendTime - previous.lastSendTime) / kNanosPerMs;
+            double arrivalDeltaMs = (current.lastArrivalTime - previous.lastArrivalTime) / kNanosPerMs;
+            double arrivalMs = (current.lastArrivalTime - firstArrivalTime) / kNanosPerMs;
+            OnGroupDelta(sendDeltaMs, arrivalDeltaMs, arrivalMs, now);
+        }
+        previous = current;
+        hasPrevious = true;
+        UpdateQueueDelay(result);
+        current.firstSendTime = current.lastSendTime = result.sendTime;
+        current.firstArrivalTime = current.lastArrivalTime = result.arrivalTime;
+        current.size = current.firstSize = result.size;
+        current.packetCount = 1;
+    }
+
+    void CongestionController::OnGroupDelta(double sendDeltaMs, double arrivalDeltaMs, double arrivalMs, uint64_t now) {
+        deltaCount = std::min(deltaCount + 1, kMaxDeltaCount);
+        accumulatedDelayMs += arrivalDeltaMs - sendDeltaMs;
+        smoothedDelayMs = kTrendSmoothing * smoothedDelayMs + (1 - kTrendSmoothing) * accumulatedDelayMs;
+
+        trendSamples.push_back({ arrivalMs, smoothedDelayMs });
+        if (trendSamples.size() > kTrendWindow) trendSamples.pop_front();
+
+        if (trendSamples.size() == kTrendWindow) {
+            // Least squares slope of smoothed delay over arrival time
+            double meanX = 0;
+            double meanY = 0;
+            for (const TrendSample& sample : trendSamples) {
+                meanX += sample.arrivalMs;
+                meanY += sample.smoothedDelayMs;
+            }
+            meanX /= trendSamples.size();
+            meanY /= trendSamples.size();
+            double numerator = 0;
+            double denominator = 0;
+            for (const TrendSample& sample : trendSamples) {
+                numerator += (sample.arrivalMs - meanX) * (sample.smoothedDelayMs - meanY);
+                denominator += (sample.arrivalMs - meanX) * (sample.arrivalMs - meanX);
+            }
+            if (denominator != 0) trend = numerator / denominator;
+        }
+        Detect(sendDeltaMs, now);
+    }
+
+    void CongestionController::Detect(double sendDeltaMs, uint64_t now) {
+        double modifiedTrend = std::min(deltaCount, kMaxDeltaCount) * trend * kThresholdGain;
+        if (queueDelayMs > kOveruseQueueMs && queueDelayMs > previousQueueDelayMs) {
+            // A queue past the budget that is still growing is overuse,
+            // however slowly the trendline turns; a single burst, a key
+            // frame, has started to drain by the next group
+            timeOverUsingMs = 0;
+            overuseCounter = 0;
+            usage = BandwidthUsage::Overusing;
+        }
+        else if (modifiedTrend > threshold) {
+            timeOverUsingMs = timeOverUsingMs < 0 ? sendDeltaMs / 2 : timeOverUsingMs + sendDeltaMs;
+            overuseCounter++;
+            if (timeOverUsingMs > kOveruseTimeMs && overuseCounter > 1 && trend >= previousTrend) {
+                timeOverUsingMs = 0;
+                overuseCounter = 0;
+                usage = BandwidthUsage::Overusing;
+            }
+        }
+        else if (modifiedTrend < -threshold) {
+            timeOverUsingMs = -1;
+            overuseCounter = 0;
+            usage = BandwidthUsage::Underusing;
+        }
+        else {
+            timeOverUsingMs = -1;
+            overuseCounter = 0;
+            usage = BandwidthUsage::Normal;
+        }
+        previousTrend = trend;
+        UpdateThreshold(modifiedTrend, now);
+    }
+
+    void CongestionController::UpdateThreshold(double modifiedTrend, uint64_t now) {
+        if (lastThresholdUpdate == 0) lastThresholdUpdate = now;
+
+        // A spike far above the threshold, a route change or a burst of
+        // cross traffic, shouldn't drag the threshold up with it
+        double magnitude = std::fabs(modifiedTrend);
+        if (magnitude > threshold + 15.0) {
+            lastThresholdUpdate = now;
+            return;
+        }
+        double k = magnitude < threshold ? kThresholdDown : kThresholdUp;
+        double elapsedMs = std::min((now - lastThresholdUpdate) / kNanosPerMs, 100.0);
+        threshold = std::clamp(threshold + k * (magnitude - threshold) * elapsedMs, kMinThreshold, kMaxThreshold);
+        lastThresholdUpdate = now;
+    }
+
+    void CongestionController::UpdateAcknowledgedRate(int64_t arrivalTime, size_t size) {
+        arrivals.push_back({ arrivalTime, size });
+        arrivalBytes += size;
+        while (!arrivals.empty() && arrivals.front().time < arrivalTime - kAcknowledgedWindow) {
+            arrivalBytes -= arrivals.front().size;
+            arrivals.pop_front();
+        }
+        if (!hasFirstArrival) return;
+        // The full window once there is that much history, less at the start
+        int64_t span = std::min(arrivalTime - firstArrivalTime, kAcknowledgedWindow);
+        if (span < kMinAcknowledgedSpan) return;
+        acknowledgedBps = arrivalBytes * 8.0 * 1e9 / span;
+    }
+
+    void CongestionController::UpdateBaseDelay(const PacketResult& result) {
+        // Smallest one-way delay seen lately, clock offset included: the
+        // delay of an empty queue. Kept as a run of increasing delays so
+        // the minimum is always in front.
+        int64_t delay = result.arrivalTime - static_cast<int64_t>(result.sendTime);
+        while (!baseDelays.empty() && baseDelays.back().delay >= delay) baseDelays.pop_back();
+        baseDelays.push_back({ result.arrivalTime, delay });
+        while (baseDelays.front().time < result.arrivalTime - kBaseDelayWindow) baseDelays.pop_front();
+    }
+
+    void CongestionController::UpdateQueueDelay(const PacketResult& result) {
+        // Measured on the first packet of a group, which the rest of its
+        // own burst doesn't hold up
+        if (baseDelays.empty()) return;
+        int64_t delay = result.arrivalTime - static_cast<int64_t>(result.sendTime);
+        double delayMs = std::max<int64_t>(delay - baseDelays.front().delay, 0) / kNanosPerMs;
+        previousQueueDelayMs = queueDelayMs;
+        queueDelayMs = delayMs;
+        queueDelaySendTime = result.sendTime;
+    }
+
+    void CongestionController::UpdateBurstRate() {
+        // The packets of one burst, a frame, leave the bottleneck back to
+        // back, so their spread on arrival gives its rate however much the
+        // encoder sent; the reports show it long before the queue delay,
+        // which a packet only reveals once it has waited out the queue
+        if (current.packetCount < kMinBurstPackets) return;
+        int64_t spread = current.lastArrivalTime - current.firstArrivalTime;
+        if (spread <= 0) return;
+        burstBps = (current.size - current.firstSize) * 8.0 * 1e9 / spread;
+        burstArrivalTime = current.lastArrivalTime;
+    }
+
+    void CongestionController::DetectSlowBurst() {
+        // Well below the target the link can't carry it: the rate has
+        // dropped under the controller, and the queue grows faster than
+        // the trendline can follow
+        if (burstBps == 0 || arrivals.empty() || burstArrivalTime < arrivals.back().time - kDeliveryWindow) return;
+        if (burstBps < kSlowBurstRatio * target * 1000.0) usage = BandwidthUsage::Overusing;
+    }
+
+    double CongestionController::LinkCapacity() const {
+        double delivered = DeliveryRate();
+        bool isBurstRecent = burstBps > 0 && !arrivals.empty() && burstArrivalTime >= arrivals.back().time - kDeliveryWindow;
+        // Right after a drop the delivery window still holds faster
+        // arrivals from before it; the latest burst doesn't
+        if (isBurstRecent && (delivered == 0 || burstBps < delivered)) return burstBps;
+        return delivered > 0 ? delivered : acknowledgedBps;
+    }
+
+    double CongestionController::ProjectedQueueDelayMs(double capacity, uint64_t now) const {
+        // The latest queue delay is as it was when its packet was sent; at
+        // the current target the queue has grown since by the share the
+        // link can't carry
+        if (queueDelaySendTime == 0 || now <= queueDelaySendTime || capacity <= 0) return queueDelayMs;
+        double sinceMs = std::min((now - queueDelaySendTime) / kNanosPerMs, kMaxQueueGrowthMs);
+        return queueDelayMs + std::max(target * 1000.0 / capacity - 1.0, 0.0) * sinceMs;
+    }
+
+    double CongestionController::DeliveryRate() const {
+        // While a queue stands, packets leave it back to back at the
+        // bottleneck rate, so a short window sees the capacity rather than
+        // what was sent before the link slowed down
+        if (arrivals.empty()) return 0;
+        int64_t latest = arrivals.back().time;
+        int64_t earliest = latest;
+        size_t bytes = 0;
+        size_t earliestSize = 0;
+        for (auto it = arrivals.rbegin(); it != arrivals.rend() && it->time >= latest - kDeliveryWindow; ++it) {
+            bytes += it->size;
+            if (it->time <= earliest) {
+                earliest = it->time;
+                earliestSize = it->size;
+            }
+        }
+        if (latest - earliest < kMinDeliverySpan) return 0;
+        return (bytes - earliestSize) * 8.0 * 1e9 / (latest - earliest);
+    }
+
+    void CongestionController::UpdateDelayBasedRate(uint64_t now) {
+        if (lastRateUpdate == 0) {
+            lastRateUpdate = now;
+            return;
+        }
+        double elapsed = std::min((now - lastRateUpdate) / 1e9, 1.0);
+        lastRateUpdate = now;
+        double responseMs = rttMs + 100.0;
+
+        if (usage == BandwidthUsage::Overusing) {
+            // At most once per response time: the queue needs that long to
+            // show the effect of the previous decrease
+            if (now - lastDecrease < responseMs * kNanosPerMs) return;
+            double capacity = LinkCapacity();
+            double reference = capacity > 0 ? capacity : delayBasedBps;
+            // Far enough below the capacity to drain the standing queue
+            // within kDrainTimeMs, then back to the usual margin
+            double factor = std::clamp(1.0 - ProjectedQueueDelayMs(reference, now) / kDrainTimeMs, kMinBackoffFactor, kBackoffFactor);
+            double reduced = reference * factor;
+            if (reduced < delayBasedBps) {
+                delayBasedBps = reduced;
+                lastDecrease = now;
+                overuseEvents++;
+                // Later cuts of the same episode see less of the capacity
+                // once the queue empties; the first saw it best
+                resumeBps = factor < kBackoffFactor ? std::max(resumeBps, reference * kBackoffFactor) : 0;
+            }
+            if (capacity > 0) {
+                // Remember where the link saturated, to approach it carefully next time
+                double capacityKbps = capacity / 1000.0;
+                double averageKbps = maxRateAverageBps / 1000.0;
+                double deviationKbps = std::sqrt(maxRateVariance * averageKbps);
+                // Well below the old saturation point: the link got slower
+                if (maxRateAverageBps == 0 || capacityKbps < averageKbps - 3 * deviationKbps) {
+                    averageKbps = capacityKbps;
+                }
+                else {
+                    averageKbps = 0.95 * averageKbps + 0.05 * capacityKbps;
+                    double error = averageKbps - capacityKbps;
+                    maxRateVariance = std::clamp(0.95 * maxRateVariance + 0.05 * error * error / std::max(averageKbps, 1.0), 0.4, 2.5);
+                }
+                maxRateAverageBps = averageKbps * 1000.0;
+            }
+        }
+        else if (resumeBps > 0 && queueDelayMs < kEmptyQueueMs) {
+            // The queue a deep backoff was draining is gone
+            delayBasedBps = std::max(delayBasedBps, resumeBps);
+            resumeBps = 0;
+        }
+        else if (usage == BandwidthUsage::Normal) {
+            if (maxRateAverageBps > 0 && acknowledgedBps > 0) {
+                double averageKbps = maxRateAverageBps / 1000.0;
+                double deviationKbps = std::sqrt(maxRateVariance * averageKbps);
+                // Well past the old saturation point: the link got faster
+                if (acknowledgedBps / 1000.0 > averageKbps + 3 * deviationKbps) maxRateAverageBps = 0;
+            }
+            if (maxRateAverageBps > 0) {
+                double perSecond = std::max(kPacketBits * 1000.0 / responseMs, delayBasedBps * kAdditiveIncreasePerSecond);
+                delayBasedBps += std::max(1000.0, perSecond * elapsed);
+            }
+            else {
+                // Nothing queued yet: the link has room, so get there quickly
+                double increase = queueDelayMs < kEmptyQueueMs ? kEmptyQueueIncreasePerSecond : kIncreasePerSecond;
+                delayBasedBps += std::max(1000.0 * elapsed, delayBasedBps * (std::pow(increase, elapsed) - 1));
+            }
+            // Don't run far ahead of what actually gets through
+            if (acknowledgedBps > 0) delayBasedBps = std::min(delayBasedBps, 1.5 * acknowledgedBps + 10000);
+        }
+        // Underusing: the queue is draining, hold until it settles
+
+        delayBasedBps = std::clamp(delayBasedBps, options.minBitrateKbps * 1000.0, options.maxBitrateKbps * 1000.0);
+    }
+
+    void CongestionController::UpdateLossBasedRate(uint64_t now) {
+        if (lossWindowPackets < kLossWindowPackets || now - lastLossUpdate < kLossWindowLength) return;
+        lossFraction = static_cast<double>(lossWindowLost) / lossWindowPackets;
+        lossWindowPackets = 0;
+        lossWindowLost = 0;
+        lastLossUpdate = now;
+
+        if (lossFraction > kHighLoss) {
+            lossBasedBps = std::min(lossBasedBps, target * 1000.0) * (1 - 0.5 * lossFraction);
+            isLossLimited = true;
+        }
+        else if (lossFraction < kLowLoss && isLossLimited) {
+            // Grows back until it meets the delay based estimate, which it
+            // then follows. With the queue empty again the loss was most
+            // likely it overflowing, which the delay based part has
+            // answered already.
+            lossBasedBps *= 1.05;
+            if (lossBasedBps >= delayBasedBps || queueDelayMs < kEmptyQueueMs) isLossLimited = false;
+        }
+        lossBasedBps = std::clamp(lossBasedBps, options.minBitrateKbps * 1000.0, options.maxBitrateKbps * 1000.0);
+    }
+
+    int CongestionController::TargetBitrateKbps() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return target;
+    }
+
+    CongestionStats CongestionController::GetStats() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        CongestionStats stats;
+        stats.targetBitrateKbps = target;
+        stats.delayBasedKbps = static_cast<int>(delayBasedBps / 1000.0);
+        stats.lossBasedKbps = static_cast<int>(lossBasedBps / 1000.0);
+        stats.acknowledgedKbps = static_cast<int>(acknowledgedBps / 1000.0);
+        stats.queueDelayMs = queueDelayMs;
+        stats.trend = std::min(deltaCount, kMaxDeltaCount) * trend * kThresholdGain;
+        stats.threshold = threshold;
+        stats.lossFraction = lossFraction;
+        stats.usage = usage;
+        stats.overuseEvents = overuseEvents;
+        return stats;
+    }
+
+    void CongestionController::SetObserver(std::function<void(int kbps)> callback) {
+        std::lock_guard<std::mutex> lock(mutex);
+        observer = std::move(callback);
+    }
+}
@@ -0,0 +1,155 @@
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+#include <string>
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <WinSock2.h>
+#elif defined(__linux__)
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <cerrno>
+#else
+#include <poll.h>
+#include <cerrno>
+#endif
+
+#include "media_pipeline/net/poller.h"
+
+namespace media_pipeline::net {
+#ifdef __linux__
+    namespace {
+        uint32_t ToEpollEvents(uint32_t flags) {
+            uint32_t events = 0;
+            if (flags & kPollReadable) events |= EPOLLIN;
+            if (flags & kPollWritable) events |= EPOLLOUT;
+            return events;
+        }
+
+        void Control(int epollFd, int operation, SocketHandle handle, uint32_t flags) {
+            epoll_event event = {};
+            event.events = ToEpollEvents(flags);
+            event.data.fd = handle;
+            if (epoll_ctl(epollFd, operation, handle, &event) != 0) {
+                throw std::runtime_error(std::string("epoll_ctl failed: ") + std::strerror(errno));
+            }
+        }
+    }
+
+    Poller::Poller()
+        : epollFd(epoll_create1(EPOLL_CLOEXEC)) {
+        if (epollFd < 0) {
+            throw std::runtime_error(std::string("epoll_create1 failed: ") + std::strerror(errno));
+        }
+    }
+
+    Poller::~Poller() {
+        close(epollFd);
+    }
+
+    void Poller::Add(SocketHandle handle, uint32_t flags) {
+        Control(epollFd, EPOLL_CTL_ADD, handle, flags);
+    }
+
+    void Poller::Modify(SocketHandle handle, uint32_t flags) {
+        Control(epollFd, EPOLL_CTL_MOD, handle, flags);
+    }
+
+    void Poller::Remove(SocketHandle handle) {
+        Control(epollFd, EPOLL_CTL_DEL, handle, 0);
+    }
+
+    size_t Poller::Wait(std::vector<PollEvent>& events, int timeoutMs) {
+        epoll_event ready[64];
+        int count;
+        do {
+            count = epoll_wait(epollFd, ready, 64, timeoutMs);
+        } while (count < 0 && errno == EINTR);
+        if (count < 0) {
+            throw std::runtime_error(std::string("epoll_wait failed: ") + std::strerror(errno));
+        }
+
+        events.clear();
+        for (int i = 0; i < count; i++) {
+            PollEvent event;
+            event.handle = ready[i].data.fd;
+            event.readable = (ready[i].events & EPOLLIN) != 0;
+            event.writable = (ready[i].events & EPOLLOUT) != 0;
+            event.hangup = (ready[i].events & (EPOLLHUP | EPOLLERR)) != 0;
+            events.push_back(event);
+        }
+        return events.size();
+    }
+#else
+    Poller::Poller() {
+    }
+
+    Poller::~Poller() {
+    }
+
+    void Poller::Add(SocketHandle handle, uint32_t flags) {
+        entries.push_back({ handle, flags });
+    }
+
+    void Poller::Modify(SocketHandle handle, uint32_t flags) {
+        for (Entry& entry : entries) {
+            if (entry.handle == handle) {
+                entry.flags = flags;
+                return;
+            }
+        }
+        throw std::runtime_error("Poller::Modify on a socket that was not added");
+    }
+
+    void Poller::Remove(SocketHandle handle) {
+        entries.erase(std::remove_if(entries.begin(), entries.end(),
+            [handle](const Entry& entry) { return entry.handle == handle; }), entries.end());
+    }
+
+    size_t Poller::Wait(std::vector<PollEvent>& events, int timeoutMs) {
+        events.clear();
+#ifdef _WIN32
+        std::vector<WSAPOLLFD> descriptors(entries.size());
+#else
+        std::vector<pollfd> descriptors(entries.size());
+#endif
+        for (size_t i = 0; i < entries.size(); i++) {
+            descriptors[i].fd = entries[i].handle;
+            descriptors[i].events = 0;
+            if (entries[i].flags & kPollReadable) descriptors[i].events |= POLLIN;
+            if (entries[i].flags & kPollWritable) descriptors[i].events |= POLLOUT;
+            descriptors[i].revents = 0;
+        }
+
+#ifdef _WIN32
+        int count = WSAPoll(descriptors.data(), static_cast<ULONG>(descriptors.size()), timeoutMs);
+        if (count < 0) {
+            throw std::runtime_error("WSAPoll failed (WSA error " + std::to_string(WSAGetLastError()) + ")");
+        }
+#else
+        int count;
+        do {
+            count = poll(descriptors.data(), descriptors.size(), timeoutMs);
+        } while (count < 0 && errno == EINTR);
+        if (count < 0) {
+            throw std::runtime_error(std::string("poll failed: ") + std::strerror(errno));
+        }
+#endif
+
+        for (size_t i = 0; i < descriptors.size() && count > 0; i++) {
+            if (descriptors[i].revents == 0) continue;
+            PollEvent event;
+            event.handle = entries[i].handle;
+            event.readable = (descriptors[i].revents & POLLIN) != 0;
+            event.writable = (descriptors[i].revents & POLLOUT) != 0;
+            event.hangup = (descriptors[i].revents & (POLLHUP | POLLERR)) != 0;
+            events.push_back(event);
+        }
+        return events.size();
+    }
+#endif
+}
@@ -0,0 +1,222 @@
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+
+#include "media_pipeline/net/rtcp.h"
+
+namespace media_pipeline::net {
+    namespace {
+        constexpr size_t kCommonHeaderSize = 4;
+        constexpr size_t kSenderInfoSize = 20;
+        constexpr size_t kReportBlockSize = 24;
+
+        void Write16(uint8_t* out, uint32_t value) {
+            out[0] = static_cast<uint8_t>(value >> 8);
+            out[1] = static_cast<uint8_t>(value);
+        }
+
+        void Write32(uint8_t* out, uint32_t value) {
+            out[0] = static_cast<uint8_t>(value >> 24);
+            out[1] = static_cast<uint8_t>(value >> 16);
+            out[2] = static_cast<uint8_t>(value >> 8);
+            out[3] = static_cast<uint8_t>(value);
+        }
+
+        uint16_t Read16(const uint8_t* data) {
+            return static_cast<uint16_t>((data[0] << 8) | data[1]);
+        }
+
+        uint32_t Read32(const uint8_t* data) {
+            return (static_cast<uint32_t>(data[0]) << 24) | (data[1] << 16) | (data[2] << 8) | data[3];
+        }
+
+        // Version 2, no padding, count in the low five bits, length in 32 bit words minus one
+        void WriteCommonHeader(uint8_t* out, uint8_t count, uint8_t packetType, size_t size) {
+            out[0] = static_cast<uint8_t>(0x80 | (count & 0x1F));
+            out[1] = packetType;
+            Write16(out + 2, static_cast<uint32_t>(size / 4 - 1));
+        }
+
+        void ParseReportBlocks(const uint8_t* data, size_t size, size_t count, RtcpFeedback& feedback) {
+            for (size_t i = 0; i < count && (i + 1) * kReportBlockSize <= size; i++) {
+                const uint8_t* block = data + i * kReportBlockSize;
+                RtcpReportBlock report;
+                report.ssrc = Read32(block);
+                report.fractionLost = block[4];
+                // Sign extend the 24 bit cumulative count
+                int32_t lost = static_cast<int32_t>((block[5] << 16) | (block[6] << 8) | block[7]);
+                report.cumulativeLost = (lost & 0x800000) ? lost - 0x1000000 : lost;
+                report.highestSequence = Read32(block + 8);
+                report.jitter = Read32(block + 12);
+                report.lastSenderReport = Read32(block + 16);
+                report.delaySinceLastSenderReport = Read32(block + 20);
+                feedback.reports.push_back(report);
+            }
+        }
+    }
+
+    bool ParseRtcp(const uint8_t* data, size_t size, RtcpFeedback& feedback) {
+        feedback.hasSenderInfo = false;
+        feedback.senderSsrc = 0;
+        feedback.reports.clear();
+        feedback.nacks.clear();
+        feedback.arrivals.clear();
+
+        size_t offset = 0;
+        while (offset + kCommonHeaderSize <= size) {
+            const uint8_t* packet = data + offset;
+            if ((packet[0] >> 6) != 2) return false;
+            size_t count = packet[0] & 0x1F;
+            uint8_t packetType = packet[1];
+            size_t length = (static_cast<size_t>(Read16(packet + 2)) + 1) * 4;
+            if (offset + length > size) return false;
+
+            const uint8_t* body = packet + kCommonHeaderSize;
+            size_t bodySize = length - kCommonHeaderSize;
+            if (packetType == kRtcpSenderReport && bodySize >= 4 + kSenderInfoSize) {
+                feedback.hasSenderInfo = true;
+                feedback.senderSsrc = Read32(body);
+                feedback.senderInfo.ntpTimestamp = (static_cast<uint64_t>(Read32(body + 4)) << 32) | Read32(body + 8);
+                feedback.senderInfo.rtpTimestamp = Read32(body + 12);
+                feedback.senderInfo.packetCount = Read32(body + 16);
+                feedback.senderInfo.octetCount = Read32(body + 20);
+                ParseReportBlocks(body + 4 + kSenderInfoSize, bodySize - 4 - kSenderInfoSize, count, feedback);
+            }
+            else if (packetType == kRtcpReceiverReport && bodySize >= 4) {
+                feedback.senderSsrc = Read32(body);
+                ParseReportBlocks(body + 4, bodySize - 4, count, feedback);
+            }
+            else if (packetType == kRtcpTransportFeedback && count == kRtcpNackFormat && bodySize >= 8) {
+                // Each FCI entry: PID, then a bitmask of the 16 sequence numbers after it
+                for (size_t fci = 8; fci + 4 <= bodySize; fci += 4) {
+                    uint16_t pid = Read16(body + fci);
+                    uint16_t mask = Read16(body + fci + 2);
+                    feedback.nacks.push_back(pid);
+                    for (int bit = 0; bit < 16; bit++) {
+                        if (mask & (1 << bit)) feedback.nacks.push_back(static_cast<uint16_t>(pid + bit + 1));
+                    }
+                }
+            }
+            else if (packetType == kRtcpTransportFeedback && count == kRtcpCongestionFormat && bodySize >= 8) {
+                // Report blocks, then the report timestamp in the last word
+                size_t end = bodySize - 4;
+                feedback.arrivalReportTime = Read32(body + end);
+                size_t block = 4;
+                while (block + 8 <= end) {
+                    uint16_t beginSequence = Read16(body + block + 4);
+                    size_t reports = Read16(body + block + 6);
+                    size_t reportBytes = (reports * 2 + 3) & ~static_cast<size_t>(3);
+                    if (block + 8 + reportBytes > end) return false;
+                    for (size_t i = 0; i < reports; i++) {
+                        uint16_t report = Read16(body + block + 8 + i * 2);
+                        RtcpPacketArrival arrival;
+                        arrival.sequenceNumber = static_cast<uint16_t>(beginSequence + i);
+                        arrival.isReceived = (report & 0x8000) != 0;
+                        arrival.arrivalOffset = report & 0x1FFF;
+                        feedback.arrivals.push_back(arrival);
+                    }
+                    block += 8 + reportBytes;
+                }
+            }
+            offset += length;
+        }
+        return offset == size;
+    }
+
+    size_t WriteSenderReport(uint8_t* out, size_t capacity, uint32_t ssrc, const RtcpSenderInfo& info) {
+        size_t size = kCommonHeaderSize + 4 + kSenderInfoSize;
+        if (capacity < size) return 0;
+        WriteCommonHeader(out, 0, kRtcpSenderReport, size);
+        Write32(out + 4, ssrc);
+        Write32(out + 8, static_cast<uint32_t>(info.ntpTimestamp >> 32));
+        Write32(out + 12, static_cast<uint32_t>(info.ntpTimestamp));
+        Write32(out + 16, info.rtpTimestamp);
+        Write32(out + 20, info.packetCount);
+        Write32(out + 24, info.octetCount);
+        return size;
+    }
+
+    size_t WriteReceiverReport(uint8_t* out, size_t capacity, uint32_t ssrc, const RtcpReportBlock& block) {
+        size_t size = kCommonHeaderSize + 4 + kReportBlockSize;
+        if (capacity < size) return 0;
+        WriteCommonHeader(out, 1, kRtcpReceiverReport, size);
+        Write32(out + 4, ssrc);
+
+        uint8_t* report = out + 8;
+        Write32(report, block.ssrc);
+        // Clamp to the 24 bit signed range
+        int32_t lost = block.cumulativeLost;
+        if (lost > 0x7FFFFF) lost = 0x7FFFFF;
+        if (lost < -0x800000) lost = -0x800000;
+        Write32(report + 4, (static_cast<uint32_t>(block.fractionLost) << 24) | (static_cast<uint32_t>(lost) & 0xFFFFFF));
+        Write32(report + 8, block.highestSequence);
+        Write32(report + 12, block.jitter);
+        Write32(report + 16, block.lastSenderReport);
+        Write32(report + 20, block.delaySinceLastSenderReport);
+        return size;
+    }
+
+    size_t WriteNack(uint8_t* out, size_t capacity, uint32_t senderSsrc, uint32_t mediaSsrc,
+        const uint16_t* sequences, size_t count, size_t* sequencesWritten) {
+        if (sequencesWritten) *sequencesWritten = 0;
+        size_t size = kCommonHeaderSize + 8;
+        // At least one PID/BLP pair, an empty NACK is malformed
+        if (capacity < size + 4 || count == 0) return 0;
+
+        size_t i = 0;
+        while (i < count && size + 4 <= capacity) {
+            uint16_t pid = sequences[i++];
+            uint16_t mask = 0;
+            while (i < count) {
+                uint16_t distance = static_cast<uint16_t>(sequences[i] - pid);
+                if (distance == 0 || distance > 16) break;
+                mask |= static_cast<uint16_t>(1 << (distance - 1));
+                i++;
+            }
+            Write16(out + size, pid);
+            Write16(out + size + 2, mask);
+            size += 4;
+        }
+
+        WriteCommonHeader(out, kRtcpNackFormat, kRtcpTransportFeedback, size);
+        Write32(out + 4, senderSsrc);
+        Write32(out + 8, mediaSsrc);
+        if (sequencesWritten) *sequencesWritten = i;
+        return size;
+    }
+
+    size_t WriteCongestionFeedback(uint8_t* out, size_t capacity, uint32_t senderSsrc, uint32_t mediaSsrc,
+        uint16_t beginSequence, const RtcpPacketArrival* arrivals, size_t count, uint32_t reportTime) {
+        if (count == 0 || count > kRtcpMaxCongestionReports) return 0;
+        size_t reportBytes = (count * 2 + 3) & ~static_cast<size_t>(3);
+        size_t size = kCommonHeaderSize + 4 + 8 + reportBytes + 4;
+        if (capacity < size) return 0;
+
+        WriteCommonHeader(out, kRtcpCongestionFormat, kRtcpTransportFeedback, size);
+        Write32(out + 4, senderSsrc);
+        Write32(out + 8, mediaSsrc);
+        Write16(out + 12, beginSequence);
+        Write16(out + 14, static_cast<uint32_t>(count));
+
+        // R bit, ECN not reported, 13 bit arrival offset; zero padding to a word
+        uint8_t* reports = out + 16;
+        std::memset(reports, 0, reportBytes);
+        for (size_t i = 0; i < count; i++) {
+            uint32_t report = 0;
+            if (arrivals[i].isReceived) {
+                report = 0x8000 | std::min<uint16_t>(arrivals[i].arrivalOffset, kRtcpMaxArrivalOffset);
+            }
+            Write16(reports + i * 2, report);
+        }
+        Write32(reports + reportBytes, reportTime);
+        return size;
+    }
+
+    uint64_t NtpFromNanos(uint64_t nanos) {
+        uint64_t seconds = nanos / 1000000000;
+        uint64_t remainder = nanos % 1000000000;
+        return (seconds << 32) | ((remainder << 32) / 1000000000);
+    }
+}
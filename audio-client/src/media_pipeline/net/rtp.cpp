@@ -0,0 +1,61 @@
+#include <cstdint>
+#include <cstddef>
+#include <random>
+
+#include "media_pipeline/net/rtp.h"
+
+namespace media_pipeline::net {
+    void WriteRtpHeader(uint8_t* out, const RtpHeader& header) {
+        out[0] = 0x80;      // Version 2, no padding, extension or CSRCs
+        out[1] = static_cast<uint8_t>((header.marker ? 0x80 : 0x00) | (header.payloadType & 0x7F));
+        out[2] = static_cast<uint8_t>(header.sequenceNumber >> 8);
+        out[3] = static_cast<uint8_t>(header.sequenceNumber);
+        out[4] = static_cast<uint8_t>(header.timestamp >> 24);
+        out[5] = static_cast<uint8_t>(header.timestamp >> 16);
+        out[6] = static_cast<uint8_t>(header.timestamp >> 8);
+        out[7] = static_cast<uint8_t>(header.timestamp);
+        out[8] = static_cast<uint8_t>(header.ssrc >> 24);
+        out[9] = static_cast<uint8_t>(header.ssrc >> 16);
+        out[10] = static_cast<uint8_t>(header.ssrc >> 8);
+        out[11] = static_cast<uint8_t>(header.ssrc);
+    }
+
+    bool ParseRtpHeader(const uint8_t* data, size_t size, RtpHeader& header,
+        size_t& payloadOffset, size_t& payloadSize) {
+        if (size < kRtpHeaderSize || (data[0] >> 6) != 2) return false;
+
+        bool hasPadding = (data[0] & 0x20) != 0;
+        bool hasExtension = (data[0] & 0x10) != 0;
+        size_t csrcCount = data[0] & 0x0F;
+
+        header.marker = (data[1] & 0x80) != 0;
+        header.payloadType = data[1] & 0x7F;
+        header.sequenceNumber = static_cast<uint16_t>((data[2] << 8) | data[3]);
+        header.timestamp = (static_cast<uint32_t>(data[4]) << 24) | (data[5] << 16) | (data[6] << 8) | data[7];
+        header.ssrc = (static_cast<uint32_t>(data[8]) << 24) | (data[9] << 16) | (data[10] << 8) | data[11];
+
+        size_t offset = kRtpHeaderSize + csrcCount * 4;
+        if (hasExtension) {
+            if (offset + 4 > size) return false;
+            size_t extensionWords = (data[offset + 2] << 8) | data[offset + 3];
+            offset += 4 + extensionWords * 4;
+        }
+        if (offset > size) return false;
+
+        size_t end = size;
+        if (hasPadding) {
+            size_t padding = data[size - 1];
+            if (padding == 0 || offset + padding > size) return false;
+            end -= padding;
+        }
+
+        payloadOffset = offset;
+        payloadSize = end - offset;
+        return true;
+    }
+
+    uint32_t RandomRtpValue() {
+        static thread_local std::mt19937 generator{ std::random_device{}() };
+        return static_cast<uint32_t>(generator());
+    }
+}
@@ -0,0 +1,339 @@
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include <algorithm>
+
+#include "media_pipeline/net/rtp_hevc.h"
+#include "media_pipeline/net/rtp.h"
+#include "media_pipeline/processors/video/nal_units.h"
+
+namespace media_pipeline::net {
+    using processors::video::nal::NalUnit;
+
+    namespace {
+        // RFC 7798 4.4
+        constexpr uint8_t kAggregationPacket = 48;
+        constexpr uint8_t kFragmentationUnit = 49;
+        constexpr size_t kPayloadHeaderSize = 2;
+        constexpr size_t kFuHeaderSize = 1;
+        constexpr size_t kApSizeField = 2;
+
+        // Largest per packet header: RTP, PayloadHdr and FU header
+        constexpr size_t kMaxPacketHeader = kRtpHeaderSize + kPayloadHeaderSize + kFuHeaderSize;
+
+        constexpr uint8_t kStartCode[4] = { 0, 0, 0, 1 };
+
+        uint8_t NalType(const uint8_t* header) {
+            return (header[0] >> 1) & 0x3F;
+        }
+
+        // BLA, IDR and CRA pictures (nal_unit_type 16 to 23)
+        bool IsIrap(uint8_t type) {
+            return type >= 16 && type <= 23;
+        }
+    }
+
+    HevcRtpPayloader::HevcRtpPayloader(uint8_t payloadType, uint32_t ssrc, uint16_t firstSequenceNumber,
+        size_t maxPacketSize)
+        : payloadType(payloadType)
+        , ssrc(ssrc)
+        , sequenceNumber(firstSequenceNumber)
+        , maxPacketSize(maxPacketSize)
+        , arenaUsed(0)
+        , lastHeader(nullptr) {
+        if (maxPacketSize <= kMaxPacketHeader + 2) {
+            throw std::runtime_error("RTP packet size too small for HEVC fragmentation units");
+        }
+    }
+
+    size_t HevcRtpPayloader::Packetize(const uint8_t* accessUnit, size_t size, uint32_t timestamp,
+        bool endOfAccessUnit) {
+        processors::video::nal::SplitAnnexB(accessUnit, size, units);
+        // Stray bytes too short for a NAL unit header can't be packetized
+        units.erase(std::remove_if(units.begin(), units.end(),
+            [](const NalUnit& unit) { return unit.size < kPayloadHeaderSize; }), units.end());
+        slices.clear();
+        packets.clear();
+        packetStarts.clear();
+
+        // Every unit yields at most one packet of its own plus its fragments,
+        // and an AP needs one size field per unit beyond its header
+        size_t fragmentPayload = maxPacketSize - kMaxPacketHeader;
+        size_t maxPackets = units.size() + size / fragmentPayload + 1;
+        size_t arenaSize = maxPackets * kMaxPacketHeader + units.size() * kApSizeField;
+        if (headerArena.size() < arenaSize) headerArena.resize(arenaSize);
+        arenaUsed = 0;
+
+        size_t i = 0;
+        while (i < units.size()) {
+            // Longest run starting here that fits one aggregation packet
+            size_t apSize = kRtpHeaderSize + kPayloadHeaderSize;
+            size_t run = 0;
+            while (i + run < units.size() &&
+                apSize + kApSizeField + units[i + run].size <= maxPacketSize) {
+                apSize += kApSizeField + units[i + run].size;
+                run++;
+            }
+
+            if (run >= 2) {
+                EmitAggregate(i, run, timestamp);
+                i += run;
+            }
+            else if (kRtpHeaderSize + units[i].size <= maxPacketSize) {
+                EmitSingle(units[i], timestamp);
+                i++;
+            }
+            else {
+                EmitFragments(units[i], timestamp);
+                i++;
+            }
+        }
+
+        for (size_t p = 0; p < packets.size(); p++) {
+            packets[p].slices = slices.data() + packetStarts[p];
+        }
+        if (endOfAccessUnit && !packets.empty()) {
+            lastHeader[1] |= 0x80;     // Marker bit
+        }
+        return packets.size();
+    }
+
+    uint8_t* HevcRtpPayloader::BeginPacket(uint32_t timestamp, size_t headerSize) {
+        uint8_t* header = headerArena.data() + arenaUsed;
+        arenaUsed += headerSize;
+        lastHeader = header;
+
+        RtpHeader rtp;
+        rtp.payloadType = payloadType;
+        rtp.sequenceNumber = sequenceNumber++;
+        rtp.timestamp = timestamp;
+        rtp.ssrc = ssrc;
+        WriteRtpHeader(header, rtp);
+
+        packetStarts.push_back(slices.size());
+        packets.push_back({ nullptr, 0, 0 });
+        AddSlice(header, headerSize);
+        return header + kRtpHeaderSize;
+    }
+
+    void HevcRtpPayloader::AddSlice(const void* data, size_t size) {
+        slices.push_back({ data, size });
+        packets.back().sliceCount++;
+        packets.back().size += size;
+    }
+
+    void HevcRtpPayloader::EmitSingle(const NalUnit& unit, uint32_t timestamp) {
+        BeginPacket(timestamp, kRtpHeaderSize);
+        AddSlice(unit.data, unit.size);
+    }
+
+    void HevcRtpPayloader::EmitAggregate(size_t first, size_t count, uint32_t timestamp) {
+        // PayloadHdr: F is set if any unit has it, LayerId and TID are the lowest (RFC 7798 4.4.2)
+        uint8_t forbidden = 0;
+        uint8_t layerId = 0x3F;
+        uint8_t tid = 0x07;
+        for (size_t i = first; i < first + count; i++) {
+            const uint8_t* nal = units[i].data;
+            forbidden |= nal[0] & 0x80;
+            uint8_t unitLayer = static_cast<uint8_t>(((nal[0] & 0x01) << 5) | (nal[1] >> 3));
+            if (unitLayer < layerId) layerId = unitLayer;
+            if ((nal[1] & 0x07) < tid) tid = nal[1] & 0x07;
+        }
+
+        uint8_t* payloadHeader = BeginPacket(timestamp, kRtpHeaderSize + kPayloadHeaderSize + kApSizeField);
+        payloadHeader[0] = static_cast<uint8_t>(forbidden | (kAggregationPacket << 1) | (layerId >> 5));
+        payloadHeader[1] = static_cast<uint8_t>(((layerId & 0x1F) << 3) | tid);
+
+        // The first size field shares the packet header slice, later ones get their own
+        uint8_t* sizeField = payloadHeader + kPayloadHeaderSize;
+        for (size_t i = first; i < first + count; i++) {
+            if (i != first) {
+                sizeField = headerArena.data() + arenaUsed;
+                arenaUsed += kApSizeField;
+                AddSlice(sizeField, kApSizeField);
+            }
+            sizeField[0] = static_cast<uint8_t>(units[i].size >> 8);
+            sizeField[1] = static_cast<uint8_t>(units[i].size);
+            AddSlice(units[i].data, units[i].size);
+        }
+    }
+
+    void HevcRtpPayloader::EmitFragments(const NalUnit& unit, uint32_t timestamp) {
+        // The NAL unit header is carried in PayloadHdr and the FU header,
+        // the fragments split what follows it
+        const uint8_t* body = unit.data + kPayloadHeaderSize;
+        size_t remaining = unit.size - kPayloadHeaderSize;
+        size_t fragmentPayload = maxPacketSize - kMaxPacketHeader;
+        uint8_t type = NalType(unit.data);
+
+        bool isFirst = true;
+        while (remaining > 0) {
+            size_t chunk = remaining < fragmentPayload ? remaining : fragmentPayload;
+            bool isLast = chunk == remaining;
+
+            uint8_t* payloadHeader = BeginPacket(timestamp, kMaxPacketHeader);
+            payloadHeader[0] = static_cast<uint8_t>((unit.data[0] & 0x81) | (kFragmentationUnit << 1));
+            payloadHeader[1] = unit.data[1];
+            payloadHeader[2] = static_cast<uint8_t>((isFirst ? 0x80 : 0) | (isLast ? 0x40 : 0) | type);
+            AddSlice(body, chunk);
+
+            body += chunk;
+            remaining -= chunk;
+            isFirst = false;
+        }
+    }
+
+    void HevcRtpDepayloader::Push(const RtpHeader& header, const uint8_t* payload, size_t size) {
+        if (hasSequence) {
+            int16_t distance = SequenceDistance(lastSequence, header.sequenceNumber);
+            if (distance <= 0) {
+                stats.packetsLate++;
+                return;
+            }
+            if (distance > 1) {
+                stats.packetsLost += distance - 1;
+                // A fragmented unit can't span the gap, and whatever is
+                // being assembled may have lost its tail
+                DiscardFragment();
+                if (hasCurrent) current.isComplete = false;
+                if (hasCurrent && header.timestamp != current.timestamp) FinishAccessUnit();
+                // The gap may also have held the head of this packet's access unit
+                if (!hasCurrent) BeginAccessUnit(header.timestamp, false);
+            }
+        }
+        hasSequence = true;
+        lastSequence = header.sequenceNumber;
+        stats.packetsReceived++;
+
+        // Marker lost: a new timestamp still ends the previous access unit
+        if (hasCurrent && header.timestamp != current.timestamp) {
+            current.isComplete = false;
+            FinishAccessUnit();
+        }
+        if (!hasCurrent) BeginAccessUnit(header.timestamp, true);
+
+        if (size < kPayloadHeaderSize) {
+            stats.packetsInvalid++;
+        }
+        else {
+            uint8_t type = NalType(payload);
+            if (type == kAggregationPacket) {
+                size_t offset = kPayloadHeaderSize;
+                while (offset + kApSizeField <= size) {
+                    size_t unitSize = (static_cast<size_t>(payload[offset]) << 8) | payload[offset + 1];
+                    offset += kApSizeField;
+                    if (unitSize < kPayloadHeaderSize || offset + unitSize > size) {
+                        stats.packetsInvalid++;
+                        break;
+                    }
+                    AppendNalUnit(payload + offset, unitSize);
+                    offset += unitSize;
+                }
+            }
+            else if (type == kFragmentationUnit) {
+                HandleFragment(payload, size);
+            }
+            else if (type < kAggregationPacket) {
+                AppendNalUnit(payload, size);
+            }
+            else {
+                // PACI and reserved types
+                stats.packetsInvalid++;
+            }
+        }
+
+        if (header.marker) FinishAccessUnit();
+    }
+
+    void HevcRtpDepayloader::HandleFragment(const uint8_t* payload, size_t size) {
+        if (size <= kPayloadHeaderSize + kFuHeaderSize) {
+            stats.packetsInvalid++;
+            return;
+        }
+        uint8_t fuHeader = payload[kPayloadHeaderSize];
+        bool isStart = (fuHeader & 0x80) != 0;
+        bool isEnd = (fuHeader & 0x40) != 0;
+        const uint8_t* body = payload + kPayloadHeaderSize + kFuHeaderSize;
+        size_t bodySize = size - kPayloadHeaderSize - kFuHeaderSize;
+
+        if (isStart) {
+            if (fragmentOpen) {
+                // Previous unit never got its end fragment
+                DiscardFragment();
+                current.isComplete = false;
+            }
+            fragmentStart = current.data.size();
+            fragmentOpen = true;
+            current.data.insert(current.data.end(), kStartCode, kStartCode + sizeof(kStartCode));
+
+            // Rebuild the NAL unit header from PayloadHdr with the FU's type
+            uint8_t type = fuHeader & 0x3F;
+            current.data.push_back(static_cast<uint8_t>((payload[0] & 0x81) | (type << 1)));
+            current.data.push_back(payload[1]);
+            if (IsIrap(type)) current.isKeyFrame = true;
+        }
+        else if (!fragmentOpen) {
+            // Start fragment was lost, the gap already marked the access unit
+            return;
+        }
+
+        current.data.insert(current.data.end(), body, body + bodySize);
+        if (isEnd) fragmentOpen = false;
+    }
+
+    void HevcRtpDepayloader::AppendNalUnit(const uint8_t* data, size_t size) {
+        if (fragmentOpen) {
+            DiscardFragment();
+            current.isComplete = false;
+        }
+        current.data.insert(current.data.end(), kStartCode, kStartCode + sizeof(kStartCode));
+        current.data.insert(current.data.end(), data, data + size);
+        if (IsIrap(NalType(data))) current.isKeyFrame = true;
+    }
+
+    void HevcRtpDepayloader::DiscardFragment() {
+        if (!fragmentOpen) return;
+        current.data.resize(fragmentStart);
+        fragmentOpen = false;
+    }
+
+    void HevcRtpDepayloader::BeginAccessUnit(uint32_t timestamp, bool isComplete) {
+        hasCurrent = true;
+        current.timestamp = timestamp;
+        current.isComplete = isComplete;
+        current.isKeyFrame = false;
+        current.data.clear();
+        if (current.data.capacity() == 0 && !spareBuffers.empty()) {
+            current.data.swap(spareBuffers.back());
+            spareBuffers.pop_back();
+        }
+    }
+
+    void HevcRtpDepayloader::FinishAccessUnit() {
+        if (!hasCurrent) return;
+        if (fragmentOpen) {
+            DiscardFragment();
+            current.isComplete = false;
+        }
+        hasCurrent = false;
+        if (current.data.empty()) return;
+
+        stats.accessUnits++;
+        if (!current.isComplete) stats.accessUnitsIncomplete++;
+        ready.push_back(std::move(current));
+        current = HevcAccessUnit();
+    }
+
+    bool HevcRtpDepayloader::Pop(HevcAccessUnit& out) {
+        if (ready.empty()) return false;
+        if (out.data.capacity() > 0) {
+            out.data.clear();
+            spareBuffers.push_back(std::move(out.data));
+        }
+        out = std::move(ready.front());
+        ready.pop_front();
+        return true;
+    }
+}
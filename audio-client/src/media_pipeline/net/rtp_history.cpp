@@ -0,0 +1,72 @@
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#include "media_pipeline/net/rtp_history.h"
+
+namespace media_pipeline::net {
+    namespace {
+        // 16 bit sequence numbers can't tell more slots apart than this
+        constexpr size_t kMaxCapacity = 32768;
+
+        size_t RoundUpToPowerOfTwo(size_t value) {
+            size_t result = 1;
+            while (result < value && result < kMaxCapacity) result <<= 1;
+            return result;
+        }
+    }
+
+    RtpPacketHistory::RtpPacketHistory(size_t capacity, uint64_t maxAgeNanos)
+        : slots(RoundUpToPowerOfTwo(capacity))
+        , maxAge(maxAgeNanos) {
+        arena.resize(slots.size() * kRtpMaxPacketSize);
+        mask = slots.size() - 1;
+    }
+
+    void RtpPacketHistory::Store(uint16_t sequenceNumber, const IoSlice* slices, size_t count, uint64_t now) {
+        size_t index = sequenceNumber & mask;
+        Slot& slot = slots[index];
+        slot.isUsed = false;
+
+        uint8_t* out = arena.data() + index * kRtpMaxPacketSize;
+        size_t size = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (size + slices[i].size > kRtpMaxPacketSize) return;
+            std::memcpy(out + size, slices[i].data, slices[i].size);
+            size += slices[i].size;
+        }
+
+        slot.sentAt = now;
+        slot.resentAt = 0;
+        slot.size = static_cast<uint32_t>(size);
+        slot.sequenceNumber = sequenceNumber;
+        slot.isUsed = true;
+    }
+
+    const uint8_t* RtpPacketHistory::Find(uint16_t sequenceNumber, uint64_t now, size_t& size) const {
+        size_t index = sequenceNumber & mask;
+        const Slot& slot = slots[index];
+        if (!slot.isUsed || slot.sequenceNumber != sequenceNumber || now - slot.sentAt > maxAge) {
+            return nullptr;
+        }
+        size = slot.size;
+        return arena.data() + index * kRtpMaxPacketSize;
+    }
+
+    bool RtpPacketHistory::MarkResent(uint16_t sequenceNumber, uint64_t now, uint64_t minInterval) {
+        Slot& slot = slots[sequenceNumber & mask];
+        if (!slot.isUsed || slot.sequenceNumber != sequenceNumber) return false;
+        if (slot.resentAt != 0 && now - slot.resentAt < minInterval) return false;
+        slot.resentAt = now;
+        return true;
+    }
+
+    bool RtpPacketHistory::GetSendInfo(uint16_t sequenceNumber, uint64_t& sentAt, size_t& size) const {
+        const Slot& slot = slots[sequenceNumber & mask];
+        if (!slot.isUsed || slot.sequenceNumber != sequenceNumber) return false;
+        sentAt = slot.sentAt;
+        size = slot.size;
+        return true;
+    }
+}
@@ -0,0 +1,490 @@
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include <mutex>
+
+#include "media_pipeline/net/rtp_session.h"
+#include "media_pipeline/net/rtp.h"
+#include "media_pipeline/net/rtcp.h"
+#include "media_pipeline/net/rtp_history.h"
+#include "media_pipeline/net/congestion_controller.h"
+#include "media_pipeline/core/bitrate_allocator.h"
+
+namespace media_pipeline::net {
+    namespace {
+        constexpr uint64_t kNanosPerSecond = 1000000000;
+        constexpr uint64_t kDefaultNackInterval = 50000000;    // Until a round trip was measured
+        constexpr uint64_t kMinNackInterval = 10000000;
+        constexpr uint64_t kDefaultResendInterval = 100000000;  // Until a round trip was measured
+
+        uint64_t ToNanos(std::chrono::milliseconds duration) {
+            return static_cast<uint64_t>(duration.count()) * 1000000;
+        }
+    }
+
+    RtpSenderSession::RtpSenderSession(uint32_t ssrc, uint32_t clockRate, RtpSenderSessionOptions options)
+        : ssrc(ssrc)
+        , clockRate(clockRate)
+        , options(options)
+        , history(options.historyPackets, ToNanos(options.historyAge))
+        , hasSent(false)
+        , lastRtpTimestamp(0)
+        , lastSentAt(0)
+        , packetCount(0)
+        , octetCount(0)
+        , nextReportAt(0)
+        , hasReportTime(false)
+        , reportTime(0) {
+        if (options.congestionController && options.bitrateAllocator) {
+            // Encoders start from the controller's start rate rather than
+            // their own defaults, then follow every change
+            std::shared_ptr<core::BitrateAllocator> allocator = options.bitrateAllocator;
+            options.congestionController->SetObserver([allocator](int kbps) { allocator->SetTotalBitrate(kbps); });
+            allocator->SetTotalBitrate(options.congestionController->TargetBitrateKbps());
+        }
+    }
+
+    void RtpSenderSession::OnPacketSent(uint16_t sequenceNumber, uint32_t rtpTimestamp,
+        const IoSlice* slices, size_t count, uint64_t now) {
+        history.Store(sequenceNumber, slices, count, now);
+
+        size_t size = 0;
+        for (size_t i = 0; i < count; i++) size += slices[i].size;
+        if (!hasSent) nextReportAt = now;
+        hasSent = true;
+        lastRtpTimestamp = rtpTimestamp;
+        lastSentAt = now;
+        packetCount++;
+        octetCount += static_cast<uint32_t>(size > kRtpHeaderSize ? size - kRtpHeaderSize : 0);
+    }
+
+    void RtpSenderSession::Service(Socket& socket, uint64_t now) {
+        while (true) {
+            ptrdiff_t received;
+            try {
+                received = socket.Receive(buffer, sizeof(buffer));
+            }
+            catch (const std::runtime_error&) {
+                // ICMP errors from a receiver that isn't up yet surface here
+                break;
+            }
+            if (received <= 0) break;
+            if (IsRtcpPacket(buffer, static_cast<size_t>(received))) {
+                HandleRtcp(socket, buffer, static_cast<size_t>(received), now);
+            }
+        }
+
+        if (hasSent && now >= nextReportAt) {
+            RtcpSenderInfo info;
+            info.ntpTimestamp = NtpFromNanos(now);
+            // Extrapolate the RTP clock from the latest packet to now
+            info.rtpTimestamp = lastRtpTimestamp +
+                static_cast<uint32_t>((now - lastSentAt) * clockRate / kNanosPerSecond);
+            info.packetCount = packetCount;
+            info.octetCount = octetCount;
+            size_t size = WriteSenderReport(buffer, sizeof(buffer), ssrc, info);
+            try {
+                socket.Send(buffer, size);
+            }
+            catch (const std::runtime_error&) {
+            }
+            nextReportAt = now + ToNanos(options.reportInterval);
+        }
+    }
+
+    void RtpSenderSession::HandleRtcp(Socket& socket, const uint8_t* data, size_t size, uint64_t now) {
+        if (!ParseRtcp(data, size, feedback)) return;
+
+        std::lock_guard<std::mutex> lock(statsMutex);
+        for (const RtcpReportBlock& report : feedback.reports) {
+            if (report.ssrc != ssrc) continue;
+            stats.reportsReceived++;
+            stats.fractionLost = report.fractionLost / 256.0;
+            stats.cumulativeLost = static_cast<uint64_t>(std::max(0, report.cumulativeLost));
+            stats.jitterMs = report.jitter * 1000.0 / clockRate;
+            if (report.lastSenderReport != 0) {
+                // RFC 3550 6.4.1: arrival - LSR - DLSR, all in 1/65536 s
+                uint32_t rtt = CompactNtp(NtpFromNanos(now)) - report.lastSenderReport - report.delaySinceLastSenderReport;
+                if (rtt < 0x80000000u) {
+                    stats.rttMs = rtt * 1000.0 / 65536.0;
+                    if (options.congestionController) options.congestionController->OnRoundTripTime(stats.rttMs);
+                }
+            }
+        }
+        if (!feedback.arrivals.empty() && options.congestionController) HandleArrivals(now);
+
+        uint64_t resendInterval = feedback.nacks.empty() ? 0 : ResendInterval();
+        for (uint16_t sequenceNumber : feedback.nacks) {
+            stats.nacksReceived++;
+            size_t packetSize;
+            const uint8_t* packet = history.Find(sequenceNumber, now, packetSize);
+            if (!packet) {
+                stats.retransmissionMisses++;
+                continue;
+            }
+            if (!history.MarkResent(sequenceNumber, now, resendInterval)) {
+                stats.retransmissionsSkipped++;
+                continue;
+            }
+            size_t sent = 0;
+            try {
+                sent = socket.Send(packet, packetSize);
+            }
+            catch (const std::runtime_error&) {
+            }
+            if (sent > 0) stats.packetsRetransmitted++;
+        }
+    }
+
+    uint64_t RtpSenderSession::ResendInterval() const {
+        // A resend is answered a round trip later, plus whatever queue it
+        // joins on the way; the report RTT is seldom fresh enough to
+        // include the queue
+        double ms = stats.rttMs;
+        if (ms == 0) return kDefaultResendInterval;
+        if (options.congestionController) ms += options.congestionController->GetStats().queueDelayMs;
+        return static_cast<uint64_t>(ms * 1e6);
+    }
+
+    void RtpSenderSession::HandleArrivals(uint64_t now) {
+        // Offsets count back from the report time, on the receiver's clock
+        if (!hasReportTime) {
+            hasReportTime = true;
+            reportTime = feedback.arrivalReportTime;
+        }
+        else {
+            reportTime += static_cast<int32_t>(feedback.arrivalReportTime - static_cast<uint32_t>(reportTime));
+        }
+        int64_t reportNanos = static_cast<int64_t>(reportTime * kNanosPerSecond / 65536);
+
+        packetResults.clear();
+        for (const RtcpPacketArrival& arrival : feedback.arrivals) {
+            PacketResult result;
+            if (!history.GetSendInfo(arrival.sequenceNumber, result.sendTime, result.size)) continue;
+            result.isReceived = arrival.isReceived;
+            result.arrivalTime = reportNanos - static_cast<int64_t>(arrival.arrivalOffset * kNanosPerSecond / 1024);
+            packetResults.push_back(result);
+        }
+        options.congestionController->OnPacketFeedback(packetResults.data(), packetResults.size(), now);
+    }
+
+    RtpFeedbackStats RtpSenderSession::GetStats() const {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        return stats;
+    }
+
+    RtpReceiverSession::RtpReceiverSession(uint32_t clockRate, RtpReceiverSessionOptions options)
+        : clockRate(clockRate)
+        , options(options)
+        , ssrc(RandomRtpValue())
+        , mediaSsrc(0)
+        , heldCount(0)
+        , hasExpected(false)
+        , expected(0)
+        , maxSequence(0)
+        , extendedBase(0)
+        , extendedMax(0)
+        , receivedCount(0)
+        , expectedPrior(0)
+        , receivedPrior(0)
+        , lastTransit(0)
+        , jitter(0)
+        , fractionLost(0)
+        , lastSenderReport(0)
+        , lastSenderReportArrival(0)
+        , nextReportAt(0)
+        , arrivalLog(kArrivalLogSize)
+        , hasArrivals(false)
+        , arrivalBegin(0)
+        , arrivalEnd(0)
+        , nextCongestionFeedbackAt(0)
+        , rttNanos(0) {
+        size_t capacity = 1;
+        while (capacity < options.reorderPackets && capacity < 32768) capacity <<= 1;
+        slots.resize(capacity);
+        arena.resize(capacity * kSlotSize);
+        mask = capacity - 1;
+        missing.reserve(kMaxMissing);
+        nackList.reserve(kMaxMissing);
+        arrivalReports.reserve(kRtcpMaxCongestionReports);
+    }
+
+    void RtpReceiverSession::Insert(const RtpHeader& header, const uint8_t* packet, size_t size, uint64_t arrival) {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        stats.packetsReceived++;
+        receivedCount++;
+
+        if (!hasExpected) {
+            mediaSsrc = header.ssrc;
+            Reset(header.sequenceNumber);
+            extendedBase = extendedMax = header.sequenceNumber;
+            maxSequence = header.sequenceNumber;
+            nextReportAt = arrival + ToNanos(options.reportInterval);
+        }
+        RecordArrival(header.sequenceNumber, arrival);
+
+        int distance = SequenceDistance(expected, header.sequenceNumber);
+        if (distance < 0) {
+            // Its turn has passed; a retransmission that came too late
+            RemoveMissing(header.sequenceNumber, 0);
+            stats.packetsLate++;
+            return;
+        }
+        if (static_cast<size_t>(distance) > mask) {
+            // Too far ahead for the arena: everything held is older than
+            // the receiver can still use, start over from this packet
+            stats.packetsLost += heldCount;
+            Reset(header.sequenceNumber);
+        }
+
+        Slot& slot = slots[header.sequenceNumber & mask];
+        if (slot.isHeld && slot.sequenceNumber == header.sequenceNumber) return;     // Duplicate
+        if (size > kSlotSize) return;
+
+        TrackArrival(header, arrival);
+
+        std::memcpy(arena.data() + (header.sequenceNumber & mask) * kSlotSize, packet, size);
+        slot.arrival = arrival;
+        slot.size = static_cast<uint32_t>(size);
+        slot.sequenceNumber = header.sequenceNumber;
+        slot.isHeld = true;
+        heldCount++;
+    }
+
+    void RtpReceiverSession::Reset(uint16_t sequenceNumber) {
+        for (Slot& slot : slots) slot.isHeld = false;
+        heldCount = 0;
+        hasExpected = true;
+        expected = sequenceNumber;
+        missing.clear();
+    }
+
+    void RtpReceiverSession::TrackArrival(const RtpHeader& header, uint64_t arrival) {
+        int distance = SequenceDistance(maxSequence, header.sequenceNumber);
+        if (distance <= 0) {
+            // Filled an earlier gap
+            RemoveMissing(header.sequenceNumber, arrival);
+            return;
+        }
+
+        if (distance > 1) AddMissing(static_cast<uint16_t>(maxSequence + 1), static_cast<uint16_t>(distance - 1), arrival);
+        maxSequence = header.sequenceNumber;
+        extendedMax += distance;
+
+        // Interarrival jitter from in order packets only, a retransmission's
+        // transit time says nothing about the path
+        double arrivalRtp = static_cast<double>(arrival) * clockRate / kNanosPerSecond;
+        double transit = arrivalRtp - header.timestamp;
+        if (lastTransit != 0) {
+            double delta = std::fabs(transit - lastTransit);
+            // Timestamps wrap every 2^32 ticks; ignore the sample that crosses it
+            if (delta < 2147483648.0) jitter += (delta - jitter) / 16.0;
+        }
+        lastTransit = transit;
+    }
+
+    void RtpReceiverSession::AddMissing(uint16_t first, uint16_t count, uint64_t now) {
+        if (options.maxRecoveryDelay.count() == 0) return;
+        for (uint16_t i = 0; i < count && missing.size() < kMaxMissing; i++) {
+            missing.push_back({ static_cast<uint16_t>(first + i), now, 0, 0 });
+        }
+    }
+
+    void RtpReceiverSession::RemoveMissing(uint16_t sequenceNumber, uint64_t now) {
+        for (size_t i = 0; i < missing.size(); i++) {
+            if (missing[i].sequenceNumber != sequenceNumber) continue;
+            if (missing[i].retries > 0 && now != 0) {
+                stats.packetsRecovered++;
+                // Only the first NACK's answer is unambiguous
+                if (missing[i].retries == 1) {
+                    double sample = static_cast<double>(now - missing[i].lastNackAt);
+                    rttNanos = rttNanos == 0 ? sample : rttNanos * 0.875 + sample * 0.125;
+                }
+            }
+            missing.erase(missing.begin() + i);
+            return;
+        }
+    }
+
+    uint64_t RtpReceiverSession::NackRetryInterval() const {
+        if (rttNanos == 0) return kDefaultNackInterval;
+        return std::max(kMinNackInterval, static_cast<uint64_t>(rttNanos * 1.5));
+    }
+
+    void RtpReceiverSession::RecordArrival(uint16_t sequenceNumber, uint64_t arrival) {
+        if (options.congestionFeedbackInterval.count() == 0) return;
+        if (!hasArrivals) {
+            hasArrivals = true;
+            arrivalBegin = arrivalEnd = sequenceNumber;
+            nextCongestionFeedbackAt = arrival + ToNanos(options.congestionFeedbackInterval);
+        }
+        // Already reported as lost; the sender has moved on
+        if (SequenceDistance(arrivalBegin, sequenceNumber) < 0) return;
+
+        ArrivalRecord& record = arrivalLog[sequenceNumber & (kArrivalLogSize - 1)];
+        if (record.isSet && record.sequenceNumber == sequenceNumber) return;     // Duplicate
+        record.arrival = arrival;
+        record.sequenceNumber = sequenceNumber;
+        record.isSet = true;
+        if (SequenceDistance(arrivalEnd, sequenceNumber) >= 0) arrivalEnd = static_cast<uint16_t>(sequenceNumber + 1);
+    }
+
+    size_t RtpReceiverSession::WriteArrivals(uint8_t* out, size_t capacity, uint64_t now) {
+        // Header, SSRC block and report timestamp take 20 bytes, each report 2
+        if (capacity < 24) return 0;
+        size_t maxCount = std::min(kRtcpMaxCongestionReports, (capacity - 20) / 4 * 2);
+
+        // More than one report holds: the oldest ones go unreported, which
+        // the sender takes as neither received nor lost
+        size_t count = static_cast<uint16_t>(arrivalEnd - arrivalBegin);
+        if (count > maxCount) {
+            arrivalBegin = static_cast<uint16_t>(arrivalEnd - maxCount);
+            count = maxCount;
+        }
+
+        arrivalReports.clear();
+        for (size_t i = 0; i < count; i++) {
+            uint16_t sequenceNumber = static_cast<uint16_t>(arrivalBegin + i);
+            ArrivalRecord& record = arrivalLog[sequenceNumber & (kArrivalLogSize - 1)];
+            RtcpPacketArrival report;
+            report.sequenceNumber = sequenceNumber;
+            if (record.isSet && record.sequenceNumber == sequenceNumber) {
+                report.isReceived = true;
+                uint64_t offset = (now - record.arrival) * 1024 / kNanosPerSecond;
+                report.arrivalOffset = static_cast<uint16_t>(std::min<uint64_t>(offset, kRtcpMaxArrivalOffset));
+                record.isSet = false;
+            }
+            arrivalReports.push_back(report);
+        }
+
+        size_t size = WriteCongestionFeedback(out, capacity, ssrc, mediaSsrc, arrivalBegin,
+            arrivalReports.data(), arrivalReports.size(), CompactNtp(NtpFromNanos(now)));
+        if (size > 0) arrivalBegin = arrivalEnd;
+        return size;
+    }
+
+    bool RtpReceiverSession::Pop(uint64_t now, const uint8_t*& packet, size_t& size) {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        while (heldCount > 0) {
+            Slot& slot = slots[expected & mask];
+            if (slot.isHeld && slot.sequenceNumber == expected) {
+                slot.isHeld = false;
+                heldCount--;
+                packet = arena.data() + (expected & mask) * kSlotSize;
+                size = slot.size;
+                expected++;
+                return true;
+            }
+
+            // A gap: wait for it as long as the first packet held behind it allows
+            uint64_t gapNoticed = now;
+            for (uint16_t next = static_cast<uint16_t>(expected + 1); ; next++) {
+                const Slot& held = slots[next & mask];
+                if (held.isHeld && held.sequenceNumber == next) {
+                    gapNoticed = held.arrival;
+                    break;
+                }
+            }
+            if (now - gapNoticed < ToNanos(options.maxRecoveryDelay)) return false;
+
+            RemoveMissing(expected, 0);
+            stats.packetsLost++;
+            expected++;
+        }
+        return false;
+    }
+
+    void RtpReceiverSession::OnRtcp(const uint8_t* data, size_t size, uint64_t arrival) {
+        if (!ParseRtcp(data, size, feedback)) return;
+        std::lock_guard<std::mutex> lock(statsMutex);
+        if (feedback.hasSenderInfo && feedback.senderSsrc == mediaSsrc) {
+            lastSenderReport = feedback.senderInfo.ntpTimestamp;
+            lastSenderReportArrival = arrival;
+        }
+    }
+
+    size_t RtpReceiverSession::BuildFeedback(uint8_t* out, size_t capacity, uint64_t now) {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        if (!hasExpected) return 0;
+
+        // Sequence numbers due for a NACK. Entries stay after their last
+        // retry so a late answer still counts as recovered, until Pop
+        // skips past them.
+        nackList.clear();
+        uint64_t retryInterval = NackRetryInterval();
+        for (size_t i = 0; i < missing.size();) {
+            Missing& entry = missing[i];
+            if (SequenceDistance(expected, entry.sequenceNumber) < 0) {
+                missing.erase(missing.begin() + i);
+                continue;
+            }
+            if (entry.retries < options.maxNackRetries && entry.nextNackAt <= now) {
+                nackList.push_back(entry.sequenceNumber);
+                entry.retries++;
+                entry.lastNackAt = now;
+                entry.nextNackAt = now + retryInterval;
+            }
+            i++;
+        }
+
+        bool isReportDue = !nackList.empty() || now >= nextReportAt;
+        bool isCongestionFeedbackDue = hasArrivals && arrivalEnd != arrivalBegin && now >= nextCongestionFeedbackAt;
+        if (!isReportDue && !isCongestionFeedbackDue) return 0;
+
+        size_t size = 0;
+        if (isReportDue) size = WriteReport(out, capacity, now);
+        if (isCongestionFeedbackDue && size < capacity) {
+            size += WriteArrivals(out + size, capacity - size, now);
+            nextCongestionFeedbackAt = now + ToNanos(options.congestionFeedbackInterval);
+        }
+        return size;
+    }
+
+    size_t RtpReceiverSession::WriteReport(uint8_t* out, size_t capacity, uint64_t now) {
+        // RFC 3550 A.3
+        uint64_t expectedCount = extendedMax - extendedBase + 1;
+        uint64_t expectedInterval = expectedCount - expectedPrior;
+        uint64_t receivedInterval = receivedCount - receivedPrior;
+        expectedPrior = expectedCount;
+        receivedPrior = receivedCount;
+        if (expectedInterval > receivedInterval) {
+            fractionLost = static_cast<uint8_t>(std::min<uint64_t>(255, ((expectedInterval - receivedInterval) << 8) / expectedInterval));
+        }
+        else {
+            fractionLost = 0;
+        }
+
+        RtcpReportBlock block;
+        block.ssrc = mediaSsrc;
+        block.fractionLost = fractionLost;
+        block.cumulativeLost = static_cast<int32_t>(static_cast<int64_t>(expectedCount) - static_cast<int64_t>(receivedCount));
+        block.highestSequence = static_cast<uint32_t>(extendedMax);
+        block.jitter = static_cast<uint32_t>(jitter);
+        if (lastSenderReport != 0) {
+            block.lastSenderReport = CompactNtp(lastSenderReport);
+            block.delaySinceLastSenderReport = static_cast<uint32_t>((now - lastSenderReportArrival) * 65536 / kNanosPerSecond);
+        }
+
+        size_t size = WriteReceiverReport(out, capacity, ssrc, block);
+        if (size > 0 && !nackList.empty()) {
+            size_t nacked = 0;
+            size += WriteNack(out + size, capacity - size, ssrc, mediaSsrc, nackList.data(), nackList.size(), &nacked);
+            stats.nacksSent += nacked;
+        }
+        nextReportAt = now + ToNanos(options.reportInterval);
+
+        stats.fractionLost = fractionLost / 256.0;
+        return size;
+    }
+
+    RtpSourceStats RtpReceiverSession::GetStats() const {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        RtpSourceStats result = stats;
+        result.jitterMs = jitter * 1000.0 / clockRate;
+        result.rttMs = rttNanos / 1e6;
+        return result;
+    }
+}
@@ -0,0 +1,518 @@
+#include <string>
+#include <stdexcept>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <WinSock2.h>
+#include <WS2tcpip.h>
+#include <mstcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netinet/udp.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+#include "media_pipeline/net/socket.h"
+
+namespace media_pipeline::net {
+    namespace {
+#ifdef _WIN32
+        int LastError() { return WSAGetLastError(); }
+        bool WouldBlock(int error) { return error == WSAEWOULDBLOCK; }
+        bool Interrupted(int error) { return error == WSAEINTR; }
+        void CloseHandle(SocketHandle handle) { closesocket(static_cast<SOCKET>(handle)); }
+#else
+        int LastError() { return errno; }
+        bool WouldBlock(int error) { return error == EAGAIN || error == EWOULDBLOCK; }
+        bool Interrupted(int error) { return error == EINTR; }
+        void CloseHandle(SocketHandle handle) { ::close(handle); }
+#endif
+
+        [[noreturn]] void ThrowSocketError(const std::string& what, int error) {
+#ifdef _WIN32
+            throw std::runtime_error(what + " (WSA error " + std::to_string(error) + ")");
+#else
+            throw std::runtime_error(what + ": " + std::strerror(error));
+#endif
+        }
+
+        sockaddr_in ResolveIpv4(const std::string& address, uint16_t port) {
+            sockaddr_in socketAddress = {};
+            socketAddress.sin_family = AF_INET;
+            socketAddress.sin_port = htons(port);
+            if (inet_pton(AF_INET, address.c_str(), &socketAddress.sin_addr) != 1) {
+                throw std::runtime_error("Invalid IPv4 address " + address);
+            }
+            return socketAddress;
+        }
+
+        SocketHandle NewTcpSocket() {
+#ifdef _WIN32
+            SOCKET raw = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+            if (raw == INVALID_SOCKET) ThrowSocketError("Failed to create TCP socket", LastError());
+            return static_cast<SocketHandle>(raw);
+#else
+            int raw = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP);
+            if (raw < 0) ThrowSocketError("Failed to create TCP socket", LastError());
+#ifdef SO_NOSIGPIPE
+            int one = 1;
+            setsockopt(raw, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+            return raw;
+#endif
+        }
+
+#if !defined(_WIN32) && defined(MSG_NOSIGNAL)
+        constexpr int kSendFlags = MSG_NOSIGNAL;   // A closed peer is an error, not SIGPIPE
+#else
+        constexpr int kSendFlags = 0;
+#endif
+
+        SocketHandle NewUdpSocket() {
+#ifdef _WIN32
+            SOCKET raw = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+            if (raw == INVALID_SOCKET) ThrowSocketError("Failed to create UDP socket", LastError());
+            // Otherwise an ICMP port unreachable fails the next receive
+            BOOL reportReset = FALSE;
+            DWORD returned = 0;
+            WSAIoctl(raw, SIO_UDP_CONNRESET, &reportReset, sizeof(reportReset), nullptr, 0, &returned, nullptr, nullptr);
+            return static_cast<SocketHandle>(raw);
+#else
+            int raw = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, IPPROTO_UDP);
+            if (raw < 0) ThrowSocketError("Failed to create UDP socket", LastError());
+            return raw;
+#endif
+        }
+
+        std::atomic<int> runtimeUsers{ 0 };
+    }
+
+    SocketAddress ResolveSocketAddress(const std::string& address, uint16_t port) {
+        sockaddr_in socketAddress = ResolveIpv4(address, port);
+        SocketAddress result;
+        std::memcpy(result.storage, &socketAddress, sizeof(socketAddress));
+        result.length = sizeof(socketAddress);
+        return result;
+    }
+
+    SocketRuntime::SocketRuntime() {
+#ifdef _WIN32
+        if (runtimeUsers.fetch_add(1) == 0) {
+            WSADATA wsaData;
+            if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+                runtimeUsers--;
+                throw std::runtime_error("WSAStartup failed");
+            }
+        }
+#endif
+    }
+
+    SocketRuntime::~SocketRuntime() {
+#ifdef _WIN32
+        if (runtimeUsers.fetch_sub(1) == 1) {
+            WSACleanup();
+        }
+#endif
+    }
+
+    Socket::Socket()
+        : handle(kInvalidSocket) {
+    }
+
+    Socket::Socket(SocketHandle handle)
+        : handle(handle) {
+    }
+
+    Socket::~Socket() {
+        Close();
+    }
+
+    Socket::Socket(Socket&& other) noexcept
+        : handle(other.handle) {
+        other.handle = kInvalidSocket;
+    }
+
+    Socket& Socket::operator=(Socket&& other) noexcept {
+        if (this != &other) {
+            Close();
+            handle = other.handle;
+            other.handle = kInvalidSocket;
+        }
+        return *this;
+    }
+
+    Socket Socket::ConnectTcp(const std::string& address, uint16_t port) {
+        sockaddr_in serverAddress = ResolveIpv4(address, port);
+        Socket socket(NewTcpSocket());
+
+        int result;
+        do {
+            result = ::connect(socket.handle, reinterpret_cast<const sockaddr*>(&serverAddress), sizeof(serverAddress));
+        } while (result != 0 && Interrupted(LastError()));
+        if (result != 0) {
+            ThrowSocketError("Failed to connect TCP socket to " + address + ":" + std::to_string(port), LastError());
+        }
+        return socket;
+    }
+
+    Socket Socket::ListenTcp(const std::string& address, uint16_t port, int backlog) {
+        sockaddr_in localAddress = ResolveIpv4(address, port);
+        Socket socket(NewTcpSocket());
+
+        int one = 1;
+        setsockopt(socket.handle, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&one), sizeof(one));
+        if (::bind(socket.handle, reinterpret_cast<const sockaddr*>(&localAddress), sizeof(localAddress)) != 0) {
+            ThrowSocketError("Failed to bind TCP socket to " + address + ":" + std::to_string(port), LastError());
+        }
+        if (::listen(socket.handle, backlog) != 0) {
+            ThrowSocketError("Failed to listen on TCP socket", LastError());
+        }
+        return socket;
+    }
+
+    Socket Socket::OpenUdp(const std::string& address, uint16_t port) {
+        sockaddr_in localAddress = ResolveIpv4(address, port);
+        Socket socket(NewUdpSocket());
+        if (::bind(socket.handle, reinterpret_cast<const sockaddr*>(&localAddress), sizeof(localAddress)) != 0) {
+            ThrowSocketError("Failed to bind UDP socket to " + address + ":" + std::to_string(port), LastError());
+        }
+        return socket;
+    }
+
+    void Socket::Connect(const std::string& address, uint16_t port) {
+        sockaddr_in peerAddress = ResolveIpv4(address, port);
+        if (::connect(handle, reinterpret_cast<const sockaddr*>(&peerAddress), sizeof(peerAddress)) != 0) {
+            ThrowSocketError("Failed to connect socket to " + address + ":" + std::to_string(port), LastError());
+        }
+    }
+
+    Socket Socket::Accept() {
+        while (true) {
+#ifdef _WIN32
+            SOCKET accepted = ::accept(handle, nullptr, nullptr);
+            if (accepted != INVALID_SOCKET) return Socket(static_cast<SocketHandle>(accepted));
+#elif defined(__linux__)
+            int accepted = ::accept4(handle, nullptr, nullptr, SOCK_CLOEXEC);
+            if (accepted >= 0) return Socket(accepted);
+#else
+            int accepted = ::accept(handle, nullptr, nullptr);
+            if (accepted >= 0) return Socket(accepted);
+#endif
+            int error = LastError();
+            if (Interrupted(error)) continue;
+            if (WouldBlock(error)) return Socket();
+            ThrowSocketError("Failed to accept TCP connection", error);
+        }
+    }
+
+    void Socket::SetNonBlocking(bool enabled) {
+#ifdef _WIN32
+        u_long mode = enabled ? 1 : 0;
+        if (ioctlsocket(handle, FIONBIO, &mode) != 0) {
+            ThrowSocketError("Failed to change socket blocking mode", LastError());
+        }
+#else
+        int flags = fcntl(handle, F_GETFL, 0);
+        flags = enabled ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK);
+        if (flags < 0 || fcntl(handle, F_SETFL, flags) != 0) {
+            ThrowSocketError("Failed to change socket blocking mode", LastError());
+        }
+#endif
+    }
+
+    void Socket::SetNoDelay(bool enabled) {
+        int value = enabled ? 1 : 0;
+        if (setsockopt(handle, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&value), sizeof(value)) != 0) {
+            ThrowSocketError("Failed to set TCP_NODELAY", LastError());
+        }
+    }
+
+    void Socket::SetUnsentLowWatermark(int bytes) {
+#ifdef TCP_NOTSENT_LOWAT
+        if (setsockopt(handle, IPPROTO_TCP, TCP_NOTSENT_LOWAT, reinterpret_cast<const char*>(&bytes), sizeof(bytes)) != 0) {
+            ThrowSocketError("Failed to set TCP_NOTSENT_LOWAT", LastError());
+        }
+#else
+        (void)bytes;
+#endif
+    }
+
+    void Socket::SetSendBufferSize(int bytes) {
+        if (setsockopt(handle, SOL_SOCKET, SO_SNDBUF, reinterpret_cast<const char*>(&bytes), sizeof(bytes)) != 0) {
+            ThrowSocketError("Failed to set SO_SNDBUF", LastError());
+        }
+    }
+
+    int Socket::SendBufferSize() const {
+        int bytes = 0;
+        socklen_t length = sizeof(bytes);
+        if (getsockopt(handle, SOL_SOCKET, SO_SNDBUF, reinterpret_cast<char*>(&bytes), &length) != 0) {
+            ThrowSocketError("Failed to read SO_SNDBUF", LastError());
+        }
+        return bytes;
+    }
+
+    void Socket::SetReceiveBufferSize(int bytes) {
+        if (setsockopt(handle, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<const char*>(&bytes), sizeof(bytes)) != 0) {
+            ThrowSocketError("Failed to set SO_RCVBUF", LastError());
+        }
+    }
+
+    uint16_t Socket::LocalPort() const {
+        sockaddr_in localAddress = {};
+        socklen_t length = sizeof(localAddress);
+        if (getsockname(handle, reinterpret_cast<sockaddr*>(&localAddress), &length) != 0) {
+            ThrowSocketError("Failed to read local socket address", LastError());
+        }
+        return ntohs(localAddress.sin_port);
+    }
+
+    size_t Socket::SendVectored(const IoSlice* slices, size_t count) {
+        count = std::min(count, kMaxSlices);
+#ifdef _WIN32
+        WSABUF buffers[kMaxSlices];
+        for (size_t i = 0; i < count; i++) {
+            buffers[i].buf = const_cast<char*>(static_cast<const char*>(slices[i].data));
+            buffers[i].len = static_cast<ULONG>(slices[i].size);
+        }
+        while (true) {
+            DWORD sent = 0;
+            if (WSASend(handle, buffers, static_cast<DWORD>(count), &sent, 0, nullptr, nullptr) == 0) {
+                return sent;
+            }
+            int error = LastError();
+            if (Interrupted(error)) continue;
+            if (WouldBlock(error)) return 0;
+            ThrowSocketError("Failed to send over TCP socket", error);
+        }
+#else
+        iovec buffers[kMaxSlices];
+        for (size_t i = 0; i < count; i++) {
+            buffers[i].iov_base = const_cast<void*>(slices[i].data);
+            buffers[i].iov_len = slices[i].size;
+        }
+        msghdr message = {};
+        message.msg_iov = buffers;
+        message.msg_iovlen = count;
+        while (true) {
+            ssize_t sent = ::sendmsg(handle, &message, kSendFlags);
+            if (sent >= 0) return static_cast<size_t>(sent);
+            int error = LastError();
+            if (Interrupted(error)) continue;
+            if (WouldBlock(error)) return 0;
+            ThrowSocketError("Failed to send over TCP socket", error);
+        }
+#endif
+    }
+
+    size_t Socket::Send(const void* data, size_t size) {
+        IoSlice slice{ data, size };
+        return SendVectored(&slice, 1);
+    }
+
+    ptrdiff_t Socket::Receive(void* buffer, size_t size) {
+        while (true) {
+#ifdef _WIN32
+            int received = ::recv(handle, static_cast<char*>(buffer), static_cast<int>(std::min<size_t>(size, INT32_MAX)), 0);
+#else
+            ssize_t received = ::recv(handle, buffer, size, 0);
+#endif
+            if (received >= 0) return static_cast<ptrdiff_t>(received);
+            int error = LastError();
+            if (Interrupted(error)) continue;
+            if (WouldBlock(error)) return -1;
+#ifdef _WIN32
+            if (error == WSAEMSGSIZE) return static_cast<ptrdiff_t>(size);   // Datagram truncated to the buffer
+#endif
+            ThrowSocketError("Failed to receive from socket", error);
+        }
+    }
+
+    size_t Socket::SendTo(const void* data, size_t size, const SocketAddress& address) {
+        while (true) {
+#ifdef _WIN32
+            int sent = ::sendto(handle, static_cast<const char*>(data), static_cast<int>(size), 0,
+                reinterpret_cast<const sockaddr*>(address.storage), static_cast<int>(address.length));
+#else
+            ssize_t sent = ::sendto(handle, data, size, kSendFlags,
+                reinterpret_cast<const sockaddr*>(address.storage), static_cast<socklen_t>(address.length));
+#endif
+            if (sent >= 0) return static_cast<size_t>(sent);
+            int error = LastError();
+            if (Interrupted(error)) continue;
+            if (WouldBlock(error)) return 0;
+            ThrowSocketError("Failed to send UDP datagram", error);
+        }
+    }
+
+    ptrdiff_t Socket::ReceiveFrom(void* buffer, size_t size, SocketAddress& source) {
+        while (true) {
+#ifdef _WIN32
+            int length = static_cast<int>(sizeof(source.storage));
+            int received = ::recvfrom(handle, static_cast<char*>(buffer), static_cast<int>(std::min<size_t>(size, INT32_MAX)), 0,
+                reinterpret_cast<sockaddr*>(source.storage), &length);
+#else
+            socklen_t length = sizeof(source.storage);
+            ssize_t received = ::recvfrom(handle, buffer, size, 0, reinterpret_cast<sockaddr*>(source.storage), &length);
+#endif
+            if (received >= 0) {
+                source.length = static_cast<uint32_t>(length);
+                return static_cast<ptrdiff_t>(received);
+            }
+            int error = LastError();
+            if (Interrupted(error)) continue;
+            if (WouldBlock(error)) return -1;
+#ifdef _WIN32
+            if (error == WSAEMSGSIZE) {
+                source.length = static_cast<uint32_t>(length);
+                return static_cast<ptrdiff_t>(size);
+            }
+#endif
+            ThrowSocketError("Failed to receive from socket", error);
+        }
+    }
+
+    size_t Socket::ReceiveBatch(Datagram* datagrams, size_t count) {
+        count = std::min(count, kMaxSlices);
+#ifdef __linux__
+        iovec buffers[kMaxSlices];
+        mmsghdr messages[kMaxSlices] = {};
+        for (size_t i = 0; i < count; i++) {
+            buffers[i].iov_base = datagrams[i].data;
+            buffers[i].iov_len = datagrams[i].capacity;
+            messages[i].msg_hdr.msg_iov = &buffers[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+            messages[i].msg_hdr.msg_name = datagrams[i].source.storage;
+            messages[i].msg_hdr.msg_namelen = sizeof(datagrams[i].source.storage);
+        }
+        while (true) {
+            int received = ::recvmmsg(handle, messages, static_cast<unsigned>(count), MSG_DONTWAIT, nullptr);
+            if (received >= 0) {
+                for (int i = 0; i < received; i++) {
+                    datagrams[i].size = messages[i].msg_len;
+                    datagrams[i].source.length = messages[i].msg_hdr.msg_namelen;
+                }
+                return static_cast<size_t>(received);
+            }
+            int error = LastError();
+            if (Interrupted(error)) continue;
+            if (WouldBlock(error)) return 0;
+            ThrowSocketError("Failed to receive UDP datagrams", error);
+        }
+#else
+        // Without recvmmsg, drain what is waiting one datagram at a time
+        size_t received = 0;
+        while (received < count) {
+            Datagram& datagram = datagrams[received];
+            ptrdiff_t size = ReceiveFrom(datagram.data, datagram.capacity, datagram.source);
+            if (size < 0) break;
+            datagrams[received++].size = static_cast<size_t>(size);
+        }
+        return received;
+#endif
+    }
+
+    size_t Socket::SendBatch(const OutgoingDatagram* datagrams, size_t count, bool* accepted) {
+        count = std::min(count, kMaxBatch);
+#if defined(__linux__) && defined(UDP_SEGMENT)
+        iovec buffers[kMaxBatch];
+        mmsghdr messages[kMaxBatch];
+        alignas(cmsghdr) char control[kMaxBatch][CMSG_SPACE(sizeof(uint16_t))];
+        std::memset(messages, 0, count * sizeof(mmsghdr));
+        for (size_t i = 0; i < count; i++) {
+            const OutgoingDatagram& datagram = datagrams[i];
+            buffers[i].iov_base = const_cast<void*>(datagram.data);
+            buffers[i].iov_len = datagram.size;
+            msghdr& header = messages[i].msg_hdr;
+            header.msg_iov = &buffers[i];
+            header.msg_iovlen = 1;
+            if (datagram.destination) {
+                header.msg_name = const_cast<uint8_t*>(datagram.destination->storage);
+                header.msg_namelen = datagram.destination->length;
+            }
+            if (datagram.segmentSize > 0 && datagram.size > datagram.segmentSize) {
+                header.msg_control = control[i];
+                header.msg_controllen = sizeof(control[i]);
+                cmsghdr* segment = CMSG_FIRSTHDR(&header);
+                segment->cmsg_level = SOL_UDP;
+                segment->cmsg_type = UDP_SEGMENT;
+                segment->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+                std::memcpy(CMSG_DATA(segment), &datagram.segmentSize, sizeof(uint16_t));
+            }
+        }
+
+        size_t handled = 0;
+        while (handled < count) {
+            int sent = ::sendmmsg(handle, messages + handled, static_cast<unsigned>(count - handled), kSendFlags);
+            if (sent > 0) {
+                if (accepted) std::fill(accepted + handled, accepted + handled + sent, true);
+                handled += static_cast<size_t>(sent);
+                continue;
+            }
+            int error = LastError();
+            if (Interrupted(error)) continue;
+            if (WouldBlock(error)) break;
+            // sendmmsg stops at the first datagram that fails and reports
+            // the error once nothing before it went out
+            if (accepted) accepted[handled] = false;
+            handled++;
+        }
+        return handled;
+#else
+        size_t handled = 0;
+        for (; handled < count; handled++) {
+            const OutgoingDatagram& datagram = datagrams[handled];
+            const uint8_t* data = static_cast<const uint8_t*>(datagram.data);
+            size_t segmentSize = datagram.segmentSize > 0 ? datagram.segmentSize : std::max<size_t>(datagram.size, 1);
+            // Segments go out one by one here, the entry counts as sent
+            // only if all of them did
+            bool allSent = true;
+            for (size_t offset = 0; offset < datagram.size || offset == 0; offset += segmentSize) {
+                size_t size = std::min(segmentSize, datagram.size - offset);
+                size_t sent;
+                try {
+                    sent = datagram.destination ? SendTo(data + offset, size, *datagram.destination) : Send(data + offset, size);
+                }
+                catch (const std::runtime_error&) {
+                    allSent = false;
+                    break;
+                }
+                if (sent == 0 && size > 0) return handled;
+            }
+            if (accepted) accepted[handled] = allSent;
+        }
+        return handled;
+#endif
+    }
+
+    bool Socket::SupportsSegmentation() const {
+#if defined(__linux__) && defined(UDP_SEGMENT)
+        // Kernels from 4.18 know the option
+        int value = 0;
+        socklen_t length = sizeof(value);
+        return getsockopt(handle, SOL_UDP, UDP_SEGMENT, &value, &length) == 0;
+#else
+        return false;
+#endif
+    }
+
+    void Socket::Close() {
+        if (handle != kInvalidSocket) {
+            CloseHandle(handle);
+            handle = kInvalidSocket;
+        }
+    }
+}
@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+
+#include "media_pipeline/net/udp_fanout.h"
+
+namespace media_pipeline::net {
+    namespace {
+        bool SameAddress(const SocketAddress& a, const SocketAddress& b) {
+            return a.length == b.length && std::memcmp(a.storage, b.storage, a.length) == 0;
+        }
+    }
+
+    UdpFanout::UdpFanout(UdpFanoutOptions options)
+        : options(options)
+        , arena(options.maxPackets * options.maxPacketSize)
+        , used(0)
+        , checkedSegmentation(false)
+        , canSegment(false) {
+        packets.reserve(options.maxPackets);
+    }
+
+    void UdpFanout::AddDestination(const SocketAddress& destination) {
+        destinations.push_back(destination);
+    }
+
+    void UdpFanout::RemoveDestination(const SocketAddress& destination) {
+        destinations.erase(std::remove_if(destinations.begin(), destinations.end(),
+            [&](const SocketAddress& other) { return SameAddress(other, destination); }), destinations.end());
+    }
+
+    bool UdpFanout::Queue(const IoSlice* slices, size_t count) {
+        size_t size = 0;
+        for (size_t i = 0; i < count; i++) size += slices[i].size;
+        if (size > options.maxPacketSize || packets.size() >= options.maxPackets) return false;
+
+        uint8_t* out = arena.data() + used;
+        for (size_t i = 0; i < count; i++) {
+            std::memcpy(out, slices[i].data, slices[i].size);
+            out += slices[i].size;
+        }
+        packets.push_back(Packet{ used, size });
+        used += size;
+        return true;
+    }
+
+    // Runs of packets the same size, the last one possibly shorter, lie
+    // back to back in the arena; each is one segmented datagram per
+    // destination. Earlier runs go to everyone before later ones.
+    void UdpFanout::BuildSegmented() {
+        size_t first = 0;
+        while (first < packets.size()) {
+            size_t segmentSize = packets[first].size;
+            size_t last = first + 1;
+            size_t bytes = segmentSize;
+            while (last < packets.size() && last - first < Socket::kMaxSegments &&
+                bytes + packets[last].size <= Socket::kMaxSegmentedSize && packets[last].size <= segmentSize) {
+                bytes += packets[last].size;
+                // A shorter packet can only end a run
+                if (packets[last++].size < segmentSize) break;
+            }
+
+            uint16_t segments = static_cast<uint16_t>(last - first);
+            OutgoingDatagram datagram;
+            datagram.data = arena.data() + packets[first].offset;
+            datagram.size = bytes;
+            datagram.segmentSize = segments > 1 ? static_cast<uint16_t>(segmentSize) : 0;
+            for (const SocketAddress& destination : destinations) {
+                datagram.destination = &destination;
+                outgoing.push_back(datagram);
+                outgoingSegments.push_back(segments);
+            }
+            first = last;
+        }
+    }
+
+    void UdpFanout::BuildPerPacket() {
+        for (const Packet& packet : packets) {
+            OutgoingDatagram datagram;
+            datagram.data = arena.data() + packet.offset;
+            datagram.size = packet.size;
+            for (const SocketAddress& destination : destinations) {
+                datagram.destination = &destination;
+                outgoing.push_back(datagram);
+                outgoingSegments.push_back(1);
+            }
+        }
+    }
+
+    size_t UdpFanout::Flush(Socket& socket) {
+        if (packets.empty()) return 0;
+        if (!checkedSegmentation) {
+            canSegment = options.useSegmentation && socket.SupportsSegmentation();
+            checkedSegmentation = true;
+        }
+
+        outgoing.clear();
+        outgoingSegments.clear();
+        if (canSegment && packets.size() > 1) BuildSegmented();
+        else BuildPerPacket();
+
+        uint64_t sent = 0;
+        uint64_t bytes = 0;
+        uint64_t calls = 0;
+        uint64_t dropped = 0;
+        size_t offset = 0;
+        bool accepted[Socket::kMaxBatch];
+        while (offset < outgoing.size()) {
+            size_t chunk = std::min(outgoing.size() - offset, Socket::kMaxBatch);
+            size_t handled = socket.SendBatch(outgoing.data() + offset, chunk, accepted);
+            calls++;
+            // Datagrams the kernel refused were handled but never sent
+            for (size_t i = 0; i < handled; i++) {
+                if (accepted[i]) {
+                    sent += outgoingSegments[offset + i];
+                    bytes += outgoing[offset + i].size;
+                }
+                else {
+                    dropped += outgoingSegments[offset + i];
+                }
+            }
+            offset += handled;
+            if (handled < chunk) break;
+        }
+        for (size_t i = offset; i < outgoing.size(); i++) {
+            dropped += outgoingSegments[i];
+        }
+
+        size_t queued = packets.size();
+        packets.clear();
+        used = 0;
+
+        std::lock_guard<std::mutex> lock(statsMutex);
+        stats.packetsQueued += queued;
+        stats.datagramsSent += sent;
+        stats.bytesSent += bytes;
+        stats.datagramsDropped += dropped;
+        stats.sendCalls += calls;
+        return static_cast<size_t>(sent);
+    }
+
+    UdpFanoutStats UdpFanout::GetStats() const {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        return stats;
+    }
+}
@@ -99,6 +99,9 @@ namespace media_pipeline::processors::audio {
 		outputFormat.format = AudioFormat::SampleFormat::MP3;
 		outputFormat.channels = lame_get_mode(lameFlags) == MONO ? 1 : 2;
 		output.format = outputFormat;
+		// LAME holds back part of a granule, so this is the capture time of
+		// the input that completed these frames rather than their first sample
+		output.timestamp = input.timestamp;
 		return output;
 	}
 
@@ -20,6 +20,7 @@ namespace media_pipeline::processors::audio {
 		int channels,
 		int frameSize) :
 		bitrate(bitrate),
+		targetBitrate(bitrate),
 		inputSampleRate(inputSampleRate),
 		channels(channels),
 		frameSize(frameSize) {
@@ -47,7 +48,21 @@ namespace media_pipeline::processors::audio {
 		// Not required
 	}
 
+	void OpusProcessor::SetTargetBitrate(int kbps) {
+		targetBitrate = kbps;
+	}
+
+	int OpusProcessor::GetTargetBitrate() const {
+		return targetBitrate;
+	}
+
 	MediaData OpusProcessor::ProcessMediaData(const MediaData& input) {
+		int target = targetBitrate;
+		if (target > 0 && target != bitrate) {
+			bitrate = target;
+			opus_encoder_ctl(encoder, OPUS_SET_BITRATE(bitrate * 1000));
+		}
+
 		const AudioFormat& inputFormat = input.getAudioFormat();
 		size_t frameCount = input.data.size() / (inputFormat.channels * sizeof(float));
 
@@ -128,6 +143,7 @@ namespace media_pipeline::processors::audio {
 		}
 
 		MediaData output = MediaData::createAudio(outputData, outputFormat);
+		output.timestamp = input.timestamp;
 		return output;
 	}
 }
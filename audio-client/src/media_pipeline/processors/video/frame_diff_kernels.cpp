@@ -0,0 +1,80 @@
+#include <cstdlib>
+
+#include "media_pipeline/processors/video/frame_diff_kernels.h"
+#include "media_pipeline/core/cpu_features.h"
+
+#if defined(MEDIA_PIPELINE_X86)
+#include <immintrin.h>
+#elif defined(MEDIA_PIPELINE_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace media_pipeline::processors::video::kernels {
+	namespace {
+		// Full blocks handled by the SIMD kernels, the scalar loop picks up from x
+		void RowBlockSadScalar(const uint8_t* a, const uint8_t* b, int x, int width, uint32_t* blockSums) {
+			for (; x < width; x++) {
+				blockSums[x / kSadBlockWidth] += static_cast<uint32_t>(std::abs(a[x] - b[x]));
+			}
+		}
+
+#if defined(MEDIA_PIPELINE_X86)
+		MEDIA_PIPELINE_TARGET_SSE2
+		int RowBlockSadSse2(const uint8_t* a, const uint8_t* b, int width, uint32_t* blockSums) {
+			int x = 0;
+			for (; x + 16 <= width; x += 16) {
+				__m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + x));
+				__m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + x));
+				// Two partial sums, one per 8 byte half
+				__m128i sad = _mm_sad_epu8(va, vb);
+				blockSums[x / 16] += static_cast<uint32_t>(
+					_mm_cvtsi128_si32(sad) + _mm_cvtsi128_si32(_mm_srli_si128(sad, 8)));
+			}
+			return x;
+		}
+
+		MEDIA_PIPELINE_TARGET_AVX2
+		int RowBlockSadAvx2(const uint8_t* a, const uint8_t* b, int width, uint32_t* blockSums) {
+			int x = 0;
+			for (; x + 32 <= width; x += 32) {
+				__m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + x));
+				__m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + x));
+				// Lanes 0-1 belong to the first block, 2-3 to the second
+				__m256i sad = _mm256_sad_epu8(va, vb);
+				__m128i low = _mm256_castsi256_si128(sad);
+				__m128i high = _mm256_extracti128_si256(sad, 1);
+				blockSums[x / 16] += static_cast<uint32_t>(
+					_mm_cvtsi128_si32(low) + _mm_cvtsi128_si32(_mm_srli_si128(low, 8)));
+				blockSums[x / 16 + 1] += static_cast<uint32_t>(
+					_mm_cvtsi128_si32(high) + _mm_cvtsi128_si32(_mm_srli_si128(high, 8)));
+			}
+			if (x + 16 <= width) {
+				x += RowBlockSadSse2(a + x, b + x, 16, blockSums + x / 16);
+			}
+			return x;
+		}
+#elif defined(MEDIA_PIPELINE_NEON)
+		int RowBlockSadNeon(const uint8_t* a, const uint8_t* b, int width, uint32_t* blockSums) {
+			int x = 0;
+			for (; x + 16 <= width; x += 16) {
+				uint8x16_t diff = vabdq_u8(vld1q_u8(a + x), vld1q_u8(b + x));
+				uint64x2_t sum = vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(diff)));
+				blockSums[x / 16] += static_cast<uint32_t>(vgetq_lane_u64(sum, 0) + vgetq_lane_u64(sum, 1));
+			}
+			return x;
+		}
+#endif
+	}
+
+	void AccumulateRowBlockSad(const uint8_t* a, const uint8_t* b, int width,
+		uint32_t* blockSums, Isa isa) {
+		int x = 0;
+#if defined(MEDIA_PIPELINE_X86)
+		if (isa == Isa::Avx2) x = RowBlockSadAvx2(a, b, width, blockSums);
+		else if (isa == Isa::Sse2 || isa == Isa::Ssse3) x = RowBlockSadSse2(a, b, width, blockSums);
+#elif defined(MEDIA_PIPELINE_NEON)
+		if (isa == Isa::Neon) x = RowBlockSadNeon(a, b, width, blockSums);
+#endif
+		RowBlockSadScalar(a, b, x, width, blockSums);
+	}
+}
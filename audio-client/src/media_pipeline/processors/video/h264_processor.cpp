@@ -0,0 +1,202 @@
+#include <stdexcept>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+#include <x264.h>
+
+#include "media_pipeline/processors/video/h264_processor.h"
+#include "media_pipeline/core/interfaces/i_media_processor.h"
+#include "media_pipeline/core/interfaces/i_media_component.h"
+#include "media_pipeline/core/media_data.h"
+
+namespace media_pipeline::processors::video {
+    using core::MediaData;
+    using core::VideoFormat;
+
+    H264Processor::H264Processor(H264Settings settings)
+        : settings(settings)
+        , targetBitrate(settings.bitrateKbps)
+        , isInitialized(false)
+        , encoder(nullptr) {}
+
+    H264Processor::~H264Processor() {
+        if (encoder) {
+            x264_encoder_close(encoder);
+        }
+    }
+
+    void H264Processor::Start() {
+        isInitialized = false;
+    }
+
+    void H264Processor::Stop() {
+        if (encoder) {
+            x264_encoder_close(encoder);
+            encoder = nullptr;
+        }
+        isInitialized = false;
+    }
+
+    MediaData H264Processor::ProcessMediaData(const MediaData& input) {
+        const VideoFormat& format = input.getVideoFormat();
+
+        if (!isInitialized) {
+            InitializeEncoder(format);
+
+            // Get H.264 headers (SPS, PPS)
+            x264_nal_t* nals;
+            int nalCount;
+            int headerSize = x264_encoder_headers(encoder, &nals, &nalCount);
+            if (headerSize < 0) {
+                throw std::runtime_error("Failed to get H.264 headers");
+            }
+
+            // x264 keeps the payloads of one call contiguous
+            std::vector<uint8_t> headerData(nals[0].p_payload, nals[0].p_payload + headerSize);
+
+            VideoFormat headerFormat = format;
+            headerFormat.format = VideoFormat::PixelFormat::H264_HEADERS;
+            return MediaData::createVideo(std::move(headerData), headerFormat);
+        }
+
+        int target = targetBitrate;
+        if (target > 0 && target != settings.bitrateKbps) {
+            settings.bitrateKbps = target;
+            x264_param_t param;
+            x264_encoder_parameters(encoder, &param);
+            SetRateControl(param);
+            if (x264_encoder_reconfig(encoder, &param) < 0) {
+                throw std::runtime_error("Failed to change H.264 bitrate");
+            }
+        }
+
+        // Packed camera formats must go through PixelFormatConverter first
+        if (format.format != VideoFormat::PixelFormat::YUV420P || format.stride != 0) {
+            throw std::runtime_error("H264Processor expects tightly packed YUV420P frames");
+        }
+
+        size_t requiredSize = static_cast<size_t>(format.width) * format.height
+            + 2 * static_cast<size_t>((format.width + 1) / 2) * ((format.height + 1) / 2);
+        if (input.data.size() < requiredSize) {
+            throw std::runtime_error("Video frame is smaller than its pixel format requires");
+        }
+
+        x264_picture_t pic_in;
+        x264_picture_init(&pic_in);
+        pic_in.img.i_csp = X264_CSP_I420;
+        pic_in.img.i_plane = 3;
+
+        int chromaWidth = (format.width + 1) / 2;
+        int chromaHeight = (format.height + 1) / 2;
+        uint8_t* basePtr = const_cast<uint8_t*>(input.data.data());
+        pic_in.img.plane[0] = basePtr;
+        pic_in.img.plane[1] = basePtr + format.width * format.height;
+        pic_in.img.plane[2] = pic_in.img.plane[1] + chromaWidth * chromaHeight;
+        pic_in.img.i_stride[0] = format.width;
+        pic_in.img.i_stride[1] = chromaWidth;
+        pic_in.img.i_stride[2] = chromaWidth;
+        pic_in.i_pts = static_cast<int64_t>(input.timestamp);
+
+        if (format.isKeyFrame) {
+            if (settings.intraRefresh) {
+                x264_encoder_intra_refresh(encoder);
+            }
+            else {
+                pic_in.i_type = X264_TYPE_IDR;
+            }
+        }
+
+        x264_picture_t pic_out;
+        x264_nal_t* nals;
+        int nalCount;
+        int frameSize = x264_encoder_encode(encoder, &nals, &nalCount, &pic_in, &pic_out);
+        if (frameSize < 0) {
+            throw std::runtime_error("Failed to encode frame");
+        }
+
+        std::vector<uint8_t> compressedData;
+        if (frameSize > 0) {
+            compressedData.assign(nals[0].p_payload, nals[0].p_payload + frameSize);
+        }
+
+        VideoFormat outputFormat = format;
+        outputFormat.format = VideoFormat::PixelFormat::H264;
+        outputFormat.isKeyFrame = frameSize > 0 && pic_out.b_keyframe;
+
+        MediaData output = MediaData::createVideo(std::move(compressedData), outputFormat);
+        output.timestamp = frameSize > 0 ? static_cast<uint64_t>(pic_out.i_pts) : input.timestamp;
+        output.layerId = input.layerId;
+        return output;
+    }
+
+    std::vector<MediaData> H264Processor::ProcessMediaDataMulti(const MediaData& input) {
+        std::vector<MediaData> outputs;
+        MediaData output = ProcessMediaData(input);
+
+        // x264 kept the frame for now, nothing to send until a later call
+        if (output.getVideoFormat().format == VideoFormat::PixelFormat::H264 && output.data.empty()) {
+            return outputs;
+        }
+
+        outputs.push_back(std::move(output));
+        return outputs;
+    }
+
+    void H264Processor::InitializeEncoder(const VideoFormat& format) {
+        x264_param_t param;
+        if (x264_param_default_preset(&param, settings.preset.c_str(), "zerolatency") < 0) {
+            throw std::runtime_error("Unknown x264 preset " + settings.preset);
+        }
+
+        param.i_width = format.width;
+        param.i_height = format.height;
+        param.i_csp = X264_CSP_I420;
+        param.i_fps_num = std::max(1, static_cast<int>(std::lround(format.frameRate)));
+        param.i_fps_den = 1;
+        param.i_threads = settings.threads > 0 ? settings.threads : X264_THREADS_AUTO;
+        param.b_sliced_threads = settings.slicedThreads ? 1 : 0;
+        param.i_log_level = X264_LOG_WARNING;
+
+        // Timestamps are passed through in the source's units, so rate control
+        // must go by the frame rate rather than pts deltas
+        param.b_vfr_input = 0;
+
+        // Annex-B without repeated headers, the header packet is sent once up front
+        param.b_repeat_headers = 0;
+        param.b_annexb = 1;
+
+        param.rc.i_rc_method = X264_RC_ABR;
+        if (targetBitrate > 0) settings.bitrateKbps = targetBitrate;
+        SetRateControl(param);
+
+        param.i_keyint_max = settings.keyframeInterval < 0 ? X264_KEYINT_MAX_INFINITE : settings.keyframeInterval;
+        param.b_intra_refresh = settings.intraRefresh ? 1 : 0;
+
+        if (x264_param_apply_profile(&param, settings.profile.c_str()) < 0) {
+            throw std::runtime_error("Unknown x264 profile " + settings.profile);
+        }
+
+        encoder = x264_encoder_open(&param);
+        if (!encoder) {
+            throw std::runtime_error("Failed to initialize H.264 encoder");
+        }
+
+        isInitialized = true;
+    }
+
+    void H264Processor::SetRateControl(x264_param_t& param) const {
+        // Average bitrate capped by the VBV so bursts fit a network link
+        param.rc.i_bitrate = settings.bitrateKbps;
+        param.rc.i_vbv_max_bitrate = settings.bitrateKbps;
+        param.rc.i_vbv_buffer_size = std::max(1, settings.bitrateKbps * settings.vbvBufferMs / 1000);
+    }
+
+    void H264Processor::SetTargetBitrate(int kbps) {
+        targetBitrate = kbps;
+    }
+
+    int H264Processor::GetTargetBitrate() const {
+        return targetBitrate;
+    }
+}
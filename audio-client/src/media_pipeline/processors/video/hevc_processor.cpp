@@ -1,5 +1,7 @@
 #include <stdexcept>
 #include <iostream>
+#include <algorithm>
+#include <cstring>
 
 #include <x265.h>
 
@@ -7,13 +9,23 @@
 #include "media_pipeline/core/interfaces/i_media_processor.h"
 #include "media_pipeline/core/interfaces/i_media_component.h"
 #include "media_pipeline/core/media_data.h"
+#include "media_pipeline/core/logging.h"
 
 namespace media_pipeline::processors::video {
     using core::MediaData;
     using core::VideoFormat;
 
-    HevcProcessor::HevcProcessor() 
-        : isInitialized(false)
+    namespace {
+        constexpr int kVbvBufferMs = 500;
+    }
+
+    HevcProcessor::HevcProcessor(int keyframeInterval, bool sceneCutDetection, int bitrateKbps)
+        : keyframeInterval(keyframeInterval)
+        , sceneCutDetection(sceneCutDetection)
+        , targetBitrate(bitrateKbps)
+        , appliedBitrate(0)
+        , ignoredTarget(false)
+        , isInitialized(false)
         , encoder(nullptr)
         , param(nullptr) {}
 
@@ -45,31 +57,28 @@ namespace media_pipeline::processors::video {
     MediaData HevcProcessor::ProcessMediaData(const MediaData& input) {
         if (!isInitialized) {
             InitializeEncoder(input);
+            return EncoderHeaders(input);
+        }
 
-            // Get HEVC headers (VPS, SPS, PPS)
-            x265_nal* nals;
-            uint32_t nalCount;
-            if (x265_encoder_headers(encoder, &nals, &nalCount) < 0) {
-                throw std::runtime_error("Failed to get HEVC headers");
+        int target = targetBitrate;
+        if (appliedBitrate == 0 && target > 0 && !ignoredTarget) {
+            MEDIA_LOG_WARNING("<HevcProcessor> Started at constant quality, ignoring target bitrates; set one before the first frame");
+            ignoredTarget = true;
+        }
+        if (appliedBitrate != 0 && target > 0 && target != appliedBitrate) {
+            SetRateControl(target);
+            if (x265_encoder_reconfig(encoder, param) < 0) {
+                throw std::runtime_error("Failed to change HEVC bitrate");
             }
+        }
 
-            // Combine all header NALs into one buffer
-            std::vector<uint8_t> headerData;
-            for (uint32_t i = 0; i < nalCount; i++) {
-                size_t currentSize = headerData.size();
-                headerData.resize(currentSize + nals[i].sizeBytes);
+        const VideoFormat& format = std::get<VideoFormat>(input.format);
 
-                // Write NAL data
-                std::memcpy(headerData.data() + currentSize,
-                    nals[i].payload,
-                    nals[i].sizeBytes);
-            }
-            VideoFormat headerFormat = std::get<VideoFormat>(input.format);
-            headerFormat.format = VideoFormat::PixelFormat::HEVC_HEADERS;
-            return MediaData::createVideo(std::move(headerData), headerFormat);
+        // Packed camera formats must go through PixelFormatConverter first
+        if (format.format != VideoFormat::PixelFormat::YUV420P || format.stride != 0) {
+            throw std::runtime_error("HevcProcessor expects tightly packed YUV420P frames");
         }
 
-        const VideoFormat& format = std::get<VideoFormat>(input.format);
         x265_picture* pic_in = x265_picture_alloc();
         x265_picture_init(param, pic_in);
 
@@ -83,6 +92,13 @@ namespace media_pipeline::processors::video {
         pic_in->stride[1] = format.width / 2;
         pic_in->stride[2] = format.width / 2;
 
+        // Timestamps pass straight through so every encoder fed from the same
+        // source keeps the source's time base
+        pic_in->pts = static_cast<int64_t>(input.timestamp);
+        if (format.isKeyFrame) {
+            pic_in->sliceType = X265_TYPE_IDR;
+        }
+
         // Encode frame
         x265_picture* pic_out = x265_picture_alloc();
         x265_nal* nals;
@@ -116,7 +132,7 @@ namespace media_pipeline::processors::video {
             pic_out->sliceType == X265_TYPE_I;
 
         MediaData output = MediaData::createVideo(std::move(compressedData), outputFormat);
-        output.timestamp = pic_out->pts * 1000;  // Convert to microseconds
+        output.timestamp = static_cast<uint64_t>(pic_out->pts);
 
         x265_picture_free(pic_in);
         x265_picture_free(pic_out);
@@ -141,21 +157,80 @@ namespace media_pipeline::processors::video {
         param->bAnnexB = 1;  // Use Annex B format for NAL units
 
         // Rate control
-        param->rc.rateControlMode = X265_RC_CRF;
-        param->rc.rfConstant = 23;  // CRF value (lower = better quality)
+        int target = targetBitrate;
+        if (target > 0) {
+            param->rc.rateControlMode = X265_RC_ABR;
+            SetRateControl(target);
+        }
+        else {
+            param->rc.rateControlMode = X265_RC_CRF;
+            param->rc.rfConstant = 23;  // CRF value (lower = better quality)
+            appliedBitrate = 0;
+        }
 
         // GOP structure
-        param->keyframeMax = 250;
-        param->keyframeMin = 25;
+        if (keyframeInterval < 0) {
+            param->keyframeMax = -1;  // Single IDR, later ones only when forced
+        }
+        else {
+            param->keyframeMax = keyframeInterval;
+            param->keyframeMin = std::min(25, keyframeInterval);
+        }
+        if (!sceneCutDetection) {
+            param->scenecutThreshold = 0;
+        }
+
+        OpenEncoder();
+        isInitialized = true;
+    }
 
-        // Initialize encoder
+    void HevcProcessor::OpenEncoder() {
         encoder = x265_encoder_open(param);
         if (!encoder) {
             x265_param_free(param);
             param = nullptr;
+            isInitialized = false;
             throw std::runtime_error("Failed to initialize HEVC encoder");
         }
+    }
 
-        isInitialized = true;
+    MediaData HevcProcessor::EncoderHeaders(const MediaData& input) {
+        // Get HEVC headers (VPS, SPS, PPS)
+        x265_nal* nals;
+        uint32_t nalCount;
+        if (x265_encoder_headers(encoder, &nals, &nalCount) < 0) {
+            throw std::runtime_error("Failed to get HEVC headers");
+        }
+
+        // Combine all header NALs into one buffer
+        std::vector<uint8_t> headerData;
+        for (uint32_t i = 0; i < nalCount; i++) {
+            size_t currentSize = headerData.size();
+            headerData.resize(currentSize + nals[i].sizeBytes);
+
+            // Write NAL data
+            std::memcpy(headerData.data() + currentSize,
+                nals[i].payload,
+                nals[i].sizeBytes);
+        }
+        VideoFormat headerFormat = std::get<VideoFormat>(input.format);
+        headerFormat.format = VideoFormat::PixelFormat::HEVC_HEADERS;
+        return MediaData::createVideo(std::move(headerData), headerFormat);
+    }
+
+    void HevcProcessor::SetRateControl(int kbps) {
+        // Average bitrate capped by the VBV so bursts fit a network link
+        param->rc.bitrate = kbps;
+        param->rc.vbvMaxBitrate = kbps;
+        param->rc.vbvBufferSize = std::max(1, kbps * kVbvBufferMs / 1000);
+        appliedBitrate = kbps;
+    }
+
+    void HevcProcessor::SetTargetBitrate(int kbps) {
+        targetBitrate = kbps;
+    }
+
+    int HevcProcessor::GetTargetBitrate() const {
+        return targetBitrate;
     }
 }
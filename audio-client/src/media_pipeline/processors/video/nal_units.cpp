@@ -0,0 +1,243 @@
+#include <stdexcept>
+#include <cstring>
+#include <vector>
+
+#include "media_pipeline/processors/video/nal_units.h"
+#include "media_pipeline/core/cpu_features.h"
+
+#if defined(MEDIA_PIPELINE_X86)
+#include <immintrin.h>
+#elif defined(MEDIA_PIPELINE_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace media_pipeline::processors::video::nal {
+	namespace {
+		size_t FindStartCodeScalar(const uint8_t* data, size_t size, size_t pos) {
+			while (pos + 3 <= size) {
+				const void* zero = std::memchr(data + pos, 0, size - pos - 2);
+				if (!zero) break;
+				pos = static_cast<const uint8_t*>(zero) - data;
+				if (data[pos + 1] == 0 && data[pos + 2] == 1) return pos;
+				pos++;
+			}
+			return size;
+		}
+
+#if defined(MEDIA_PIPELINE_X86)
+		inline unsigned LowestBit(uint32_t mask) {
+#if defined(_MSC_VER)
+			unsigned long index;
+			_BitScanForward(&index, mask);
+			return static_cast<unsigned>(index);
+#else
+			return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+		}
+
+		// Compares three overlapping loads against 00, 00 and 01 so every
+		// lane answers "does a start code begin here" in one pass. Slice data
+		// is mostly non-zero, memchr stops on every lone zero byte instead.
+		MEDIA_PIPELINE_TARGET_SSE2
+		size_t FindStartCodeSse2(const uint8_t* data, size_t size, size_t pos) {
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i one = _mm_set1_epi8(1);
+			for (; pos + 18 <= size; pos += 16) {
+				__m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+				__m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos + 1));
+				__m128i b2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos + 2));
+				__m128i match = _mm_and_si128(_mm_and_si128(_mm_cmpeq_epi8(b0, zero), _mm_cmpeq_epi8(b1, zero)),
+					_mm_cmpeq_epi8(b2, one));
+				uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(match));
+				if (mask) return pos + LowestBit(mask);
+			}
+			return FindStartCodeScalar(data, size, pos);
+		}
+
+		MEDIA_PIPELINE_TARGET_AVX2
+		size_t FindStartCodeAvx2(const uint8_t* data, size_t size, size_t pos) {
+			const __m256i zero = _mm256_setzero_si256();
+			const __m256i one = _mm256_set1_epi8(1);
+			for (; pos + 34 <= size; pos += 32) {
+				__m256i b0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+				__m256i b1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos + 1));
+				__m256i b2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos + 2));
+				__m256i match = _mm256_and_si256(_mm256_and_si256(_mm256_cmpeq_epi8(b0, zero), _mm256_cmpeq_epi8(b1, zero)),
+					_mm256_cmpeq_epi8(b2, one));
+				uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(match));
+				if (mask) return pos + LowestBit(mask);
+			}
+			return FindStartCodeSse2(data, size, pos);
+		}
+#elif defined(MEDIA_PIPELINE_NEON)
+		size_t FindStartCodeNeon(const uint8_t* data, size_t size, size_t pos) {
+			const uint8x16_t zero = vdupq_n_u8(0);
+			const uint8x16_t one = vdupq_n_u8(1);
+			for (; pos + 18 <= size; pos += 16) {
+				uint8x16_t match = vandq_u8(vandq_u8(vceqq_u8(vld1q_u8(data + pos), zero),
+					vceqq_u8(vld1q_u8(data + pos + 1), zero)), vceqq_u8(vld1q_u8(data + pos + 2), one));
+				// No movemask on NEON: test the block, then find the lane in scalar
+				uint64x2_t halves = vreinterpretq_u64_u8(match);
+				if ((vgetq_lane_u64(halves, 0) | vgetq_lane_u64(halves, 1)) != 0) {
+					return FindStartCodeScalar(data, pos + 18, pos);
+				}
+			}
+			return FindStartCodeScalar(data, size, pos);
+		}
+#endif
+
+		// Position of the next 00 00 01 at or after pos, or size if there is none
+		size_t FindStartCode(const uint8_t* data, size_t size, size_t pos) {
+#if defined(MEDIA_PIPELINE_X86)
+			static const bool hasAvx2 = core::cpu::GetFeatures().avx2;
+			return hasAvx2 ? FindStartCodeAvx2(data, size, pos) : FindStartCodeSse2(data, size, pos);
+#elif defined(MEDIA_PIPELINE_NEON)
+			return FindStartCodeNeon(data, size, pos);
+#else
+			return FindStartCodeScalar(data, size, pos);
+#endif
+		}
+
+		void AppendBigEndian(std::vector<uint8_t>& out, uint32_t value, int bytes) {
+			for (int i = bytes - 1; i >= 0; i--) {
+				out.push_back(static_cast<uint8_t>(value >> (i * 8)));
+			}
+		}
+
+		// First count RBSP bytes of a NAL unit payload, with emulation
+		// prevention bytes (00 00 03) removed
+		std::vector<uint8_t> ReadRbsp(const uint8_t* data, size_t size, size_t count) {
+			std::vector<uint8_t> rbsp;
+			int zeros = 0;
+			for (size_t i = 0; i < size && rbsp.size() < count; i++) {
+				if (zeros >= 2 && data[i] == 3) {
+					zeros = 0;
+					continue;
+				}
+				zeros = data[i] == 0 ? zeros + 1 : 0;
+				rbsp.push_back(data[i]);
+			}
+			return rbsp;
+		}
+	}
+
+	std::vector<NalUnit> SplitAnnexB(const uint8_t* data, size_t size) {
+		std::vector<NalUnit> units;
+		SplitAnnexB(data, size, units);
+		return units;
+	}
+
+	void SplitAnnexB(const uint8_t* data, size_t size, std::vector<NalUnit>& units) {
+		units.clear();
+		size_t start = FindStartCode(data, size, 0);
+		while (start < size) {
+			size_t payload = start + 3;
+			size_t next = FindStartCode(data, size, payload);
+
+			// Trailing zeros belong to the next 4 byte start code
+			size_t end = next;
+			while (end > payload && data[end - 1] == 0) end--;
+			if (end > payload) {
+				units.push_back({ data + payload, end - payload });
+			}
+			start = next;
+		}
+	}
+
+	std::vector<uint8_t> AnnexBToLengthPrefixed(const uint8_t* data, size_t size) {
+		std::vector<uint8_t> out;
+		out.reserve(size + 16);
+		for (const NalUnit& unit : SplitAnnexB(data, size)) {
+			AppendBigEndian(out, static_cast<uint32_t>(unit.size), 4);
+			out.insert(out.end(), unit.data, unit.data + unit.size);
+		}
+		return out;
+	}
+
+	std::vector<uint8_t> BuildAvcDecoderConfig(const uint8_t* headers, size_t size) {
+		std::vector<NalUnit> sps;
+		std::vector<NalUnit> pps;
+		for (const NalUnit& unit : SplitAnnexB(headers, size)) {
+			if (H264Type(unit) == kH264Sps) sps.push_back(unit);
+			else if (H264Type(unit) == kH264Pps) pps.push_back(unit);
+		}
+		if (sps.empty() || pps.empty() || sps.front().size < 4) {
+			throw std::runtime_error("H.264 headers are missing SPS or PPS");
+		}
+
+		const uint8_t* first = sps.front().data;
+		uint8_t profile = first[1];
+
+		std::vector<uint8_t> config;
+		config.push_back(1);            // configurationVersion
+		config.push_back(profile);
+		config.push_back(first[2]);     // profile_compatibility
+		config.push_back(first[3]);     // AVCLevelIndication
+		config.push_back(0xFC | 3);     // lengthSizeMinusOne
+		config.push_back(static_cast<uint8_t>(0xE0 | sps.size()));
+		for (const NalUnit& unit : sps) {
+			AppendBigEndian(config, static_cast<uint32_t>(unit.size), 2);
+			config.insert(config.end(), unit.data, unit.data + unit.size);
+		}
+		config.push_back(static_cast<uint8_t>(pps.size()));
+		for (const NalUnit& unit : pps) {
+			AppendBigEndian(config, static_cast<uint32_t>(unit.size), 2);
+			config.insert(config.end(), unit.data, unit.data + unit.size);
+		}
+
+		// High profiles carry chroma format and bit depth, the encoders here
+		// only produce 8-bit 4:2:0
+		if (profile == 100 || profile == 110 || profile == 122 || profile == 144) {
+			config.push_back(0xFC | 1);     // chroma_format_idc
+			config.push_back(0xF8 | 0);     // bit_depth_luma_minus8
+			config.push_back(0xF8 | 0);     // bit_depth_chroma_minus8
+			config.push_back(0);            // numOfSequenceParameterSetExt
+		}
+		return config;
+	}
+
+	std::vector<uint8_t> BuildHevcDecoderConfig(const uint8_t* headers, size_t size) {
+		std::vector<NalUnit> arrays[3];     // VPS, SPS, PPS
+		for (const NalUnit& unit : SplitAnnexB(headers, size)) {
+			if (unit.size < 2) continue;
+			uint8_t type = HevcType(unit);
+			if (type >= kHevcVps && type <= kHevcPps) arrays[type - kHevcVps].push_back(unit);
+		}
+		if (arrays[0].empty() || arrays[1].empty() || arrays[2].empty()) {
+			throw std::runtime_error("HEVC headers are missing VPS, SPS or PPS");
+		}
+
+		// SPS after the 2 byte NAL header: sub layer info, then the 12 byte
+		// general profile_tier_level
+		const NalUnit& sps = arrays[1].front();
+		std::vector<uint8_t> rbsp = ReadRbsp(sps.data + 2, sps.size - 2, 13);
+		if (rbsp.size() < 13) {
+			throw std::runtime_error("HEVC SPS is too short");
+		}
+		uint8_t maxSubLayersMinus1 = (rbsp[0] >> 1) & 0x07;
+		uint8_t temporalIdNesting = rbsp[0] & 0x01;
+
+		std::vector<uint8_t> config;
+		config.push_back(1);            // configurationVersion
+		config.insert(config.end(), rbsp.begin() + 1, rbsp.begin() + 13);   // profile, flags, level
+		config.push_back(0xF0);         // min_spatial_segmentation_idc
+		config.push_back(0x00);
+		config.push_back(0xFC);         // parallelismType
+		// The encoders here only produce 8-bit 4:2:0, as for H.264
+		config.push_back(0xFC | 1);     // chromaFormat
+		config.push_back(0xF8 | 0);     // bitDepthLumaMinus8
+		config.push_back(0xF8 | 0);     // bitDepthChromaMinus8
+		AppendBigEndian(config, 0, 2);  // avgFrameRate
+		config.push_back(static_cast<uint8_t>(((maxSubLayersMinus1 + 1) << 3) | (temporalIdNesting << 2) | 3));
+		config.push_back(3);            // numOfArrays
+		for (int i = 0; i < 3; i++) {
+			config.push_back(static_cast<uint8_t>(0x80 | (kHevcVps + i)));
+			AppendBigEndian(config, static_cast<uint32_t>(arrays[i].size()), 2);
+			for (const NalUnit& unit : arrays[i]) {
+				AppendBigEndian(config, static_cast<uint32_t>(unit.size), 2);
+				config.insert(config.end(), unit.data, unit.data + unit.size);
+			}
+		}
+		return config;
+	}
+}
@@ -0,0 +1,144 @@
+#include <stdexcept>
+#include <vector>
+
+#include "media_pipeline/processors/video/pixel_format_converter.h"
+#include "media_pipeline/processors/video/pixel_format_kernels.h"
+#include "media_pipeline/core/interfaces/i_media_processor.h"
+#include "media_pipeline/core/interfaces/i_media_component.h"
+#include "media_pipeline/core/media_data.h"
+#include "media_pipeline/core/video_frame.h"
+
+namespace media_pipeline::processors::video {
+    using core::MediaData;
+    using core::VideoFormat;
+    using core::I420Layout;
+    using core::I420View;
+
+    PixelFormatConverter::PixelFormatConverter(bool halveResolution)
+        : halveResolution(halveResolution)
+        , isa(kernels::SelectIsa()) {}
+
+    void PixelFormatConverter::Start() {
+        // Not required
+    }
+
+    void PixelFormatConverter::Stop() {
+        // Not required
+    }
+
+    int PixelFormatConverter::SourceStride(const VideoFormat& format) const {
+        if (format.stride > 0) return format.stride;
+
+        switch (format.format) {
+        case VideoFormat::PixelFormat::YUY2:
+        case VideoFormat::PixelFormat::UYVY:
+            return ((format.width + 1) / 2) * 4;
+        case VideoFormat::PixelFormat::RGB24:
+        case VideoFormat::PixelFormat::BGR24:
+            return format.width * 3;
+        default:
+            return format.width;
+        }
+    }
+
+    MediaData PixelFormatConverter::ProcessMediaData(const MediaData& input) {
+        const VideoFormat& format = input.getVideoFormat();
+        bool isTightI420 = format.format == VideoFormat::PixelFormat::YUV420P && format.stride == 0;
+
+        // Nothing to do, hand the frame straight to the encoder
+        if (isTightI420 && !halveResolution) {
+            return input;
+        }
+
+        int srcWidth = format.width;
+        int srcHeight = format.height;
+        int srcStride = SourceStride(format);
+        int srcChromaRows = (srcHeight + 1) / 2;
+        // Planar chroma rows are half the luma stride, rounded up as I420Layout does for odd widths
+        int srcChromaStride = (srcStride + 1) / 2;
+
+        size_t requiredSize;
+        switch (format.format) {
+        case VideoFormat::PixelFormat::NV12:
+            requiredSize = static_cast<size_t>(srcStride) * (srcHeight + srcChromaRows);
+            break;
+        case VideoFormat::PixelFormat::YUV420P:
+            requiredSize = static_cast<size_t>(srcStride) * srcHeight
+                + 2 * static_cast<size_t>(srcChromaStride) * srcChromaRows;
+            break;
+        case VideoFormat::PixelFormat::YUY2:
+        case VideoFormat::PixelFormat::UYVY:
+        case VideoFormat::PixelFormat::RGB24:
+        case VideoFormat::PixelFormat::BGR24:
+            requiredSize = static_cast<size_t>(srcStride) * srcHeight;
+            break;
+        default:
+            throw std::runtime_error("PixelFormatConverter received a compressed frame");
+        }
+        if (input.data.size() < requiredSize) {
+            throw std::runtime_error("Video frame is smaller than its pixel format requires");
+        }
+
+        int dstWidth = halveResolution ? (srcWidth + 1) / 2 : srcWidth;
+        int dstHeight = halveResolution ? (srcHeight + 1) / 2 : srcHeight;
+        I420Layout layout = I420Layout::ForSize(dstWidth, dstHeight);
+        std::vector<uint8_t> converted(layout.TotalSize());
+        I420View dst = I420View::FromBuffer(converted.data(), layout);
+        const uint8_t* src = input.data.data();
+
+        switch (format.format) {
+        case VideoFormat::PixelFormat::YUY2:
+            if (halveResolution) kernels::Yuy2ToI420Half(src, srcStride, srcWidth, srcHeight, dst, isa);
+            else kernels::Yuy2ToI420(src, srcStride, dst, isa);
+            break;
+        case VideoFormat::PixelFormat::UYVY:
+            if (halveResolution) kernels::UyvyToI420Half(src, srcStride, srcWidth, srcHeight, dst, isa);
+            else kernels::UyvyToI420(src, srcStride, dst, isa);
+            break;
+        case VideoFormat::PixelFormat::NV12: {
+            // The interleaved chroma plane follows the luma plane with the same stride
+            const uint8_t* srcUV = src + static_cast<size_t>(srcStride) * srcHeight;
+            if (halveResolution) kernels::Nv12ToI420Half(src, srcStride, srcUV, srcStride, srcWidth, srcHeight, dst, isa);
+            else kernels::Nv12ToI420(src, srcStride, srcUV, srcStride, dst, isa);
+            break;
+        }
+        case VideoFormat::PixelFormat::RGB24:
+        case VideoFormat::PixelFormat::BGR24: {
+            bool isBgr = format.format == VideoFormat::PixelFormat::BGR24;
+            if (halveResolution) kernels::Rgb24ToI420Half(src, srcStride, srcWidth, srcHeight, dst, isBgr, isa);
+            else kernels::Rgb24ToI420(src, srcStride, dst, isBgr, isa);
+            break;
+        }
+        case VideoFormat::PixelFormat::YUV420P: {
+            uint8_t* base = const_cast<uint8_t*>(src);
+            I420View source{
+                { base, srcStride },
+                { base + static_cast<size_t>(srcStride) * srcHeight, srcChromaStride },
+                { base + static_cast<size_t>(srcStride) * srcHeight + static_cast<size_t>(srcChromaStride) * srcChromaRows, srcChromaStride },
+                srcWidth,
+                srcHeight
+            };
+            if (halveResolution) {
+                kernels::I420ToI420Half(source, dst, isa);
+            }
+            else {
+                // Padded I420, repack into a tight buffer
+                kernels::I420ToI420Copy(source, dst);
+            }
+            break;
+        }
+        default:
+            break;
+        }
+
+        VideoFormat outputFormat = format;
+        outputFormat.width = dstWidth;
+        outputFormat.height = dstHeight;
+        outputFormat.format = VideoFormat::PixelFormat::YUV420P;
+        outputFormat.stride = 0;
+
+        MediaData output = MediaData::createVideo(std::move(converted), outputFormat);
+        output.timestamp = input.timestamp;
+        return output;
+    }
+}
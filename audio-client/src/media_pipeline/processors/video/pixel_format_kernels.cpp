@@ -0,0 +1,691 @@
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "media_pipeline/processors/video/pixel_format_kernels.h"
+#include "media_pipeline/core/cpu_features.h"
+#include "media_pipeline/core/video_frame.h"
+
+#if defined(MEDIA_PIPELINE_X86)
+#include <immintrin.h>
+#elif defined(MEDIA_PIPELINE_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace media_pipeline::processors::video::kernels {
+	namespace {
+		// BT.601 limited range, 8-bit fixed point
+		inline uint8_t RgbToY(int r, int g, int b) {
+			return static_cast<uint8_t>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+		}
+
+		inline uint8_t RgbToU(int r, int g, int b) {
+			return static_cast<uint8_t>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+		}
+
+		inline uint8_t RgbToV(int r, int g, int b) {
+			return static_cast<uint8_t>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+		}
+
+		// Byte offsets of the first Y, U and V samples inside a 4 byte macropixel
+		struct Yuy2Layout { static constexpr int Y = 0, U = 1, V = 3; };
+		struct UyvyLayout { static constexpr int Y = 1, U = 0, V = 2; };
+
+		// Row pair kernels convert two source rows into two luma rows and one
+		// chroma row. They return how many pixels were handled so the scalar
+		// version can finish the tail. On the last row of an odd height frame
+		// both rows point at the same memory.
+		using RowPairFn = int (*)(const uint8_t* row0, const uint8_t* row1,
+			uint8_t* y0, uint8_t* y1, uint8_t* u, uint8_t* v, int width);
+
+		template <typename L>
+		void PackedRowsScalar(const uint8_t* row0, const uint8_t* row1,
+			uint8_t* y0, uint8_t* y1, uint8_t* u, uint8_t* v, int x, int width) {
+			for (; x < width; x += 2) {
+				const uint8_t* p0 = row0 + x * 2;
+				const uint8_t* p1 = row1 + x * 2;
+				y0[x] = p0[L::Y];
+				y1[x] = p1[L::Y];
+				if (x + 1 < width) {
+					y0[x + 1] = p0[L::Y + 2];
+					y1[x + 1] = p1[L::Y + 2];
+				}
+				u[x / 2] = static_cast<uint8_t>((p0[L::U] + p1[L::U] + 1) >> 1);
+				v[x / 2] = static_cast<uint8_t>((p0[L::V] + p1[L::V] + 1) >> 1);
+			}
+		}
+
+		template <bool IsBgr>
+		void RgbRowsScalar(const uint8_t* row0, const uint8_t* row1,
+			uint8_t* y0, uint8_t* y1, uint8_t* u, uint8_t* v, int x, int width) {
+			constexpr int R = IsBgr ? 2 : 0;
+			constexpr int B = IsBgr ? 0 : 2;
+			for (; x < width; x += 2) {
+				int x1 = std::min(x + 1, width - 1);
+				const uint8_t* a = row0 + x * 3;
+				const uint8_t* b = row0 + x1 * 3;
+				const uint8_t* c = row1 + x * 3;
+				const uint8_t* d = row1 + x1 * 3;
+				y0[x] = RgbToY(a[R], a[1], a[B]);
+				y1[x] = RgbToY(c[R], c[1], c[B]);
+				if (x + 1 < width) {
+					y0[x + 1] = RgbToY(b[R], b[1], b[B]);
+					y1[x + 1] = RgbToY(d[R], d[1], d[B]);
+				}
+				int r = (a[R] + b[R] + c[R] + d[R] + 2) >> 2;
+				int g = (a[1] + b[1] + c[1] + d[1] + 2) >> 2;
+				int bl = (a[B] + b[B] + c[B] + d[B] + 2) >> 2;
+				u[x / 2] = RgbToU(r, g, bl);
+				v[x / 2] = RgbToV(r, g, bl);
+			}
+		}
+
+		int DeinterleaveScalar(const uint8_t* uv, uint8_t* u, uint8_t* v, int x, int count) {
+			for (; x < count; x++) {
+				u[x] = uv[x * 2];
+				v[x] = uv[x * 2 + 1];
+			}
+			return count;
+		}
+
+		using DeinterleaveFn = int (*)(const uint8_t* uv, uint8_t* u, uint8_t* v, int count);
+
+		// Half row kernels average 2x2 boxes from two rows of one plane into one
+		// output row. They only take whole pixel pairs and return how many
+		// outputs they wrote; the scalar version clamps at the right edge.
+		using HalfRowFn = int (*)(const uint8_t* row0, const uint8_t* row1, uint8_t* out, int srcWidth);
+
+		void HalfRowScalar(const uint8_t* row0, const uint8_t* row1, uint8_t* out, int x, int srcWidth, int dstWidth) {
+			for (; x < dstWidth; x++) {
+				int x0 = std::min(2 * x, srcWidth - 1);
+				int x1 = std::min(2 * x + 1, srcWidth - 1);
+				out[x] = static_cast<uint8_t>((row0[x0] + row0[x1] + row1[x0] + row1[x1] + 2) >> 2);
+			}
+		}
+
+#if defined(MEDIA_PIPELINE_X86)
+		template <typename L>
+		MEDIA_PIPELINE_TARGET_SSE2
+		int PackedRowsSse2(const uint8_t* row0, const uint8_t* row1,
+			uint8_t* y0, uint8_t* y1, uint8_t* u, uint8_t* v, int width) {
+			const __m128i lowMask = _mm_set1_epi16(0x00FF);
+			const __m128i zero = _mm_setzero_si128();
+			int x = 0;
+			for (; x + 16 <= width; x += 16) {
+				__m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 2));
+				__m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 2 + 16));
+				__m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 2));
+				__m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 2 + 16));
+
+				__m128i luma0, luma1, chroma0, chroma1;
+				if constexpr (L::Y == 0) {
+					luma0 = _mm_packus_epi16(_mm_and_si128(a0, lowMask), _mm_and_si128(b0, lowMask));
+					luma1 = _mm_packus_epi16(_mm_and_si128(a1, lowMask), _mm_and_si128(b1, lowMask));
+					chroma0 = _mm_packus_epi16(_mm_srli_epi16(a0, 8), _mm_srli_epi16(b0, 8));
+					chroma1 = _mm_packus_epi16(_mm_srli_epi16(a1, 8), _mm_srli_epi16(b1, 8));
+				}
+				else {
+					luma0 = _mm_packus_epi16(_mm_srli_epi16(a0, 8), _mm_srli_epi16(b0, 8));
+					luma1 = _mm_packus_epi16(_mm_srli_epi16(a1, 8), _mm_srli_epi16(b1, 8));
+					chroma0 = _mm_packus_epi16(_mm_and_si128(a0, lowMask), _mm_and_si128(b0, lowMask));
+					chroma1 = _mm_packus_epi16(_mm_and_si128(a1, lowMask), _mm_and_si128(b1, lowMask));
+				}
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(y0 + x), luma0);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(y1 + x), luma1);
+
+				// Chroma is U V U V ... for both layouts, average the row pair and split
+				__m128i chroma = _mm_avg_epu8(chroma0, chroma1);
+				__m128i uu = _mm_packus_epi16(_mm_and_si128(chroma, lowMask), zero);
+				__m128i vv = _mm_packus_epi16(_mm_srli_epi16(chroma, 8), zero);
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(u + x / 2), uu);
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(v + x / 2), vv);
+			}
+			return x;
+		}
+
+		template <typename L>
+		MEDIA_PIPELINE_TARGET_AVX2
+		int PackedRowsAvx2(const uint8_t* row0, const uint8_t* row1,
+			uint8_t* y0, uint8_t* y1, uint8_t* u, uint8_t* v, int width) {
+			const __m256i lowMask = _mm256_set1_epi16(0x00FF);
+			const __m256i zero = _mm256_setzero_si256();
+			int x = 0;
+			// packus works per 128 bit lane, permute 0xD8 restores linear order
+			for (; x + 32 <= width; x += 32) {
+				__m256i a0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row0 + x * 2));
+				__m256i b0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row0 + x * 2 + 32));
+				__m256i a1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row1 + x * 2));
+				__m256i b1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row1 + x * 2 + 32));
+
+				__m256i luma0, luma1, chroma0, chroma1;
+				if constexpr (L::Y == 0) {
+					luma0 = _mm256_packus_epi16(_mm256_and_si256(a0, lowMask), _mm256_and_si256(b0, lowMask));
+					luma1 = _mm256_packus_epi16(_mm256_and_si256(a1, lowMask), _mm256_and_si256(b1, lowMask));
+					chroma0 = _mm256_packus_epi16(_mm256_srli_epi16(a0, 8), _mm256_srli_epi16(b0, 8));
+					chroma1 = _mm256_packus_epi16(_mm256_srli_epi16(a1, 8), _mm256_srli_epi16(b1, 8));
+				}
+				else {
+					luma0 = _mm256_packus_epi16(_mm256_srli_epi16(a0, 8), _mm256_srli_epi16(b0, 8));
+					luma1 = _mm256_packus_epi16(_mm256_srli_epi16(a1, 8), _mm256_srli_epi16(b1, 8));
+					chroma0 = _mm256_packus_epi16(_mm256_and_si256(a0, lowMask), _mm256_and_si256(b0, lowMask));
+					chroma1 = _mm256_packus_epi16(_mm256_and_si256(a1, lowMask), _mm256_and_si256(b1, lowMask));
+				}
+				luma0 = _mm256_permute4x64_epi64(luma0, 0xD8);
+				luma1 = _mm256_permute4x64_epi64(luma1, 0xD8);
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(y0 + x), luma0);
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(y1 + x), luma1);
+
+				__m256i chroma = _mm256_permute4x64_epi64(_mm256_avg_epu8(chroma0, chroma1), 0xD8);
+				__m256i uu = _mm256_permute4x64_epi64(
+					_mm256_packus_epi16(_mm256_and_si256(chroma, lowMask), zero), 0xD8);
+				__m256i vv = _mm256_permute4x64_epi64(
+					_mm256_packus_epi16(_mm256_srli_epi16(chroma, 8), zero), 0xD8);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(u + x / 2), _mm256_castsi256_si128(uu));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(v + x / 2), _mm256_castsi256_si128(vv));
+			}
+			return x;
+		}
+
+		MEDIA_PIPELINE_TARGET_SSE2
+		int DeinterleaveSse2(const uint8_t* uv, uint8_t* u, uint8_t* v, int count) {
+			const __m128i lowMask = _mm_set1_epi16(0x00FF);
+			int x = 0;
+			for (; x + 16 <= count; x += 16) {
+				__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(uv + x * 2));
+				__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(uv + x * 2 + 16));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(u + x),
+					_mm_packus_epi16(_mm_and_si128(a, lowMask), _mm_and_si128(b, lowMask)));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(v + x),
+					_mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8)));
+			}
+			return x;
+		}
+
+		MEDIA_PIPELINE_TARGET_AVX2
+		int DeinterleaveAvx2(const uint8_t* uv, uint8_t* u, uint8_t* v, int count) {
+			const __m256i lowMask = _mm256_set1_epi16(0x00FF);
+			int x = 0;
+			for (; x + 32 <= count; x += 32) {
+				__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(uv + x * 2));
+				__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(uv + x * 2 + 32));
+				__m256i uu = _mm256_packus_epi16(_mm256_and_si256(a, lowMask), _mm256_and_si256(b, lowMask));
+				__m256i vv = _mm256_packus_epi16(_mm256_srli_epi16(a, 8), _mm256_srli_epi16(b, 8));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(u + x), _mm256_permute4x64_epi64(uu, 0xD8));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(v + x), _mm256_permute4x64_epi64(vv, 0xD8));
+			}
+			return x;
+		}
+
+		// Even and odd bytes of both rows summed in 16-bit lanes, rounded once
+		MEDIA_PIPELINE_TARGET_SSE2
+		inline __m128i SumPairsSse2(__m128i row0, __m128i row1, __m128i lowMask) {
+			__m128i sum0 = _mm_add_epi16(_mm_and_si128(row0, lowMask), _mm_srli_epi16(row0, 8));
+			__m128i sum1 = _mm_add_epi16(_mm_and_si128(row1, lowMask), _mm_srli_epi16(row1, 8));
+			return _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(sum0, sum1), _mm_set1_epi16(2)), 2);
+		}
+
+		MEDIA_PIPELINE_TARGET_SSE2
+		int HalfRowSse2(const uint8_t* row0, const uint8_t* row1, uint8_t* out, int srcWidth) {
+			const __m128i lowMask = _mm_set1_epi16(0x00FF);
+			int pairs = srcWidth / 2;
+			int x = 0;
+			for (; x + 16 <= pairs; x += 16) {
+				__m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 2));
+				__m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 2 + 16));
+				__m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 2));
+				__m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 2 + 16));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out + x),
+					_mm_packus_epi16(SumPairsSse2(a0, a1, lowMask), SumPairsSse2(b0, b1, lowMask)));
+			}
+			return x;
+		}
+
+		MEDIA_PIPELINE_TARGET_AVX2
+		inline __m256i SumPairsAvx2(__m256i row0, __m256i row1, __m256i lowMask) {
+			__m256i sum0 = _mm256_add_epi16(_mm256_and_si256(row0, lowMask), _mm256_srli_epi16(row0, 8));
+			__m256i sum1 = _mm256_add_epi16(_mm256_and_si256(row1, lowMask), _mm256_srli_epi16(row1, 8));
+			return _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(sum0, sum1), _mm256_set1_epi16(2)), 2);
+		}
+
+		MEDIA_PIPELINE_TARGET_AVX2
+		int HalfRowAvx2(const uint8_t* row0, const uint8_t* row1, uint8_t* out, int srcWidth) {
+			const __m256i lowMask = _mm256_set1_epi16(0x00FF);
+			int pairs = srcWidth / 2;
+			int x = 0;
+			for (; x + 32 <= pairs; x += 32) {
+				__m256i a0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row0 + x * 2));
+				__m256i b0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row0 + x * 2 + 32));
+				__m256i a1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row1 + x * 2));
+				__m256i b1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row1 + x * 2 + 32));
+				__m256i packed = _mm256_packus_epi16(SumPairsAvx2(a0, a1, lowMask), SumPairsAvx2(b0, b1, lowMask));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + x), _mm256_permute4x64_epi64(packed, 0xD8));
+			}
+			return x;
+		}
+
+		// pshufb masks gathering one 8-bit channel of 16 packed RGB pixels out of
+		// three consecutive 16 byte loads. Lanes that come from another load are 0x80.
+		MEDIA_PIPELINE_TARGET_SSSE3
+		void BuildRgbShuffle(int channelOffset, __m128i masks[3]) {
+			for (int reg = 0; reg < 3; reg++) {
+				alignas(16) int8_t lanes[16];
+				for (int i = 0; i < 16; i++) {
+					int byte = i * 3 + channelOffset - reg * 16;
+					lanes[i] = (byte >= 0 && byte < 16) ? static_cast<int8_t>(byte) : static_cast<int8_t>(0x80);
+				}
+				masks[reg] = _mm_load_si128(reinterpret_cast<const __m128i*>(lanes));
+			}
+		}
+
+		MEDIA_PIPELINE_TARGET_SSSE3
+		inline __m128i GatherChannel(__m128i s0, __m128i s1, __m128i s2, const __m128i masks[3]) {
+			return _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(s0, masks[0]),
+				_mm_shuffle_epi8(s1, masks[1])), _mm_shuffle_epi8(s2, masks[2]));
+		}
+
+		MEDIA_PIPELINE_TARGET_SSSE3
+		inline __m128i LumaFromRgb16(__m128i r, __m128i g, __m128i b) {
+			__m128i y = _mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(66)),
+				_mm_mullo_epi16(g, _mm_set1_epi16(129)));
+			y = _mm_add_epi16(y, _mm_mullo_epi16(b, _mm_set1_epi16(25)));
+			y = _mm_srli_epi16(_mm_add_epi16(y, _mm_set1_epi16(128)), 8);
+			return _mm_add_epi16(y, _mm_set1_epi16(16));
+		}
+
+		MEDIA_PIPELINE_TARGET_SSSE3
+		inline __m128i ChromaFromRgb16(__m128i r, __m128i g, __m128i b, int16_t kr, int16_t kg, int16_t kb) {
+			__m128i c = _mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(kr)),
+				_mm_mullo_epi16(g, _mm_set1_epi16(kg)));
+			c = _mm_add_epi16(c, _mm_mullo_epi16(b, _mm_set1_epi16(kb)));
+			c = _mm_srai_epi16(_mm_add_epi16(c, _mm_set1_epi16(128)), 8);
+			return _mm_add_epi16(c, _mm_set1_epi16(128));
+		}
+
+		// 2x2 average of one channel, 16 bytes from each row into 8 16-bit lanes.
+		// Sums all four before rounding once, like the scalar path; averaging
+		// rows first with pavgb rounds twice and comes out one too high.
+		MEDIA_PIPELINE_TARGET_SSSE3
+		inline __m128i Average2x2(__m128i row0, __m128i row1) {
+			const __m128i ones = _mm_set1_epi8(1);
+			__m128i sum = _mm_add_epi16(_mm_maddubs_epi16(row0, ones), _mm_maddubs_epi16(row1, ones));
+			return _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(2)), 2);
+		}
+
+		template <bool IsBgr>
+		MEDIA_PIPELINE_TARGET_SSSE3
+		int RgbRowsSsse3(const uint8_t* row0, const uint8_t* row1,
+			uint8_t* y0, uint8_t* y1, uint8_t* u, uint8_t* v, int width) {
+			__m128i rMask[3], gMask[3], bMask[3];
+			BuildRgbShuffle(IsBgr ? 2 : 0, rMask);
+			BuildRgbShuffle(1, gMask);
+			BuildRgbShuffle(IsBgr ? 0 : 2, bMask);
+			const __m128i zero = _mm_setzero_si128();
+
+			int x = 0;
+			for (; x + 16 <= width; x += 16) {
+				__m128i channels[2][3];
+				const uint8_t* rows[2] = { row0 + x * 3, row1 + x * 3 };
+				uint8_t* lumaRows[2] = { y0 + x, y1 + x };
+				for (int r = 0; r < 2; r++) {
+					__m128i s0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[r]));
+					__m128i s1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[r] + 16));
+					__m128i s2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[r] + 32));
+					__m128i red = GatherChannel(s0, s1, s2, rMask);
+					__m128i green = GatherChannel(s0, s1, s2, gMask);
+					__m128i blue = GatherChannel(s0, s1, s2, bMask);
+
+					__m128i lumaLo = LumaFromRgb16(_mm_unpacklo_epi8(red, zero),
+						_mm_unpacklo_epi8(green, zero), _mm_unpacklo_epi8(blue, zero));
+					__m128i lumaHi = LumaFromRgb16(_mm_unpackhi_epi8(red, zero),
+						_mm_unpackhi_epi8(green, zero), _mm_unpackhi_epi8(blue, zero));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(lumaRows[r]), _mm_packus_epi16(lumaLo, lumaHi));
+
+					channels[r][0] = red;
+					channels[r][1] = green;
+					channels[r][2] = blue;
+				}
+
+				__m128i red = Average2x2(channels[0][0], channels[1][0]);
+				__m128i green = Average2x2(channels[0][1], channels[1][1]);
+				__m128i blue = Average2x2(channels[0][2], channels[1][2]);
+				__m128i uu = ChromaFromRgb16(red, green, blue, -38, -74, 112);
+				__m128i vv = ChromaFromRgb16(red, green, blue, 112, -94, -18);
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(u + x / 2), _mm_packus_epi16(uu, zero));
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(v + x / 2), _mm_packus_epi16(vv, zero));
+			}
+			return x;
+		}
+#endif
+
+#if defined(MEDIA_PIPELINE_NEON)
+		template <typename L>
+		int PackedRowsNeon(const uint8_t* row0, const uint8_t* row1,
+			uint8_t* y0, uint8_t* y1, uint8_t* u, uint8_t* v, int width) {
+			int x = 0;
+			for (; x + 16 <= width; x += 16) {
+				// vld4 splits macropixels into Y0, U, Y1, V (or U, Y0, V, Y1)
+				uint8x8x4_t p0 = vld4_u8(row0 + x * 2);
+				uint8x8x4_t p1 = vld4_u8(row1 + x * 2);
+				uint8x8x2_t l0 = { { p0.val[L::Y], p0.val[L::Y + 2] } };
+				uint8x8x2_t l1 = { { p1.val[L::Y], p1.val[L::Y + 2] } };
+				vst2_u8(y0 + x, l0);
+				vst2_u8(y1 + x, l1);
+				vst1_u8(u + x / 2, vrhadd_u8(p0.val[L::U], p1.val[L::U]));
+				vst1_u8(v + x / 2, vrhadd_u8(p0.val[L::V], p1.val[L::V]));
+			}
+			return x;
+		}
+
+		int DeinterleaveNeon(const uint8_t* uv, uint8_t* u, uint8_t* v, int count) {
+			int x = 0;
+			for (; x + 16 <= count; x += 16) {
+				uint8x16x2_t pairs = vld2q_u8(uv + x * 2);
+				vst1q_u8(u + x, pairs.val[0]);
+				vst1q_u8(v + x, pairs.val[1]);
+			}
+			return x;
+		}
+
+		int HalfRowNeon(const uint8_t* row0, const uint8_t* row1, uint8_t* out, int srcWidth) {
+			int pairs = srcWidth / 2;
+			int x = 0;
+			for (; x + 16 <= pairs; x += 16) {
+				uint16x8_t lo = vpadalq_u8(vpaddlq_u8(vld1q_u8(row0 + x * 2)), vld1q_u8(row1 + x * 2));
+				uint16x8_t hi = vpadalq_u8(vpaddlq_u8(vld1q_u8(row0 + x * 2 + 16)), vld1q_u8(row1 + x * 2 + 16));
+				vst1q_u8(out + x, vcombine_u8(vrshrn_n_u16(lo, 2), vrshrn_n_u16(hi, 2)));
+			}
+			return x;
+		}
+
+		inline uint8x8_t LumaFromRgbNeon(uint8x8_t r, uint8x8_t g, uint8x8_t b) {
+			uint16x8_t y = vmull_u8(r, vdup_n_u8(66));
+			y = vmlal_u8(y, g, vdup_n_u8(129));
+			y = vmlal_u8(y, b, vdup_n_u8(25));
+			y = vaddq_u16(y, vdupq_n_u16(128));
+			return vadd_u8(vshrn_n_u16(y, 8), vdup_n_u8(16));
+		}
+
+		inline uint8x8_t ChromaFromRgbNeon(int16x8_t r, int16x8_t g, int16x8_t b,
+			int16_t kr, int16_t kg, int16_t kb) {
+			int16x8_t c = vmulq_n_s16(r, kr);
+			c = vmlaq_n_s16(c, g, kg);
+			c = vmlaq_n_s16(c, b, kb);
+			c = vshrq_n_s16(vaddq_s16(c, vdupq_n_s16(128)), 8);
+			return vqmovun_s16(vaddq_s16(c, vdupq_n_s16(128)));
+		}
+
+		template <bool IsBgr>
+		int RgbRowsNeon(const uint8_t* row0, const uint8_t* row1,
+			uint8_t* y0, uint8_t* y1, uint8_t* u, uint8_t* v, int width) {
+			constexpr int R = IsBgr ? 2 : 0;
+			constexpr int B = IsBgr ? 0 : 2;
+			int x = 0;
+			for (; x + 16 <= width; x += 16) {
+				uint8x16x3_t p0 = vld3q_u8(row0 + x * 3);
+				uint8x16x3_t p1 = vld3q_u8(row1 + x * 3);
+
+				vst1q_u8(y0 + x, vcombine_u8(
+					LumaFromRgbNeon(vget_low_u8(p0.val[R]), vget_low_u8(p0.val[1]), vget_low_u8(p0.val[B])),
+					LumaFromRgbNeon(vget_high_u8(p0.val[R]), vget_high_u8(p0.val[1]), vget_high_u8(p0.val[B]))));
+				vst1q_u8(y1 + x, vcombine_u8(
+					LumaFromRgbNeon(vget_low_u8(p1.val[R]), vget_low_u8(p1.val[1]), vget_low_u8(p1.val[B])),
+					LumaFromRgbNeon(vget_high_u8(p1.val[R]), vget_high_u8(p1.val[1]), vget_high_u8(p1.val[B]))));
+
+				// Pairwise widen-add both rows, then a rounded divide by four
+				int16x8_t r = vreinterpretq_s16_u16(vrshrq_n_u16(
+					vaddq_u16(vpaddlq_u8(p0.val[R]), vpaddlq_u8(p1.val[R])), 2));
+				int16x8_t g = vreinterpretq_s16_u16(vrshrq_n_u16(
+					vaddq_u16(vpaddlq_u8(p0.val[1]), vpaddlq_u8(p1.val[1])), 2));
+				int16x8_t b = vreinterpretq_s16_u16(vrshrq_n_u16(
+					vaddq_u16(vpaddlq_u8(p0.val[B]), vpaddlq_u8(p1.val[B])), 2));
+				vst1_u8(u + x / 2, ChromaFromRgbNeon(r, g, b, -38, -74, 112));
+				vst1_u8(v + x / 2, ChromaFromRgbNeon(r, g, b, 112, -94, -18));
+			}
+			return x;
+		}
+#endif
+
+		template <typename L>
+		RowPairFn SelectPackedRows(Isa isa) {
+#if defined(MEDIA_PIPELINE_X86)
+			if (isa == Isa::Avx2) return &PackedRowsAvx2<L>;
+			if (isa == Isa::Sse2 || isa == Isa::Ssse3) return &PackedRowsSse2<L>;
+#elif defined(MEDIA_PIPELINE_NEON)
+			if (isa == Isa::Neon) return &PackedRowsNeon<L>;
+#endif
+			return nullptr;
+		}
+
+		template <bool IsBgr>
+		RowPairFn SelectRgbRows(Isa isa) {
+#if defined(MEDIA_PIPELINE_X86)
+			if (isa == Isa::Avx2 || isa == Isa::Ssse3) return &RgbRowsSsse3<IsBgr>;
+#elif defined(MEDIA_PIPELINE_NEON)
+			if (isa == Isa::Neon) return &RgbRowsNeon<IsBgr>;
+#endif
+			return nullptr;
+		}
+
+		DeinterleaveFn SelectDeinterleave(Isa isa) {
+#if defined(MEDIA_PIPELINE_X86)
+			if (isa == Isa::Avx2) return &DeinterleaveAvx2;
+			if (isa == Isa::Sse2 || isa == Isa::Ssse3) return &DeinterleaveSse2;
+#elif defined(MEDIA_PIPELINE_NEON)
+			if (isa == Isa::Neon) return &DeinterleaveNeon;
+#endif
+			return nullptr;
+		}
+
+		HalfRowFn SelectHalfRow(Isa isa) {
+#if defined(MEDIA_PIPELINE_X86)
+			if (isa == Isa::Avx2) return &HalfRowAvx2;
+			if (isa == Isa::Sse2 || isa == Isa::Ssse3) return &HalfRowSse2;
+#elif defined(MEDIA_PIPELINE_NEON)
+			if (isa == Isa::Neon) return &HalfRowNeon;
+#endif
+			return nullptr;
+		}
+
+		void HalfRow(HalfRowFn simd, const uint8_t* row0, const uint8_t* row1, uint8_t* out,
+			int srcWidth, int dstWidth) {
+			int done = simd ? simd(row0, row1, out, srcWidth) : 0;
+			HalfRowScalar(row0, row1, out, done, srcWidth, dstWidth);
+		}
+
+		template <typename ScalarRows>
+		void ConvertRowPairs(const uint8_t* src, int srcStride, const I420View& dst,
+			RowPairFn simdRows, ScalarRows scalarRows) {
+			for (int y = 0; y < dst.height; y += 2) {
+				int yNext = std::min(y + 1, dst.height - 1);
+				const uint8_t* row0 = src + static_cast<size_t>(y) * srcStride;
+				const uint8_t* row1 = src + static_cast<size_t>(yNext) * srcStride;
+				uint8_t* y0 = dst.y.data + static_cast<size_t>(y) * dst.y.stride;
+				uint8_t* y1 = dst.y.data + static_cast<size_t>(yNext) * dst.y.stride;
+				uint8_t* u = dst.u.data + static_cast<size_t>(y / 2) * dst.u.stride;
+				uint8_t* v = dst.v.data + static_cast<size_t>(y / 2) * dst.v.stride;
+
+				int done = simdRows ? simdRows(row0, row1, y0, y1, u, v, dst.width) : 0;
+				scalarRows(row0, row1, y0, y1, u, v, done, dst.width);
+			}
+		}
+
+		template <typename L>
+		void PackedToI420(const uint8_t* src, int srcStride, const I420View& dst, Isa isa) {
+			ConvertRowPairs(src, srcStride, dst, SelectPackedRows<L>(isa), &PackedRowsScalar<L>);
+		}
+
+		// Half size conversion over a strip of four source rows: the row pair
+		// kernels convert it at full size into a small buffer, which is then
+		// halved into two output luma rows and one chroma row. The full size
+		// frame never exists, only the strip, which stays in cache.
+		template <typename ScalarRows>
+		void ConvertRowPairsHalf(const uint8_t* src, int srcStride, int srcWidth, int srcHeight,
+			const I420View& dst, RowPairFn simdRows, ScalarRows scalarRows, HalfRowFn half) {
+			int srcChromaWidth = (srcWidth + 1) / 2;
+			int srcChromaHeight = (srcHeight + 1) / 2;
+			int chromaWidth = (dst.width + 1) / 2;
+			int chromaHeight = (dst.height + 1) / 2;
+			std::vector<uint8_t> strip(4 * static_cast<size_t>(srcWidth) + 4 * static_cast<size_t>(srcChromaWidth));
+			uint8_t* luma[4];
+			for (int i = 0; i < 4; i++) luma[i] = strip.data() + static_cast<size_t>(i) * srcWidth;
+			uint8_t* u[2] = { luma[3] + srcWidth, luma[3] + srcWidth + srcChromaWidth };
+			uint8_t* v[2] = { u[1] + srcChromaWidth, u[1] + 2 * srcChromaWidth };
+
+			for (int y = 0; y < chromaHeight; y++) {
+				for (int pair = 0; pair < 2; pair++) {
+					// Past the bottom edge repeat the last full size chroma row
+					int first = 2 * std::min(2 * y + pair, srcChromaHeight - 1);
+					int second = std::min(first + 1, srcHeight - 1);
+					const uint8_t* row0 = src + static_cast<size_t>(first) * srcStride;
+					const uint8_t* row1 = src + static_cast<size_t>(second) * srcStride;
+					uint8_t* y0 = luma[2 * pair];
+					uint8_t* y1 = luma[2 * pair + 1];
+					int done = simdRows ? simdRows(row0, row1, y0, y1, u[pair], v[pair], srcWidth) : 0;
+					scalarRows(row0, row1, y0, y1, u[pair], v[pair], done, srcWidth);
+				}
+
+				for (int i = 0; i < 2 && 2 * y + i < dst.height; i++) {
+					HalfRow(half, luma[2 * i], luma[2 * i + 1],
+						dst.y.data + static_cast<size_t>(2 * y + i) * dst.y.stride, srcWidth, dst.width);
+				}
+				HalfRow(half, u[0], u[1], dst.u.data + static_cast<size_t>(y) * dst.u.stride, srcChromaWidth, chromaWidth);
+				HalfRow(half, v[0], v[1], dst.v.data + static_cast<size_t>(y) * dst.v.stride, srcChromaWidth, chromaWidth);
+			}
+		}
+
+		// 2x2 box downscale of a single plane, clamping at the right and bottom edge
+		void DownscalePlaneHalf(const uint8_t* src, int srcStride, int srcWidth, int srcHeight,
+			uint8_t* dst, int dstStride, int dstWidth, int dstHeight, HalfRowFn half) {
+			for (int y = 0; y < dstHeight; y++) {
+				const uint8_t* r0 = src + static_cast<size_t>(std::min(2 * y, srcHeight - 1)) * srcStride;
+				const uint8_t* r1 = src + static_cast<size_t>(std::min(2 * y + 1, srcHeight - 1)) * srcStride;
+				HalfRow(half, r0, r1, dst + static_cast<size_t>(y) * dstStride, srcWidth, dstWidth);
+			}
+		}
+	}
+
+	Isa SelectIsa() {
+		const core::cpu::Features& features = core::cpu::GetFeatures();
+		if (features.avx2) return Isa::Avx2;
+		if (features.ssse3) return Isa::Ssse3;
+		if (features.sse2) return Isa::Sse2;
+		if (features.neon) return Isa::Neon;
+		return Isa::Scalar;
+	}
+
+	void Yuy2ToI420(const uint8_t* src, int srcStride, const I420View& dst, Isa isa) {
+		PackedToI420<Yuy2Layout>(src, srcStride, dst, isa);
+	}
+
+	void UyvyToI420(const uint8_t* src, int srcStride, const I420View& dst, Isa isa) {
+		PackedToI420<UyvyLayout>(src, srcStride, dst, isa);
+	}
+
+	void Nv12ToI420(const uint8_t* srcY, int srcStrideY,
+		const uint8_t* srcUV, int srcStrideUV,
+		const I420View& dst, Isa isa) {
+		for (int y = 0; y < dst.height; y++) {
+			std::memcpy(dst.y.data + static_cast<size_t>(y) * dst.y.stride,
+				srcY + static_cast<size_t>(y) * srcStrideY,
+				dst.width);
+		}
+
+		DeinterleaveFn simd = SelectDeinterleave(isa);
+		int chromaWidth = (dst.width + 1) / 2;
+		int chromaHeight = (dst.height + 1) / 2;
+		for (int y = 0; y < chromaHeight; y++) {
+			const uint8_t* uv = srcUV + static_cast<size_t>(y) * srcStrideUV;
+			uint8_t* u = dst.u.data + static_cast<size_t>(y) * dst.u.stride;
+			uint8_t* v = dst.v.data + static_cast<size_t>(y) * dst.v.stride;
+			int done = simd ? simd(uv, u, v, chromaWidth) : 0;
+			DeinterleaveScalar(uv, u, v, done, chromaWidth);
+		}
+	}
+
+	void Rgb24ToI420(const uint8_t* src, int srcStride, const I420View& dst, bool isBgr, Isa isa) {
+		if (isBgr) {
+			ConvertRowPairs(src, srcStride, dst, SelectRgbRows<true>(isa), &RgbRowsScalar<true>);
+		}
+		else {
+			ConvertRowPairs(src, srcStride, dst, SelectRgbRows<false>(isa), &RgbRowsScalar<false>);
+		}
+	}
+
+	void Yuy2ToI420Half(const uint8_t* src, int srcStride, int srcWidth, int srcHeight, const I420View& dst, Isa isa) {
+		ConvertRowPairsHalf(src, srcStride, srcWidth, srcHeight, dst,
+			SelectPackedRows<Yuy2Layout>(isa), &PackedRowsScalar<Yuy2Layout>, SelectHalfRow(isa));
+	}
+
+	void UyvyToI420Half(const uint8_t* src, int srcStride, int srcWidth, int srcHeight, const I420View& dst, Isa isa) {
+		ConvertRowPairsHalf(src, srcStride, srcWidth, srcHeight, dst,
+			SelectPackedRows<UyvyLayout>(isa), &PackedRowsScalar<UyvyLayout>, SelectHalfRow(isa));
+	}
+
+	void Nv12ToI420Half(const uint8_t* srcY, int srcStrideY,
+		const uint8_t* srcUV, int srcStrideUV,
+		int srcWidth, int srcHeight, const I420View& dst, Isa isa) {
+		HalfRowFn half = SelectHalfRow(isa);
+		DownscalePlaneHalf(srcY, srcStrideY, srcWidth, srcHeight,
+			dst.y.data, dst.y.stride, dst.width, dst.height, half);
+
+		// Split two chroma rows at a time, then halve them like planar chroma
+		DeinterleaveFn split = SelectDeinterleave(isa);
+		int srcChromaWidth = (srcWidth + 1) / 2;
+		int srcChromaHeight = (srcHeight + 1) / 2;
+		int chromaWidth = (dst.width + 1) / 2;
+		int chromaHeight = (dst.height + 1) / 2;
+		std::vector<uint8_t> strip(4 * static_cast<size_t>(srcChromaWidth));
+		uint8_t* u[2] = { strip.data(), strip.data() + srcChromaWidth };
+		uint8_t* v[2] = { strip.data() + 2 * srcChromaWidth, strip.data() + 3 * srcChromaWidth };
+		for (int y = 0; y < chromaHeight; y++) {
+			for (int i = 0; i < 2; i++) {
+				const uint8_t* uv = srcUV + static_cast<size_t>(std::min(2 * y + i, srcChromaHeight - 1)) * srcStrideUV;
+				int done = split ? split(uv, u[i], v[i], srcChromaWidth) : 0;
+				DeinterleaveScalar(uv, u[i], v[i], done, srcChromaWidth);
+			}
+			HalfRow(half, u[0], u[1], dst.u.data + static_cast<size_t>(y) * dst.u.stride, srcChromaWidth, chromaWidth);
+			HalfRow(half, v[0], v[1], dst.v.data + static_cast<size_t>(y) * dst.v.stride, srcChromaWidth, chromaWidth);
+		}
+	}
+
+	void Rgb24ToI420Half(const uint8_t* src, int srcStride, int srcWidth, int srcHeight,
+		const I420View& dst, bool isBgr, Isa isa) {
+		if (isBgr) {
+			ConvertRowPairsHalf(src, srcStride, srcWidth, srcHeight, dst,
+				SelectRgbRows<true>(isa), &RgbRowsScalar<true>, SelectHalfRow(isa));
+		}
+		else {
+			ConvertRowPairsHalf(src, srcStride, srcWidth, srcHeight, dst,
+				SelectRgbRows<false>(isa), &RgbRowsScalar<false>, SelectHalfRow(isa));
+		}
+	}
+
+	void I420ToI420Half(const I420View& src, const I420View& dst, Isa isa) {
+		HalfRowFn half = SelectHalfRow(isa);
+		DownscalePlaneHalf(src.y.data, src.y.stride, src.width, src.height,
+			dst.y.data, dst.y.stride, dst.width, dst.height, half);
+
+		int srcChromaWidth = (src.width + 1) / 2;
+		int srcChromaHeight = (src.height + 1) / 2;
+		int chromaWidth = (dst.width + 1) / 2;
+		int chromaHeight = (dst.height + 1) / 2;
+		DownscalePlaneHalf(src.u.data, src.u.stride, srcChromaWidth, srcChromaHeight,
+			dst.u.data, dst.u.stride, chromaWidth, chromaHeight, half);
+		DownscalePlaneHalf(src.v.data, src.v.stride, srcChromaWidth, srcChromaHeight,
+			dst.v.data, dst.v.stride, chromaWidth, chromaHeight, half);
+	}
+
+	void I420ToI420Copy(const I420View& src, const I420View& dst) {
+		const core::PlaneView* srcPlanes[3] = { &src.y, &src.u, &src.v };
+		const core::PlaneView* dstPlanes[3] = { &dst.y, &dst.u, &dst.v };
+		for (int plane = 0; plane < 3; plane++) {
+			int width = plane == 0 ? dst.width : (dst.width + 1) / 2;
+			int height = plane == 0 ? dst.height : (dst.height + 1) / 2;
+			for (int y = 0; y < height; y++) {
+				std::memcpy(dstPlanes[plane]->data + static_cast<size_t>(y) * dstPlanes[plane]->stride,
+					srcPlanes[plane]->data + static_cast<size_t>(y) * srcPlanes[plane]->stride,
+					width);
+			}
+		}
+	}
+}
@@ -0,0 +1,365 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "media_pipeline/processors/video/scaler_kernels.h"
+#include "media_pipeline/core/cpu_features.h"
+
+#if defined(MEDIA_PIPELINE_X86)
+#include <immintrin.h>
+#elif defined(MEDIA_PIPELINE_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace media_pipeline::processors::video::kernels {
+	namespace {
+		constexpr int kRound = 1 << (ScaleFilter::kFilterBits - 1);
+
+		double FilterSupport(ScaleMode mode) {
+			switch (mode) {
+			case ScaleMode::Box: return 0.5;
+			case ScaleMode::Bilinear: return 1.0;
+			case ScaleMode::Bicubic: return 2.0;
+			}
+			return 1.0;
+		}
+
+		// Weight of source sample `sample` for an output centred at `center`.
+		// stretch widens the kernel when downscaling so it averages instead of aliasing.
+		double FilterWeight(ScaleMode mode, double sample, double center, double stretch) {
+			switch (mode) {
+			case ScaleMode::Box: {
+				double halfWidth = 0.5 * stretch;
+				double overlap = std::min(sample + 0.5, center + halfWidth) - std::max(sample - 0.5, center - halfWidth);
+				return std::max(0.0, overlap);
+			}
+			case ScaleMode::Bilinear: {
+				double x = std::abs(sample - center) / stretch;
+				return std::max(0.0, 1.0 - x);
+			}
+			case ScaleMode::Bicubic: {
+				double x = std::abs(sample - center) / stretch;
+				if (x < 1.0) return 1.5 * x * x * x - 2.5 * x * x + 1.0;
+				if (x < 2.0) return -0.5 * x * x * x + 2.5 * x * x - 4.0 * x + 2.0;
+				return 0.0;
+			}
+			}
+			return 0.0;
+		}
+
+		inline uint8_t ClampPixel(int value) {
+			return static_cast<uint8_t>(std::min(255, std::max(0, value)));
+		}
+
+		using VerticalFn = int (*)(const uint8_t* const* rows, const int16_t* weights, int taps,
+			uint8_t* out, int width);
+
+		void VerticalScalar(const uint8_t* const* rows, const int16_t* weights, int taps,
+			uint8_t* out, int x, int width) {
+			for (; x < width; x++) {
+				int acc = kRound;
+				for (int t = 0; t < taps; t++) {
+					acc += weights[t] * rows[t][x];
+				}
+				out[x] = ClampPixel(acc >> ScaleFilter::kFilterBits);
+			}
+		}
+
+		// Taps known at compile time let the inner loop fully unroll
+		template <int Taps>
+		void HorizontalFixed(const uint8_t* row, const ScaleFilter& filter, uint8_t* out, int x, int width) {
+			const int16_t* weights = filter.weights.data() + static_cast<size_t>(x) * Taps;
+			const int* starts = filter.starts.data();
+			for (; x < width; x++, weights += Taps) {
+				const uint8_t* p = row + starts[x];
+				int acc = kRound;
+				for (int t = 0; t < Taps; t++) {
+					acc += weights[t] * p[t];
+				}
+				out[x] = ClampPixel(acc >> ScaleFilter::kFilterBits);
+			}
+		}
+
+		void HorizontalScalar(const uint8_t* row, const ScaleFilter& filter, uint8_t* out, int x, int width) {
+			switch (filter.taps) {
+			case 2: HorizontalFixed<2>(row, filter, out, x, width); return;
+			case 3: HorizontalFixed<3>(row, filter, out, x, width); return;
+			case 4: HorizontalFixed<4>(row, filter, out, x, width); return;
+			case 5: HorizontalFixed<5>(row, filter, out, x, width); return;
+			case 6: HorizontalFixed<6>(row, filter, out, x, width); return;
+			case 7: HorizontalFixed<7>(row, filter, out, x, width); return;
+			case 8: HorizontalFixed<8>(row, filter, out, x, width); return;
+			default: break;
+			}
+
+			const int taps = filter.taps;
+			const int16_t* weights = filter.weights.data() + static_cast<size_t>(x) * taps;
+			for (; x < width; x++, weights += taps) {
+				const uint8_t* p = row + filter.starts[x];
+				int acc = kRound;
+				for (int t = 0; t < taps; t++) {
+					acc += weights[t] * p[t];
+				}
+				out[x] = ClampPixel(acc >> ScaleFilter::kFilterBits);
+			}
+		}
+
+#if defined(MEDIA_PIPELINE_X86)
+		// Taps are consumed in pairs: two rows interleaved as 16-bit lanes and one
+		// madd against (w0, w1) gives a * w0 + b * w1 per pixel in 32 bits.
+		MEDIA_PIPELINE_TARGET_SSE2
+		int VerticalSse2(const uint8_t* const* rows, const int16_t* weights, int taps,
+			uint8_t* out, int width) {
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i round = _mm_set1_epi32(kRound);
+			int x = 0;
+			for (; x + 8 <= width; x += 8) {
+				__m128i accLo = round;
+				__m128i accHi = round;
+				for (int t = 0; t < taps; t += 2) {
+					bool hasPair = t + 1 < taps;
+					const uint8_t* rowB = hasPair ? rows[t + 1] : rows[t];
+					int16_t weightB = hasPair ? weights[t + 1] : 0;
+					__m128i pair = _mm_set1_epi32(static_cast<uint16_t>(weights[t]) | (static_cast<uint32_t>(static_cast<uint16_t>(weightB)) << 16));
+
+					__m128i a = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(rows[t] + x)), zero);
+					__m128i b = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(rowB + x)), zero);
+					accLo = _mm_add_epi32(accLo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), pair));
+					accHi = _mm_add_epi32(accHi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), pair));
+				}
+				accLo = _mm_srai_epi32(accLo, ScaleFilter::kFilterBits);
+				accHi = _mm_srai_epi32(accHi, ScaleFilter::kFilterBits);
+				__m128i pixels = _mm_packus_epi16(_mm_packs_epi32(accLo, accHi), zero);
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(out + x), pixels);
+			}
+			return x;
+		}
+
+		MEDIA_PIPELINE_TARGET_AVX2
+		int VerticalAvx2(const uint8_t* const* rows, const int16_t* weights, int taps,
+			uint8_t* out, int width) {
+			const __m256i round = _mm256_set1_epi32(kRound);
+			int x = 0;
+			for (; x + 16 <= width; x += 16) {
+				__m256i accLo = round;
+				__m256i accHi = round;
+				for (int t = 0; t < taps; t += 2) {
+					bool hasPair = t + 1 < taps;
+					const uint8_t* rowB = hasPair ? rows[t + 1] : rows[t];
+					int16_t weightB = hasPair ? weights[t + 1] : 0;
+					__m256i pair = _mm256_set1_epi32(static_cast<uint16_t>(weights[t]) | (static_cast<uint32_t>(static_cast<uint16_t>(weightB)) << 16));
+
+					__m256i a = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[t] + x)));
+					__m256i b = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rowB + x)));
+					accLo = _mm256_add_epi32(accLo, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), pair));
+					accHi = _mm256_add_epi32(accHi, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), pair));
+				}
+				// unpack and pack are both per lane, so packs restores pixel order within
+				// each lane and the final permute joins the two 8 byte halves
+				accLo = _mm256_srai_epi32(accLo, ScaleFilter::kFilterBits);
+				accHi = _mm256_srai_epi32(accHi, ScaleFilter::kFilterBits);
+				__m256i words = _mm256_packs_epi32(accLo, accHi);
+				__m256i bytes = _mm256_permute4x64_epi64(_mm256_packus_epi16(words, words), 0xD8);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), _mm256_castsi256_si128(bytes));
+			}
+			return x;
+		}
+#endif
+
+#if defined(MEDIA_PIPELINE_X86)
+		// Four outputs at a time: each one loads 8 source bytes at its start and
+		// does one madd against its padded weights, two rounds of hadd then
+		// reduce the four partial sums. Stops before a load would cross srcWidth.
+		MEDIA_PIPELINE_TARGET_SSSE3
+		int HorizontalSsse3(const uint8_t* row, const ScaleFilter& filter, uint8_t* out, int width, int srcWidth) {
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i round = _mm_set1_epi32(kRound);
+			const int* starts = filter.starts.data();
+			const int16_t* weights = filter.paddedWeights.data();
+			int x = 0;
+			for (; x + 4 <= width; x += 4) {
+				if (starts[x + 3] + ScaleFilter::kPaddedTaps > srcWidth) break;
+				__m128i sums[4];
+				for (int i = 0; i < 4; i++) {
+					__m128i pixels = _mm_unpacklo_epi8(
+						_mm_loadl_epi64(reinterpret_cast<const __m128i*>(row + starts[x + i])), zero);
+					__m128i taps = _mm_loadu_si128(reinterpret_cast<const __m128i*>(weights + (x + i) * ScaleFilter::kPaddedTaps));
+					sums[i] = _mm_madd_epi16(pixels, taps);
+				}
+				__m128i total = _mm_hadd_epi32(_mm_hadd_epi32(sums[0], sums[1]), _mm_hadd_epi32(sums[2], sums[3]));
+				total = _mm_srai_epi32(_mm_add_epi32(total, round), ScaleFilter::kFilterBits);
+				__m128i words = _mm_packs_epi32(total, zero);
+				int packed = _mm_cvtsi128_si32(_mm_packus_epi16(words, zero));
+				std::memcpy(out + x, &packed, 4);
+			}
+			return x;
+		}
+#endif
+
+#if defined(MEDIA_PIPELINE_NEON)
+		int HorizontalNeon(const uint8_t* row, const ScaleFilter& filter, uint8_t* out, int width, int srcWidth) {
+			const int* starts = filter.starts.data();
+			const int16_t* weights = filter.paddedWeights.data();
+			int x = 0;
+			for (; x < width; x++) {
+				if (starts[x] + ScaleFilter::kPaddedTaps > srcWidth) break;
+				int16x8_t pixels = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(row + starts[x])));
+				int16x8_t taps = vld1q_s16(weights + x * ScaleFilter::kPaddedTaps);
+				int32x4_t acc = vmull_s16(vget_low_s16(pixels), vget_low_s16(taps));
+				acc = vmlal_s16(acc, vget_high_s16(pixels), vget_high_s16(taps));
+				out[x] = ClampPixel((vaddvq_s32(acc) + kRound) >> ScaleFilter::kFilterBits);
+			}
+			return x;
+		}
+
+		int VerticalNeon(const uint8_t* const* rows, const int16_t* weights, int taps,
+			uint8_t* out, int width) {
+			int x = 0;
+			for (; x + 8 <= width; x += 8) {
+				int32x4_t accLo = vdupq_n_s32(0);
+				int32x4_t accHi = vdupq_n_s32(0);
+				for (int t = 0; t < taps; t++) {
+					int16x8_t pixels = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(rows[t] + x)));
+					accLo = vmlal_n_s16(accLo, vget_low_s16(pixels), weights[t]);
+					accHi = vmlal_n_s16(accHi, vget_high_s16(pixels), weights[t]);
+				}
+				// Rounding shift with unsigned saturation matches the scalar clamp
+				uint16x8_t words = vcombine_u16(vqrshrun_n_s32(accLo, ScaleFilter::kFilterBits),
+					vqrshrun_n_s32(accHi, ScaleFilter::kFilterBits));
+				vst1_u8(out + x, vqmovn_u16(words));
+			}
+			return x;
+		}
+#endif
+
+		using HorizontalFn = int (*)(const uint8_t* row, const ScaleFilter& filter, uint8_t* out, int width, int srcWidth);
+
+		HorizontalFn SelectHorizontal(Isa isa, const ScaleFilter& filter) {
+			if (filter.paddedWeights.empty()) return nullptr;
+#if defined(MEDIA_PIPELINE_X86)
+			if (isa == Isa::Avx2 || isa == Isa::Ssse3) return &HorizontalSsse3;
+#elif defined(MEDIA_PIPELINE_NEON)
+			if (isa == Isa::Neon) return &HorizontalNeon;
+#endif
+			return nullptr;
+		}
+
+		VerticalFn SelectVertical(Isa isa) {
+#if defined(MEDIA_PIPELINE_X86)
+			if (isa == Isa::Avx2) return &VerticalAvx2;
+			if (isa == Isa::Sse2 || isa == Isa::Ssse3) return &VerticalSse2;
+#elif defined(MEDIA_PIPELINE_NEON)
+			if (isa == Isa::Neon) return &VerticalNeon;
+#endif
+			return nullptr;
+		}
+	}
+
+	ScaleFilter BuildScaleFilter(int srcSize, int dstSize, ScaleMode mode) {
+		ScaleFilter filter;
+
+		// Same size is a plain copy. A single tap alone doesn't mean that: a
+		// one sample source also gets one tap, repeated across the output.
+		if (srcSize == dstSize) {
+			filter.taps = 1;
+			filter.starts.resize(dstSize);
+			filter.weights.assign(dstSize, static_cast<int16_t>(1 << ScaleFilter::kFilterBits));
+			for (int i = 0; i < dstSize; i++) filter.starts[i] = i;
+			return filter;
+		}
+
+		double scale = static_cast<double>(srcSize) / dstSize;
+		double stretch = std::max(scale, 1.0);
+		double support = FilterSupport(mode) * stretch;
+		filter.taps = std::min(static_cast<int>(std::ceil(support * 2.0)) + 1, srcSize);
+		filter.starts.resize(dstSize);
+		filter.weights.assign(static_cast<size_t>(dstSize) * filter.taps, 0);
+
+		std::vector<double> window(filter.taps);
+		for (int i = 0; i < dstSize; i++) {
+			double center = (i + 0.5) * scale - 0.5;
+			int first = static_cast<int>(std::floor(center - support));
+			int start = std::min(std::max(first, 0), srcSize - filter.taps);
+
+			std::fill(window.begin(), window.end(), 0.0);
+			double sum = 0.0;
+			for (int t = 0; t < filter.taps; t++) {
+				int sample = first + t;
+				double weight = FilterWeight(mode, sample, center, stretch);
+				int clamped = std::min(std::max(sample, 0), srcSize - 1);
+				window[clamped - start] += weight;
+				sum += weight;
+			}
+
+			int nearest = std::min(std::max(static_cast<int>(std::lround(center)), 0), srcSize - 1) - start;
+			if (sum <= 0.0) {
+				std::fill(window.begin(), window.end(), 0.0);
+				window[nearest] = 1.0;
+				sum = 1.0;
+			}
+
+			// Quantize and push the rounding error into the nearest tap so the sum is exact
+			int16_t* weights = &filter.weights[static_cast<size_t>(i) * filter.taps];
+			int total = 0;
+			for (int t = 0; t < filter.taps; t++) {
+				weights[t] = static_cast<int16_t>(std::lround(window[t] / sum * (1 << ScaleFilter::kFilterBits)));
+				total += weights[t];
+			}
+			weights[nearest] = static_cast<int16_t>(weights[nearest] + (1 << ScaleFilter::kFilterBits) - total);
+			filter.starts[i] = start;
+		}
+
+		if (filter.taps <= ScaleFilter::kPaddedTaps) {
+			filter.paddedWeights.assign(static_cast<size_t>(dstSize) * ScaleFilter::kPaddedTaps, 0);
+			for (int i = 0; i < dstSize; i++) {
+				std::copy_n(&filter.weights[static_cast<size_t>(i) * filter.taps], filter.taps,
+					&filter.paddedWeights[static_cast<size_t>(i) * ScaleFilter::kPaddedTaps]);
+			}
+		}
+		return filter;
+	}
+
+	void ScalePlaneRows(const uint8_t* src, int srcStride, int srcWidth,
+		uint8_t* dst, int dstStride, int dstWidth,
+		const ScaleFilter& horizontal, const ScaleFilter& vertical,
+		int rowBegin, int rowEnd, Isa isa) {
+		// Per thread scratch, reused across frames once it has grown
+		thread_local std::vector<uint8_t> columnRow;
+		thread_local std::vector<const uint8_t*> rowPointers;
+		columnRow.resize(srcWidth);
+		rowPointers.resize(vertical.taps);
+
+		VerticalFn simd = SelectVertical(isa);
+		HorizontalFn simdHorizontal = SelectHorizontal(isa, horizontal);
+		// One tap picks a whole source row, whatever the sizes; a row only
+		// copies as is when the width doesn't change
+		bool copyRows = vertical.taps == 1;
+		bool copyColumns = horizontal.taps == 1 && srcWidth == dstWidth;
+
+		for (int y = rowBegin; y < rowEnd; y++) {
+			const uint8_t* filteredRow;
+			if (copyRows) {
+				filteredRow = src + static_cast<size_t>(vertical.starts[y]) * srcStride;
+			}
+			else {
+				const int16_t* weights = &vertical.weights[static_cast<size_t>(y) * vertical.taps];
+				for (int t = 0; t < vertical.taps; t++) {
+					rowPointers[t] = src + static_cast<size_t>(vertical.starts[y] + t) * srcStride;
+				}
+				int done = simd ? simd(rowPointers.data(), weights, vertical.taps, columnRow.data(), srcWidth) : 0;
+				VerticalScalar(rowPointers.data(), weights, vertical.taps, columnRow.data(), done, srcWidth);
+				filteredRow = columnRow.data();
+			}
+
+			uint8_t* out = dst + static_cast<size_t>(y) * dstStride;
+			if (copyColumns) {
+				std::memcpy(out, filteredRow, dstWidth);
+			}
+			else {
+				int done = simdHorizontal ? simdHorizontal(filteredRow, horizontal, out, dstWidth, srcWidth) : 0;
+				HorizontalScalar(filteredRow, horizontal, out, done, dstWidth);
+			}
+		}
+	}
+}
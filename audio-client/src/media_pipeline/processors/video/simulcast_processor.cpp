@@ -0,0 +1,103 @@
+#include <stdexcept>
+#include <vector>
+#include <memory>
+
+#include "media_pipeline/processors/video/simulcast_processor.h"
+#include "media_pipeline/processors/video/hevc_processor.h"
+#include "media_pipeline/processors/video/video_scaler.h"
+#include "media_pipeline/core/interfaces/i_media_processor.h"
+#include "media_pipeline/core/interfaces/i_media_component.h"
+#include "media_pipeline/core/media_data.h"
+#include "media_pipeline/core/thread_pool.h"
+
+namespace media_pipeline::processors::video {
+    using core::MediaData;
+    using core::VideoFormat;
+
+    namespace {
+        // Parameter sets an encoder emits ahead of its first frame
+        bool IsHeaderPacket(const MediaData& packet) {
+            if (packet.type != MediaData::Type::Video) return false;
+            VideoFormat::PixelFormat format = std::get<VideoFormat>(packet.format).format;
+            return format == VideoFormat::PixelFormat::HEVC_HEADERS ||
+                format == VideoFormat::PixelFormat::H264_HEADERS ||
+                format == VideoFormat::PixelFormat::THEORA_HEADERS;
+        }
+    }
+
+    SimulcastProcessor::SimulcastProcessor(std::vector<ScaledSize> layerSizes,
+        int keyframeInterval,
+        EncoderFactory encoderFactory,
+        std::shared_ptr<ThreadPool> pool,
+        ScaleMode scaleMode)
+        : pool(pool ? pool : std::make_shared<ThreadPool>())
+        , scaler(layerSizes, scaleMode, this->pool)
+        , keyframeInterval(keyframeInterval)
+        , frameIndex(0)
+        , keyFrameRequested(false) {
+        if (keyframeInterval <= 0) {
+            throw std::runtime_error("SimulcastProcessor keyframe interval must be positive");
+        }
+        if (!encoderFactory) {
+            // Keyframes only when this class asks for them, otherwise scene cuts
+            // would put layers on different GOPs
+            encoderFactory = [](int, const ScaledSize&) {
+                return std::make_shared<HevcProcessor>(-1, false);
+            };
+        }
+        for (size_t i = 0; i < layerSizes.size(); i++) {
+            encoders.push_back(encoderFactory(static_cast<int>(i), layerSizes[i]));
+        }
+    }
+
+    void SimulcastProcessor::Start() {
+        scaler.Start();
+        for (auto& encoder : encoders) {
+            encoder->Start();
+        }
+        frameIndex = 0;
+        keyFrameRequested = false;
+    }
+
+    void SimulcastProcessor::Stop() {
+        for (auto& encoder : encoders) {
+            encoder->Stop();
+        }
+        scaler.Stop();
+    }
+
+    void SimulcastProcessor::RequestKeyFrame() {
+        keyFrameRequested = true;
+    }
+
+    MediaData SimulcastProcessor::ProcessMediaData(const MediaData& input) {
+        std::vector<MediaData> outputs = ProcessMediaDataMulti(input);
+        return std::move(outputs.front());
+    }
+
+    std::vector<MediaData> SimulcastProcessor::ProcessMediaDataMulti(const MediaData& input) {
+        std::vector<MediaData> layers = scaler.ScaleAll(input);
+
+        bool keyFrame = frameIndex % keyframeInterval == 0;
+        if (keyFrameRequested.exchange(false)) {
+            keyFrame = true;
+        }
+        frameIndex++;
+        for (MediaData& layer : layers) {
+            layer.getVideoFormat().isKeyFrame = keyFrame;
+        }
+
+        // Each encoder is only ever used by one job per frame, so they need no locking
+        std::vector<MediaData> outputs(layers.size());
+        pool->ParallelFor(static_cast<int>(layers.size()), [&](int index) {
+            outputs[index] = encoders[index]->ProcessMediaData(layers[index]);
+        });
+
+        for (size_t i = 0; i < outputs.size(); i++) {
+            outputs[i].layerId = static_cast<int>(i);
+            // Header packets keep the timestamp their encoder gave them
+            if (!IsHeaderPacket(outputs[i])) outputs[i].timestamp = input.timestamp;
+        }
+        return outputs;
+    }
+}
@@ -0,0 +1,135 @@
+#include <vector>
+#include <algorithm>
+#include <cstring>
+
+#include "media_pipeline/processors/video/static_frame_detector.h"
+#include "media_pipeline/processors/video/frame_diff_kernels.h"
+#include "media_pipeline/core/interfaces/i_media_processor.h"
+#include "media_pipeline/core/interfaces/i_media_component.h"
+#include "media_pipeline/core/media_data.h"
+#include "media_pipeline/core/logging.h"
+
+namespace media_pipeline::processors::video {
+    using core::MediaData;
+    using core::VideoFormat;
+
+    namespace {
+        constexpr int kBlockRows = 16;
+
+        // Formats that start with a plain 8-bit luma plane
+        bool HasLumaPlane(const VideoFormat& format) {
+            return format.format == VideoFormat::PixelFormat::YUV420P ||
+                format.format == VideoFormat::PixelFormat::NV12;
+        }
+    }
+
+    StaticFrameDetector::StaticFrameDetector(double changeThreshold, int minRefreshFrames, int rowStep)
+        : changeThreshold(changeThreshold)
+        , minRefreshFrames(minRefreshFrames)
+        , rowStep(std::max(1, rowStep))
+        , isa(kernels::SelectIsa())
+        , referenceWidth(0)
+        , referenceHeight(0)
+        , framesSinceRefresh(0)
+        , framesIn(0)
+        , framesSkipped(0) {}
+
+    void StaticFrameDetector::Start() {
+        reference.clear();
+        referenceWidth = 0;
+        referenceHeight = 0;
+        framesSinceRefresh = 0;
+        framesIn = 0;
+        framesSkipped = 0;
+    }
+
+    void StaticFrameDetector::Stop() {
+        StaticFrameStats stats = GetStats();
+        MEDIA_LOG_DEBUG("<StaticFrameDetector> Skipped " << stats.framesSkipped << " of "
+            << stats.framesIn << " frames (" << stats.SkipRate() * 100.0 << "%)");
+    }
+
+    StaticFrameStats StaticFrameDetector::GetStats() const {
+        StaticFrameStats stats;
+        stats.framesIn = framesIn.load();
+        stats.framesSkipped = framesSkipped.load();
+        return stats;
+    }
+
+    MediaData StaticFrameDetector::ProcessMediaData(const MediaData& input) {
+        framesIn++;
+        KeepReference(input);
+        return input;
+    }
+
+    std::vector<MediaData> StaticFrameDetector::ProcessMediaDataMulti(const MediaData& input) {
+        std::vector<MediaData> outputs;
+        framesIn++;
+
+        if (!input.isEndOfStream && IsStatic(input)) {
+            framesSkipped++;
+            framesSinceRefresh++;
+            return outputs;
+        }
+
+        KeepReference(input);
+        outputs.push_back(input);
+        return outputs;
+    }
+
+    bool StaticFrameDetector::IsStatic(const MediaData& input) {
+        // Anything else (packed YUV, RGB, encoded video) passes untouched
+        const VideoFormat& format = input.getVideoFormat();
+        if (!HasLumaPlane(format)) return false;
+
+        if (format.isKeyFrame || framesSinceRefresh >= minRefreshFrames) return false;
+        if (format.width != referenceWidth || format.height != referenceHeight) return false;
+
+        // A short buffer is left for the encoder to reject
+        int stride = format.stride > 0 ? format.stride : format.width;
+        if (input.data.size() < static_cast<size_t>(stride) * format.height) return false;
+
+        int blockCount = (format.width + kernels::kSadBlockWidth - 1) / kernels::kSadBlockWidth;
+        blockSums.resize(blockCount);
+        const uint8_t* current = input.data.data();
+
+        // Checked per stripe so a change near the top ends the scan early
+        for (int stripe = 0; stripe < format.height; stripe += kBlockRows) {
+            int stripeEnd = std::min(stripe + kBlockRows, format.height);
+            std::fill(blockSums.begin(), blockSums.end(), 0u);
+
+            int sampledRows = 0;
+            for (int row = stripe; row < stripeEnd; row += rowStep) {
+                kernels::AccumulateRowBlockSad(current + static_cast<size_t>(row) * stride,
+                    reference.data() + static_cast<size_t>(row) * format.width,
+                    format.width, blockSums.data(), isa);
+                sampledRows++;
+            }
+
+            for (int block = 0; block < blockCount; block++) {
+                int blockWidth = std::min(kernels::kSadBlockWidth, format.width - block * kernels::kSadBlockWidth);
+                double limit = changeThreshold * blockWidth * sampledRows;
+                if (blockSums[block] > limit) return false;
+            }
+        }
+        return true;
+    }
+
+    void StaticFrameDetector::KeepReference(const MediaData& input) {
+        framesSinceRefresh = 0;
+        if (input.isEndOfStream || input.type != MediaData::Type::Video) return;
+
+        const VideoFormat& format = input.getVideoFormat();
+        if (!HasLumaPlane(format)) return;
+        int stride = format.stride > 0 ? format.stride : format.width;
+        if (input.data.size() < static_cast<size_t>(stride) * format.height) return;
+
+        reference.resize(static_cast<size_t>(format.width) * format.height);
+        for (int row = 0; row < format.height; row++) {
+            std::memcpy(reference.data() + static_cast<size_t>(row) * format.width,
+                input.data.data() + static_cast<size_t>(row) * stride, format.width);
+        }
+        referenceWidth = format.width;
+        referenceHeight = format.height;
+    }
+}
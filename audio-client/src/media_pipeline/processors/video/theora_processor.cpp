@@ -71,12 +71,14 @@ namespace media_pipeline::processors::video {
 
         const VideoFormat& format = std::get<VideoFormat>(input.format);
 
-        // Convert YUY2 to YUV420P format that Theora expects
-        std::vector<uint8_t> yuvData = input.data;
+        // Packed camera formats must go through PixelFormatConverter first
+        if (format.format != VideoFormat::PixelFormat::YUV420P || format.stride != 0) {
+            throw std::runtime_error("TheoraProcessor expects tightly packed YUV420P frames");
+        }
 
         // Set up Theora picture
         th_ycbcr_buffer ycbcr;
-        SetupTheoraPicture(ycbcr, yuvData.data(), format.width, format.height);
+        SetupTheoraPicture(ycbcr, input.data.data(), format.width, format.height);
 
         // Encode frame
         if (th_encode_ycbcr_in(enc_state, ycbcr) != 0) {
@@ -0,0 +1,148 @@
+#include <stdexcept>
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+#include "media_pipeline/processors/video/video_scaler.h"
+#include "media_pipeline/processors/video/scaler_kernels.h"
+#include "media_pipeline/core/interfaces/i_media_processor.h"
+#include "media_pipeline/core/interfaces/i_media_component.h"
+#include "media_pipeline/core/media_data.h"
+#include "media_pipeline/core/video_frame.h"
+#include "media_pipeline/core/thread_pool.h"
+
+namespace media_pipeline::processors::video {
+    using core::MediaData;
+    using core::VideoFormat;
+    using core::I420Layout;
+    using core::I420View;
+    using core::PlaneView;
+
+    VideoScaler::VideoScaler(std::vector<ScaledSize> outputSizes,
+        ScaleMode mode,
+        std::shared_ptr<ThreadPool> pool)
+        : mode(mode)
+        , pool(pool ? pool : std::make_shared<ThreadPool>())
+        , isa(kernels::SelectIsa())
+        , filterWidth(0)
+        , filterHeight(0) {
+        if (outputSizes.empty()) {
+            throw std::runtime_error("VideoScaler needs at least one output size");
+        }
+        for (const ScaledSize& size : outputSizes) {
+            if (size.width <= 0 || size.height <= 0) {
+                throw std::runtime_error("VideoScaler output size must be positive");
+            }
+            Layer layer;
+            layer.size = size;
+            layers.push_back(std::move(layer));
+        }
+    }
+
+    void VideoScaler::Start() {
+        // Filters are built lazily from the first frame
+    }
+
+    void VideoScaler::Stop() {
+        filterWidth = 0;
+        filterHeight = 0;
+    }
+
+    void VideoScaler::PrepareFilters(int sourceWidth, int sourceHeight) {
+        if (sourceWidth == filterWidth && sourceHeight == filterHeight) return;
+
+        I420Layout source = I420Layout::ForSize(sourceWidth, sourceHeight);
+        for (Layer& layer : layers) {
+            I420Layout target = I420Layout::ForSize(layer.size.width, layer.size.height);
+            layer.lumaX = kernels::BuildScaleFilter(source.width, target.width, mode);
+            layer.lumaY = kernels::BuildScaleFilter(source.height, target.height, mode);
+            layer.chromaX = kernels::BuildScaleFilter(source.chromaWidth, target.chromaWidth, mode);
+            layer.chromaY = kernels::BuildScaleFilter(source.chromaHeight, target.chromaHeight, mode);
+        }
+        filterWidth = sourceWidth;
+        filterHeight = sourceHeight;
+    }
+
+    MediaData VideoScaler::ProcessMediaData(const MediaData& input) {
+        std::vector<MediaData> outputs = Scale(input, 1);
+        return std::move(outputs.front());
+    }
+
+    std::vector<MediaData> VideoScaler::ScaleAll(const MediaData& input) {
+        return Scale(input, layers.size());
+    }
+
+    std::vector<MediaData> VideoScaler::Scale(const MediaData& input, size_t layerCount) {
+        const VideoFormat& format = input.getVideoFormat();
+        if (format.format != VideoFormat::PixelFormat::YUV420P || format.stride != 0) {
+            throw std::runtime_error("VideoScaler expects tightly packed YUV420P frames");
+        }
+
+        I420Layout sourceLayout = I420Layout::ForSize(format.width, format.height);
+        if (input.data.size() < sourceLayout.TotalSize()) {
+            throw std::runtime_error("Video frame is smaller than its pixel format requires");
+        }
+        PrepareFilters(format.width, format.height);
+        I420View source = I420View::FromBuffer(const_cast<uint8_t*>(input.data.data()), sourceLayout);
+
+        std::vector<std::vector<uint8_t>> buffers(layerCount);
+        std::vector<I420View> targets;
+        targets.reserve(layerCount);
+        for (size_t i = 0; i < layerCount; i++) {
+            I420Layout layout = I420Layout::ForSize(layers[i].size.width, layers[i].size.height);
+            buffers[i].resize(layout.TotalSize());
+            targets.push_back(I420View::FromBuffer(buffers[i].data(), layout));
+        }
+
+        // One job per (layer, plane, row slice) so small layers don't leave threads idle
+        struct Job {
+            const PlaneView* src;
+            int srcWidth;
+            const PlaneView* dst;
+            int dstWidth;
+            const kernels::ScaleFilter* horizontal;
+            const kernels::ScaleFilter* vertical;
+            int rowBegin;
+            int rowEnd;
+        };
+        std::vector<Job> jobs;
+        for (size_t i = 0; i < layerCount; i++) {
+            const Layer& layer = layers[i];
+            const I420View& target = targets[i];
+            int chromaWidth = (target.width + 1) / 2;
+            int chromaHeight = (target.height + 1) / 2;
+
+            auto addPlane = [&](const PlaneView& src, int srcWidth, const PlaneView& dst, int dstWidth, int dstHeight,
+                const kernels::ScaleFilter& horizontal, const kernels::ScaleFilter& vertical) {
+                for (int row = 0; row < dstHeight; row += kSliceRows) {
+                    jobs.push_back({ &src, srcWidth, &dst, dstWidth, &horizontal, &vertical,
+                        row, std::min(row + kSliceRows, dstHeight) });
+                }
+            };
+            addPlane(source.y, source.width, target.y, target.width, target.height, layer.lumaX, layer.lumaY);
+            addPlane(source.u, sourceLayout.chromaWidth, target.u, chromaWidth, chromaHeight, layer.chromaX, layer.chromaY);
+            addPlane(source.v, sourceLayout.chromaWidth, target.v, chromaWidth, chromaHeight, layer.chromaX, layer.chromaY);
+        }
+
+        pool->ParallelFor(static_cast<int>(jobs.size()), [&jobs, this](int index) {
+            const Job& job = jobs[index];
+            kernels::ScalePlaneRows(job.src->data, job.src->stride, job.srcWidth,
+                job.dst->data, job.dst->stride, job.dstWidth,
+                *job.horizontal, *job.vertical,
+                job.rowBegin, job.rowEnd, isa);
+        });
+
+        std::vector<MediaData> outputs;
+        outputs.reserve(layerCount);
+        for (size_t i = 0; i < layerCount; i++) {
+            VideoFormat outputFormat = format;
+            outputFormat.width = layers[i].size.width;
+            outputFormat.height = layers[i].size.height;
+
+            MediaData output = MediaData::createVideo(std::move(buffers[i]), outputFormat);
+            output.timestamp = input.timestamp;
+            outputs.push_back(std::move(output));
+        }
+        return outputs;
+    }
+}
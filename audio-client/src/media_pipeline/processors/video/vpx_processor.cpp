@@ -0,0 +1,281 @@
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+#include <vpx/vpx_encoder.h>
+#include <vpx/vp8cx.h>
+
+#include "media_pipeline/processors/video/vpx_processor.h"
+#include "media_pipeline/core/interfaces/i_media_processor.h"
+#include "media_pipeline/core/interfaces/i_media_component.h"
+#include "media_pipeline/core/media_data.h"
+
+namespace media_pipeline::processors::video {
+    using core::MediaData;
+    using core::VideoFormat;
+
+    namespace {
+        // Layer 0 only references and updates LAST, layer 1 updates GOLDEN and
+        // layer 2 updates nothing, so each layer depends on lower layers only
+        constexpr vpx_enc_frame_flags_t kBaseLayerFlags =
+            VP8_EFLAG_NO_REF_GF | VP8_EFLAG_NO_REF_ARF | VP8_EFLAG_NO_UPD_GF | VP8_EFLAG_NO_UPD_ARF;
+        constexpr vpx_enc_frame_flags_t kMiddleLayerFlags =
+            VP8_EFLAG_NO_REF_ARF | VP8_EFLAG_NO_UPD_LAST | VP8_EFLAG_NO_UPD_ARF;
+        constexpr vpx_enc_frame_flags_t kTopLayerFlags =
+            VP8_EFLAG_NO_REF_ARF | VP8_EFLAG_NO_UPD_LAST | VP8_EFLAG_NO_UPD_GF | VP8_EFLAG_NO_UPD_ARF;
+
+        void Control(vpx_codec_ctx_t* codec, int id, int value) {
+            if (vpx_codec_control_(codec, id, value) != VPX_CODEC_OK) {
+                throw std::runtime_error(std::string("Failed to configure VPX encoder: ") + vpx_codec_error(codec));
+            }
+        }
+    }
+
+    VpxProcessor::VpxProcessor(VpxSettings settings)
+        : settings(settings)
+        , targetBitrate(settings.bitrateKbps)
+        , codec{}
+        , config{}
+        , isInitialized(false)
+        , frameIndex(0) {
+        if (settings.temporalLayers < 1 || settings.temporalLayers > 3) {
+            throw std::runtime_error("VpxProcessor supports 1 to 3 temporal layers");
+        }
+    }
+
+    VpxProcessor::~VpxProcessor() {
+        if (isInitialized) {
+            vpx_codec_destroy(&codec);
+        }
+    }
+
+    void VpxProcessor::Start() {
+        frameIndex = 0;
+    }
+
+    void VpxProcessor::Stop() {
+        if (isInitialized) {
+            vpx_codec_destroy(&codec);
+            isInitialized = false;
+        }
+    }
+
+    MediaData VpxProcessor::ProcessMediaData(const MediaData& input) {
+        const VideoFormat& format = input.getVideoFormat();
+
+        // Packed camera formats must go through PixelFormatConverter first
+        if (format.format != VideoFormat::PixelFormat::YUV420P || format.stride != 0) {
+            throw std::runtime_error("VpxProcessor expects tightly packed YUV420P frames");
+        }
+        size_t frameSize = static_cast<size_t>(format.width) * format.height
+            + 2 * static_cast<size_t>((format.width + 1) / 2) * ((format.height + 1) / 2);
+        if (input.data.size() < frameSize) {
+            throw std::runtime_error("Video frame is smaller than its pixel format requires");
+        }
+
+        if (!isInitialized) {
+            InitializeEncoder(format);
+        }
+
+        int target = targetBitrate;
+        if (target > 0 && target != settings.bitrateKbps) {
+            settings.bitrateKbps = target;
+            config.rc_target_bitrate = target;
+            ConfigureTemporalLayers(config);
+            if (vpx_codec_enc_config_set(&codec, &config) != VPX_CODEC_OK) {
+                throw std::runtime_error(std::string("Failed to change VPX bitrate: ") + vpx_codec_error(&codec));
+            }
+        }
+
+        vpx_image_t image;
+        if (!vpx_img_wrap(&image, VPX_IMG_FMT_I420, format.width, format.height, 1,
+            const_cast<uint8_t*>(input.data.data()))) {
+            throw std::runtime_error("Failed to wrap frame for VPX encoder");
+        }
+
+        int layerId = 0;
+        vpx_enc_frame_flags_t flags = TemporalLayerFlags(layerId);
+        if (settings.temporalLayers > 1) {
+            if (settings.codec == VpxCodec::VP9) {
+                vpx_svc_layer_id_t svcLayer = {};
+                svcLayer.temporal_layer_id = layerId;
+                if (vpx_codec_control(&codec, VP9E_SET_SVC_LAYER_ID, &svcLayer) != VPX_CODEC_OK) {
+                    throw std::runtime_error(std::string("Failed to set VPX temporal layer: ") + vpx_codec_error(&codec));
+                }
+            }
+            else {
+                Control(&codec, VP8E_SET_TEMPORAL_LAYER_ID, layerId);
+            }
+        }
+        if (format.isKeyFrame) {
+            flags |= VPX_EFLAG_FORCE_KF;
+        }
+
+        // Time base is one tick per frame
+        if (vpx_codec_encode(&codec, &image, frameIndex, 1, flags, VPX_DL_REALTIME) != VPX_CODEC_OK) {
+            throw std::runtime_error(std::string("Failed to encode frame: ") + vpx_codec_error(&codec));
+        }
+        frameIndex++;
+
+        std::vector<uint8_t> compressedData;
+        bool isKeyFrame = false;
+        vpx_codec_iter_t iter = nullptr;
+        const vpx_codec_cx_pkt_t* packet;
+        while ((packet = vpx_codec_get_cx_data(&codec, &iter)) != nullptr) {
+            if (packet->kind != VPX_CODEC_CX_FRAME_PKT) continue;
+
+            const uint8_t* bytes = static_cast<const uint8_t*>(packet->data.frame.buf);
+            compressedData.insert(compressedData.end(), bytes, bytes + packet->data.frame.sz);
+            isKeyFrame = isKeyFrame || (packet->data.frame.flags & VPX_FRAME_IS_KEY) != 0;
+        }
+
+        VideoFormat outputFormat = format;
+        outputFormat.format = settings.codec == VpxCodec::VP9
+            ? VideoFormat::PixelFormat::VP9
+            : VideoFormat::PixelFormat::VP8;
+        outputFormat.isKeyFrame = isKeyFrame;
+        outputFormat.temporalLayerId = layerId;
+
+        MediaData output = MediaData::createVideo(std::move(compressedData), outputFormat);
+        output.timestamp = input.timestamp;
+        output.layerId = input.layerId;
+        return output;
+    }
+
+    vpx_enc_frame_flags_t VpxProcessor::TemporalLayerFlags(int& layerId) const {
+        switch (settings.temporalLayers) {
+        case 2:
+            layerId = static_cast<int>(frameIndex % 2);
+            return layerId == 0 ? kBaseLayerFlags : kMiddleLayerFlags;
+        case 3: {
+            static constexpr int kPattern[4] = { 0, 2, 1, 2 };
+            layerId = kPattern[frameIndex % 4];
+            if (layerId == 0) return kBaseLayerFlags;
+            return layerId == 1 ? kMiddleLayerFlags : kTopLayerFlags;
+        }
+        default:
+            layerId = 0;
+            return 0;
+        }
+    }
+
+    void VpxProcessor::ConfigureTemporalLayers(vpx_codec_enc_cfg_t& config) {
+        config.ts_number_layers = settings.temporalLayers;
+        if (settings.temporalLayers == 1) return;
+
+        // Bitrates are cumulative, the top entry is the full stream
+        if (settings.temporalLayers == 2) {
+            config.ts_periodicity = 2;
+            config.ts_layer_id[0] = 0;
+            config.ts_layer_id[1] = 1;
+            config.ts_rate_decimator[0] = 2;
+            config.ts_rate_decimator[1] = 1;
+            config.ts_target_bitrate[0] = settings.bitrateKbps * 6 / 10;
+            config.ts_target_bitrate[1] = settings.bitrateKbps;
+        }
+        else {
+            config.ts_periodicity = 4;
+            config.ts_layer_id[0] = 0;
+            config.ts_layer_id[1] = 2;
+            config.ts_layer_id[2] = 1;
+            config.ts_layer_id[3] = 2;
+            config.ts_rate_decimator[0] = 4;
+            config.ts_rate_decimator[1] = 2;
+            config.ts_rate_decimator[2] = 1;
+            config.ts_target_bitrate[0] = settings.bitrateKbps * 4 / 10;
+            config.ts_target_bitrate[1] = settings.bitrateKbps * 6 / 10;
+            config.ts_target_bitrate[2] = settings.bitrateKbps;
+        }
+        if (settings.codec == VpxCodec::VP9) {
+            // VP9 expresses temporal layers through its SVC path
+            config.ss_number_layers = 1;
+            for (int i = 0; i < settings.temporalLayers; i++) {
+                config.layer_target_bitrate[i] = config.ts_target_bitrate[i];
+            }
+        }
+    }
+
+    void VpxProcessor::InitializeEncoder(const VideoFormat& format) {
+        vpx_codec_iface_t* iface = settings.codec == VpxCodec::VP9
+            ? vpx_codec_vp9_cx()
+            : vpx_codec_vp8_cx();
+
+        if (targetBitrate > 0) settings.bitrateKbps = targetBitrate;
+        if (vpx_codec_enc_config_default(iface, &config, 0) != VPX_CODEC_OK) {
+            throw std::runtime_error("Failed to get default VPX encoder config");
+        }
+
+        int threads = settings.threads > 0
+            ? settings.threads
+            : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+
+        config.g_w = format.width;
+        config.g_h = format.height;
+        config.g_timebase.num = 1;
+        config.g_timebase.den = std::max(1, static_cast<int>(std::lround(format.frameRate)));
+        config.g_threads = threads;
+        config.g_lag_in_frames = 0;
+        config.g_pass = VPX_RC_ONE_PASS;
+        config.g_error_resilient = settings.errorResilient ? VPX_ERROR_RESILIENT_DEFAULT : 0;
+
+        // Constant bitrate with a short buffer, frames are never dropped so the
+        // output stays one packet per input
+        config.rc_end_usage = VPX_CBR;
+        config.rc_target_bitrate = settings.bitrateKbps;
+        config.rc_min_quantizer = 4;
+        config.rc_max_quantizer = 56;
+        config.rc_undershoot_pct = 50;
+        config.rc_overshoot_pct = 50;
+        config.rc_buf_sz = 1000;
+        config.rc_buf_initial_sz = 600;
+        config.rc_buf_optimal_sz = 600;
+        config.rc_dropframe_thresh = 0;
+
+        if (settings.keyframeInterval < 0) {
+            config.kf_mode = VPX_KF_DISABLED;
+        }
+        else {
+            config.kf_mode = VPX_KF_AUTO;
+            config.kf_min_dist = 0;
+            config.kf_max_dist = settings.keyframeInterval;
+        }
+
+        ConfigureTemporalLayers(config);
+
+        if (vpx_codec_enc_init(&codec, iface, &config, 0) != VPX_CODEC_OK) {
+            throw std::runtime_error(std::string("Failed to initialize VPX encoder: ") + vpx_codec_error(&codec));
+        }
+        isInitialized = true;
+
+        Control(&codec, VP8E_SET_CPUUSED, settings.cpuUsed);
+        Control(&codec, VP8E_SET_STATIC_THRESHOLD, 1);
+        // Caps keyframe size relative to the per-frame budget (in percent)
+        Control(&codec, VP8E_SET_MAX_INTRA_BITRATE_PCT, 300);
+
+        if (settings.codec == VpxCodec::VP9) {
+            Control(&codec, VP9E_SET_ROW_MT, settings.rowMultithreading ? 1 : 0);
+            Control(&codec, VP9E_SET_TILE_COLUMNS, settings.tileColumnsLog2);
+            Control(&codec, VP9E_SET_AQ_MODE, 3);  // Cyclic refresh, tuned for realtime
+            Control(&codec, VP9E_SET_NOISE_SENSITIVITY, 0);
+            if (settings.temporalLayers > 1) {
+                Control(&codec, VP9E_SET_SVC, 1);
+            }
+        }
+        else {
+            // log2 of the token partition count, lets the decoder use threads as well
+            int partitions = threads >= 8 ? 3 : threads >= 4 ? 2 : threads >= 2 ? 1 : 0;
+            Control(&codec, VP8E_SET_TOKEN_PARTITIONS, partitions);
+        }
+    }
+
+    void VpxProcessor::SetTargetBitrate(int kbps) {
+        targetBitrate = kbps;
+    }
+
+    int VpxProcessor::GetTargetBitrate() const {
+        return targetBitrate;
+    }
+}
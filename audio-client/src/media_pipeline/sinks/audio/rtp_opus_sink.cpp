@@ -0,0 +1,114 @@
+#include <string>
+#include <stdexcept>
+#include <mutex>
+#include <cstring>
+
+#include "media_pipeline/sinks/audio/rtp_opus_sink.h"
+#include "media_pipeline/core/interfaces/i_media_sink.h"
+#include "media_pipeline/core/interfaces/i_media_component.h"
+#include "media_pipeline/core/media_data.h"
+#include "media_pipeline/net/socket.h"
+#include "media_pipeline/net/rtp.h"
+#include "media_pipeline/net/rtp_session.h"
+#include "media_pipeline/core/media_clock.h"
+
+namespace media_pipeline::sinks::audio {
+	using core::MediaData;
+	using core::AudioFormat;
+
+	namespace {
+		constexpr uint32_t kOpusRtpClockRate = 48000;	// RFC 7587 4.1, fixed for every input rate
+	}
+
+	RtpOpusSink::RtpOpusSink(RtpOpusSinkOptions options)
+		: options(options)
+		, header{}
+		, ssrc(options.ssrc != 0 ? options.ssrc : net::RandomRtpValue())
+		, session(ssrc, kOpusRtpClockRate, options.feedback)
+		, sequenceNumber(static_cast<uint16_t>(net::RandomRtpValue()))
+		, rtpTimestamp(net::RandomRtpValue())
+		, isFirstPacket(true) {
+	}
+
+	RtpOpusSink::~RtpOpusSink() {
+		Stop();
+	}
+
+	void RtpOpusSink::Start() {
+		socket = net::Socket::OpenUdp();
+		socket.Connect(options.address, options.port);
+		if (options.sendBufferBytes > 0) {
+			socket.SetSendBufferSize(options.sendBufferBytes);
+		}
+		socket.SetNonBlocking(true);
+		isFirstPacket = true;
+	}
+
+	void RtpOpusSink::Stop() {
+		socket.Close();
+	}
+
+	void RtpOpusSink::ConsumeMediaData(const MediaData& data) {
+		if (data.isEndOfStream || !socket.IsOpen()) return;
+
+		const AudioFormat& format = data.getAudioFormat();
+		if (format.format != AudioFormat::SampleFormat::OPUS) {
+			throw std::runtime_error("RtpOpusSink expects Opus packets");
+		}
+		if (data.data.size() <= sizeof(uint32_t)) return;
+
+		// OpusProcessor prefixes each packet with its frame count at the input rate
+		uint32_t frameCount;
+		std::memcpy(&frameCount, data.data.data(), sizeof(frameCount));
+		const uint8_t* payload = data.data.data() + sizeof(frameCount);
+		size_t payloadSize = data.data.size() - sizeof(frameCount);
+		uint32_t duration = static_cast<uint32_t>(
+			static_cast<uint64_t>(frameCount) * kOpusRtpClockRate / (format.sampleRate > 0 ? format.sampleRate : kOpusRtpClockRate));
+
+		net::RtpHeader rtp;
+		rtp.marker = isFirstPacket;
+		rtp.payloadType = options.payloadType;
+		rtp.sequenceNumber = sequenceNumber;
+		rtp.timestamp = rtpTimestamp;
+		rtp.ssrc = ssrc;
+		net::WriteRtpHeader(header, rtp);
+
+		size_t sent = 0;
+		uint64_t now = core::MediaClock::Now();
+		if (net::kRtpHeaderSize + payloadSize <= net::kRtpMaxPacketSize) {
+			net::IoSlice slices[2] = { { header, sizeof(header) }, { payload, payloadSize } };
+			try {
+				sent = socket.SendVectored(slices, 2);
+			}
+			catch (const std::runtime_error&) {
+				// A receiver that isn't listening yet bounces an ICMP error
+				// into the next send; for live audio that is just a lost packet
+				sent = 0;
+			}
+			session.OnPacketSent(sequenceNumber, rtpTimestamp, slices, 2, now);
+		}
+
+		// Sequence and timestamp advance for dropped packets too, the
+		// receiver sees them as lost instead of as a time jump
+		sequenceNumber++;
+		rtpTimestamp += duration;
+		isFirstPacket = false;
+
+		session.Service(socket, now);
+
+		std::lock_guard<std::mutex> lock(statsMutex);
+		if (sent == 0) {
+			stats.packetsDropped++;
+			return;
+		}
+		stats.packetsSent++;
+		stats.bytesSent += sent;
+	}
+
+	RtpSinkStats RtpOpusSink::GetStats() const {
+		std::lock_guard<std::mutex> lock(statsMutex);
+		RtpSinkStats result = stats;
+		result.feedback = session.GetStats();
+		return result;
+	}
+}
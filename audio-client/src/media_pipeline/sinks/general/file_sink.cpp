@@ -1,4 +1,3 @@
-#include <fstream>
 #include <string>
 #include <iostream>
 
@@ -7,28 +6,25 @@
 #include "media_pipeline/core/interfaces/i_media_component.h"
 #include "media_pipeline/core/interfaces/i_file_format.h"
 #include "media_pipeline/core/media_data.h"
+#include "media_pipeline/core/async_file_writer.h"
 
 namespace media_pipeline::sinks::general {
     using core::MediaData;
     using core::interfaces::IFileFormat;
 
-    FileSink::FileSink(const std::string& filePath, std::unique_ptr<IFileFormat> format)
-        : filePath(filePath), format(std::move(format)) {
+    FileSink::FileSink(const std::string& filePath, std::unique_ptr<IFileFormat> format,
+        AsyncFileWriterOptions writerOptions)
+        : outputFile(writerOptions), format(std::move(format)), filePath(filePath) {
     }
 
     void FileSink::Start() {
-        outputFile.open(filePath, std::ios::binary);
-        if (!outputFile) {
-            throw std::runtime_error("Failed to open MP3 output file");
-        }
+        outputFile.Open(filePath);
         format->WriteHeader(outputFile);
     }
 
     void FileSink::Stop() {
         format->Finalize(outputFile);
-        if (outputFile.is_open()) {
-            outputFile.close();
-        }
+        outputFile.Close();
     }
 
     void FileSink::ConsumeMediaData(const MediaData& data) {
@@ -37,9 +33,7 @@ namespace media_pipeline::sinks::general {
 
     FileSink::~FileSink() {
         try {
-            if (outputFile.is_open()) {
-                outputFile.close();
-            }
+            outputFile.Close();
         }
         catch (const std::exception& e) {
             std::cout << "Error closing audio file sink" << std::endl;
@@ -1,75 +1,580 @@
 #include <string>
 #include <stdexcept>
-
-#include <WinSock2.h>
-#include <WS2tcpip.h>
-#pragma comment(lib, "ws2_32.lib")
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+#include <iterator>
+#include <cstring>
 
 #include "media_pipeline/sinks/general/network_sink.h"
 #include "media_pipeline/core/interfaces/i_media_sink.h"
 #include "media_pipeline/core/interfaces/i_media_component.h"
 #include "media_pipeline/core/media_data.h"
+#include "media_pipeline/net/socket.h"
+#include "media_pipeline/net/poller.h"
+#include "media_pipeline/net/relay_protocol.h"
+#include "media_pipeline/net/wire_protocol.h"
 
 namespace media_pipeline::sinks::general {
 	using core::MediaData;
+	using core::AudioFormat;
+	using core::VideoFormat;
+
+	namespace {
+		// Bounds how long Stop waits for a sender blocked on a full socket
+		constexpr int kWritableWaitMs = 50;
+		constexpr size_t kOpusDtxMaxSize = 2;	// A TOC byte and at most one more, no audio
+		// Round robin turn when frames aren't split; large frames then take
+		// several turns
+		constexpr size_t kUnsplitQuantum = 16 * 1024;
 
-	NetworkSink::NetworkSink(
-		const std::string& address = "127.0.0.1",
-		USHORT port = 12345)
-		: sock(INVALID_SOCKET)
-		, serverPort(port)
-		, serverAddress(address) {
+		net::WireCodec AudioCodec(AudioFormat::SampleFormat format) {
+			switch (format) {
+			case AudioFormat::SampleFormat::OPUS: return net::WireCodec::Opus;
+			case AudioFormat::SampleFormat::AAC: return net::WireCodec::Aac;
+			case AudioFormat::SampleFormat::MP3: return net::WireCodec::Mp3;
+			case AudioFormat::SampleFormat::PCM_S16LE: return net::WireCodec::PcmS16;
+			case AudioFormat::SampleFormat::PCM_FLOAT: return net::WireCodec::PcmF32;
+			default: return net::WireCodec::Unknown;
+			}
+		}
+
+		net::WireCodec VideoCodec(VideoFormat::PixelFormat format) {
+			switch (format) {
+			case VideoFormat::PixelFormat::HEVC:
+			case VideoFormat::PixelFormat::HEVC_HEADERS: return net::WireCodec::Hevc;
+			case VideoFormat::PixelFormat::H264:
+			case VideoFormat::PixelFormat::H264_HEADERS: return net::WireCodec::H264;
+			case VideoFormat::PixelFormat::VP8: return net::WireCodec::Vp8;
+			case VideoFormat::PixelFormat::VP9: return net::WireCodec::Vp9;
+			case VideoFormat::PixelFormat::THEORA:
+			case VideoFormat::PixelFormat::THEORA_HEADERS: return net::WireCodec::Theora;
+			default: return net::WireCodec::Unknown;
+			}
+		}
 
-		// configure socket
-		WSADATA wsaData;
-		if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
-			throw std::runtime_error("WSAStartup failed");
+		bool IsCodecConfig(VideoFormat::PixelFormat format) {
+			return format == VideoFormat::PixelFormat::HEVC_HEADERS ||
+				format == VideoFormat::PixelFormat::H264_HEADERS ||
+				format == VideoFormat::PixelFormat::THEORA_HEADERS;
 		}
+
+		double MillisSince(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point now) {
+			return std::chrono::duration<double, std::milli>(now - start).count();
+		}
+	}
+
+	NetworkSink::NetworkSink(const std::string& address, uint16_t port)
+		: NetworkSink(NetworkSinkOptions{ address, port }) {
+	}
+
+	NetworkSink::NetworkSink(NetworkSinkOptions options)
+		: options(options)
+		, queuedBytes(0)
+		, currentStream(-1)
+		, frontOffset(0)
+		, roundRobin{}
+		, isStopping(false)
+		, bytesSent(0)
+		, packetsSent(0)
+		, packetsDropped(0)
+		, bytesDropped(0)
+		, sendStalls(0)
+		, fragmentsSent(0)
+		, totalQueueDelayMs(0.0)
+		, maxQueueDelayMs(0.0) {
 	}
 
 	NetworkSink::~NetworkSink() {
-		// configuration cleanup
-		WSACleanup();
+		Stop();
 	}
 
 	void NetworkSink::Start() {
-		// establish socket connection
-		sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-		if (sock == INVALID_SOCKET) {
-			throw std::runtime_error("Failed to configure TCP socket");
+		// Connecting blocks, everything after that is non-blocking
+		socket = net::Socket::ConnectTcp(options.address, options.port);
+		socket.SetNoDelay(options.noDelay);
+		if (options.sendBufferBytes > 0) {
+			socket.SetSendBufferSize(options.sendBufferBytes);
 		}
-
-		sockaddr_in serverAddr = {};
-		serverAddr.sin_family = AF_INET;
-		serverAddr.sin_port = htons(serverPort);
-		inet_pton(AF_INET, serverAddress.c_str(), &serverAddr.sin_addr);
-
-		if (connect(sock, (sockaddr*)&serverAddr, sizeof(serverAddr)) == SOCKET_ERROR) {
-			throw std::runtime_error("Failed to connect TCP socket");
+		if (options.unsentLowWatermark > 0) {
+			socket.SetUnsentLowWatermark(options.unsentLowWatermark);
 		}
+		if (options.relayChannel != 0) {
+			// Still blocking, so the join goes out whole ahead of any media
+			uint8_t join[net::kRelayJoinMessageSize];
+			net::WriteRelayJoin(join, net::RelayJoin{ options.relayChannel, net::kRelayPublish });
+			socket.Send(join, sizeof(join));
+		}
+		socket.SetNonBlocking(true);
+
+		isStopping = false;
+		streams.clear();		// A new connection starts every stream over
+		queues.clear();
+		std::fill(std::begin(roundRobin), std::end(roundRobin), 0);
+		senderThread = std::thread(&NetworkSink::SenderLoop, this);
 	}
 
 	void NetworkSink::Stop() {
-		// close socket connection
-		if (sock != INVALID_SOCKET) {
-			closesocket(sock);
+		// Live media still queued is discarded rather than delaying shutdown
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			isStopping = true;
+		}
+		cv.notify_all();
+		if (senderThread.joinable()) {
+			senderThread.join();
+		}
+		socket.Close();
+
+		std::lock_guard<std::mutex> lock(mutex);
+		for (SendQueue& queue : queues) {
+			queue.packets.clear();
+			queue.queuedBytes = 0;
+			queue.queuedFrames = 0;
+			queue.deficit = 0;
 		}
+		queuedBytes = 0;
+		currentStream = -1;
+		frontOffset = 0;
 	}
 
 	void NetworkSink::ConsumeMediaData(const MediaData& data) {
-		// if socket established, AudioData.data over network
-		uint32_t dataSize = static_cast<uint32_t>(data.data.size());
-		if (send(sock, reinterpret_cast<const char*>(&dataSize), sizeof(dataSize), 0) != sizeof(dataSize)) {
-			throw std::runtime_error("Failed to send data size over TCP socket");
+		ThrowIfFailed();
+		if (data.isEndOfStream) {
+			// Pipeline end of stream markers belong to no stream in particular
+			if (options.legacyFraming) return;
+			for (StreamState& stream : streams) {
+				building.clear();
+				building.emplace_back();
+				BuildEndOfStream(stream, building.back());
+				Enqueue(stream, building);
+			}
+			return;
+		}
+
+		StreamState& stream = FindStream(data);
+		building.clear();
+		BuildPackets(data, stream, building);
+		Enqueue(stream, building);
+	}
+
+	NetworkSink::StreamState& NetworkSink::FindStream(const MediaData& data) {
+		for (StreamState& stream : streams) {
+			if (stream.type == data.type && stream.layerId == data.layerId) return stream;
+		}
+		streams.push_back(StreamState{ data.type, data.layerId, static_cast<uint16_t>(streams.size()), 0, -1, -1 });
+		return streams.back();
+	}
+
+	void NetworkSink::BuildPackets(const MediaData& data, StreamState& stream, std::vector<OutboundPacket>& packets) {
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		if (options.legacyFraming) {
+			// Legacy receivers can't reassemble, frames always go whole
+			OutboundPacket& packet = packets.emplace_back();
+			uint32_t size = static_cast<uint32_t>(data.data.size());
+			std::memcpy(packet.header, &size, sizeof(size));
+			packet.headerSize = sizeof(size);
+			packet.payload = data.data;
+			packet.queuedAt = now;
+			return;
 		}
 
-		size_t bytesSent = 0;
-		while (bytesSent < data.data.size()) {
-			int sent = send(sock, (const char*)(data.data.data()), dataSize - bytesSent, 0);
-			if (sent == SOCKET_ERROR) {
-				throw std::runtime_error("Failed to send data over TCP socket");
+		net::WireHeader header;
+		header.streamId = stream.id;
+		header.sequence = stream.sequence++;
+		header.timestamp = data.timestamp;
+
+		uint8_t extensions[net::kWireMaxExtensionsSize - net::kWireFragmentExtensionSize];
+		size_t extensionsSize = 0;
+		const uint8_t* payload = data.data.data();
+		size_t payloadSize = data.data.size();
+
+		if (data.type == MediaData::Type::Audio) {
+			const AudioFormat& format = data.getAudioFormat();
+			header.mediaType = net::WireMediaType::Audio;
+			header.codec = AudioCodec(format.format);
+			if (format.format == AudioFormat::SampleFormat::OPUS && payloadSize >= sizeof(uint32_t)) {
+				// OpusProcessor prefixes each packet with its frame count
+				payload += sizeof(uint32_t);
+				payloadSize -= sizeof(uint32_t);
+				if (payloadSize <= kOpusDtxMaxSize) header.flags |= net::kWireDtx;
+			}
+			if (format.sampleRate != stream.formatA || format.channels != stream.formatB) {
+				uint8_t value[5];
+				net::WriteRelayU32(value, static_cast<uint32_t>(format.sampleRate));
+				value[4] = static_cast<uint8_t>(format.channels);
+				extensionsSize += net::WriteWireExtension(extensions + extensionsSize, net::kWireExtAudioFormat, value, sizeof(value));
+				stream.formatA = format.sampleRate;
+				stream.formatB = format.channels;
+			}
+		}
+		else {
+			const VideoFormat& format = data.getVideoFormat();
+			header.mediaType = net::WireMediaType::Video;
+			header.codec = VideoCodec(format.format);
+			if (format.isKeyFrame) header.flags |= net::kWireKeyFrame;
+			if (IsCodecConfig(format.format)) header.flags |= net::kWireCodecConfig;
+			// Repeated on keyframes for receivers that join mid-stream
+			if (format.isKeyFrame || format.width != stream.formatA || format.height != stream.formatB) {
+				uint8_t value[4];
+				net::WriteWireU16(value, static_cast<uint16_t>(format.width));
+				net::WriteWireU16(value + 2, static_cast<uint16_t>(format.height));
+				extensionsSize += net::WriteWireExtension(extensions + extensionsSize, net::kWireExtVideoFormat, value, sizeof(value));
+				stream.formatA = format.width;
+				stream.formatB = format.height;
+			}
+			if (format.temporalLayerId != 0 || data.layerId != 0) {
+				uint8_t value[2] = { static_cast<uint8_t>(data.layerId), static_cast<uint8_t>(format.temporalLayerId) };
+				extensionsSize += net::WriteWireExtension(extensions + extensionsSize, net::kWireExtLayers, value, sizeof(value));
+			}
+		}
+
+		// Fragments repeat the header; the first also carries the frame's
+		// extensions, every one its place in the frame
+		size_t fragmentSize = options.maxFragmentBytes;
+		bool split = fragmentSize > 0 && payloadSize > fragmentSize;
+		if (!split) fragmentSize = payloadSize;
+		size_t offset = 0;
+		do {
+			size_t size = std::min(fragmentSize, payloadSize - offset);
+			OutboundPacket& packet = packets.emplace_back();
+			uint8_t* packetExtensions = packet.header + net::kWireHeaderSize;
+			size_t packetExtensionsSize = 0;
+			if (offset == 0) {
+				std::memcpy(packetExtensions, extensions, extensionsSize);
+				packetExtensionsSize = extensionsSize;
+			}
+			if (split) {
+				packetExtensionsSize += net::WriteWireFragment(packetExtensions + packetExtensionsSize,
+					static_cast<uint32_t>(offset), static_cast<uint32_t>(payloadSize));
+			}
+			packet.headerSize = net::WriteWireHeader(packet.header, header, packetExtensionsSize, size) + packetExtensionsSize;
+			packet.payload.assign(payload + offset, payload + offset + size);
+			packet.queuedAt = now;
+			packet.startsFrame = offset == 0;
+			offset += size;
+			packet.endsFrame = offset == payloadSize;
+		} while (offset < payloadSize);
+	}
+
+	void NetworkSink::BuildEndOfStream(StreamState& stream, OutboundPacket& packet) {
+		net::WireHeader header;
+		header.mediaType = stream.type == MediaData::Type::Audio ? net::WireMediaType::Audio : net::WireMediaType::Video;
+		header.streamId = stream.id;
+		header.flags = net::kWireEndOfStream;
+		header.sequence = stream.sequence++;
+		packet.headerSize = net::WriteWireHeader(packet.header, header, 0, 0);
+		packet.queuedAt = std::chrono::steady_clock::now();
+		// The next frame starts over with its format
+		stream.formatA = -1;
+		stream.formatB = -1;
+	}
+
+	void NetworkSink::Enqueue(const StreamState& stream, std::vector<OutboundPacket>& packets) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			while (queues.size() <= stream.id) {
+				// A turn is about one fragment's worth, audioWeight of them
+				// for audio when it doesn't go first anyway
+				const StreamState& added = streams[queues.size()];
+				bool isAudio = added.type == MediaData::Type::Audio;
+				bool audioFirst = options.schedule == NetworkSchedule::AudioFirst;
+				size_t quantum = options.maxFragmentBytes > 0 && !options.legacyFraming ? options.maxFragmentBytes : kUnsplitQuantum;
+				quantum = std::max(quantum, net::kWireHeaderSize + net::kWireMaxExtensionsSize);
+				if (isAudio && !audioFirst) quantum *= std::max<uint32_t>(options.audioWeight, 1);
+				queues.push_back(SendQueue{ {}, added.type, added.layerId, isAudio || !audioFirst ? 0 : 1,
+					quantum, 0, 0, 0, 0, 0, 0.0, 0.0 });
+			}
+
+			SendQueue& queue = queues[stream.id];
+			for (OutboundPacket& packet : packets) {
+				queue.queuedBytes += packet.Size();
+				queuedBytes += packet.Size();
+				queue.packets.push_back(std::move(packet));
+			}
+			queue.queuedFrames++;
+
+			// The newest frame always stays, even if it alone exceeds the bound
+			while (queuedBytes > options.maxQueuedBytes) {
+				if (!DropOldest(stream.id, queue.packets.size() - packets.size())) break;
 			}
-			bytesSent += sent;
 		}
+		cv.notify_one();
+	}
+
+	size_t NetworkSink::FirstDroppable(size_t stream) const {
+		// Past the frame that has started sending, if any
+		const std::deque<OutboundPacket>& packets = queues[stream].packets;
+		if (packets.empty()) return 0;
+		if (currentStream != static_cast<int>(stream) && packets.front().startsFrame) return 0;
+		size_t index = 0;
+		while (index < packets.size() && !packets[index].endsFrame) index++;
+		return std::min(index + 1, packets.size());
+	}
+
+	void NetworkSink::DropFrame(size_t stream, size_t index) {
+		SendQueue& queue = queues[stream];
+		size_t end = index;
+		size_t bytes = 0;
+		do {
+			bytes += queue.packets[end].Size();
+		} while (!queue.packets[end++].endsFrame);
+
+		packetsDropped++;
+		queue.packetsDropped++;
+		bytesDropped += bytes;
+		queuedBytes -= bytes;
+		queue.queuedBytes -= bytes;
+		queue.queuedFrames--;
+		queue.packets.erase(queue.packets.begin() + index, queue.packets.begin() + end);
+	}
+
+	// Frames of keepStream from keepFrom on are never dropped
+	bool NetworkSink::DropOldest(size_t keepStream, size_t keepFrom) {
+		// The oldest frame of the least important streams that have one
+		for (int priority = kPriorities - 1; priority >= 0; priority--) {
+			size_t victim = queues.size();
+			size_t victimIndex = 0;
+			for (size_t stream = 0; stream < queues.size(); stream++) {
+				const SendQueue& queue = queues[stream];
+				if (queue.priority != priority) continue;
+				size_t index = FirstDroppable(stream);
+				size_t end = stream == keepStream ? keepFrom : queue.packets.size();
+				if (index >= end) continue;
+				if (victim == queues.size() || queue.packets[index].queuedAt < queues[victim].packets[victimIndex].queuedAt) {
+					victim = stream;
+					victimIndex = index;
+				}
+			}
+			if (victim != queues.size()) {
+				DropFrame(victim, victimIndex);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void NetworkSink::DropStale(std::chrono::steady_clock::time_point now) {
+		if (options.maxQueueDelay.count() <= 0) return;
+
+		for (size_t stream = 0; stream < queues.size(); stream++) {
+			const std::deque<OutboundPacket>& packets = queues[stream].packets;
+			size_t index = FirstDroppable(stream);
+			while (index < packets.size() && now - packets[index].queuedAt > options.maxQueueDelay) {
+				DropFrame(stream, index);
+			}
+		}
+	}
+
+	void NetworkSink::ResetCursors(std::vector<ScheduleCursor>& cursors) const {
+		cursors.resize(queues.size());
+		for (size_t stream = 0; stream < queues.size(); stream++) {
+			cursors[stream] = ScheduleCursor{ 0, queues[stream].deficit };
+		}
+		// Picked when it started
+		if (currentStream >= 0) cursors[currentStream].next = 1;
+	}
+
+	int NetworkSink::NextStream(std::vector<ScheduleCursor>& cursors, size_t* roundRobin) const {
+		// Strict priority between priorities, deficit round robin within
+		// one: a turn adds the quantum to a stream's deficit and it sends
+		// packets while they fit, so streams share bytes, not packets
+		for (int priority = 0; priority < kPriorities; priority++) {
+			bool waiting = false;
+			for (size_t stream = 0; stream < queues.size(); stream++) {
+				waiting = waiting || (queues[stream].priority == priority && cursors[stream].next < queues[stream].packets.size());
+			}
+			if (!waiting) continue;
+
+			size_t stream = roundRobin[priority] % queues.size();
+			while (true) {
+				const SendQueue& queue = queues[stream];
+				ScheduleCursor& cursor = cursors[stream];
+				if (queue.priority == priority) {
+					if (cursor.next < queue.packets.size()) {
+						size_t size = queue.packets[cursor.next].Size();
+						if (cursor.deficit >= size) {
+							cursor.deficit -= size;
+							cursor.next++;
+							roundRobin[priority] = stream;
+							return static_cast<int>(stream);
+						}
+					}
+					else {
+						cursor.deficit = 0;		// Idle streams save up nothing
+					}
+				}
+				stream = (stream + 1) % queues.size();
+				if (queues[stream].priority == priority && cursors[stream].next < queues[stream].packets.size()) {
+					cursors[stream].deficit += queues[stream].quantum;
+				}
+			}
+		}
+		return -1;
+	}
+
+	void NetworkSink::CompleteFront(size_t stream, std::chrono::steady_clock::time_point now) {
+		SendQueue& queue = queues[stream];
+		OutboundPacket& front = queue.packets.front();
+		if (!front.startsFrame || !front.endsFrame) fragmentsSent++;
+		if (front.endsFrame) {
+			// Delay counts until the frame's last byte went out
+			double delay = MillisSince(front.queuedAt, now);
+			totalQueueDelayMs += delay;
+			maxQueueDelayMs = std::max(maxQueueDelayMs, delay);
+			queue.totalQueueDelayMs += delay;
+			queue.maxQueueDelayMs = std::max(queue.maxQueueDelayMs, delay);
+			packetsSent++;
+			queue.packetsSent++;
+			queue.queuedFrames--;
+		}
+		queuedBytes -= front.Size();
+		queue.queuedBytes -= front.Size();
+		queue.packets.pop_front();
+	}
+
+	bool NetworkSink::SendQueued() {
+		// The send is non-blocking, so holding the lock through it only
+		// briefly delays producers, and no packet can be dropped while its
+		// bytes are referenced by the slices
+		std::lock_guard<std::mutex> lock(mutex);
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		DropStale(now);
+		if (queuedBytes == 0) return true;
+
+		// Plans as many packets as one send takes on a copy of the
+		// scheduler state. The socket may take fewer; only the packets it
+		// took (or started) are committed, the rest are picked afresh next
+		// time, so later audio can still go ahead of them.
+		net::IoSlice slices[net::Socket::kMaxSlices];
+		size_t sliceCount = 0;
+		size_t plannedBytes = 0;
+		auto addSlices = [&](const OutboundPacket& packet, size_t skip) {
+			plannedBytes += packet.Size() - skip;
+			if (skip < packet.headerSize) {
+				slices[sliceCount++] = { packet.header + skip, packet.headerSize - skip };
+				skip = 0;
+			}
+			else {
+				skip -= packet.headerSize;
+			}
+			if (packet.payload.size() > skip) {
+				slices[sliceCount++] = { packet.payload.data() + skip, packet.payload.size() - skip };
+			}
+		};
+
+		ResetCursors(planCursors);
+		size_t planRoundRobin[kPriorities];
+		std::copy(std::begin(roundRobin), std::end(roundRobin), planRoundRobin);
+		if (currentStream >= 0) {
+			addSlices(queues[currentStream].packets.front(), frontOffset);
+		}
+		// The kernel checks the low watermark only between its segments,
+		// which can be 64 KB, so one large send would overshoot it by that
+		size_t maxPlannedBytes = options.unsentLowWatermark > 0 ? options.unsentLowWatermark : SIZE_MAX;
+		while (sliceCount + 2 <= net::Socket::kMaxSlices && plannedBytes < maxPlannedBytes) {
+			int stream = NextStream(planCursors, planRoundRobin);
+			if (stream < 0) break;
+			addSlices(queues[stream].packets[planCursors[stream].next - 1], 0);
+		}
+
+		size_t sent = socket.SendVectored(slices, sliceCount);
+		if (sent == 0) {
+			sendStalls++;
+			return false;
+		}
+		bytesSent += sent;
+
+		if (currentStream >= 0) {
+			size_t remaining = queues[currentStream].packets.front().Size() - frontOffset;
+			if (sent < remaining) {
+				frontOffset += sent;
+				return true;
+			}
+			sent -= remaining;
+			CompleteFront(currentStream, now);
+			currentStream = -1;
+			frontOffset = 0;
+		}
+
+		// Picks the same packets again, now for real
+		ResetCursors(planCursors);
+		while (sent > 0) {
+			int stream = NextStream(planCursors, roundRobin);
+			planCursors[stream].next = 0;
+			size_t size = queues[stream].packets.front().Size();
+			if (sent < size) {
+				currentStream = stream;
+				frontOffset = sent;
+				break;
+			}
+			sent -= size;
+			CompleteFront(stream, now);
+		}
+		for (size_t stream = 0; stream < queues.size(); stream++) {
+			queues[stream].deficit = planCursors[stream].deficit;
+		}
+		return true;
+	}
+
+	void NetworkSink::SenderLoop() {
+		try {
+			net::Poller poller;
+			poller.Add(socket.Handle(), net::kPollWritable);
+			std::vector<net::PollEvent> events;
+
+			while (true) {
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					cv.wait(lock, [this] { return isStopping || queuedBytes > 0; });
+					if (isStopping) return;
+				}
+				if (!SendQueued()) {
+					poller.Wait(events, kWritableWaitMs);
+				}
+			}
+		}
+		catch (...) {
+			std::lock_guard<std::mutex> lock(mutex);
+			error = std::current_exception();
+		}
+	}
+
+	NetworkSinkStats NetworkSink::GetStats() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		NetworkSinkStats stats;
+		stats.bytesSent = bytesSent;
+		stats.packetsSent = packetsSent;
+		stats.packetsDropped = packetsDropped;
+		stats.bytesDropped = bytesDropped;
+		stats.sendStalls = sendStalls;
+		stats.fragmentsSent = fragmentsSent;
+		stats.queuedBytes = queuedBytes;
+		stats.averageQueueDelayMs = packetsSent > 0 ? totalQueueDelayMs / packetsSent : 0.0;
+		stats.maxQueueDelayMs = maxQueueDelayMs;
+		for (size_t stream = 0; stream < queues.size(); stream++) {
+			const SendQueue& queue = queues[stream];
+			NetworkStreamStats streamStats;
+			streamStats.streamId = static_cast<uint16_t>(stream);
+			streamStats.type = queue.type;
+			streamStats.layerId = queue.layerId;
+			streamStats.packetsSent = queue.packetsSent;
+			streamStats.packetsDropped = queue.packetsDropped;
+			streamStats.queuedPackets = queue.queuedFrames;
+			streamStats.queuedBytes = queue.queuedBytes;
+			streamStats.averageQueueDelayMs = queue.packetsSent > 0 ? queue.totalQueueDelayMs / queue.packetsSent : 0.0;
+			streamStats.maxQueueDelayMs = queue.maxQueueDelayMs;
+			stats.queuedPackets += queue.queuedFrames;
+			stats.streams.push_back(streamStats);
+		}
+		return stats;
+	}
+
+	void NetworkSink::ThrowIfFailed() {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (error) std::rethrow_exception(error);
 	}
 }
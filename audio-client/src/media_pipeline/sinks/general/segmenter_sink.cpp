@@ -0,0 +1,414 @@
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <stdexcept>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <filesystem>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <cstring>
+#include <cstdio>
+
+#include "media_pipeline/sinks/general/segmenter_sink.h"
+#include "media_pipeline/core/interfaces/i_media_sink.h"
+#include "media_pipeline/core/media_data.h"
+#include "media_pipeline/core/logging.h"
+
+namespace media_pipeline::sinks::general {
+    using core::MediaData;
+    using core::VideoFormat;
+
+    namespace {
+        constexpr double kNanosPerSecond = 1e9;
+        // Frame timestamps are rounded, a keyframe exactly one target in may land just short of it
+        constexpr double kCutTolerance = 0.01;
+        const uint8_t kEbmlId[] = { 0x1A, 0x45, 0xDF, 0xA3 };
+        const uint8_t kClusterId[] = { 0x1F, 0x43, 0xB6, 0x75 };
+
+        bool StartsWith(const std::vector<uint8_t>& data, const uint8_t* prefix, size_t size) {
+            return data.size() >= size && std::memcmp(data.data(), prefix, size) == 0;
+        }
+
+        // Payload of the first box of this type, found by scanning for its fourcc
+        const uint8_t* FindBox(const std::vector<uint8_t>& data, const char* type, size_t& payloadSize) {
+            for (size_t i = 4; i + 4 <= data.size(); i++) {
+                if (std::memcmp(data.data() + i, type, 4) != 0) continue;
+                uint32_t size = (data[i - 4] << 24) | (data[i - 3] << 16) | (data[i - 2] << 8) | data[i - 1];
+                if (size < 8 || i - 4 + size > data.size()) continue;
+                payloadSize = size - 8;
+                return data.data() + i + 4;
+            }
+            return nullptr;
+        }
+
+        bool Contains(const std::vector<uint8_t>& data, const char* text) {
+            size_t length = std::strlen(text);
+            return std::search(data.begin(), data.end(), text, text + length) != data.end();
+        }
+
+        // RFC 6381 codecs parameter for the manifests
+        std::string CodecsFromInit(const std::vector<uint8_t>& init, bool isWebm) {
+            std::vector<std::string> codecs;
+            char text[64];
+            size_t size = 0;
+
+            if (isWebm) {
+                if (Contains(init, "V_VP8")) codecs.push_back("vp8");
+                if (Contains(init, "V_VP9")) codecs.push_back("vp9");
+                if (Contains(init, "A_OPUS")) codecs.push_back("opus");
+            }
+            else {
+                if (const uint8_t* avcc = FindBox(init, "avcC", size); avcc && size >= 4) {
+                    std::snprintf(text, sizeof(text), "avc1.%02X%02X%02X", avcc[1], avcc[2], avcc[3]);
+                    codecs.push_back(text);
+                }
+                if (const uint8_t* hvcc = FindBox(init, "hvcC", size); hvcc && size >= 13) {
+                    uint8_t profileSpace = hvcc[1] >> 6;
+                    bool highTier = (hvcc[1] >> 5) & 1;
+                    uint32_t compatibility = (hvcc[2] << 24) | (hvcc[3] << 16) | (hvcc[4] << 8) | hvcc[5];
+                    uint32_t reversed = 0;
+                    for (int bit = 0; bit < 32; bit++) {
+                        if (compatibility & (1u << bit)) reversed |= 1u << (31 - bit);
+                    }
+                    std::ostringstream hevc;
+                    hevc << "hvc1.";
+                    if (profileSpace) hevc << static_cast<char>('A' + profileSpace - 1);
+                    hevc << (hvcc[1] & 0x1F) << "." << std::hex << std::uppercase << reversed << std::dec
+                        << "." << (highTier ? 'H' : 'L') << static_cast<int>(hvcc[12]);
+                    int lastConstraint = 11;
+                    while (lastConstraint >= 6 && hvcc[lastConstraint] == 0) lastConstraint--;
+                    for (int i = 6; i <= lastConstraint; i++) {
+                        hevc << "." << std::hex << std::uppercase << static_cast<int>(hvcc[i]) << std::dec;
+                    }
+                    codecs.push_back(hevc.str());
+                }
+                if (FindBox(init, "dOps", size)) codecs.push_back("opus");
+                if (FindBox(init, "esds", size)) codecs.push_back("mp4a.40.2");
+            }
+
+            std::string joined;
+            for (const std::string& codec : codecs) {
+                if (!joined.empty()) joined += ",";
+                joined += codec;
+            }
+            return joined;
+        }
+
+        std::string IsoDuration(double seconds) {
+            std::ostringstream text;
+            text << "PT" << std::fixed << std::setprecision(3) << seconds << "S";
+            return text.str();
+        }
+
+        std::string IsoTime(std::chrono::system_clock::time_point time) {
+            std::time_t seconds = std::chrono::system_clock::to_time_t(time);
+            std::tm utc{};
+#ifdef _WIN32
+            gmtime_s(&utc, &seconds);
+#else
+            gmtime_r(&seconds, &utc);
+#endif
+            char text[32];
+            std::strftime(text, sizeof(text), "%Y-%m-%dT%H:%M:%SZ", &utc);
+            return text;
+        }
+    }
+
+    SegmenterSink::SegmenterSink(SegmenterOptions options)
+        : options(options)
+        , hasInit(false)
+        , hasVideo(false)
+        , isWebm(false)
+        , segmentIndex(0)
+        , segmentStart(0)
+        , lastTimestamp(0)
+        , lastChunkGap(0)
+        , isStopping(false)
+        , totalDuration(0.0) {
+        if (options.targetDuration <= 0.0) {
+            throw std::runtime_error("SegmenterSink target duration must be positive");
+        }
+    }
+
+    SegmenterSink::~SegmenterSink() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            isStopping = true;
+        }
+        cv.notify_all();
+        if (ioThread.joinable()) ioThread.join();
+    }
+
+    void SegmenterSink::Start() {
+        std::filesystem::create_directories(options.directory);
+        isStopping = false;
+        ioThread = std::thread(&SegmenterSink::IoLoop, this);
+    }
+
+    void SegmenterSink::Stop() {
+        if (hasInit && segmentIndex > 0) {
+            // The last chunk's duration is unknown, assume it matches the one before
+            Job close{ Job::Kind::Close };
+            close.index = segmentIndex;
+            close.start = segmentStart / kNanosPerSecond;
+            close.duration = (lastTimestamp + lastChunkGap - segmentStart) / kNanosPerSecond;
+            Enqueue(std::move(close));
+        }
+        Enqueue(Job{ Job::Kind::Finish });
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            isStopping = true;
+        }
+        cv.notify_all();
+        if (ioThread.joinable()) ioThread.join();
+        ThrowIfFailed();
+    }
+
+    void SegmenterSink::ConsumeMediaData(const MediaData& data) {
+        ThrowIfFailed();
+
+        if (!hasInit) {
+            hasInit = true;
+            hasVideo = data.type == MediaData::Type::Video;
+            isWebm = StartsWith(data.data, kEbmlId, sizeof(kEbmlId));
+            Job init{ Job::Kind::Init };
+            init.data = data.data;
+            Enqueue(std::move(init));
+            return;
+        }
+
+        bool isBoundary = hasVideo
+            ? data.type == MediaData::Type::Video && data.getVideoFormat().isKeyFrame
+            : true;
+        if (isWebm) {
+            isBoundary = isBoundary && StartsWith(data.data, kClusterId, sizeof(kClusterId));
+        }
+
+        if (segmentIndex > 0) {
+            lastChunkGap = data.timestamp > lastTimestamp ? data.timestamp - lastTimestamp : lastChunkGap;
+        }
+        lastTimestamp = data.timestamp;
+
+        double elapsed = data.timestamp > segmentStart ? (data.timestamp - segmentStart) / kNanosPerSecond : 0.0;
+        if (segmentIndex == 0 || (isBoundary && elapsed + kCutTolerance >= options.targetDuration)) {
+            if (segmentIndex > 0) {
+                Job close{ Job::Kind::Close };
+                close.index = segmentIndex;
+                close.start = segmentStart / kNanosPerSecond;
+                close.duration = elapsed;
+                Enqueue(std::move(close));
+            }
+            segmentIndex++;
+            segmentStart = data.timestamp;
+        }
+
+        Job append{ Job::Kind::Append };
+        append.index = segmentIndex;
+        append.data = data.data;
+        Enqueue(std::move(append));
+    }
+
+    void SegmenterSink::Enqueue(Job job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back(std::move(job));
+        }
+        cv.notify_one();
+    }
+
+    void SegmenterSink::ThrowIfFailed() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (error) std::rethrow_exception(error);
+    }
+
+    void SegmenterSink::IoLoop() {
+        while (true) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [this] { return isStopping || !jobs.empty(); });
+                if (jobs.empty()) return;
+                job = std::move(jobs.front());
+                jobs.pop_front();
+                if (error) continue;    // Drain without touching the files again
+            }
+
+            try {
+                RunJob(job);
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                error = std::current_exception();
+            }
+        }
+    }
+
+    void SegmenterSink::RunJob(Job& job) {
+        switch (job.kind) {
+        case Job::Kind::Init: {
+            codecs = CodecsFromInit(job.data, isWebm);
+            availabilityStart = std::chrono::system_clock::now();
+            std::string name = options.baseName + (isWebm ? "_init.webm" : "_init.mp4");
+            ReplaceFile(name, std::string(job.data.begin(), job.data.end()));
+            if (options.writeHls && isWebm) {
+                MEDIA_LOG_WARNING("<SegmenterSink> HLS needs fMP4 segments, only writing DASH for WebM");
+            }
+            break;
+        }
+        case Job::Kind::Append: {
+            // Segments are written under .tmp until complete
+            if (!segmentFile.is_open()) {
+                segmentFile.open(PathFor(SegmentName(job.index) + ".tmp"), std::ios::binary | std::ios::trunc);
+                if (!segmentFile) {
+                    throw std::runtime_error("Failed to create segment " + SegmentName(job.index));
+                }
+            }
+            segmentFile.write(reinterpret_cast<const char*>(job.data.data()), job.data.size());
+            if (!segmentFile) {
+                throw std::runtime_error("Failed to write segment " + SegmentName(job.index));
+            }
+            break;
+        }
+        case Job::Kind::Close: {
+            if (!segmentFile.is_open()) break;
+            uint64_t bytes = static_cast<uint64_t>(segmentFile.tellp());
+            segmentFile.close();
+            std::string name = SegmentName(job.index);
+            std::filesystem::rename(PathFor(name + ".tmp"), PathFor(name));
+
+            segments.push_back({ job.index, job.start, job.duration, bytes });
+            totalDuration = job.start + job.duration;
+
+            if (options.windowSize > 0) {
+                while (segments.size() > options.windowSize) {
+                    expiredSegments.push_back(segments.front().index);
+                    segments.pop_front();
+                }
+            }
+            WriteManifests(false);
+
+            // Removed only after the manifests stopped listing them, plus a grace period
+            while (expiredSegments.size() > options.expiredSegmentGrace) {
+                std::error_code ignored;
+                std::filesystem::remove(PathFor(SegmentName(expiredSegments.front())), ignored);
+                expiredSegments.pop_front();
+            }
+            break;
+        }
+        case Job::Kind::Finish: {
+            if (!segments.empty()) WriteManifests(true);
+            break;
+        }
+        }
+    }
+
+    std::string SegmenterSink::SegmentName(uint64_t index) const {
+        char number[32];
+        std::snprintf(number, sizeof(number), "_%05llu", static_cast<unsigned long long>(index));
+        return options.baseName + number + (isWebm ? ".webm" : ".m4s");
+    }
+
+    std::string SegmenterSink::PathFor(const std::string& name) const {
+        return (std::filesystem::path(options.directory) / name).string();
+    }
+
+    void SegmenterSink::ReplaceFile(const std::string& name, const std::string& contents) {
+        std::string temporary = PathFor(name + ".tmp");
+        {
+            std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+            file.write(contents.data(), contents.size());
+            if (!file) {
+                throw std::runtime_error("Failed to write " + name);
+            }
+        }
+        std::filesystem::rename(temporary, PathFor(name));
+    }
+
+    void SegmenterSink::WriteManifests(bool isFinal) {
+        if (options.writeHls && !isWebm) WriteHls(isFinal);
+        if (options.writeDash) WriteDash(isFinal);
+    }
+
+    void SegmenterSink::WriteHls(bool isFinal) {
+        double longest = 0.0;
+        for (const Segment& segment : segments) longest = std::max(longest, segment.duration);
+
+        std::ostringstream playlist;
+        playlist << "#EXTM3U\n"
+            << "#EXT-X-VERSION:7\n"
+            << "#EXT-X-TARGETDURATION:" << static_cast<int>(std::ceil(longest)) << "\n"
+            << "#EXT-X-MEDIA-SEQUENCE:" << segments.front().index << "\n";
+        if (options.windowSize == 0) {
+            playlist << "#EXT-X-PLAYLIST-TYPE:" << (isFinal ? "VOD" : "EVENT") << "\n";
+        }
+        playlist << "#EXT-X-INDEPENDENT-SEGMENTS\n"
+            << "#EXT-X-MAP:URI=\"" << options.baseName << "_init.mp4\"\n";
+        playlist << std::fixed << std::setprecision(3);
+        for (const Segment& segment : segments) {
+            playlist << "#EXTINF:" << segment.duration << ",\n" << SegmentName(segment.index) << "\n";
+        }
+        if (isFinal) {
+            playlist << "#EXT-X-ENDLIST\n";
+        }
+        ReplaceFile(options.baseName + ".m3u8", playlist.str());
+    }
+
+    void SegmenterSink::WriteDash(bool isFinal) {
+        double windowDuration = 0.0;
+        uint64_t windowBytes = 0;
+        for (const Segment& segment : segments) {
+            windowDuration += segment.duration;
+            windowBytes += segment.bytes;
+        }
+        uint64_t bandwidth = windowDuration > 0.0 ? static_cast<uint64_t>(windowBytes * 8 / windowDuration) : 0;
+        const char* mimeType = isWebm ? "video/webm" : "video/mp4";
+        std::string extension = isWebm ? ".webm" : ".m4s";
+
+        std::ostringstream mpd;
+        mpd << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+            << "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\" profiles=\"urn:mpeg:dash:profile:isoff-live:2011\"";
+        if (isFinal) {
+            mpd << " type=\"static\" mediaPresentationDuration=\"" << IsoDuration(totalDuration) << "\"";
+        }
+        else {
+            mpd << " type=\"dynamic\" availabilityStartTime=\"" << IsoTime(availabilityStart) << "\""
+                << " publishTime=\"" << IsoTime(std::chrono::system_clock::now()) << "\""
+                << " minimumUpdatePeriod=\"" << IsoDuration(options.targetDuration) << "\"";
+            if (options.windowSize > 0) {
+                mpd << " timeShiftBufferDepth=\"" << IsoDuration(windowDuration) << "\"";
+            }
+        }
+        mpd << " minBufferTime=\"" << IsoDuration(options.targetDuration) << "\">\n"
+            << "  <Period id=\"0\" start=\"PT0S\">\n"
+            << "    <AdaptationSet mimeType=\"" << mimeType << "\" segmentAlignment=\"true\" startWithSAP=\"1\">\n"
+            << "      <Representation id=\"0\" bandwidth=\"" << bandwidth << "\"";
+        if (!codecs.empty()) {
+            mpd << " codecs=\"" << codecs << "\"";
+        }
+        mpd << ">\n"
+            << "        <SegmentTemplate timescale=\"1000\" initialization=\"" << options.baseName << "_init"
+            << (isWebm ? ".webm" : ".mp4") << "\" media=\"" << options.baseName << "_$Number%05d$" << extension
+            << "\" startNumber=\"" << segments.front().index << "\">\n"
+            << "          <SegmentTimeline>\n";
+        for (const Segment& segment : segments) {
+            mpd << "            <S t=\"" << static_cast<uint64_t>(std::llround(segment.start * 1000))
+                << "\" d=\"" << static_cast<uint64_t>(std::llround(segment.duration * 1000)) << "\"/>\n";
+        }
+        mpd << "          </SegmentTimeline>\n"
+            << "        </SegmentTemplate>\n"
+            << "      </Representation>\n"
+            << "    </AdaptationSet>\n"
+            << "  </Period>\n"
+            << "</MPD>\n";
+        ReplaceFile(options.baseName + ".mpd", mpd.str());
+    }
+}
@@ -0,0 +1,113 @@
+#include <string>
+#include <stdexcept>
+#include <mutex>
+
+#include "media_pipeline/sinks/video/rtp_hevc_sink.h"
+#include "media_pipeline/core/interfaces/i_media_sink.h"
+#include "media_pipeline/core/interfaces/i_media_component.h"
+#include "media_pipeline/core/media_data.h"
+#include "media_pipeline/core/media_clock.h"
+#include "media_pipeline/net/socket.h"
+#include "media_pipeline/net/rtp.h"
+#include "media_pipeline/net/rtp_hevc.h"
+#include "media_pipeline/net/rtp_session.h"
+
+namespace media_pipeline::sinks::video {
+	using core::MediaData;
+	using core::VideoFormat;
+
+	RtpHevcSink::RtpHevcSink(RtpHevcSinkOptions options)
+		: options(options)
+		, payloader(options.payloadType, options.ssrc != 0 ? options.ssrc : net::RandomRtpValue(),
+			static_cast<uint16_t>(net::RandomRtpValue()), options.maxPacketSize)
+		, session(payloader.Ssrc(), static_cast<uint32_t>(core::kMpegTicks.den), options.feedback)
+		, timestampOrigin(net::RandomRtpValue())
+		, hasFirstTimestamp(false)
+		, firstTimestamp(0) {
+	}
+
+	RtpHevcSink::~RtpHevcSink() {
+		Stop();
+	}
+
+	void RtpHevcSink::Start() {
+		socket = net::Socket::OpenUdp();
+		socket.Connect(options.address, options.port);
+		if (options.sendBufferBytes > 0) {
+			socket.SetSendBufferSize(options.sendBufferBytes);
+		}
+		socket.SetNonBlocking(true);
+	}
+
+	void RtpHevcSink::Stop() {
+		socket.Close();
+	}
+
+	void RtpHevcSink::ConsumeMediaData(const MediaData& data) {
+		if (data.isEndOfStream || !socket.IsOpen()) return;
+
+		const VideoFormat& format = data.getVideoFormat();
+		if (format.format == VideoFormat::PixelFormat::HEVC_HEADERS) {
+			parameterSets = data.data;
+			return;
+		}
+		if (format.format != VideoFormat::PixelFormat::HEVC) {
+			throw std::runtime_error("RtpHevcSink expects HEVC access units");
+		}
+		if (data.data.empty()) return;
+
+		if (!hasFirstTimestamp) {
+			hasFirstTimestamp = true;
+			firstTimestamp = data.timestamp;
+		}
+		int64_t elapsed = static_cast<int64_t>(data.timestamp - firstTimestamp);
+		uint32_t rtpTimestamp = timestampOrigin +
+			static_cast<uint32_t>(core::Rescale(elapsed, core::kNanoseconds, core::kMpegTicks));
+
+		uint64_t now = core::MediaClock::Now();
+		if (format.isKeyFrame && !parameterSets.empty()) {
+			payloader.Packetize(parameterSets.data(), parameterSets.size(), rtpTimestamp, false);
+			SendPackets(rtpTimestamp, now);
+		}
+		payloader.Packetize(data.data.data(), data.data.size(), rtpTimestamp);
+		SendPackets(rtpTimestamp, now);
+		session.Service(socket, now);
+	}
+
+	void RtpHevcSink::SendPackets(uint32_t rtpTimestamp, uint64_t now) {
+		uint16_t sequenceNumber = static_cast<uint16_t>(payloader.NextSequenceNumber() - payloader.PacketCount());
+		uint64_t sentPackets = 0;
+		uint64_t sentBytes = 0;
+		uint64_t dropped = 0;
+		for (size_t i = 0; i < payloader.PacketCount(); i++) {
+			const net::RtpPacketView& packet = payloader.Packet(i);
+			size_t sent = 0;
+			try {
+				sent = socket.SendVectored(packet.slices, packet.sliceCount);
+			}
+			catch (const std::runtime_error&) {
+				// ICMP errors from a receiver that isn't up yet, same as a lost packet
+				sent = 0;
+			}
+			session.OnPacketSent(sequenceNumber++, rtpTimestamp, packet.slices, packet.sliceCount, now);
+			if (sent == 0) {
+				dropped++;
+				continue;
+			}
+			sentPackets++;
+			sentBytes += sent;
+		}
+
+		std::lock_guard<std::mutex> lock(statsMutex);
+		stats.packetsSent += sentPackets;
+		stats.bytesSent += sentBytes;
+		stats.packetsDropped += dropped;
+	}
+
+	RtpSinkStats RtpHevcSink::GetStats() const {
+		std::lock_guard<std::mutex> lock(statsMutex);
+		RtpSinkStats result = stats;
+		result.feedback = session.GetStats();
+		return result;
+	}
+}
@@ -1,4 +1,5 @@
 #include <mutex>
+#include <algorithm>
 #include <iostream>
 
 #include <portaudio.h>
@@ -7,12 +8,14 @@
 #include "media_pipeline/core/interfaces/i_media_source.h"
 #include "media_pipeline/core/interfaces/i_media_component.h"
 #include "media_pipeline/core/media_data.h"
+#include "media_pipeline/core/media_clock.h"
 
 static int packetCount = 0;
 
 namespace media_pipeline::sources::audio {
 	using core::MediaData;
 	using core::AudioFormat;
+	using core::MediaClock;
 
 	PortaudioSource::PortaudioSource(
 		double requestedSampleRate, 
@@ -23,6 +26,11 @@ namespace media_pipeline::sources::audio {
 		, ringBufferSize(preferredBufferFrames * 8)
 		, writePos(0)
 		, readPos(0)
+		, framesCaptured(0)
+		, framesRead(0)
+		, observations{}
+		, observationsWritten(0)
+		, observationsRead(0)
 		, deviceSampleRate(requestedSampleRate)
 		, deviceChannels(requestedChannels)
 		, deviceFormat(requestedFormat)
@@ -116,6 +124,9 @@ namespace media_pipeline::sources::audio {
 	}
 
 	MediaData PortaudioSource::GetMediaData() {
+		// The fit runs here, outside the lock the callback waits on
+		DrainCaptureObservations();
+
 		MediaData data;
 		std::lock_guard<std::mutex> lock(bufferMutex);
 
@@ -170,6 +181,10 @@ namespace media_pipeline::sources::audio {
 			}
 
 			readPos = (readPos + byteSize) % ringBuffer.size();
+
+			int64_t deviceTime = static_cast<int64_t>(framesRead * 1000000000ull / deviceSampleRate);
+			data.timestamp = static_cast<uint64_t>(std::max<int64_t>(0, captureClock.ToMediaClock(deviceTime)));
+			framesRead += preferredBufferFrames;
 		}
 
 		AudioFormat format;
@@ -180,6 +195,20 @@ namespace media_pipeline::sources::audio {
 		return data;
 	}
 
+	void PortaudioSource::DrainCaptureObservations() {
+		size_t read = observationsRead.load(std::memory_order_relaxed);
+		size_t written = observationsWritten.load(std::memory_order_acquire);
+		for (; read != written; read++) {
+			const CaptureObservation& observation = observations[read % kObservationSlots];
+			captureClock.AddObservation(observation.deviceNanos, observation.mediaNanos);
+		}
+		observationsRead.store(read, std::memory_order_release);
+	}
+
+	double PortaudioSource::ClockDriftPpm() const {
+		return captureClock.DriftPpm();
+	}
+
 	int PortaudioSource::RecordCallback(
 		const void* inputBuffer,
 		void* outputBuffer,
@@ -193,6 +222,23 @@ namespace media_pipeline::sources::audio {
 			return paContinue;
 		}
 
+		// Media clock time of the first frame in the buffer. PortAudio gives
+		// the ADC time on its stream clock, which only tells how long ago the
+		// buffer was captured; without it assume the buffer just filled.
+		double age = static_cast<double>(framesPerBuffer) / self->deviceSampleRate;
+		if (timeInfo && timeInfo->inputBufferAdcTime > 0.0 && timeInfo->currentTime >= timeInfo->inputBufferAdcTime) {
+			age = timeInfo->currentTime - timeInfo->inputBufferAdcTime;
+		}
+		int64_t captureTime = static_cast<int64_t>(MediaClock::Now()) - static_cast<int64_t>(age * 1e9);
+
+		int64_t deviceTime = static_cast<int64_t>(self->framesCaptured * 1000000000ull / self->deviceSampleRate);
+		self->framesCaptured += framesPerBuffer;
+		size_t written = self->observationsWritten.load(std::memory_order_relaxed);
+		if (written - self->observationsRead.load(std::memory_order_acquire) < kObservationSlots) {
+			self->observations[written % kObservationSlots] = { deviceTime, captureTime };
+			self->observationsWritten.store(written + 1, std::memory_order_release);
+		}
+
 		std::lock_guard<std::mutex> lock(self->bufferMutex);
 
 		switch (self->deviceFormat) {
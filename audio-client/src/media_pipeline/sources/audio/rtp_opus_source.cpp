@@ -0,0 +1,190 @@
+#include <string>
+#include <stdexcept>
+#include <memory>
+#include <algorithm>
+#include <cstring>
+
+#include <opus/opus.h>
+
+#include "media_pipeline/sources/audio/rtp_opus_source.h"
+#include "media_pipeline/core/interfaces/i_media_source.h"
+#include "media_pipeline/core/interfaces/i_media_component.h"
+#include "media_pipeline/core/media_data.h"
+#include "media_pipeline/core/media_clock.h"
+#include "media_pipeline/net/socket.h"
+#include "media_pipeline/net/poller.h"
+#include "media_pipeline/net/rtp.h"
+#include "media_pipeline/net/rtcp.h"
+#include "media_pipeline/net/rtp_session.h"
+
+namespace media_pipeline::sources::audio {
+	using core::MediaData;
+	using core::AudioFormat;
+	using core::MediaClock;
+
+	namespace {
+		constexpr uint32_t kOpusRtpClockRate = 48000;
+	}
+
+	RtpOpusSource::RtpOpusSource(RtpOpusSourceOptions options)
+		: options(options)
+		, slotArena(kBatchSize * kSlotSize)
+		, session(kOpusRtpClockRate, options.feedback)
+		, hasSsrc(false)
+		, ssrc(0)
+		, hasTimestamp(false)
+		, extendedTimestamp(0)
+		, lastTimestamp(0) {
+		for (size_t i = 0; i < kBatchSize; i++) {
+			slots[i].data = slotArena.data() + i * kSlotSize;
+			slots[i].capacity = kSlotSize;
+			slots[i].size = 0;
+		}
+	}
+
+	RtpOpusSource::~RtpOpusSource() {
+		Stop();
+	}
+
+	void RtpOpusSource::Start() {
+		socket = net::Socket::OpenUdp(options.address, options.port);
+		if (options.receiveBufferBytes > 0) {
+			socket.SetReceiveBufferSize(options.receiveBufferBytes);
+		}
+		socket.SetNonBlocking(true);
+		poller = std::make_unique<net::Poller>();
+		poller->Add(socket.Handle(), net::kPollReadable);
+	}
+
+	void RtpOpusSource::Stop() {
+		poller.reset();
+		socket.Close();
+	}
+
+	uint16_t RtpOpusSource::LocalPort() const {
+		return socket.LocalPort();
+	}
+
+	MediaData RtpOpusSource::GetMediaData() {
+		if (ready.empty() && socket.IsOpen()) {
+			ReceivePending();
+			if (ready.empty()) {
+				poller->Wait(events, kReceiveWaitMs);
+				ReceivePending();
+			}
+		}
+
+		if (ready.empty()) {
+			return MediaData();
+		}
+		MediaData data = std::move(ready.front());
+		ready.pop_front();
+		return data;
+	}
+
+	void RtpOpusSource::ReceivePending() {
+		size_t received;
+		do {
+			received = socket.ReceiveBatch(slots, kBatchSize);
+			uint64_t arrival = MediaClock::Now();
+			for (size_t i = 0; i < received; i++) {
+				HandlePacket(slots[i], arrival);
+			}
+		} while (received == kBatchSize);
+
+		uint64_t now = MediaClock::Now();
+		const uint8_t* packet;
+		size_t size;
+		while (session.Pop(now, packet, size)) {
+			DeliverPacket(packet, size);
+		}
+		SendFeedback(now);
+	}
+
+	void RtpOpusSource::HandlePacket(const net::Datagram& datagram, uint64_t arrival) {
+		if (net::IsRtcpPacket(datagram.data, datagram.size)) {
+			session.OnRtcp(datagram.data, datagram.size, arrival);
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(statsMutex);
+		net::RtpHeader header;
+		size_t payloadOffset;
+		size_t payloadSize;
+		if (!net::ParseRtpHeader(datagram.data, datagram.size, header, payloadOffset, payloadSize) ||
+			header.payloadType != options.payloadType || payloadSize == 0 ||
+			(hasSsrc && header.ssrc != ssrc)) {
+			stats.packetsInvalid++;
+			return;
+		}
+		if (!hasSsrc) {
+			hasSsrc = true;
+			ssrc = header.ssrc;
+		}
+		// Feedback goes wherever the stream currently comes from
+		senderAddress = datagram.source;
+		stats.bytesReceived += datagram.size;
+		session.Insert(header, datagram.data, datagram.size, arrival);
+	}
+
+	void RtpOpusSource::DeliverPacket(const uint8_t* data, size_t size) {
+		uint64_t arrival = MediaClock::Now();
+		net::RtpHeader header;
+		size_t payloadOffset;
+		size_t payloadSize;
+		net::ParseRtpHeader(data, size, header, payloadOffset, payloadSize);
+
+		// The session hands packets out in sequence order, so timestamps
+		// move forward modulo 2^32
+		if (hasTimestamp) {
+			extendedTimestamp += static_cast<uint32_t>(header.timestamp - lastTimestamp);
+		}
+		hasTimestamp = true;
+		lastTimestamp = header.timestamp;
+
+		const uint8_t* payload = data + payloadOffset;
+		int samples = opus_packet_get_nb_samples(payload, static_cast<opus_int32>(payloadSize), kOpusRtpClockRate);
+		if (samples <= 0) {
+			std::lock_guard<std::mutex> lock(statsMutex);
+			stats.packetsInvalid++;
+			return;
+		}
+
+		// Same layout OpusProcessor emits: frame count at the input rate, then the packet
+		uint32_t frameCount = static_cast<uint32_t>(static_cast<uint64_t>(samples) * options.sampleRate / kOpusRtpClockRate);
+		std::vector<uint8_t> packet(sizeof(frameCount) + payloadSize);
+		std::memcpy(packet.data(), &frameCount, sizeof(frameCount));
+		std::memcpy(packet.data() + sizeof(frameCount), payload, payloadSize);
+
+		AudioFormat format = {};
+		format.sampleRate = options.sampleRate;
+		format.channels = options.channels;
+		format.format = AudioFormat::SampleFormat::OPUS;
+		MediaData output = MediaData::createAudio(std::move(packet), format);
+
+		int64_t senderTime = core::Rescale(static_cast<int64_t>(extendedTimestamp), { 1, kOpusRtpClockRate }, core::kNanoseconds);
+		senderClock.AddObservation(senderTime, static_cast<int64_t>(arrival));
+		output.timestamp = static_cast<uint64_t>(std::max<int64_t>(0, senderClock.ToMediaClock(senderTime)));
+		ready.push_back(std::move(output));
+	}
+
+	void RtpOpusSource::SendFeedback(uint64_t now) {
+		if (senderAddress.length == 0) return;
+		size_t size = session.BuildFeedback(feedbackBuffer, sizeof(feedbackBuffer), now);
+		if (size == 0) return;
+		try {
+			socket.SendTo(feedbackBuffer, size, senderAddress);
+		}
+		catch (const std::runtime_error&) {
+			// The sender may be gone; reports are best effort
+		}
+	}
+
+	RtpSourceStats RtpOpusSource::GetStats() const {
+		RtpSourceStats result = session.GetStats();
+		std::lock_guard<std::mutex> lock(statsMutex);
+		result.bytesReceived = stats.bytesReceived;
+		result.packetsInvalid = stats.packetsInvalid;
+		return result;
+	}
+}
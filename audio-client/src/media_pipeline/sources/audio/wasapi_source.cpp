@@ -5,6 +5,7 @@
 #include <chrono>
 #include <thread>
 #include <vector>
+#include <algorithm>
 
 #include <Audioclient.h>
 #include <mmdeviceapi.h>
@@ -14,10 +15,12 @@
 #include "media_pipeline/core/interfaces/i_media_component.h"
 #include "media_pipeline/core/interfaces/i_media_source.h"
 #include "media_pipeline/core/media_data.h"
+#include "media_pipeline/core/media_clock.h"
 
 namespace media_pipeline::sources::audio {
 	using core::MediaData;
 	using core::AudioFormat;
+	using core::MediaClock;
 
 	WasapiSource::WasapiSource()
 		: deviceSampleRate(0)
@@ -136,8 +139,25 @@ namespace media_pipeline::sources::audio {
 			if (WASAPI_LOGGING) {
 				std::cout << "<WASAPI Source> Received audio packet with " << numFrames << " frames." << std::endl;
 			}
-			hr = pCaptureClient->GetBuffer(&pData, &numFrames, &flags, nullptr, nullptr);
+			UINT64 devicePosition = 0;
+			UINT64 qpcPosition = 0;
+			hr = pCaptureClient->GetBuffer(&pData, &numFrames, &flags, &devicePosition, &qpcPosition);
 			if (SUCCEEDED(hr)) {
+				// The QPC position is when the first frame was captured, in 100ns
+				// units. Its age against the current QPC time places it on the
+				// media clock, which has a different epoch.
+				int64_t deviceTime = static_cast<int64_t>(devicePosition * 1000000000ull / deviceSampleRate);
+				if (!(flags & AUDCLNT_BUFFERFLAGS_TIMESTAMP_ERROR)) {
+					LARGE_INTEGER counter;
+					LARGE_INTEGER frequency;
+					QueryPerformanceCounter(&counter);
+					QueryPerformanceFrequency(&frequency);
+					int64_t qpcNow = core::Rescale(counter.QuadPart, { 1, frequency.QuadPart }, core::kHundredNanoseconds);
+					int64_t age = core::Rescale(qpcNow - static_cast<int64_t>(qpcPosition), core::kHundredNanoseconds, core::kNanoseconds);
+					captureClock.AddObservation(deviceTime, static_cast<int64_t>(MediaClock::Now()) - age);
+				}
+				data.timestamp = static_cast<uint64_t>(std::max<int64_t>(0, captureClock.ToMediaClock(deviceTime)));
+
 				size_t byteSize = numFrames * deviceChannels * sizeof(float);
 				data.data.resize(byteSize);
 
@@ -167,6 +187,10 @@ namespace media_pipeline::sources::audio {
 		return data;
 	}
 
+	double WasapiSource::ClockDriftPpm() const {
+		return captureClock.DriftPpm();
+	}
+
 	void WasapiSource::CleanupCOM() {
 		if (pCaptureClient) pCaptureClient->Release();
 		if (pAudioClient) pAudioClient->Release();
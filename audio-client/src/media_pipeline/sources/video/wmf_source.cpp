@@ -1,5 +1,8 @@
 #include <stdexcept>
 #include <iostream>
+#include <cstdlib>
+#include <algorithm>
+#include <cstring>
 
 #include <mfapi.h>
 #include <mfidl.h>
@@ -14,14 +17,20 @@
 #include "media_pipeline/core/interfaces/i_media_source.h"
 #include "media_pipeline/core/interfaces/i_media_component.h"
 #include "media_pipeline/core/media_data.h"
+#include "media_pipeline/core/media_clock.h"
 
 static int frameCount = 0;
 
 namespace media_pipeline::sources::video {
 	using core::MediaData;
 	using core::VideoFormat;
+	using core::MediaClock;
 
-	WmfSource::WmfSource() : pReader(nullptr), isInitialized(false) {
+	WmfSource::WmfSource()
+		: pReader(nullptr)
+		, isInitialized(false)
+		, pixelFormat(VideoFormat::PixelFormat::YUV420P)
+		, stride(0) {
 		HRESULT hr = MFStartup(MF_VERSION);
 		if (FAILED(hr)) {
 			throw std::runtime_error("Failed to initialize Media Foundation");
@@ -111,13 +120,37 @@ namespace media_pipeline::sources::video {
 			if (SUCCEEDED(hr)) {
 				if (subtype == MFVideoFormat_NV12) {
 					std::cout << "Format: NV12" << std::endl;
+					pixelFormat = VideoFormat::PixelFormat::NV12;
 				}
 				else if (subtype == MFVideoFormat_YUY2) {
 					std::cout << "Format: YUY2" << std::endl;
+					pixelFormat = VideoFormat::PixelFormat::YUY2;
 				}
 				else if (subtype == MFVideoFormat_UYVY) {
 					std::cout << "Format: UYVY" << std::endl;
+					pixelFormat = VideoFormat::PixelFormat::UYVY;
 				}
+				else if (subtype == MFVideoFormat_RGB24) {
+					// MF RGB24 is stored B, G, R in memory
+					std::cout << "Format: RGB24" << std::endl;
+					pixelFormat = VideoFormat::PixelFormat::BGR24;
+				}
+				else if (subtype != MFVideoFormat_I420 && subtype != MFVideoFormat_IYUV) {
+					pType->Release();
+					CoTaskMemFree(ppDevices);
+					pConfig->Release();
+					throw std::runtime_error("Camera pixel format is not supported");
+				}
+			}
+
+			// Padded rows are reported through the default stride, negative for
+			// bottom-up RGB; the sign is kept so GetMediaData can flip those
+			UINT32 defaultStride = 0;
+			if (SUCCEEDED(pType->GetUINT32(MF_MT_DEFAULT_STRIDE, &defaultStride))) {
+				stride = static_cast<LONG>(defaultStride);
+			}
+			if (pixelFormat == VideoFormat::PixelFormat::YUV420P && stride == static_cast<LONG>(width)) {
+				stride = 0;
 			}
 
 			pType->Release();
@@ -144,6 +177,10 @@ namespace media_pipeline::sources::video {
 		// Unnecessary, reader released in destructor
 	}
 
+	double WmfSource::ClockDriftPpm() const {
+		return captureClock.DriftPpm();
+	}
+
 	MediaData WmfSource::GetMediaData() {
 		if (!pReader) {
 			throw std::runtime_error("Video reader not initialized");
@@ -178,14 +215,31 @@ namespace media_pipeline::sources::video {
 					VideoFormat format;
 					format.width = width;
 					format.height = height;
-					format.format = VideoFormat::PixelFormat::YUV420P;
+					format.format = pixelFormat;
 					format.frameRate = frameRate;
-
-					// Copy data
-					data.data.assign(buffer, buffer + bufferSize);
+					format.isKeyFrame = false;
+					format.stride = static_cast<int>(std::abs(stride));
+
+					// Copy data. Bottom-up frames start with the last row in
+					// memory, so they are copied row by row in reverse.
+					size_t rowSize = static_cast<size_t>(std::abs(stride));
+					if (stride < 0 && rowSize * height <= bufferSize) {
+						data.data.resize(rowSize * height);
+						for (UINT32 row = 0; row < height; row++) {
+							std::memcpy(data.data.data() + row * rowSize, buffer + (height - 1 - row) * rowSize, rowSize);
+						}
+					}
+					else {
+						data.data.assign(buffer, buffer + bufferSize);
+					}
 					data.type = MediaData::Type::Video;
 					data.format = format;
-					data.timestamp = timestamp;
+					// Sample times are 100ns ticks on the camera's clock. The
+					// read returns right after capture, so fitting sample times
+					// against read times removes scheduling jitter and drift.
+					int64_t sampleTime = core::Rescale(timestamp, core::kHundredNanoseconds, core::kNanoseconds);
+					captureClock.AddObservation(sampleTime, static_cast<int64_t>(MediaClock::Now()));
+					data.timestamp = static_cast<uint64_t>(std::max<int64_t>(0, captureClock.ToMediaClock(sampleTime)));
 
 					pBuffer->Unlock();
 				}
@@ -0,0 +1,657 @@
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <stdexcept>
+#include <cstring>
+#include <vector>
+
+#include <media_pipeline/media_pipeline.h>
+
+#include "muxing/interfaces/i_muxer.h"
+#include "muxing/fmp4_muxer.h"
+#include "muxing/mp4_box_writer.h"
+#include "media_pipeline/processors/video/nal_units.h"
+
+using namespace media_pipeline;
+namespace nal = processors::video::nal;
+
+namespace {
+	constexpr uint16_t kOpusPreSkip = 312;
+
+	// trun sample_flags
+	constexpr uint32_t kSyncSampleFlags = 0x02000000;		// depends on no other sample
+	constexpr uint32_t kNonSyncSampleFlags = 0x01010000;	// depends on others, non-sync
+
+	void WriteMatrix(Mp4BoxWriter& box) {
+		const uint32_t identity[9] = { 0x00010000, 0, 0, 0, 0x00010000, 0, 0, 0, 0x40000000 };
+		for (uint32_t value : identity) box.U32(value);
+	}
+
+	// AudioSpecificConfig for AAC-LC
+	std::vector<uint8_t> AacAudioSpecificConfig(const AudioFormat& format) {
+		const int rates[] = { 96000, 88200, 64000, 48000, 44100, 32000, 24000, 22050, 16000, 12000, 11025, 8000, 7350 };
+		int rateIndex = 4;
+		for (int i = 0; i < 13; i++) {
+			if (rates[i] == format.sampleRate) rateIndex = i;
+		}
+		uint16_t config = static_cast<uint16_t>((2 << 11) | (rateIndex << 7) | ((format.channels & 0x0F) << 3));
+		return { static_cast<uint8_t>(config >> 8), static_cast<uint8_t>(config) };
+	}
+
+	// MPEG-4 descriptor with a one byte length, all of ours are short
+	size_t BeginDescriptor(Mp4BoxWriter& box, uint8_t tag) {
+		box.U8(tag);
+		size_t lengthPosition = box.Position();
+		box.U8(0);
+		return lengthPosition;
+	}
+
+	void EndDescriptor(Mp4BoxWriter& box, size_t lengthPosition) {
+		box.PatchU8(lengthPosition, static_cast<uint8_t>(box.Position() - lengthPosition - 1));
+	}
+}
+
+Fmp4Muxer::Fmp4Muxer(std::shared_ptr<MediaQueue> mediaQueue, std::shared_ptr<IMediaSink> output, Fmp4Options options)
+	: mediaQueue(mediaQueue)
+	, output(output)
+	, options(options)
+	, isRunning(false)
+	, headersSet(false)
+	, droppedVideo(false)
+	, droppedAudio(false)
+	, fragmentHeader(kInitialFragmentHeader)
+	, sequenceNumber(1)
+	, fragmentStart(0) {
+	if (!output) {
+		throw std::runtime_error("Fmp4Muxer needs an output sink");
+	}
+}
+
+Fmp4Muxer::~Fmp4Muxer() {
+	if (muxerThread.joinable()) {
+		isRunning = false;
+		muxerThread.join();
+	}
+}
+
+std::vector<uint8_t> Fmp4Muxer::InitSegment() const {
+	std::lock_guard<std::mutex> lock(initSegmentMutex);
+	return initSegment;
+}
+
+void Fmp4Muxer::Start() {
+	output->Start();
+	isRunning = true;
+	muxerThread = std::thread(&Fmp4Muxer::MuxerLoop, this);
+}
+
+void Fmp4Muxer::Stop() {
+	isRunning = false;
+
+	// Wake the loop if it is waiting on an empty queue
+	MediaData endOfStream;
+	endOfStream.isEndOfStream = true;
+	mediaQueue->Push(std::move(endOfStream));
+
+	if (muxerThread.joinable()) {
+		muxerThread.join();
+	}
+
+	if (!headersSet && !pendingPackets.empty()) {
+		WriteInitSegment();
+	}
+	WriteFragment();
+	output->Stop();
+}
+
+void Fmp4Muxer::MuxerLoop() {
+	while (isRunning) {
+		MediaData data = mediaQueue->Pop();
+
+		if (data.isEndOfStream) {
+			break;
+		}
+
+		switch (data.type) {
+		case MediaData::Type::Audio: {
+			handleAudioData(data, data.getAudioFormat());
+			break;
+		}
+		case MediaData::Type::Video: {
+			handleVideoData(data, data.getVideoFormat());
+			break;
+		}
+		}
+	}
+}
+
+void Fmp4Muxer::handleAudioData(const MediaData& data, const AudioFormat& format) {
+	if (format.format != AudioFormat::SampleFormat::OPUS && format.format != AudioFormat::SampleFormat::AAC) {
+		if (!droppedAudio) {
+			MEDIA_LOG_WARNING("<Fmp4Muxer> Only Opus and AAC audio can be muxed, dropping audio");
+			droppedAudio = true;
+		}
+		return;
+	}
+	if (!audioFormat && !headersSet) {
+		audioFormat = format;
+	}
+	Mux(data);
+}
+
+void Fmp4Muxer::handleVideoData(const MediaData& data, const VideoFormat& format) {
+	// Parameter sets become the avcC/hvcC record, they are not samples
+	if (format.format == VideoFormat::PixelFormat::HEVC_HEADERS) {
+		if (!headersSet) {
+			videoFormat = format;
+			video.codecConfig = nal::BuildHevcDecoderConfig(data.data.data(), data.data.size());
+		}
+		return;
+	}
+	if (format.format == VideoFormat::PixelFormat::H264_HEADERS) {
+		if (!headersSet) {
+			videoFormat = format;
+			video.codecConfig = nal::BuildAvcDecoderConfig(data.data.data(), data.data.size());
+		}
+		return;
+	}
+
+	// Without parameter sets first there is nothing to describe the track with
+	if (!videoFormat) {
+		if (!droppedVideo) {
+			MEDIA_LOG_WARNING("<Fmp4Muxer> Video needs HEVC or H.264 headers before frames, dropping video");
+			droppedVideo = true;
+		}
+		return;
+	}
+	Mux(data);
+}
+
+void Fmp4Muxer::Mux(const MediaData& data) {
+	if (headersSet) {
+		AddSample(data);
+		return;
+	}
+
+	pendingPackets.push_back(data);
+	if ((videoFormat && audioFormat) || pendingPackets.size() >= kMaxPendingPackets) {
+		WriteInitSegment();
+		while (!pendingPackets.empty()) {
+			AddSample(pendingPackets.front());
+			pendingPackets.pop_front();
+		}
+	}
+}
+
+void Fmp4Muxer::WriteInitSegment() {
+	uint32_t nextTrackId = 1;
+	if (videoFormat) {
+		video.trackId = nextTrackId++;
+		video.timescale = kVideoTimescale;
+	}
+	if (audioFormat) {
+		audio.trackId = nextTrackId++;
+		bool isOpus = audioFormat->format == AudioFormat::SampleFormat::OPUS;
+		audio.timescale = isOpus ? kOpusTimescale : static_cast<uint32_t>(audioFormat->sampleRate);
+		if (!isOpus) {
+			audio.codecConfig = AacAudioSpecificConfig(*audioFormat);
+		}
+	}
+
+	box.Clear();
+	box.Reserve(1024 + video.codecConfig.size());
+
+	size_t ftyp = box.BeginBox("ftyp");
+	box.FourCc("iso6");
+	box.U32(0);
+	box.FourCc("iso6");
+	box.FourCc("cmfc");
+	box.FourCc("mp41");
+	box.EndBox(ftyp);
+
+	size_t moov = box.BeginBox("moov");
+	size_t mvhd = box.BeginFullBox("mvhd", 0, 0);
+	box.U32(0);				// creation_time
+	box.U32(0);				// modification_time
+	box.U32(1000);			// timescale
+	box.U32(0);				// duration, unknown for fragments
+	box.U32(0x00010000);	// rate 1.0
+	box.U16(0x0100);		// volume 1.0
+	box.Zeros(10);
+	WriteMatrix(box);
+	box.Zeros(24);			// pre_defined
+	box.U32(nextTrackId);
+	box.EndBox(mvhd);
+
+	if (video.trackId) WriteVideoTrack();
+	if (audio.trackId) WriteAudioTrack();
+
+	size_t mvex = box.BeginBox("mvex");
+	for (const Track* track : { &video, &audio }) {
+		if (!track->trackId) continue;
+		size_t trex = box.BeginFullBox("trex", 0, 0);
+		box.U32(track->trackId);
+		box.U32(1);		// default_sample_description_index
+		box.U32(0);		// default_sample_duration
+		box.U32(0);		// default_sample_size
+		box.U32(0);		// default_sample_flags
+		box.EndBox(trex);
+	}
+	box.EndBox(mvex);
+	box.EndBox(moov);
+	headersSet = true;
+
+	{
+		std::lock_guard<std::mutex> lock(initSegmentMutex);
+		initSegment = box.Data();
+	}
+
+	MediaData chunk;
+	chunk.data = box.Data();
+	chunk.timestamp = 0;
+	if (videoFormat) {
+		chunk.type = MediaData::Type::Video;
+		chunk.format = *videoFormat;
+	}
+	else {
+		chunk.type = MediaData::Type::Audio;
+		if (audioFormat) chunk.format = *audioFormat;
+	}
+	output->ConsumeMediaData(chunk);
+}
+
+void Fmp4Muxer::WriteVideoTrack() {
+	bool isHevc = videoFormat->format == VideoFormat::PixelFormat::HEVC_HEADERS;
+	uint16_t width = static_cast<uint16_t>(videoFormat->width);
+	uint16_t height = static_cast<uint16_t>(videoFormat->height);
+
+	size_t trak = box.BeginBox("trak");
+	size_t tkhd = box.BeginFullBox("tkhd", 0, 0x000003);	// enabled, in movie
+	box.U32(0);
+	box.U32(0);
+	box.U32(video.trackId);
+	box.U32(0);
+	box.U32(0);				// duration
+	box.Zeros(8);
+	box.U16(0);				// layer
+	box.U16(0);				// alternate_group
+	box.U16(0);				// volume
+	box.U16(0);
+	WriteMatrix(box);
+	box.U32(static_cast<uint32_t>(width) << 16);
+	box.U32(static_cast<uint32_t>(height) << 16);
+	box.EndBox(tkhd);
+
+	size_t mdia = box.BeginBox("mdia");
+	size_t mdhd = box.BeginFullBox("mdhd", 0, 0);
+	box.U32(0);
+	box.U32(0);
+	box.U32(video.timescale);
+	box.U32(0);
+	box.U16(0x55C4);		// "und"
+	box.U16(0);
+	box.EndBox(mdhd);
+
+	size_t hdlr = box.BeginFullBox("hdlr", 0, 0);
+	box.U32(0);
+	box.FourCc("vide");
+	box.Zeros(12);
+	const char name[] = "VideoHandler";
+	box.Bytes(reinterpret_cast<const uint8_t*>(name), sizeof(name));
+	box.EndBox(hdlr);
+
+	size_t minf = box.BeginBox("minf");
+	size_t vmhd = box.BeginFullBox("vmhd", 0, 1);
+	box.Zeros(8);			// graphicsmode, opcolor
+	box.EndBox(vmhd);
+
+	size_t dinf = box.BeginBox("dinf");
+	size_t dref = box.BeginFullBox("dref", 0, 0);
+	box.U32(1);
+	size_t url = box.BeginFullBox("url ", 0, 1);	// media is in this file
+	box.EndBox(url);
+	box.EndBox(dref);
+	box.EndBox(dinf);
+
+	size_t stbl = box.BeginBox("stbl");
+	size_t stsd = box.BeginFullBox("stsd", 0, 0);
+	box.U32(1);
+	size_t sampleEntry = box.BeginBox(isHevc ? "hvc1" : "avc1");
+	box.Zeros(6);
+	box.U16(1);				// data_reference_index
+	box.Zeros(16);			// pre_defined, reserved
+	box.U16(width);
+	box.U16(height);
+	box.U32(0x00480000);	// 72 dpi
+	box.U32(0x00480000);
+	box.U32(0);
+	box.U16(1);				// frame_count
+	box.Zeros(32);			// compressorname
+	box.U16(0x0018);		// depth
+	box.U16(0xFFFF);		// pre_defined
+	size_t config = box.BeginBox(isHevc ? "hvcC" : "avcC");
+	box.Bytes(video.codecConfig);
+	box.EndBox(config);
+	box.EndBox(sampleEntry);
+	box.EndBox(stsd);
+
+	// Empty tables, samples live in the fragments
+	for (const char* type : { "stts", "stsc", "stco" }) {
+		size_t table = box.BeginFullBox(type, 0, 0);
+		box.U32(0);
+		box.EndBox(table);
+	}
+	size_t stsz = box.BeginFullBox("stsz", 0, 0);
+	box.U32(0);
+	box.U32(0);
+	box.EndBox(stsz);
+	box.EndBox(stbl);
+	box.EndBox(minf);
+	box.EndBox(mdia);
+	box.EndBox(trak);
+}
+
+void Fmp4Muxer::WriteAudioTrack() {
+	bool isOpus = audioFormat->format == AudioFormat::SampleFormat::OPUS;
+	uint16_t channels = static_cast<uint16_t>(audioFormat->channels);
+
+	size_t trak = box.BeginBox("trak");
+	size_t tkhd = box.BeginFullBox("tkhd", 0, 0x000003);
+	box.U32(0);
+	box.U32(0);
+	box.U32(audio.trackId);
+	box.U32(0);
+	box.U32(0);
+	box.Zeros(8);
+	box.U16(0);
+	box.U16(1);				// alternate_group
+	box.U16(0x0100);		// volume 1.0
+	box.U16(0);
+	WriteMatrix(box);
+	box.U32(0);
+	box.U32(0);
+	box.EndBox(tkhd);
+
+	size_t mdia = box.BeginBox("mdia");
+	size_t mdhd = box.BeginFullBox("mdhd", 0, 0);
+	box.U32(0);
+	box.U32(0);
+	box.U32(audio.timescale);
+	box.U32(0);
+	box.U16(0x55C4);
+	box.U16(0);
+	box.EndBox(mdhd);
+
+	size_t hdlr = box.BeginFullBox("hdlr", 0, 0);
+	box.U32(0);
+	box.FourCc("soun");
+	box.Zeros(12);
+	const char name[] = "SoundHandler";
+	box.Bytes(reinterpret_cast<const uint8_t*>(name), sizeof(name));
+	box.EndBox(hdlr);
+
+	size_t minf = box.BeginBox("minf");
+	size_t smhd = box.BeginFullBox("smhd", 0, 0);
+	box.U16(0);				// balance
+	box.U16(0);
+	box.EndBox(smhd);
+
+	size_t dinf = box.BeginBox("dinf");
+	size_t dref = box.BeginFullBox("dref", 0, 0);
+	box.U32(1);
+	size_t url = box.BeginFullBox("url ", 0, 1);
+	box.EndBox(url);
+	box.EndBox(dref);
+	box.EndBox(dinf);
+
+	size_t stbl = box.BeginBox("stbl");
+	size_t stsd = box.BeginFullBox("stsd", 0, 0);
+	box.U32(1);
+	size_t sampleEntry = box.BeginBox(isOpus ? "Opus" : "mp4a");
+	box.Zeros(6);
+	box.U16(1);				// data_reference_index
+	box.Zeros(8);
+	box.U16(channels);
+	box.U16(16);			// samplesize
+	box.U32(0);				// pre_defined, reserved
+	box.U32((isOpus ? kOpusTimescale : audio.timescale) << 16);
+
+	if (isOpus) {
+		size_t dops = box.BeginBox("dOps");
+		box.U8(0);			// Version
+		box.U8(static_cast<uint8_t>(channels));
+		box.U16(kOpusPreSkip);
+		box.U32(static_cast<uint32_t>(audioFormat->sampleRate));
+		box.U16(0);			// OutputGain
+		box.U8(0);			// ChannelMappingFamily
+		box.EndBox(dops);
+	}
+	else {
+		size_t esds = box.BeginFullBox("esds", 0, 0);
+		size_t esDescriptor = BeginDescriptor(box, 0x03);
+		box.U16(0);			// ES_ID
+		box.U8(0);
+		size_t decoderConfig = BeginDescriptor(box, 0x04);
+		box.U8(0x40);		// MPEG-4 Audio
+		box.U8(0x15);		// AudioStream
+		box.U24(0);			// bufferSizeDB
+		box.U32(0);			// maxBitrate
+		box.U32(0);			// avgBitrate
+		size_t specificInfo = BeginDescriptor(box, 0x05);
+		box.Bytes(audio.codecConfig);
+		EndDescriptor(box, specificInfo);
+		EndDescriptor(box, decoderConfig);
+		size_t slConfig = BeginDescriptor(box, 0x06);
+		box.U8(0x02);
+		EndDescriptor(box, slConfig);
+		EndDescriptor(box, esDescriptor);
+		box.EndBox(esds);
+	}
+	box.EndBox(sampleEntry);
+	box.EndBox(stsd);
+
+	for (const char* type : { "stts", "stsc", "stco" }) {
+		size_t table = box.BeginFullBox(type, 0, 0);
+		box.U32(0);
+		box.EndBox(table);
+	}
+	size_t stsz = box.BeginFullBox("stsz", 0, 0);
+	box.U32(0);
+	box.U32(0);
+	box.EndBox(stsz);
+	box.EndBox(stbl);
+	box.EndBox(minf);
+	box.EndBox(mdia);
+	box.EndBox(trak);
+}
+
+uint64_t Fmp4Muxer::RelativeTimestamp(const MediaData& data) {
+	if (!firstTimestamp) {
+		firstTimestamp = data.timestamp;
+	}
+	return data.timestamp > *firstTimestamp ? data.timestamp - *firstTimestamp : 0;
+}
+
+void Fmp4Muxer::AddSample(const MediaData& data) {
+	bool isVideo = data.type == MediaData::Type::Video;
+	Track& track = isVideo ? video : audio;
+	if (!track.trackId) return;  // Stream started after the init segment was sent
+
+	uint64_t timestamp = RelativeTimestamp(data);
+	bool isSync = isVideo ? data.getVideoFormat().isKeyFrame : true;
+
+	bool hasSamples = !video.samples.empty() || !audio.samples.empty();
+	if (hasSamples) {
+		bool cut = options.fragmentDuration == 0 ||
+			(isVideo && isSync && options.fragmentAtKeyframes) ||
+			(timestamp >= fragmentStart && timestamp - fragmentStart >= options.fragmentDuration);
+		if (cut) WriteFragment();
+	}
+	if (video.samples.empty() && audio.samples.empty()) {
+		fragmentStart = timestamp;
+	}
+
+	Sample sample;
+	sample.decodeTime = static_cast<uint64_t>(core::Rescale(static_cast<int64_t>(timestamp),
+		core::kNanoseconds, { 1, static_cast<int64_t>(track.timescale) }));
+	sample.isSync = isSync;
+	std::vector<uint8_t>& payload = SamplePayload(track);
+	size_t dataStart = payload.size();
+
+	if (isVideo) {
+		const VideoFormat& format = data.getVideoFormat();
+		float frameRate = format.frameRate > 0 ? format.frameRate : 30.0f;
+		sample.nominalDuration = static_cast<uint32_t>(track.timescale / frameRate);
+
+		// Annex-B to 4 byte length prefixed, written straight into the fragment payload
+		for (const nal::NalUnit& unit : nal::SplitAnnexB(data.data.data(), data.data.size())) {
+			uint32_t length = static_cast<uint32_t>(unit.size);
+			const uint8_t prefix[4] = {
+				static_cast<uint8_t>(length >> 24), static_cast<uint8_t>(length >> 16),
+				static_cast<uint8_t>(length >> 8), static_cast<uint8_t>(length)
+			};
+			payload.insert(payload.end(), prefix, prefix + 4);
+			payload.insert(payload.end(), unit.data, unit.data + unit.size);
+		}
+		if (!fragmentVideoFormat) fragmentVideoFormat = format;
+	}
+	else {
+		const AudioFormat& format = data.getAudioFormat();
+		if (format.format == AudioFormat::SampleFormat::OPUS) {
+			// Opus packets carry the input frame count up front
+			if (data.data.size() <= sizeof(uint32_t)) return;
+			uint32_t frameCount;
+			std::memcpy(&frameCount, data.data.data(), sizeof(frameCount));
+			sample.nominalDuration = static_cast<uint32_t>(
+				static_cast<uint64_t>(frameCount) * kOpusTimescale / format.sampleRate);
+			payload.insert(payload.end(), data.data.begin() + sizeof(uint32_t), data.data.end());
+		}
+		else {
+			sample.nominalDuration = 1024;	// AAC-LC frame
+			payload.insert(payload.end(), data.data.begin(), data.data.end());
+		}
+		if (!fragmentAudioFormat) fragmentAudioFormat = format;
+	}
+
+	sample.size = static_cast<uint32_t>(payload.size() - dataStart);
+	if (sample.size == 0) return;
+	track.samples.push_back(sample);
+}
+
+bool Fmp4Muxer::WritesInPlace(const Track& track) const {
+	return &track == &video || !video.trackId;
+}
+
+std::vector<uint8_t>& Fmp4Muxer::SamplePayload(Track& track) {
+	if (!WritesInPlace(track)) return track.sampleData;
+
+	if (fragment.empty()) {
+		fragment.resize(fragmentHeader);
+	}
+	return fragment;
+}
+
+void Fmp4Muxer::WriteFragment() {
+	if (video.samples.empty() && audio.samples.empty()) return;
+
+	// moof is roughly 100 bytes per track plus 12 per sample
+	box.Clear();
+	box.Reserve(256 + (video.samples.size() + audio.samples.size()) * 12);
+
+	size_t dataOffsetPositions[2] = {};
+	Track* tracks[2] = { &video, &audio };
+
+	size_t moof = box.BeginBox("moof");
+	size_t mfhd = box.BeginFullBox("mfhd", 0, 0);
+	box.U32(sequenceNumber++);
+	box.EndBox(mfhd);
+
+	for (int i = 0; i < 2; i++) {
+		Track& track = *tracks[i];
+		if (track.samples.empty()) continue;
+
+		size_t traf = box.BeginBox("traf");
+		size_t tfhd = box.BeginFullBox("tfhd", 0, 0x020000);	// default-base-is-moof
+		box.U32(track.trackId);
+		box.EndBox(tfhd);
+
+		size_t tfdt = box.BeginFullBox("tfdt", 1, 0);
+		box.U64(track.samples.front().decodeTime);
+		box.EndBox(tfdt);
+
+		// data offset, then duration, size and flags per sample
+		size_t trun = box.BeginFullBox("trun", 0, 0x000001 | 0x000100 | 0x000200 | 0x000400);
+		box.U32(static_cast<uint32_t>(track.samples.size()));
+		dataOffsetPositions[i] = box.Position();
+		box.U32(0);
+		for (size_t s = 0; s < track.samples.size(); s++) {
+			const Sample& sample = track.samples[s];
+			uint32_t duration = sample.nominalDuration;
+			if (s + 1 < track.samples.size() && track.samples[s + 1].decodeTime > sample.decodeTime) {
+				duration = static_cast<uint32_t>(track.samples[s + 1].decodeTime - sample.decodeTime);
+			}
+			box.U32(duration);
+			box.U32(sample.size);
+			box.U32(sample.isSync ? kSyncSampleFlags : kNonSyncSampleFlags);
+		}
+		box.EndBox(trun);
+		box.EndBox(traf);
+	}
+	box.EndBox(moof);
+
+	// Fit the space left in front of the in place payload to moof and the mdat header
+	size_t headerSize = box.Position() + 8;
+	if (fragment.empty()) {
+		fragment.resize(headerSize);
+	}
+	else if (headerSize > fragmentHeader) {
+		fragment.insert(fragment.begin(), headerSize - fragmentHeader, 0);
+	}
+	else if (headerSize < fragmentHeader) {
+		fragment.erase(fragment.begin(), fragment.begin() + (fragmentHeader - headerSize));
+	}
+	fragmentHeader = headerSize;
+
+	// Offsets count from the start of moof, which is the start of the chunk
+	for (int i = 0; i < 2; i++) {
+		Track& track = *tracks[i];
+		if (track.samples.empty()) continue;
+		if (WritesInPlace(track)) {
+			box.PatchU32(dataOffsetPositions[i], static_cast<uint32_t>(headerSize));
+		}
+		else {
+			box.PatchU32(dataOffsetPositions[i], static_cast<uint32_t>(fragment.size()));
+			fragment.insert(fragment.end(), track.sampleData.begin(), track.sampleData.end());
+		}
+		track.samples.clear();
+		track.sampleData.clear();
+	}
+
+	size_t mdatSize = fragment.size() - box.Position();
+	if (mdatSize > UINT32_MAX) {
+		throw std::runtime_error("MP4 box exceeds 4 GiB");
+	}
+	box.U32(static_cast<uint32_t>(mdatSize));
+	box.FourCc("mdat");
+	std::memcpy(fragment.data(), box.Data().data(), headerSize);
+
+	MediaData chunk;
+	chunk.data = std::move(fragment);
+	chunk.timestamp = fragmentStart;
+	if (fragmentVideoFormat) {
+		chunk.type = MediaData::Type::Video;
+		chunk.format = *fragmentVideoFormat;
+	}
+	else {
+		chunk.type = MediaData::Type::Audio;
+		chunk.format = *fragmentAudioFormat;
+	}
+	fragmentVideoFormat.reset();
+	fragmentAudioFormat.reset();
+	output->ConsumeMediaData(chunk);
+
+	// Take the buffer back, its capacity carries over to the next fragment
+	fragment = std::move(chunk.data);
+	fragment.clear();
+}
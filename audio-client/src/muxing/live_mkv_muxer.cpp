@@ -0,0 +1,254 @@
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <stdexcept>
+#include <algorithm>
+#include <vector>
+
+#include <ebml/EbmlHead.h>
+#include <ebml/MemIOCallback.h>
+#include <matroska/KaxSegment.h>
+#include <matroska/KaxInfo.h>
+#include <matroska/KaxTracks.h>
+#include <matroska/KaxCluster.h>
+#include <matroska/KaxBlock.h>
+#include <matroska/KaxSemantic.h>
+
+#include <media_pipeline/media_pipeline.h>
+
+#include "muxing/interfaces/i_muxer.h"
+#include "muxing/live_mkv_muxer.h"
+#include "muxing/mkv_tracks.h"
+
+using namespace media_pipeline;
+using namespace libmatroska;
+using namespace libebml;
+
+namespace {
+	// Element IDs followed by the reserved 8-byte "unknown size" value.
+	// libebml only renders known sizes, so these headers are written raw.
+	constexpr uint8_t kSegmentHeader[] = {
+		0x18, 0x53, 0x80, 0x67, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
+	};
+	constexpr uint8_t kClusterHeader[] = {
+		0x1F, 0x43, 0xB6, 0x75, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
+	};
+	constexpr size_t kClusterIdSize = 4;
+}
+
+LiveMkvMuxer::LiveMkvMuxer(std::shared_ptr<MediaQueue> mediaQueue, std::shared_ptr<IMediaSink> output)
+	: mediaQueue(mediaQueue)
+	, output(output)
+	, isRunning(false)
+	, headersSet(false)
+	, clusterTimestamp(0)
+	, timestampScale(1000000) {
+	if (!output) {
+		throw std::runtime_error("LiveMkvMuxer needs an output sink");
+	}
+}
+
+LiveMkvMuxer::~LiveMkvMuxer() {
+	if (muxerThread.joinable()) {
+		isRunning = false;
+		muxerThread.join();
+	}
+}
+
+std::vector<uint8_t> LiveMkvMuxer::InitSegment() const {
+	std::lock_guard<std::mutex> lock(initSegmentMutex);
+	return initSegment;
+}
+
+bool LiveMkvMuxer::IsClusterStart(const MediaData& chunk) {
+	return chunk.data.size() >= kClusterIdSize &&
+		std::equal(kClusterHeader, kClusterHeader + kClusterIdSize, chunk.data.begin());
+}
+
+void LiveMkvMuxer::Start() {
+	output->Start();
+	isRunning = true;
+	muxerThread = std::thread(&LiveMkvMuxer::MuxerLoop, this);
+}
+
+void LiveMkvMuxer::Stop() {
+	isRunning = false;
+
+	// Wake the loop if it is waiting on an empty queue
+	MediaData endOfStream;
+	endOfStream.isEndOfStream = true;
+	mediaQueue->Push(std::move(endOfStream));
+
+	if (muxerThread.joinable()) {
+		muxerThread.join();
+	}
+
+	// Unknown sizes need no finalization, the stream simply ends
+	output->Stop();
+}
+
+void LiveMkvMuxer::MuxerLoop() {
+	while (isRunning) {
+		MediaData data = mediaQueue->Pop();
+
+		if (data.isEndOfStream) {
+			break;
+		}
+
+		switch (data.type) {
+		case MediaData::Type::Audio: {
+			handleAudioData(data, data.getAudioFormat());
+			break;
+		}
+		case MediaData::Type::Video: {
+			handleVideoData(data, data.getVideoFormat());
+			break;
+		}
+		}
+	}
+}
+
+void LiveMkvMuxer::handleAudioData(const MediaData& data, const AudioFormat& format) {
+	if (trackSetup.Observe(data)) {
+		Mux(data);
+	}
+}
+
+void LiveMkvMuxer::handleVideoData(const MediaData& data, const VideoFormat& format) {
+	if (trackSetup.Observe(data)) {
+		Mux(data);
+	}
+}
+
+void LiveMkvMuxer::Mux(const MediaData& data) {
+	if (headersSet) {
+		WritePacket(data);
+		return;
+	}
+
+	pendingPackets.push_back(data);
+	if ((trackSetup.HasVideo() && trackSetup.HasAudio()) || pendingPackets.size() >= kMaxPendingPackets) {
+		WriteInitSegment();
+		while (!pendingPackets.empty()) {
+			WritePacket(pendingPackets.front());
+			pendingPackets.pop_front();
+		}
+	}
+}
+
+void LiveMkvMuxer::WriteInitSegment() {
+	EbmlHead fileHeader;
+	GetChild<EDocType>(fileHeader).SetValue(trackSetup.IsWebmCompatible() ? "webm" : "matroska");
+	GetChild<EDocTypeVersion>(fileHeader).SetValue(4);
+	GetChild<EDocTypeReadVersion>(fileHeader).SetValue(2);
+	fileHeader.Render(chunkBuffer, true);
+
+	chunkBuffer.write(kSegmentHeader, sizeof(kSegmentHeader));
+
+	// No Duration, it is unknown while live
+	KaxInfo info;
+	GetChild<KaxTimecodeScale>(info).SetValue(timestampScale);
+	GetChild<KaxMuxingApp>(info).SetValue(L"media_pipeline");
+	GetChild<KaxWritingApp>(info).SetValue(L"media_pipeline");
+	info.Render(chunkBuffer);
+
+	// Track entries stay alive, blocks reference them for their track number
+	tracks = std::make_unique<KaxTracks>();
+	trackSetup.AddTracks(*tracks, timestampScale);
+	tracks->Render(chunkBuffer);
+	headersSet = true;
+
+	{
+		std::lock_guard<std::mutex> lock(initSegmentMutex);
+		const binary* bytes = chunkBuffer.GetDataBuffer();
+		initSegment.assign(bytes, bytes + chunkBuffer.GetDataBufferSize());
+	}
+
+	// Sent as a chunk of its own, typed by the tracks it describes
+	MediaData tracksDescribed;
+	if (trackSetup.StreamVideoFormat()) {
+		tracksDescribed.type = MediaData::Type::Video;
+		tracksDescribed.format = *trackSetup.StreamVideoFormat();
+	}
+	else {
+		tracksDescribed.type = MediaData::Type::Audio;
+		if (trackSetup.StreamAudioFormat()) tracksDescribed.format = *trackSetup.StreamAudioFormat();
+	}
+	EmitChunk(tracksDescribed, 0);
+}
+
+uint64_t LiveMkvMuxer::RelativeTimestamp(const MediaData& data) {
+	if (!firstTimestamp) {
+		firstTimestamp = data.timestamp;
+	}
+	return data.timestamp > *firstTimestamp ? data.timestamp - *firstTimestamp : 0;
+}
+
+void LiveMkvMuxer::StartCluster(uint64_t timestamp) {
+	cluster = std::make_unique<KaxCluster>();
+	cluster->InitTimecode(timestamp / timestampScale, timestampScale);
+	clusterTimestamp = timestamp;
+
+	chunkBuffer.write(kClusterHeader, sizeof(kClusterHeader));
+	KaxClusterTimecode clusterTimecode;
+	clusterTimecode.SetValue(timestamp / timestampScale);
+	clusterTimecode.Render(chunkBuffer);
+}
+
+void LiveMkvMuxer::WritePacket(const MediaData& data) {
+	KaxTrackEntry* track = trackSetup.TrackFor(data);
+	if (!track) return;  // Stream started after the init segment was sent
+
+	std::vector<uint8_t> scratch;
+	auto [payload, payloadSize] = MkvFramePayload(data, scratch);
+	if (payloadSize == 0) return;
+
+	bool isVideo = data.type == MediaData::Type::Video;
+	bool isKeyFrame = isVideo ? data.getVideoFormat().isKeyFrame : true;
+	bool hasVideo = trackSetup.VideoTrack() != nullptr;
+	bool videoKeyFrame = isVideo && isKeyFrame;
+
+	// Nothing is written until the first cluster can open on a keyframe, and
+	// timestamps count from that packet
+	if (!cluster && hasVideo && !videoKeyFrame) return;
+	uint64_t timestamp = RelativeTimestamp(data);
+
+	// Every video keyframe opens a cluster, so joiners never wait longer
+	// than one keyframe interval
+	bool startCluster = !cluster;
+	if (cluster && timestamp >= clusterTimestamp) {
+		uint64_t clusterDuration = timestamp - clusterTimestamp;
+		startCluster = hasVideo
+			? videoKeyFrame && clusterDuration > 0
+			: clusterDuration >= kAudioClusterDuration;
+		if (!startCluster && clusterDuration >= kMaxClusterDuration) return;
+	}
+	if (startCluster) {
+		StartCluster(timestamp);
+	}
+
+	// The block is rendered right away, so it can borrow the packet bytes
+	KaxSimpleBlock block;
+	block.SetParent(*cluster);
+	block.AddFrame(*track, timestamp,
+		*new DataBuffer(const_cast<binary*>(payload), static_cast<uint32>(payloadSize), nullptr, false),
+		LACING_NONE);
+	block.SetKeyframe(isKeyFrame);
+	block.Render(chunkBuffer);
+
+	EmitChunk(data, timestamp);
+}
+
+void LiveMkvMuxer::EmitChunk(const MediaData& source, uint64_t timestamp) {
+	const binary* bytes = chunkBuffer.GetDataBuffer();
+	MediaData chunk;
+	chunk.data.assign(bytes, bytes + chunkBuffer.GetDataBufferSize());
+	chunk.timestamp = timestamp;
+	chunk.type = source.type;
+	chunk.format = source.format;
+	output->ConsumeMediaData(chunk);
+
+	chunkBuffer.setFilePointer(0);
+	chunkBuffer.SetDataBufferSize(0);
+}
@@ -1,12 +1,15 @@
 #include <memory>
-#include <fstream>
 #include <atomic>
 #include <thread>
 #include <iostream>
+#include <stdexcept>
+#include <algorithm>
+#include <vector>
 
 #include <ebml/EbmlHead.h>
 #include <ebml/EbmlStream.h>
 #include <ebml/EbmlVoid.h>
+#include <ebml/StdIOCallback.h>
 #include <matroska/KaxSegment.h>
 #include <matroska/KaxTracks.h>
 #include <matroska/KaxCluster.h>
@@ -15,98 +18,214 @@
 #include <matroska/KaxSeekHead.h>
 #include <matroska/KaxCues.h>
 #include <matroska/KaxInfo.h>
+#include <matroska/KaxSemantic.h>
 
 #include <media_pipeline/media_pipeline.h>
 
 #include "muxing/interfaces/i_muxer.h"
 #include "muxing/mkv_muxer.h"
+#include "muxing/mkv_tracks.h"
 
 using namespace media_pipeline;
 using namespace libmatroska;
 using namespace libebml;
 
-MkvMuxer::MkvMuxer(std::shared_ptr<MediaQueue> mediaQueue)
-	: isRunning(false)
-	, headersSet(false)
-	, mediaQueue(mediaQueue)
-	, segment(nullptr)
-	, videoTrackNumber(0)
-	, audioTrackNumber(0)
-	, timestampScale(1000000)
-	, lastTimestamp(0) 
-{
-	tracks = std::make_unique<KaxTracks>();
-	videoTrack = std::make_unique<KaxTrackEntry>();
-	audioTrack = std::make_unique<KaxTrackEntry>();
-	InitializeMkvStructure();
+namespace {
+	// Room for SeekHead entries of Info, Tracks and Cues, filled in on finalize
+	constexpr uint64_t kSeekHeadSpace = 256;
 }
 
-MkvMuxer::~MkvMuxer() { }
+MkvMuxer::MkvMuxer(std::shared_ptr<MediaQueue> mediaQueue, const std::string& filePath)
+	: mediaQueue(mediaQueue)
+	, filePath(filePath)
+	, isRunning(false)
+	, headersSet(false)
+	, info(nullptr)
+	, tracks(nullptr)
+	, cues(nullptr)
+	, clusterTimestamp(0)
+	, lastTimestamp(0)
+	, timestampScale(1000000) {}
+
+MkvMuxer::~MkvMuxer() {
+	if (muxerThread.joinable()) {
+		isRunning = false;
+		muxerThread.join();
+	}
+}
 
-void MkvMuxer::InitializeMkvStructure() {
+void MkvMuxer::WriteFileHeader() {
 	EbmlHead fileHeader;
+	GetChild<EDocType>(fileHeader).SetValue("matroska");
+	GetChild<EDocTypeVersion>(fileHeader).SetValue(4);
+	GetChild<EDocTypeReadVersion>(fileHeader).SetValue(2);	// SimpleBlock
+	fileHeader.Render(*outputFile, true);
+
+	// Size is unknown until finalize, 5 bytes leave room to patch it in place
+	segment = std::make_unique<KaxSegment>();
+	segment->WriteHead(*outputFile, 5);
+
+	seekHeadSpace = std::make_unique<EbmlVoid>();
+	seekHeadSpace->SetSize(kSeekHeadSpace);
+	seekHeadSpace->Render(*outputFile);
+	seekHead = std::make_unique<KaxSeekHead>();
+
+	// Duration is rendered now as a 64-bit float and overwritten on finalize,
+	// so the element keeps its size
+	info = &GetChild<KaxInfo>(*segment);
+	GetChild<KaxTimecodeScale>(*info).SetValue(timestampScale);
+	KaxDuration& duration = GetChild<KaxDuration>(*info);
+	duration.SetPrecision(EbmlFloat::FLOAT_64);
+	duration.SetValue(0.0);
+	GetChild<KaxMuxingApp>(*info).SetValue(L"media_pipeline");
+	GetChild<KaxWritingApp>(*info).SetValue(L"media_pipeline");
+	info->Render(*outputFile);
+	seekHead->IndexThis(*info, *segment);
+
+	cues = &GetChild<KaxCues>(*segment);
+	cues->SetGlobalTimecodeScale(timestampScale);
+}
+
+void MkvMuxer::WriteTracks() {
+	tracks = &GetChild<KaxTracks>(*segment);
+	trackSetup.AddTracks(*tracks, timestampScale);
+	tracks->Render(*outputFile);
+	seekHead->IndexThis(*tracks, *segment);
+	headersSet = true;
 
-	segment = new KaxSegment();
-	tracks.reset(&GetChild<KaxTracks>(*segment));
-
-	// Set up HEVC video track
-	videoTrack.reset(&GetChild<KaxTrackEntry>(*tracks));
-	videoTrack->SetGlobalTimecodeScale(timestampScale);
-	videoTrackNumber = 1;
-	GetChild<KaxTrackNumber>(*videoTrack).SetValue(videoTrackNumber);
-	GetChild<KaxTrackType>(*videoTrack).SetValue(0x01);
-	GetChild<KaxCodecID>(*videoTrack).SetValue("V_MPEGH/ISO/HEVC");
-
-	// Set up MP3 audio track
-	audioTrack.reset(&GetChild<KaxTrackEntry>(*tracks));
-	audioTrack->SetGlobalTimecodeScale(timestampScale);
-	audioTrackNumber = 2;
-	GetChild<KaxTrackNumber>(*audioTrack).SetValue(audioTrackNumber);
-	GetChild<KaxTrackType>(*audioTrack).SetValue(0x02);
-	GetChild<KaxCodecID>(*audioTrack).SetValue("A_MPEG/L3");
+	while (!pendingPackets.empty()) {
+		WritePacket(pendingPackets.front());
+		pendingPackets.pop_front();
+	}
 }
 
-void MkvMuxer::WriteEbmlHeader() {
-	EbmlHead fileHeader;
-	fileHeader.Render(outputFile);
+uint64_t MkvMuxer::RelativeTimestamp(const MediaData& data) {
+	if (!firstTimestamp) {
+		firstTimestamp = data.timestamp;
+	}
+	return data.timestamp > *firstTimestamp ? data.timestamp - *firstTimestamp : 0;
+}
+
+void MkvMuxer::StartCluster(uint64_t timestamp) {
+	cluster = std::make_unique<KaxCluster>();
+	cluster->SetParent(*segment);
+	cluster->InitTimecode(timestamp / timestampScale, timestampScale);
+	clusterTimestamp = timestamp;
+}
+
+void MkvMuxer::FinishCluster() {
+	if (!cluster) return;
 
-	EbmlVoid spacer;
-	spacer.SetSize(1024);
-	spacer.Render(outputFile);
+	cluster->Render(*outputFile, *cues);
+
+	// Cue positions are only known once the cluster is on disk
+	for (KaxSimpleBlock* keyframe : clusterKeyframes) {
+		KaxCuePoint& cuePoint = AddNewChild<KaxCuePoint>(*cues);
+		cuePoint.PositionSet(*keyframe, timestampScale);
+	}
+	clusterKeyframes.clear();
+
+	// Frees every block and its frame buffer
+	cluster.reset();
+}
+
+void MkvMuxer::WritePacket(const MediaData& data) {
+	KaxTrackEntry* track = trackSetup.TrackFor(data);
+	if (!track) return;  // Stream started after the tracks were written
+
+	std::vector<uint8_t> scratch;
+	auto [payload, payloadSize] = MkvFramePayload(data, scratch);
+	if (payloadSize == 0) return;
+
+	bool isVideo = data.type == MediaData::Type::Video;
+
+	uint64_t timestamp = RelativeTimestamp(data);
+	bool isKeyFrame = isVideo ? data.getVideoFormat().isKeyFrame : true;
+
+	// Clusters open on video keyframes so each one can be decoded on its own
+	bool startCluster = !cluster;
+	if (cluster && timestamp >= clusterTimestamp) {
+		uint64_t clusterDuration = timestamp - clusterTimestamp;
+		bool clusterOnKeyframe = trackSetup.VideoTrack() ? (isVideo && isKeyFrame) : true;
+		startCluster = clusterDuration >= kMaxClusterDuration ||
+			(clusterOnKeyframe && clusterDuration >= kMinClusterDuration);
+	}
+	if (startCluster) {
+		FinishCluster();
+		StartCluster(timestamp);
+	}
+
+	// The block owns and deletes its frame buffers, so they are heap copies
+	DataBuffer* frameBuffer = new DataBuffer(
+		const_cast<binary*>(payload),
+		static_cast<uint32>(payloadSize),
+		nullptr,
+		true
+	);
+	KaxSimpleBlock& block = AddNewChild<KaxSimpleBlock>(*cluster);
+	block.SetParent(*cluster);
+	block.AddFrame(*track, timestamp, *frameBuffer, LACING_NONE);
+	block.SetKeyframe(isKeyFrame);
+
+	if (isVideo && isKeyFrame) {
+		clusterKeyframes.push_back(&block);
+	}
+	lastTimestamp = std::max(lastTimestamp, timestamp);
 }
 
 void MkvMuxer::FinalizeMkvFile() {
-	KaxCues& cues = GetChild<KaxCues>(*segment);
-	cues.SetGlobalTimecodeScale(timestampScale);
-	cues.Render(outputFile);
+	if (!headersSet) {
+		WriteTracks();
+	}
+	FinishCluster();
+
+	if (cues->ListSize() > 0) {
+		cues->Render(*outputFile);
+		seekHead->IndexThis(*cues, *segment);
+	}
+
+	// Rewrite Info in place with the final duration
+	GetChild<KaxDuration>(*info).SetValue(static_cast<double>(lastTimestamp) / timestampScale);
+	outputFile->setFilePointer(info->GetElementPosition());
+	info->Render(*outputFile);
+
+	seekHeadSpace->ReplaceWith(*seekHead, *outputFile, true);
+
+	outputFile->setFilePointer(0, seek_end);
+	uint64_t endPosition = outputFile->getFilePointer();
+	if (segment->ForceSize(endPosition - segment->GetElementPosition() - segment->HeadSize())) {
+		segment->OverwriteHead(*outputFile);
+	}
 
-	KaxInfo& info = GetChild<KaxInfo>(*segment);
-	GetChild<KaxDuration>(info).SetValue(float(lastTimestamp));
-	info.Render(outputFile);
+	outputFile->close();
+	outputFile.reset();
 }
 
 void MkvMuxer::Start() {
-	isRunning = true;
-	//if (!outputFile) {
-	//	throw std::runtime_error("Failed to open MKV output file");
-	//}
+	// Throws if the file can't be created
+	outputFile = std::make_unique<StdIOCallback>(filePath.c_str(), MODE_CREATE);
+	WriteFileHeader();
 
-	WriteEbmlHeader();
+	isRunning = true;
 	muxerThread = std::thread(&MkvMuxer::MuxerLoop, this);
 }
 
 void MkvMuxer::Stop() {
-	isRunning = false;
+	// The loop muxes everything queued before this and exits at the marker
+	MediaData endOfStream;
+	endOfStream.isEndOfStream = true;
+	mediaQueue->Push(std::move(endOfStream));
+
 	if (muxerThread.joinable()) {
 		muxerThread.join();
 	}
-	FinalizeMkvFile();
+	isRunning = false;
+	if (outputFile) {
+		FinalizeMkvFile();
+	}
 }
 
 void MkvMuxer::MuxerLoop() {
-	KaxCluster* cluster = nullptr;
-	uint64_t clusterTimecode = 0;
-
 	while (isRunning) {
 		MediaData data = mediaQueue->Pop();
 
@@ -114,72 +233,41 @@ void MkvMuxer::MuxerLoop() {
 			break;
 		}
 
-		KaxCues& dummyCues = GetChild<KaxCues>(*segment);
-
-		// Create new cluster every 1 second (adjustable with timestampScale)
-		if (!cluster || (data.timestamp - clusterTimecode) >= timestampScale) {
-			if (cluster) {
-				cluster->Render(outputFile, dummyCues);
-				delete cluster;
-			}
-			cluster = new KaxCluster();
-			cluster->SetParent(*segment);
-			cluster->InitTimecode(data.timestamp, timestampScale);
-			clusterTimecode = data.timestamp;
-		}
-
 		switch (data.type) {
 		case MediaData::Type::Audio: {
-			handleAudioData(data, cluster);
+			handleAudioData(data, data.getAudioFormat());
 			break;
 		}
 		case MediaData::Type::Video: {
-			handleVideoData(data, cluster);
+			handleVideoData(data, data.getVideoFormat());
 			break;
 		}
 		}
 	}
 }
 
-// Unused and overloaded the original handler functions
-void MkvMuxer::handleAudioData(const MediaData& data, const AudioFormat& format) {}
-void MkvMuxer::handleVideoData(const MediaData& data, const VideoFormat& format) {}
-
-void MkvMuxer::handleAudioData(const MediaData& data, KaxCluster* cluster) {
-	KaxBlockGroup& blockGroup = GetChild<KaxBlockGroup>(*cluster);
-	KaxBlock& block = GetChild<KaxBlock>(blockGroup);
-
-	block.SetParent(*cluster);
-	DataBuffer frameBuffer(
-		(binary*)data.data.data(),
-		data.data.size()
-	);
-	block.AddFrame(*audioTrack, data.timestamp, frameBuffer);
+void MkvMuxer::handleAudioData(const MediaData& data, const AudioFormat& format) {
+	if (trackSetup.Observe(data)) {
+		Mux(data);
+	}
 }
 
-void MkvMuxer::handleVideoData(const MediaData& data, KaxCluster* cluster) {
-	const VideoFormat& format = data.getVideoFormat();
+void MkvMuxer::handleVideoData(const MediaData& data, const VideoFormat& format) {
+	if (trackSetup.Observe(data)) {
+		Mux(data);
+	}
+}
 
-	if (format.format == VideoFormat::PixelFormat::HEVC_HEADERS) {
-		KaxCodecPrivate& codecPrivate = GetChild<KaxCodecPrivate>(*videoTrack);
-		codecPrivate.CopyBuffer(data.data.data(), data.data.size());
-		tracks->Render(outputFile);
+void MkvMuxer::Mux(const MediaData& data) {
+	if (headersSet) {
+		WritePacket(data);
 		return;
 	}
 
-	KaxBlockGroup& blockGroup = GetChild<KaxBlockGroup>(*cluster);
-	KaxBlock& block = GetChild<KaxBlock>(blockGroup);
-
-	block.SetParent(*cluster);
-
-	DataBuffer frameBuffer(
-		(binary*)data.data.data(),
-		data.data.size()
-	);
-	block.AddFrame(*videoTrack, data.timestamp, frameBuffer);
-
-	if (format.isKeyFrame) {
-		GetChild<KaxBlockDuration>(blockGroup).SetValue(0);
-		GetChild<KaxReferenceBlock>(blockGroup).SetValue(0);
+	// Hold packets back until both streams have been seen, or give up on the
+	// missing one once the backlog gets long
+	pendingPackets.push_back(data);
+	if ((trackSetup.HasVideo() && trackSetup.HasAudio()) || pendingPackets.size() >= kMaxPendingPackets) {
+		WriteTracks();
 	}
 }
@@ -0,0 +1,182 @@
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <matroska/KaxTracks.h>
+#include <matroska/KaxSemantic.h>
+
+#include <media_pipeline/media_pipeline.h>
+
+#include "muxing/mkv_tracks.h"
+#include "media_pipeline/processors/video/nal_units.h"
+
+using namespace libmatroska;
+using namespace libebml;
+
+namespace {
+	constexpr uint16_t kOpusPreSkip = 312;
+
+	const char* VideoCodecId(VideoFormat::PixelFormat format) {
+		switch (format) {
+		case VideoFormat::PixelFormat::HEVC:
+		case VideoFormat::PixelFormat::HEVC_HEADERS:
+			return "V_MPEGH/ISO/HEVC";
+		case VideoFormat::PixelFormat::H264:
+		case VideoFormat::PixelFormat::H264_HEADERS:
+			return "V_MPEG4/ISO/AVC";
+		case VideoFormat::PixelFormat::VP8:
+			return "V_VP8";
+		case VideoFormat::PixelFormat::VP9:
+			return "V_VP9";
+		default:
+			throw std::runtime_error("Matroska muxing does not support this video codec");
+		}
+	}
+
+	const char* AudioCodecId(AudioFormat::SampleFormat format) {
+		switch (format) {
+		case AudioFormat::SampleFormat::MP3:
+			return "A_MPEG/L3";
+		case AudioFormat::SampleFormat::OPUS:
+			return "A_OPUS";
+		case AudioFormat::SampleFormat::AAC:
+			return "A_AAC";
+		case AudioFormat::SampleFormat::PCM_FLOAT:
+			return "A_PCM/FLOAT/IEEE";
+		default:
+			return "A_PCM/INT/LIT";
+		}
+	}
+
+	bool IsPcm(AudioFormat::SampleFormat format) {
+		return format == AudioFormat::SampleFormat::PCM_S16LE ||
+			format == AudioFormat::SampleFormat::PCM_S24LE ||
+			format == AudioFormat::SampleFormat::PCM_S32LE ||
+			format == AudioFormat::SampleFormat::PCM_FLOAT;
+	}
+
+	// OpusHead, the same identification header the Ogg writer uses
+	std::vector<uint8_t> OpusCodecPrivate(const AudioFormat& format) {
+		std::vector<uint8_t> head = { 'O', 'p', 'u', 's', 'H', 'e', 'a', 'd', 1 };
+		head.push_back(static_cast<uint8_t>(format.channels));
+		head.push_back(kOpusPreSkip & 0xFF);
+		head.push_back(kOpusPreSkip >> 8);
+		uint32_t rate = static_cast<uint32_t>(format.sampleRate);
+		for (int i = 0; i < 4; i++) head.push_back(static_cast<uint8_t>(rate >> (i * 8)));
+		head.push_back(0);	// Output gain
+		head.push_back(0);
+		head.push_back(0);	// Mapping family 0, mono or stereo
+		return head;
+	}
+}
+
+bool MkvTrackSetup::Observe(const MediaData& data) {
+	if (data.type == MediaData::Type::Audio) {
+		if (!audioFormat && !tracksAdded) {
+			audioFormat = data.getAudioFormat();
+		}
+		return true;
+	}
+
+	const VideoFormat& format = data.getVideoFormat();
+
+	// Parameter sets become CodecPrivate, they are not frames themselves
+	if (format.format == VideoFormat::PixelFormat::HEVC_HEADERS) {
+		if (!tracksAdded) {
+			videoFormat = format;
+			videoCodecPrivate = processors::video::nal::BuildHevcDecoderConfig(data.data.data(), data.data.size());
+		}
+		return false;
+	}
+	if (format.format == VideoFormat::PixelFormat::H264_HEADERS) {
+		if (!tracksAdded) {
+			videoFormat = format;
+			videoCodecPrivate = processors::video::nal::BuildAvcDecoderConfig(data.data.data(), data.data.size());
+		}
+		return false;
+	}
+
+	// VP8/VP9 have no header packet, the first frame describes the track
+	if (!videoFormat && !tracksAdded) {
+		videoFormat = format;
+	}
+	return true;
+}
+
+bool MkvTrackSetup::IsWebmCompatible() const {
+	if (videoFormat &&
+		videoFormat->format != VideoFormat::PixelFormat::VP8 &&
+		videoFormat->format != VideoFormat::PixelFormat::VP9) {
+		return false;
+	}
+	return !audioFormat || audioFormat->format == AudioFormat::SampleFormat::OPUS;
+}
+
+void MkvTrackSetup::AddTracks(KaxTracks& tracks, uint64_t timestampScale) {
+	uint64_t trackNumber = 1;
+
+	if (videoFormat) {
+		videoTrack = &AddNewChild<KaxTrackEntry>(tracks);
+		videoTrack->SetGlobalTimecodeScale(timestampScale);
+		GetChild<KaxTrackNumber>(*videoTrack).SetValue(trackNumber);
+		GetChild<KaxTrackUID>(*videoTrack).SetValue(trackNumber);
+		GetChild<KaxTrackType>(*videoTrack).SetValue(0x01);
+		GetChild<KaxCodecID>(*videoTrack).SetValue(VideoCodecId(videoFormat->format));
+		if (!videoCodecPrivate.empty()) {
+			GetChild<KaxCodecPrivate>(*videoTrack).CopyBuffer(videoCodecPrivate.data(),
+				static_cast<uint32>(videoCodecPrivate.size()));
+		}
+		KaxTrackVideo& video = GetChild<KaxTrackVideo>(*videoTrack);
+		GetChild<KaxVideoPixelWidth>(video).SetValue(videoFormat->width);
+		GetChild<KaxVideoPixelHeight>(video).SetValue(videoFormat->height);
+		trackNumber++;
+	}
+
+	if (audioFormat) {
+		audioTrack = &AddNewChild<KaxTrackEntry>(tracks);
+		audioTrack->SetGlobalTimecodeScale(timestampScale);
+		GetChild<KaxTrackNumber>(*audioTrack).SetValue(trackNumber);
+		GetChild<KaxTrackUID>(*audioTrack).SetValue(trackNumber);
+		GetChild<KaxTrackType>(*audioTrack).SetValue(0x02);
+		GetChild<KaxCodecID>(*audioTrack).SetValue(AudioCodecId(audioFormat->format));
+		if (audioFormat->format == AudioFormat::SampleFormat::OPUS) {
+			std::vector<uint8_t> opusHead = OpusCodecPrivate(*audioFormat);
+			GetChild<KaxCodecPrivate>(*audioTrack).CopyBuffer(opusHead.data(),
+				static_cast<uint32>(opusHead.size()));
+		}
+		KaxTrackAudio& audio = GetChild<KaxTrackAudio>(*audioTrack);
+		GetChild<KaxAudioSamplingFreq>(audio).SetValue(audioFormat->sampleRate);
+		GetChild<KaxAudioChannels>(audio).SetValue(audioFormat->channels);
+		if (IsPcm(audioFormat->format)) {
+			GetChild<KaxAudioBitDepth>(audio).SetValue(audioFormat->bitDepth);
+		}
+	}
+
+	tracksAdded = true;
+}
+
+KaxTrackEntry* MkvTrackSetup::TrackFor(const MediaData& data) const {
+	return data.type == MediaData::Type::Video ? videoTrack : audioTrack;
+}
+
+std::pair<const uint8_t*, size_t> MkvFramePayload(const MediaData& data, std::vector<uint8_t>& scratch) {
+	const uint8_t* payload = data.data.data();
+	size_t payloadSize = data.data.size();
+
+	if (data.type == MediaData::Type::Audio) {
+		if (data.getAudioFormat().format == AudioFormat::SampleFormat::OPUS) {
+			if (payloadSize <= sizeof(uint32_t)) return { payload, 0 };
+			payload += sizeof(uint32_t);
+			payloadSize -= sizeof(uint32_t);
+		}
+	}
+	else if (data.getVideoFormat().format == VideoFormat::PixelFormat::H264 ||
+		data.getVideoFormat().format == VideoFormat::PixelFormat::HEVC) {
+		scratch = processors::video::nal::AnnexBToLengthPrefixed(payload, payloadSize);
+		payload = scratch.data();
+		payloadSize = scratch.size();
+	}
+	return { payload, payloadSize };
+}
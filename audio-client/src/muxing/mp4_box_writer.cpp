@@ -0,0 +1,68 @@
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include "muxing/mp4_box_writer.h"
+
+size_t Mp4BoxWriter::BeginBox(const char* type) {
+	size_t boxStart = buffer.size();
+	U32(0);		// Patched by EndBox
+	FourCc(type);
+	return boxStart;
+}
+
+size_t Mp4BoxWriter::BeginFullBox(const char* type, uint8_t version, uint32_t flags) {
+	size_t boxStart = BeginBox(type);
+	U8(version);
+	U24(flags);
+	return boxStart;
+}
+
+void Mp4BoxWriter::EndBox(size_t boxStart) {
+	size_t boxSize = buffer.size() - boxStart;
+	if (boxSize > UINT32_MAX) {
+		throw std::runtime_error("MP4 box exceeds 4 GiB");
+	}
+	PatchU32(boxStart, static_cast<uint32_t>(boxSize));
+}
+
+void Mp4BoxWriter::U16(uint16_t value) {
+	buffer.push_back(static_cast<uint8_t>(value >> 8));
+	buffer.push_back(static_cast<uint8_t>(value));
+}
+
+void Mp4BoxWriter::U24(uint32_t value) {
+	buffer.push_back(static_cast<uint8_t>(value >> 16));
+	buffer.push_back(static_cast<uint8_t>(value >> 8));
+	buffer.push_back(static_cast<uint8_t>(value));
+}
+
+void Mp4BoxWriter::U32(uint32_t value) {
+	U16(static_cast<uint16_t>(value >> 16));
+	U16(static_cast<uint16_t>(value));
+}
+
+void Mp4BoxWriter::U64(uint64_t value) {
+	U32(static_cast<uint32_t>(value >> 32));
+	U32(static_cast<uint32_t>(value));
+}
+
+void Mp4BoxWriter::FourCc(const char* type) {
+	buffer.insert(buffer.end(), type, type + 4);
+}
+
+void Mp4BoxWriter::Zeros(size_t count) {
+	buffer.insert(buffer.end(), count, 0);
+}
+
+void Mp4BoxWriter::Bytes(const uint8_t* data, size_t size) {
+	buffer.insert(buffer.end(), data, data + size);
+}
+
+void Mp4BoxWriter::PatchU32(size_t position, uint32_t value) {
+	buffer[position] = static_cast<uint8_t>(value >> 24);
+	buffer[position + 1] = static_cast<uint8_t>(value >> 16);
+	buffer[position + 2] = static_cast<uint8_t>(value >> 8);
+	buffer[position + 3] = static_cast<uint8_t>(value);
+}
@@ -1,6 +1,5 @@
 #include <memory>
 #include <thread>
-#include <fstream>
 #include <atomic>
 
 #include <media_pipeline/media_pipeline.h>
@@ -9,9 +8,10 @@
 #include "muxing/ogg_muxer.h"
 #include "muxing/interfaces/i_muxer.h"
 
-OggMuxer::OggMuxer(std::shared_ptr<MediaQueue> mediaQueue) :
+OggMuxer::OggMuxer(std::shared_ptr<MediaQueue> mediaQueue, const std::string& filePath) :
 	isRunning(false),
 	mediaQueue(mediaQueue),
+	filePath(filePath),
 	packetNo(0),
 	granulePos(0),
 	oggSerialNo(0) {
@@ -59,21 +59,23 @@ void OggMuxer::MuxerLoop() {
 
 void OggMuxer::Start() {
 	// spin up OggMuxer on new thread
+	outputFile.Open(filePath);
+	oggFormat.WriteHeader(outputFile);
 	isRunning = true;
 	muxerThread = std::thread(&OggMuxer::MuxerLoop, this);
-	outputFile.open("test.ogg", std::ios::binary);
-	if (!outputFile) {
-		throw std::runtime_error("Failed to open OGG output file");
-	}
-	oggFormat.WriteHeader(outputFile);
 }
 
 void OggMuxer::Stop() {
-	isRunning = false;
+	// The loop muxes everything queued before this and exits at the marker
+	MediaData endOfStream;
+	endOfStream.isEndOfStream = true;
+	mediaQueue->Push(std::move(endOfStream));
+
 	if (muxerThread.joinable()) {
 		muxerThread.join();
 	}
-	outputFile.close();
+	isRunning = false;
+	outputFile.Close();
 }
 
 void OggMuxer::handleAudioData(const MediaData& data, const AudioFormat& format) {
@@ -0,0 +1,264 @@
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <deque>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstring>
+#include <exception>
+
+#include <media_pipeline/media_pipeline.h>
+
+#include "muxing/replay_recorder.h"
+#include "muxing/interfaces/i_muxer.h"
+#include "muxing/ogg_muxer.h"
+#include "muxing/mkv_muxer.h"
+
+class ReplayRecorder::SnapshotQueue : public MediaQueue {
+public:
+	explicit SnapshotQueue(Snapshot snapshot)
+		: snapshot(std::move(snapshot))
+		, next(0) {}
+
+	// Parameter sets, then the packets, then whatever was pushed (the
+	// muxer's end of stream marker)
+	MediaData Pop() override {
+		size_t parameterSets = snapshot.parameterSets.size();
+		if (next < parameterSets) {
+			return std::move(snapshot.parameterSets[next++]);
+		}
+		if (next - parameterSets >= snapshot.packets.size()) {
+			return MediaQueue::Pop();
+		}
+
+		const Packet& packet = snapshot.packets[next++ - parameterSets];
+		const Slab& slab = *snapshot.slabs[packet.slab - snapshot.firstSlab];
+
+		MediaData data;
+		data.data.assign(slab.data.get() + packet.offset, slab.data.get() + packet.offset + packet.size);
+		data.timestamp = packet.timestamp;
+		data.layerId = packet.layerId;
+		data.type = packet.type;
+		data.format = packet.format;
+		return data;
+	}
+
+private:
+	Snapshot snapshot;
+	size_t next;
+};
+
+ReplayRecorder::ReplayRecorder(ReplayOptions options)
+	: options(options)
+	, firstSlab(0)
+	, slabBytes(0)
+	, firstPacket(0)
+	, hasVideo(false)
+	, lastTimestamp(0)
+	, lastSegmentTimestamp(0) {
+	if (this->options.slabSize == 0) {
+		throw std::runtime_error("ReplayRecorder slab size must be positive");
+	}
+}
+
+ReplayRecorder::~ReplayRecorder() {
+	WaitForSave();
+}
+
+void ReplayRecorder::Start() {
+	// Nothing to open, packets are buffered as they arrive
+}
+
+void ReplayRecorder::Stop() {
+	WaitForSave();
+}
+
+void ReplayRecorder::ConsumeMediaData(const MediaData& data) {
+	ThrowIfFailed();
+	if (data.isEndOfStream || data.data.empty()) return;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	if (IsParameterSet(data)) {
+		KeepParameterSet(data);
+		return;
+	}
+
+	bool isSegmentStart = packets.empty();
+	if (data.type == MediaData::Type::Video) {
+		bool isKeyFrame = data.getVideoFormat().isKeyFrame;
+		// Frames before the first keyframe can't be decoded from the buffer
+		if (!hasVideo && !isKeyFrame) return;
+		hasVideo = true;
+		isSegmentStart = isSegmentStart || isKeyFrame;
+	}
+	else if (!hasVideo) {
+		isSegmentStart = isSegmentStart || data.timestamp >= lastSegmentTimestamp + options.audioSegmentDuration;
+	}
+
+	Append(data, isSegmentStart);
+	Evict();
+}
+
+bool ReplayRecorder::IsParameterSet(const MediaData& data) {
+	if (data.type != MediaData::Type::Video) return false;
+	VideoFormat::PixelFormat format = data.getVideoFormat().format;
+	return format == VideoFormat::PixelFormat::HEVC_HEADERS ||
+		format == VideoFormat::PixelFormat::H264_HEADERS ||
+		format == VideoFormat::PixelFormat::THEORA_HEADERS;
+}
+
+void ReplayRecorder::KeepParameterSet(const MediaData& data) {
+	// One per layer and codec, a newer one replaces it
+	for (MediaData& kept : parameterSets) {
+		if (kept.layerId == data.layerId && kept.getVideoFormat().format == data.getVideoFormat().format) {
+			kept = data;
+			return;
+		}
+	}
+	parameterSets.push_back(data);
+}
+
+std::shared_ptr<ReplayRecorder::Slab> ReplayRecorder::SlabFor(size_t size) {
+	if (!slabs.empty() && slabs.back()->capacity - slabs.back()->used >= size) {
+		return slabs.back();
+	}
+
+	size_t capacity = std::max(options.slabSize, size);
+	std::shared_ptr<Slab> slab;
+	// A save still reading the spare holds another reference
+	if (spareSlab && spareSlab->capacity >= capacity && spareSlab.use_count() == 1) {
+		slab = std::move(spareSlab);
+		slab->used = 0;
+	}
+	else {
+		slab = std::make_shared<Slab>();
+		slab->data = std::make_unique<uint8_t[]>(capacity);
+		slab->capacity = capacity;
+		slab->used = 0;
+	}
+	spareSlab.reset();
+
+	slabBytes += slab->capacity;
+	slabs.push_back(slab);
+	return slab;
+}
+
+void ReplayRecorder::Append(const MediaData& data, bool isSegmentStart) {
+	std::shared_ptr<Slab> slab = SlabFor(data.data.size());
+
+	Packet packet;
+	packet.slab = firstSlab + slabs.size() - 1;
+	packet.offset = slab->used;
+	packet.size = data.data.size();
+	packet.timestamp = data.timestamp;
+	packet.layerId = data.layerId;
+	packet.type = data.type;
+	packet.format = data.format;
+
+	std::memcpy(slab->data.get() + slab->used, data.data.data(), data.data.size());
+	slab->used += data.data.size();
+
+	if (isSegmentStart) {
+		segmentStarts.push_back(firstPacket + packets.size());
+		if (data.type == MediaData::Type::Audio) {
+			lastSegmentTimestamp = data.timestamp;
+		}
+	}
+	packets.push_back(std::move(packet));
+	lastTimestamp = std::max(lastTimestamp, data.timestamp);
+}
+
+void ReplayRecorder::Evict() {
+	// Whole segments only, and never the newest one
+	while (segmentStarts.size() > 1) {
+		uint64_t duration = lastTimestamp - std::min(lastTimestamp, packets.front().timestamp);
+		if (duration <= options.maxDuration && slabBytes <= options.maxBytes) break;
+
+		segmentStarts.pop_front();
+		while (firstPacket < segmentStarts.front()) {
+			packets.pop_front();
+			firstPacket++;
+		}
+
+		while (firstSlab < packets.front().slab) {
+			slabBytes -= slabs.front()->capacity;
+			spareSlab = std::move(slabs.front());
+			slabs.pop_front();
+			firstSlab++;
+		}
+	}
+}
+
+bool ReplayRecorder::SaveReplay(const std::string& filePath, ReplayFormat format) {
+	ThrowIfFailed();
+	if (isSaving) return false;
+	if (saveThread.joinable()) {
+		saveThread.join();
+	}
+
+	// Records are copied, payloads stay in the shared slabs
+	Snapshot snapshot;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		snapshot.parameterSets = parameterSets;
+		snapshot.packets.assign(packets.begin(), packets.end());
+		snapshot.slabs = slabs;
+		snapshot.firstSlab = firstSlab;
+	}
+
+	isSaving = true;
+	saveThread = std::thread(&ReplayRecorder::SaveLoop, this, std::move(snapshot), filePath, format);
+	return true;
+}
+
+void ReplayRecorder::WaitForSave() {
+	if (saveThread.joinable()) {
+		saveThread.join();
+	}
+}
+
+void ReplayRecorder::SaveLoop(Snapshot snapshot, std::string filePath, ReplayFormat format) {
+	try {
+		size_t packetCount = snapshot.packets.size();
+		auto queue = std::make_shared<SnapshotQueue>(std::move(snapshot));
+		std::unique_ptr<IMuxer> muxer;
+		if (format == ReplayFormat::Ogg) {
+			muxer = std::make_unique<OggMuxer>(queue, filePath);
+		}
+		else {
+			muxer = std::make_unique<MkvMuxer>(queue, filePath);
+		}
+		muxer->Start();
+
+		// Returns once the whole snapshot is written and the file finalized
+		muxer->Stop();
+		MEDIA_LOG_INFO("Saved " << packetCount << " packets of replay to " << filePath);
+	}
+	catch (...) {
+		std::lock_guard<std::mutex> lock(mutex);
+		error = std::current_exception();
+	}
+	isSaving = false;
+}
+
+uint64_t ReplayRecorder::BufferedDuration() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	if (packets.empty()) return 0;
+	return lastTimestamp - std::min(lastTimestamp, packets.front().timestamp);
+}
+
+size_t ReplayRecorder::BufferedBytes() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return slabBytes;
+}
+
+void ReplayRecorder::ThrowIfFailed() {
+	std::exception_ptr pending;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		std::swap(pending, error);
+	}
+	if (pending) std::rethrow_exception(pending);
+}
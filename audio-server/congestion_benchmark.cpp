@@ -0,0 +1,317 @@
+#include "congestion_benchmark.h"
+
+#ifdef __linux__
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+
+#include "media_pipeline/core/bitrate_allocator.h"
+#include "media_pipeline/core/interfaces/i_bitrate_controllable.h"
+#include "media_pipeline/core/media_clock.h"
+#include "media_pipeline/core/media_data.h"
+#include "media_pipeline/net/congestion_controller.h"
+#include "media_pipeline/net/rtcp.h"
+#include "media_pipeline/net/rtp.h"
+#include "media_pipeline/net/rtp_session.h"
+#include "media_pipeline/net/socket.h"
+#include "media_pipeline/sinks/video/rtp_hevc_sink.h"
+
+using media_pipeline::core::BitrateAllocator;
+using media_pipeline::core::MediaClock;
+using media_pipeline::core::MediaData;
+using media_pipeline::core::VideoFormat;
+using media_pipeline::core::interfaces::IBitrateControllable;
+using media_pipeline::net::CongestionController;
+using media_pipeline::net::RtpReceiverSession;
+using media_pipeline::net::Socket;
+using media_pipeline::net::SocketAddress;
+using media_pipeline::sinks::video::RtpHevcSink;
+using media_pipeline::sinks::video::RtpHevcSinkOptions;
+
+namespace {
+    constexpr uint64_t kNanosPerMilli = 1000000;
+    constexpr size_t kMaxDatagram = 2048;
+    constexpr int kKeyFrameInterval = 90;
+    constexpr int kMinVideoKbps = 100;
+    constexpr int kMaxVideoKbps = 5000;
+    constexpr auto kPollInterval = std::chrono::microseconds(100);
+
+    // Stands in for HevcProcessor: access units sized from the current
+    // target, key frames twice the size
+    class SyntheticEncoder : public IBitrateControllable {
+    public:
+        explicit SyntheticEncoder(int frameRate) : frameRate(frameRate), frames(0), kbps(0), random(1) {}
+
+        void SetTargetBitrate(int target) override { kbps = target; }
+        int GetTargetBitrate() const override { return kbps; }
+
+        MediaData NextFrame(uint64_t timestamp) {
+            bool isKeyFrame = frames++ % kKeyFrameInterval == 0;
+            size_t size = std::max<size_t>(64, static_cast<size_t>(kbps.load()) * 1000 / 8 / frameRate);
+            if (isKeyFrame) size *= 2;
+
+            // One Annex B NAL unit, IDR or trailing picture; odd filler
+            // bytes never form a start code
+            std::vector<uint8_t> data(size);
+            data[0] = 0; data[1] = 0; data[2] = 0; data[3] = 1;
+            data[4] = static_cast<uint8_t>((isKeyFrame ? 19 : 1) << 1);
+            data[5] = 1;
+            for (size_t i = 6; i < size; i++) data[i] = static_cast<uint8_t>(random() | 1);
+
+            VideoFormat format = {};
+            format.format = VideoFormat::PixelFormat::HEVC;
+            format.frameRate = frameRate;
+            format.isKeyFrame = isKeyFrame;
+            MediaData frame = MediaData::createVideo(std::move(data), format);
+            frame.timestamp = timestamp;
+            return frame;
+        }
+
+    private:
+        int frameRate;
+        uint64_t frames;
+        std::atomic<int> kbps;
+        std::minstd_rand random;
+    };
+
+    struct Step {
+        std::vector<double> latencyMs;
+        uint64_t overLimit = 0;
+        uint64_t lastOverLimit = 0;         // Arrival of the latest slow packet, 0 if none
+        uint64_t queueDrops = 0;
+        double targetSum = 0.0;
+        uint64_t targetSamples = 0;
+    };
+
+    // Both directions of the link; sender to receiver through the
+    // bottleneck queue, feedback back with the delay only
+    class Relay {
+    public:
+        Relay(const CongestionBenchmarkOptions& options, uint16_t receiverPort, std::vector<Step>& steps)
+            : options(options)
+            , steps(steps)
+            , fromSender(Socket::OpenUdp("127.0.0.1", 0))
+            , toReceiver(Socket::OpenUdp("127.0.0.1", 0))
+            , running(true) {
+            toReceiver.Connect("127.0.0.1", receiverPort);
+            fromSender.SetNonBlocking(true);
+            toReceiver.SetNonBlocking(true);
+        }
+
+        uint16_t Port() const { return fromSender.LocalPort(); }
+
+        void Start(uint64_t start) {
+            origin = start;
+            thread = std::thread(&Relay::Run, this);
+        }
+
+        void Stop() {
+            running = false;
+            if (thread.joinable()) thread.join();
+        }
+
+        // Step the capacity at media clock time now is in, clamped to the last
+        size_t StepAt(uint64_t now) const {
+            uint64_t step = (now - origin) / (static_cast<uint64_t>(options.stepSeconds) * 1000 * kNanosPerMilli);
+            return std::min<size_t>(static_cast<size_t>(step), options.capacitiesKbps.size() - 1);
+        }
+
+    private:
+        struct Packet {
+            std::vector<uint8_t> data;
+            uint64_t arrival;
+            uint64_t release;
+        };
+
+        void Run() {
+            const uint64_t delay = static_cast<uint64_t>(options.delayMs) * kNanosPerMilli;
+            std::deque<Packet> queue;           // Waiting for the bottleneck
+            std::deque<Packet> forward;         // Past it, waiting out the delay
+            std::deque<Packet> backward;
+            size_t queuedBytes = 0;
+            double credit = 0.0;
+            uint64_t last = MediaClock::Now();
+            SocketAddress sender;
+            bool hasSender = false;
+            uint8_t buffer[kMaxDatagram];
+
+            while (running) {
+                uint64_t now = MediaClock::Now();
+                size_t stepIndex = StepAt(now);
+                double bytesPerSecond = options.capacitiesKbps[stepIndex] * 1000.0 / 8.0;
+
+                ptrdiff_t size;
+                while ((size = fromSender.ReceiveFrom(buffer, sizeof(buffer), sender)) > 0) {
+                    hasSender = true;
+                    if (queuedBytes + size > bytesPerSecond * options.queueMs / 1000.0) {
+                        steps[stepIndex].queueDrops++;
+                        continue;
+                    }
+                    queue.push_back(Packet{ std::vector<uint8_t>(buffer, buffer + size), now, 0 });
+                    queuedBytes += size;
+                }
+                while ((size = toReceiver.Receive(buffer, sizeof(buffer))) > 0) {
+                    backward.push_back(Packet{ std::vector<uint8_t>(buffer, buffer + size), now, now + delay });
+                }
+
+                // Token bucket: an idle link saves up at most one packet
+                credit += (now - last) / 1e9 * bytesPerSecond;
+                last = now;
+                if (queue.empty()) credit = std::min(credit, static_cast<double>(kMaxDatagram));
+                while (!queue.empty() && credit >= queue.front().data.size()) {
+                    Packet packet = std::move(queue.front());
+                    queue.pop_front();
+                    credit -= packet.data.size();
+                    queuedBytes -= packet.data.size();
+                    packet.release = now + delay;
+                    forward.push_back(std::move(packet));
+                }
+
+                while (!forward.empty() && forward.front().release <= now) {
+                    const Packet& packet = forward.front();
+                    toReceiver.Send(packet.data.data(), packet.data.size());
+                    Record(packet, now);
+                    forward.pop_front();
+                }
+                while (!backward.empty() && backward.front().release <= now) {
+                    if (hasSender) fromSender.SendTo(backward.front().data.data(), backward.front().data.size(), sender);
+                    backward.pop_front();
+                }
+                std::this_thread::sleep_for(kPollInterval);
+            }
+        }
+
+        void Record(const Packet& packet, uint64_t now) {
+            Step& step = steps[StepAt(packet.arrival)];
+            double latency = (now - packet.arrival) / 1e6;
+            step.latencyMs.push_back(latency);
+            if (latency > options.latencyLimitMs) {
+                step.overLimit++;
+                step.lastOverLimit = packet.arrival;
+            }
+        }
+
+        const CongestionBenchmarkOptions& options;
+        std::vector<Step>& steps;
+        Socket fromSender;
+        Socket toReceiver;
+        uint64_t origin = 0;
+        std::atomic<bool> running;
+        std::thread thread;
+    };
+
+    // Depacketizing is left out; the session's ordering and feedback are
+    // what the sender needs
+    void Receive(Socket& socket, const std::atomic<bool>& running) {
+        RtpReceiverSession session(90000);
+        uint8_t buffer[kMaxDatagram];
+        uint8_t feedback[media_pipeline::net::kRtcpMaxPacketSize];
+        SocketAddress relay;
+        bool hasRelay = false;
+        while (running) {
+            ptrdiff_t size;
+            while ((size = socket.ReceiveFrom(buffer, sizeof(buffer), relay)) > 0) {
+                hasRelay = true;
+                uint64_t arrival = MediaClock::Now();
+                if (media_pipeline::net::IsRtcpPacket(buffer, size)) {
+                    session.OnRtcp(buffer, size, arrival);
+                    continue;
+                }
+                media_pipeline::net::RtpHeader header;
+                size_t payloadOffset;
+                size_t payloadSize;
+                if (media_pipeline::net::ParseRtpHeader(buffer, size, header, payloadOffset, payloadSize)) {
+                    session.Insert(header, buffer, size, arrival);
+                }
+            }
+
+            uint64_t now = MediaClock::Now();
+            const uint8_t* packet;
+            size_t packetSize;
+            while (session.Pop(now, packet, packetSize)) {}
+            size_t feedbackSize = session.BuildFeedback(feedback, sizeof(feedback), now);
+            if (feedbackSize > 0 && hasRelay) socket.SendTo(feedback, feedbackSize, relay);
+            std::this_thread::sleep_for(kPollInterval);
+        }
+    }
+
+    CongestionBenchmarkStep Summarize(int capacityKbps, Step& step, uint64_t stepStart) {
+        CongestionBenchmarkStep row;
+        row.capacityKbps = capacityKbps;
+        row.packets = step.latencyMs.size();
+        row.overLimit = step.overLimit;
+        row.queueDrops = step.queueDrops;
+        if (step.targetSamples > 0) row.meanTargetKbps = step.targetSum / step.targetSamples;
+        if (step.lastOverLimit > 0) row.settleMs = (step.lastOverLimit - stepStart) / 1e6;
+
+        std::vector<double>& latency = step.latencyMs;
+        if (latency.empty()) return row;
+        std::sort(latency.begin(), latency.end());
+        row.p50LatencyMs = latency[(latency.size() - 1) / 2];
+        row.p95LatencyMs = latency[(latency.size() - 1) * 95 / 100];
+        row.maxLatencyMs = latency.back();
+        return row;
+    }
+}
+
+std::vector<CongestionBenchmarkStep> RunCongestionBenchmark(const CongestionBenchmarkOptions& options) {
+    if (options.capacitiesKbps.empty() || options.stepSeconds <= 0 || options.frameRate <= 0) return {};
+
+    std::vector<Step> steps(options.capacitiesKbps.size());
+    Socket receiver = Socket::OpenUdp("127.0.0.1", 0);
+    receiver.SetNonBlocking(true);
+    Relay relay(options, receiver.LocalPort(), steps);
+
+    SyntheticEncoder encoder(options.frameRate);
+    auto allocator = std::make_shared<BitrateAllocator>();
+    allocator->AddStream(encoder, kMinVideoKbps, kMaxVideoKbps);
+    auto controller = std::make_shared<CongestionController>();
+
+    RtpHevcSinkOptions sinkOptions;
+    sinkOptions.address = "127.0.0.1";
+    sinkOptions.port = relay.Port();
+    sinkOptions.feedback.historyPackets = 4096;
+    sinkOptions.feedback.congestionController = controller;
+    sinkOptions.feedback.bitrateAllocator = allocator;
+    RtpHevcSink sink(sinkOptions);
+    sink.Start();
+
+    std::atomic<bool> receiving{ true };
+    std::thread receiverThread(Receive, std::ref(receiver), std::cref(receiving));
+    uint64_t start = MediaClock::Now();
+    relay.Start(start);
+
+    const uint64_t stepNanos = static_cast<uint64_t>(options.stepSeconds) * 1000 * kNanosPerMilli;
+    const uint64_t end = start + stepNanos * options.capacitiesKbps.size();
+    const auto frameInterval = std::chrono::nanoseconds(1000000000 / options.frameRate);
+    auto nextFrame = std::chrono::steady_clock::now();
+    for (uint64_t now = MediaClock::Now(); now < end; now = MediaClock::Now()) {
+        sink.ConsumeMediaData(encoder.NextFrame(now));
+
+        Step& step = steps[relay.StepAt(now)];
+        if ((now - start) % stepNanos >= stepNanos / 2) {
+            step.targetSum += controller->TargetBitrateKbps();
+            step.targetSamples++;
+        }
+        nextFrame += frameInterval;
+        std::this_thread::sleep_until(nextFrame);
+    }
+
+    relay.Stop();
+    receiving = false;
+    receiverThread.join();
+    sink.Stop();
+    allocator->RemoveStream(encoder);
+
+    std::vector<CongestionBenchmarkStep> rows;
+    for (size_t i = 0; i < steps.size(); i++) {
+        rows.push_back(Summarize(options.capacitiesKbps[i], steps[i], start + stepNanos * i));
+    }
+    return rows;
+}
+#endif
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+
+struct CongestionBenchmarkOptions {
+    std::vector<int> capacitiesKbps = { 2500, 1000, 3000, 600, 2000 };
+    int stepSeconds = 10;                   // Each capacity holds this long
+    int delayMs = 20;                       // Each way, on top of the queue
+    int queueMs = 500;                      // Drop-tail queue, in time at the current capacity
+    int frameRate = 30;
+    int latencyLimitMs = 200;
+};
+
+struct CongestionBenchmarkStep {
+    int capacityKbps = 0;
+    double meanTargetKbps = 0.0;            // Controller target, second half of the step
+    uint64_t packets = 0;                   // Through the bottleneck during the step
+    double p50LatencyMs = 0.0;              // Relay in to receiver in, queue and delay
+    double p95LatencyMs = 0.0;
+    double maxLatencyMs = 0.0;
+    uint64_t overLimit = 0;                 // Packets slower than latencyLimitMs
+    double settleMs = 0.0;                  // Step start to the last of those, 0 if none
+    uint64_t queueDrops = 0;
+};
+
+// Closed loop test of the congestion control: a synthetic HEVC encoder,
+// registered with a BitrateAllocator, feeds RtpHevcSink, whose sender
+// session carries a CongestionController wired to the allocator. The
+// packets cross a relay on loopback with a token bucket bottleneck that
+// steps through capacitiesKbps, and reach an RtpReceiverSession whose
+// RFC 8888 feedback comes back through the relay. Each frame is sized
+// from the encoder's current allocation, so the link only sees what the
+// controller asks for.
+//
+// Latency is measured per packet at the relay, queue wait plus the fixed
+// delay, and reported for each step along with how long after the step
+// packets were still over the limit. Linux only.
+std::vector<CongestionBenchmarkStep> RunCongestionBenchmark(const CongestionBenchmarkOptions& options);
@@ -1,10 +1,233 @@
 #include <iostream>
 #include <stdexcept>
+#include <string>
+#ifdef __linux__
+#include <cstdlib>
+#include <algorithm>
+#include <utility>
+#include "relay_server.h"
+#include "relay_load_generator.h"
+#include "udp_fanout_benchmark.h"
+#include "wire_protocol_benchmark.h"
+#include "pixel_format_benchmark.h"
+#include "scaler_benchmark.h"
+#include "transport_benchmark.h"
+#include "congestion_benchmark.h"
+#else
 //#include "audio_server.h"
 //#include "audio_playback_server.h"
 #include "opus_playback_server.h"
+#endif
 
 
+#ifdef __linux__
+// Runs the load generator against an in-process relay on each backend
+void RunBenchmark(const RelayLoadOptions& load, size_t threads) {
+    for (RelayBackend backend : { RelayBackend::Epoll, RelayBackend::IoUring }) {
+        RelayServerOptions options;
+        options.port = load.port;
+        options.threads = threads;
+        options.backend = backend;
+        RelayServer server(options);
+        server.Start();
+        const char* name = backend == RelayBackend::Epoll ? "epoll" : "io_uring";
+        if (server.Backend() != backend) {
+            std::cout << name << ": unavailable" << std::endl;
+            continue;
+        }
+
+        RelayServerStats before = server.GetStats();
+        RelayLoadResult result = RunRelayLoad(load);
+        RelayServerStats after = server.GetStats();
+        server.Stop();
+
+        double frames = static_cast<double>(after.framesForwarded - before.framesForwarded);
+        double megabits = static_cast<double>(after.bytesForwarded - before.bytesForwarded) * 8.0 / 1e6;
+        std::cout << name << ": " << result.forwardedPerSecond << " frames/s forwarded ("
+            << result.framesReceived << " of " << result.framesExpected << "), p50 " << result.p50LatencyMs
+            << " ms, p99 " << result.p99LatencyMs << " ms, "
+            << static_cast<double>(after.syscalls - before.syscalls) / std::max(frames, 1.0) << " syscalls/frame, "
+            << (after.cpuSeconds - before.cpuSeconds) * 1e6 / std::max(megabits, 1e-9) << " us CPU/Mbit" << std::endl;
+    }
+}
+
+// Fans the same bursts out with each send method; false if any listener
+// got the check burst wrong
+bool RunUdpBenchmark(const UdpFanoutBenchmarkOptions& options) {
+    bool delivered = true;
+    const std::pair<UdpFanoutMethod, const char*> methods[] = {
+        { UdpFanoutMethod::SendTo, "sendto" },
+        { UdpFanoutMethod::SendMmsg, "sendmmsg" },
+        { UdpFanoutMethod::SendMmsgGso, "sendmmsg+gso" },
+    };
+    for (const auto& method : methods) {
+        UdpFanoutBenchmarkResult result = RunUdpFanoutBenchmark(options, method.first);
+        std::cout << method.second << ": 1->" << options.listeners << " x " << options.packetsPerBurst
+            << " packets, " << result.datagramsPerSecond << " datagrams/s, "
+            << result.datagramsPerCoreSecond << " datagrams/s per core, "
+            << result.sendCallsPerDatagram << " send calls/datagram"
+            << (method.first == UdpFanoutMethod::SendMmsgGso && !result.segmented ? " (no GSO)" : "")
+            << ", " << result.wrongDatagrams << " of " << result.checkedDatagrams << " check datagrams wrong" << std::endl;
+        delivered = delivered && result.wrongDatagrams == 0;
+    }
+    return delivered;
+}
+
+// audio-server [relay] [port] [threads] [epoll|io_uring]
+// audio-server load [port] [channels] [subscribers per channel] [interval us] [seconds]
+// audio-server bench [channels] [subscribers per channel] [interval us] [seconds] [threads]
+// audio-server udpbench [listeners] [packets per burst] [seconds]
+// audio-server wirebench [frames] [passes] [fuzz inputs]
+// audio-server convbench [width] [height] [iterations]
+// audio-server scalebench [src width] [src height] [dst width] [dst height] [iterations]
+// audio-server transportbench [loss %] [delay ms] [packets] [interval ms]
+// audio-server ccbench [step seconds] [delay ms] [queue ms]
+int main(int argc, char** argv) {
+    std::string mode = argc > 1 ? argv[1] : "relay";
+    auto arg = [&](int index, long fallback) {
+        return argc > index ? std::strtol(argv[index], nullptr, 10) : fallback;
+    };
+
+    try {
+        if (mode == "load") {
+            RelayLoadOptions options;
+            options.port = static_cast<uint16_t>(arg(2, options.port));
+            options.channels = static_cast<size_t>(arg(3, static_cast<long>(options.channels)));
+            options.subscribersPerChannel = static_cast<size_t>(arg(4, static_cast<long>(options.subscribersPerChannel)));
+            options.packetIntervalUs = static_cast<int>(arg(5, options.packetIntervalUs));
+            options.seconds = static_cast<int>(arg(6, options.seconds));
+
+            RelayLoadResult result = RunRelayLoad(options);
+            std::cout << "Sent " << result.framesSent << " frames, received " << result.framesReceived
+                << " of " << result.framesExpected << " in " << result.seconds << " s\n"
+                << "Forwarded " << result.forwardedPerSecond << " frames/s\n"
+                << "Latency p50 " << result.p50LatencyMs << " ms, p99 " << result.p99LatencyMs
+                << " ms, p99.9 " << result.p999LatencyMs << " ms, max " << result.maxLatencyMs << " ms" << std::endl;
+            return 0;
+        }
+        if (mode == "bench") {
+            RelayLoadOptions options;
+            options.port = 23456;
+            options.channels = static_cast<size_t>(arg(2, static_cast<long>(options.channels)));
+            options.subscribersPerChannel = static_cast<size_t>(arg(3, static_cast<long>(options.subscribersPerChannel)));
+            options.packetIntervalUs = static_cast<int>(arg(4, options.packetIntervalUs));
+            options.seconds = static_cast<int>(arg(5, options.seconds));
+            RunBenchmark(options, static_cast<size_t>(arg(6, 1)));
+            return 0;
+        }
+
+        if (mode == "udpbench") {
+            UdpFanoutBenchmarkOptions options;
+            options.listeners = static_cast<size_t>(arg(2, static_cast<long>(options.listeners)));
+            options.packetsPerBurst = static_cast<size_t>(arg(3, static_cast<long>(options.packetsPerBurst)));
+            options.seconds = static_cast<double>(arg(4, 2));
+            return RunUdpBenchmark(options) ? 0 : 1;
+        }
+
+        if (mode == "wirebench") {
+            WireProtocolBenchmarkOptions options;
+            options.frames = static_cast<size_t>(arg(2, static_cast<long>(options.frames)));
+            options.passes = static_cast<size_t>(arg(3, static_cast<long>(options.passes)));
+            options.fuzzInputs = static_cast<size_t>(arg(4, static_cast<long>(options.fuzzInputs)));
+            WireProtocolBenchmarkResult result = RunWireProtocolBenchmark(options);
+            std::cout << "Parse: " << result.nanosPerFrame << " ns/frame, " << result.gigabytesPerSecond << " GB/s\n"
+                << "Fuzz: " << result.fuzzInputs << " inputs, " << result.fuzzFramesParsed << " frames parsed, "
+                << result.fuzzRejected << " rejected, " << result.fuzzOutOfBounds << " out of bounds" << std::endl;
+            return result.fuzzOutOfBounds == 0 ? 0 : 1;
+        }
+
+        if (mode == "convbench") {
+            PixelFormatBenchmarkOptions options;
+            options.width = static_cast<int>(arg(2, options.width));
+            options.height = static_cast<int>(arg(3, options.height));
+            options.iterations = static_cast<size_t>(arg(4, static_cast<long>(options.iterations)));
+            size_t mismatched = 0;
+            for (const PixelFormatBenchmarkRow& row : RunPixelFormatBenchmark(options)) {
+                std::cout << row.conversion << " at " << options.width << "x" << options.height << ": ";
+                if (row.scalarMicros > 0.0) {
+                    std::cout << row.scalarMicros << " us scalar, " << row.simdMicros << " us SIMD ("
+                        << row.scalarMicros / row.simdMicros << "x), " << row.mismatchedBytes << " bytes differ" << std::endl;
+                }
+                else {
+                    std::cout << row.simdMicros << " us" << std::endl;
+                }
+                mismatched += row.mismatchedBytes;
+            }
+            return mismatched == 0 ? 0 : 1;
+        }
+
+        if (mode == "scalebench") {
+            ScalerBenchmarkOptions options;
+            options.srcWidth = static_cast<int>(arg(2, options.srcWidth));
+            options.srcHeight = static_cast<int>(arg(3, options.srcHeight));
+            options.dstWidth = static_cast<int>(arg(4, options.dstWidth));
+            options.dstHeight = static_cast<int>(arg(5, options.dstHeight));
+            options.iterations = static_cast<size_t>(arg(6, static_cast<long>(options.iterations)));
+            ScalerBenchmarkResult result = RunScalerBenchmark(options);
+            size_t mismatched = 0;
+            for (const ScalerBenchmarkRow& row : result.rows) {
+                std::cout << row.mode << " " << options.srcWidth << "x" << options.srcHeight << " -> "
+                    << options.dstWidth << "x" << options.dstHeight << ": " << row.scalarMicros << " us scalar, "
+                    << row.simdMicros << " us SIMD (" << row.scalarMicros / row.simdMicros << "x), "
+                    << row.mismatchedBytes << " bytes differ" << std::endl;
+                mismatched += row.mismatchedBytes;
+            }
+            std::cout << "Edge sizes: " << result.edgeCases << " cases, " << result.edgeFailures << " failed" << std::endl;
+            return mismatched == 0 && result.edgeFailures == 0 ? 0 : 1;
+        }
+
+        if (mode == "transportbench") {
+            TransportBenchmarkOptions options;
+            options.lossPercent = argc > 2 ? std::strtod(argv[2], nullptr) : options.lossPercent;
+            options.delayMs = static_cast<int>(arg(3, options.delayMs));
+            options.packets = static_cast<size_t>(arg(4, static_cast<long>(options.packets)));
+            options.packetIntervalMs = static_cast<int>(arg(5, options.packetIntervalMs));
+            std::cout << options.packets << " packets every " << options.packetIntervalMs << " ms, "
+                << options.delayMs << " ms each way, " << options.lossPercent << "% loss" << std::endl;
+            for (const TransportBenchmarkRow& row : RunTransportBenchmark(options)) {
+                std::cout << row.transport << ": " << row.packetsReceived << " of " << row.packetsSent << " received, "
+                    << row.linkDropped << " dropped on the link, latency mean " << row.meanLatencyMs << " ms, p50 "
+                    << row.p50LatencyMs << " ms, p99 " << row.p99LatencyMs << " ms, max " << row.maxLatencyMs << " ms" << std::endl;
+            }
+            return 0;
+        }
+
+        if (mode == "ccbench") {
+            CongestionBenchmarkOptions options;
+            options.stepSeconds = static_cast<int>(arg(2, options.stepSeconds));
+            options.delayMs = static_cast<int>(arg(3, options.delayMs));
+            options.queueMs = static_cast<int>(arg(4, options.queueMs));
+            for (const CongestionBenchmarkStep& step : RunCongestionBenchmark(options)) {
+                std::cout << step.capacityKbps << " kbps: target " << step.meanTargetKbps << " kbps, latency p50 "
+                    << step.p50LatencyMs << " ms, p95 " << step.p95LatencyMs << " ms, max " << step.maxLatencyMs << " ms, "
+                    << step.overLimit << " of " << step.packets << " packets over " << options.latencyLimitMs
+                    << " ms (settled after " << step.settleMs << " ms), " << step.queueDrops << " dropped" << std::endl;
+            }
+            return 0;
+        }
+
+        RelayServerOptions options;
+        options.port = static_cast<uint16_t>(arg(2, options.port));
+        options.threads = static_cast<size_t>(arg(3, 0));
+        if (argc > 4 && std::string(argv[4]) == "io_uring") options.backend = RelayBackend::IoUring;
+        RelayServer server(options);
+        server.Start();
+        std::cout << "Relay listening on port " << options.port
+            << (server.Backend() == RelayBackend::IoUring ? " (io_uring)" : " (epoll)") << ". Press Enter to stop.\n";
+        std::cin.get();
+
+        RelayServerStats stats = server.GetStats();
+        std::cout << "Received " << stats.framesReceived << " frames, forwarded " << stats.framesForwarded
+            << ", dropped " << stats.framesDropped << std::endl;
+        server.Stop();
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
+#else
 int main() {
     try {
         OpusPlaybackServer server;
@@ -33,3 +256,4 @@ int main() {
     }
     return 0;
 }
+#endif
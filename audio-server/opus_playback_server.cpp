@@ -4,6 +4,16 @@
 #include <iostream>
 #include <avrt.h>
 
+#include "media_pipeline/net/wire_protocol.h"
+
+using media_pipeline::net::WireFrame;
+using media_pipeline::net::WireParseResult;
+
+namespace {
+	constexpr int kMaxOpusFrames = 5760;	// 120 ms at 48 kHz, the longest Opus packet
+	constexpr uint32_t kMaxConcealedPackets = 5;	// Longer gaps are skipped, not concealed
+}
+
 
 // Create a static member function instead:
 static DWORD WINAPI CaptureThreadProc(LPVOID param) {
@@ -25,7 +35,7 @@ OpusPlaybackServer::OpusPlaybackServer() :
 	int err;
 	decoder = opus_decoder_create(48000, 2, &err);
 
-	pcmInterleaved.resize(480 * 2);
+	pcmInterleaved.resize(kMaxOpusFrames * 2);
 
 	HRESULT hr = CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED);
 	if (FAILED(hr)) {
@@ -178,28 +188,52 @@ void OpusPlaybackServer::AcceptAndHandle() {
 		return;
 	}
 
-	while (true) {
-		// Receive data sizes of incoming data
-		uint32_t dataSize;
-		if (recv(clientSock, (char*)&dataSize, sizeof(dataSize), 0) != sizeof(dataSize)) {
-			break;
-		}
-
-		// Receive the actual data
-		std::vector<uint8_t> packet(dataSize);
+	auto receiveAll = [this](uint8_t* out, size_t size) {
 		size_t totalReceived = 0;
-		while (totalReceived < dataSize) {
-			int received = recv(clientSock, (char*)packet.data() + totalReceived, dataSize - totalReceived, 0);
+		while (totalReceived < size) {
+			int received = recv(clientSock, (char*)out + totalReceived, static_cast<int>(size - totalReceived), 0);
 			if (received <= 0) {
-				return;
+				return false;
 			}
 			totalReceived += received;
 		}
+		return true;
+	};
 
-		//std::cout << "Received " << packet.size() << " bytes of data over network. Queueing packet" << std::endl;
+	// Frames come from NetworkSink in the wire_protocol.h format, audio and
+	// video multiplexed; only the Opus audio streams are played
+	std::vector<uint8_t> frame;
+	while (true) {
+		frame.resize(media_pipeline::net::kRelayFrameHeaderSize);
+		if (!receiveAll(frame.data(), frame.size())) {
+			break;
+		}
+		size_t frameSize = media_pipeline::net::ReadRelayU32(frame.data());
+		if (frameSize > media_pipeline::net::kWireMaxFrameSize) {
+			std::cerr << "Frame of " << frameSize << " bytes, closing the connection" << std::endl;
+			break;
+		}
+		frame.resize(frame.size() + frameSize);
+		if (!receiveAll(frame.data() + media_pipeline::net::kRelayFrameHeaderSize, frameSize)) {
+			break;
+		}
+
+		WireFrame parsed;
+		if (media_pipeline::net::ParseWireFrame(frame.data(), frame.size(), parsed) != WireParseResult::Ok) {
+			std::cerr << "Not a media frame of this protocol version, closing the connection" << std::endl;
+			break;
+		}
+		if (parsed.header.codec != media_pipeline::net::WireCodec::Opus || parsed.payloadSize == 0) {
+			continue;
+		}
+
+		uint32_t lost = streams[parsed.header.streamId].Track(parsed.header.sequence);
 		std::lock_guard<std::mutex> lock(audioMutex);
-		std::cout << "Queue size before push: " << audioQueue.size() << std::endl;
-		audioQueue.push(std::move(packet));
+		if (lost > 0) {
+			// An empty packet has the decoder conceal one lost packet
+			for (uint32_t i = 0; i < lost && i < kMaxConcealedPackets; i++) audioQueue.push({});
+		}
+		audioQueue.push(std::vector<uint8_t>(parsed.payload, parsed.payload + parsed.payloadSize));
 	}
 }
 
@@ -227,35 +261,26 @@ void OpusPlaybackServer::ConvertAndWriteAudio() {
 				packet = std::move(audioQueue.front());
 				audioQueue.pop();
 
-				if (!packet.empty()) {
-					int samples = opus_decode_float(
-						decoder,
-						packet.data(),
-						packet.size(),
-						pcmInterleaved.data(),
-						480,
-						0
-					);
-
-					//std::cout << "Received " << samples << " samples, sending to output" << std::endl;
-
-					if (samples > 0) {
-						BYTE* pData;
-						hr = pRenderClient->GetBuffer(samples, &pData);
-						if (SUCCEEDED(hr)) {
-							//std::cout << "First few samples: "
-							//	<< pcmInterleaved[0] << ", "
-							//	<< pcmInterleaved[1] << ", "
-							//	<< pcmInterleaved[2] << std::endl;
-
-							memcpy(pData, pcmInterleaved.data(), samples * 2 * sizeof(float));
-							hr = pRenderClient->ReleaseBuffer(samples, 0);
-							if (FAILED(hr)) {
-								std::cerr << "Failed to release buffer" << std::endl;
-							}
-							else {
-								//std::cout << "Successfully released " << samples << " frames to audio device" << std::endl;
-							}
+				// Packets carry their own duration; an empty one is a
+				// lost packet for the decoder to conceal
+				int samples = opus_decode_float(
+					decoder,
+					packet.empty() ? nullptr : packet.data(),
+					static_cast<opus_int32>(packet.size()),
+					pcmInterleaved.data(),
+					packet.empty() ? lastPacketFrames : kMaxOpusFrames,
+					0
+				);
+				if (samples > 0 && !packet.empty()) lastPacketFrames = samples;
+
+				if (samples > 0) {
+					BYTE* pData;
+					hr = pRenderClient->GetBuffer(samples, &pData);
+					if (SUCCEEDED(hr)) {
+						memcpy(pData, pcmInterleaved.data(), samples * 2 * sizeof(float));
+						hr = pRenderClient->ReleaseBuffer(samples, 0);
+						if (FAILED(hr)) {
+							std::cerr << "Failed to release buffer" << std::endl;
 						}
 					}
 				}
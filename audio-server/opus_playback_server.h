@@ -8,6 +8,9 @@
 #include <opus/opus.h>
 #include <mutex>
 #include <queue>
+#include <unordered_map>
+
+#include "media_pipeline/net/wire_protocol.h"
 
 #pragma comment(lib, "avrt.lib")
 
@@ -38,7 +41,9 @@ private:
     // Audio data buffers
     std::vector<float> pcmInterleaved;
     std::mutex audioMutex;
-    std::queue<std::vector<uint8_t>> audioQueue;
+    std::queue<std::vector<uint8_t>> audioQueue;     // Empty packets stand for lost ones
+    std::unordered_map<uint16_t, media_pipeline::net::WireStreamState> streams;
+    int lastPacketFrames = 960;
 
     OpusDecoder* decoder;
 };
@@ -0,0 +1,92 @@
+#include "pixel_format_benchmark.h"
+
+#include <chrono>
+#include <functional>
+#include <random>
+#include <utility>
+
+#include "media_pipeline/core/video_frame.h"
+#include "media_pipeline/processors/video/pixel_format_kernels.h"
+
+using media_pipeline::core::I420Layout;
+using media_pipeline::core::I420View;
+namespace kernels = media_pipeline::processors::video::kernels;
+
+namespace {
+    double MicrosPerFrame(size_t iterations, const std::function<void()>& convert) {
+        convert();      // Warms caches and pages in the output
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; i++) convert();
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() /
+            static_cast<double>(iterations);
+    }
+
+    size_t Mismatches(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b) {
+        size_t count = 0;
+        for (size_t i = 0; i < a.size(); i++) count += a[i] != b[i];
+        return count;
+    }
+}
+
+std::vector<PixelFormatBenchmarkRow> RunPixelFormatBenchmark(const PixelFormatBenchmarkOptions& options) {
+    int width = options.width;
+    int height = options.height;
+    kernels::Isa isa = kernels::SelectIsa();
+
+    // Rows padded the way camera drivers pad them, so the stride paths run
+    int packedStride = (width * 2 + 63) & ~63;
+    int rgbStride = (width * 3 + 63) & ~63;
+    int nv12Stride = (width + 63) & ~63;
+    std::vector<uint8_t> packed(static_cast<size_t>(packedStride) * height);
+    std::vector<uint8_t> rgb(static_cast<size_t>(rgbStride) * height);
+    std::vector<uint8_t> nv12(static_cast<size_t>(nv12Stride) * (height + (height + 1) / 2));
+    std::mt19937 random(1);
+    for (std::vector<uint8_t>* buffer : { &packed, &rgb, &nv12 }) {
+        for (uint8_t& value : *buffer) value = static_cast<uint8_t>(random());
+    }
+    const uint8_t* nv12UV = nv12.data() + static_cast<size_t>(nv12Stride) * height;
+
+    I420Layout layout = I420Layout::ForSize(width, height);
+    I420Layout halfLayout = I420Layout::ForSize(width / 2, height / 2);
+    std::vector<uint8_t> scalarOut(layout.TotalSize());
+    std::vector<uint8_t> simdOut(layout.TotalSize());
+    I420View scalarView = I420View::FromBuffer(scalarOut.data(), layout);
+    I420View simdView = I420View::FromBuffer(simdOut.data(), layout);
+
+    using Convert = std::function<void(const I420View&, kernels::Isa)>;
+    const std::pair<const char*, Convert> conversions[] = {
+        { "YUY2 -> I420", [&](const I420View& dst, kernels::Isa with) { kernels::Yuy2ToI420(packed.data(), packedStride, dst, with); } },
+        { "UYVY -> I420", [&](const I420View& dst, kernels::Isa with) { kernels::UyvyToI420(packed.data(), packedStride, dst, with); } },
+        { "NV12 -> I420", [&](const I420View& dst, kernels::Isa with) { kernels::Nv12ToI420(nv12.data(), nv12Stride, nv12UV, nv12Stride, dst, with); } },
+        { "BGR24 -> I420", [&](const I420View& dst, kernels::Isa with) { kernels::Rgb24ToI420(rgb.data(), rgbStride, dst, true, with); } },
+    };
+
+    std::vector<PixelFormatBenchmarkRow> rows;
+    for (const auto& conversion : conversions) {
+        PixelFormatBenchmarkRow row;
+        row.conversion = conversion.first;
+        row.scalarMicros = MicrosPerFrame(options.iterations, [&] { conversion.second(scalarView, kernels::Isa::Scalar); });
+        row.simdMicros = MicrosPerFrame(options.iterations, [&] { conversion.second(simdView, isa); });
+        row.mismatchedBytes = Mismatches(scalarOut, simdOut);
+        rows.push_back(row);
+    }
+
+    std::vector<uint8_t> scalarHalfOut(halfLayout.TotalSize());
+    std::vector<uint8_t> simdHalfOut(halfLayout.TotalSize());
+    I420View scalarHalfView = I420View::FromBuffer(scalarHalfOut.data(), halfLayout);
+    I420View simdHalfView = I420View::FromBuffer(simdHalfOut.data(), halfLayout);
+    const std::pair<const char*, Convert> halfConversions[] = {
+        { "YUY2 -> I420 half", [&](const I420View& dst, kernels::Isa with) { kernels::Yuy2ToI420Half(packed.data(), packedStride, width, height, dst, with); } },
+        { "NV12 -> I420 half", [&](const I420View& dst, kernels::Isa with) { kernels::Nv12ToI420Half(nv12.data(), nv12Stride, nv12UV, nv12Stride, width, height, dst, with); } },
+        { "BGR24 -> I420 half", [&](const I420View& dst, kernels::Isa with) { kernels::Rgb24ToI420Half(rgb.data(), rgbStride, width, height, dst, true, with); } },
+    };
+    for (const auto& conversion : halfConversions) {
+        PixelFormatBenchmarkRow row;
+        row.conversion = conversion.first;
+        row.scalarMicros = MicrosPerFrame(options.iterations, [&] { conversion.second(scalarHalfView, kernels::Isa::Scalar); });
+        row.simdMicros = MicrosPerFrame(options.iterations, [&] { conversion.second(simdHalfView, isa); });
+        row.mismatchedBytes = Mismatches(scalarHalfOut, simdHalfOut);
+        rows.push_back(row);
+    }
+    return rows;
+}
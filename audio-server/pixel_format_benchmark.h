@@ -0,0 +1,24 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+
+struct PixelFormatBenchmarkOptions {
+    int width = 1920;
+    int height = 1080;
+    size_t iterations = 200;
+};
+
+struct PixelFormatBenchmarkRow {
+    std::string conversion;                 // e.g. "YUY2 -> I420"
+    double scalarMicros = 0.0;              // Per frame
+    double simdMicros = 0.0;                // Per frame, best instruction set on this machine
+    size_t mismatchedBytes = 0;             // SIMD output differing from scalar, must stay 0
+};
+
+// Times the camera format conversions with the scalar kernels against the
+// best SIMD kernels this machine has, on a synthetic frame, and checks the
+// two produce the same picture, for full and fused half-size output.
+std::vector<PixelFormatBenchmarkRow> RunPixelFormatBenchmark(const PixelFormatBenchmarkOptions& options);
@@ -0,0 +1,280 @@
+#include "relay_event_loop.h"
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <algorithm>
+
+#include "media_pipeline/net/relay_protocol.h"
+
+using media_pipeline::net::kRelayFrameHeaderSize;
+
+namespace {
+    constexpr size_t kBlockSize = 64 * 1024;
+    constexpr size_t kMinReceiveSpace = 4096;   // Less free space than this starts a new block
+    constexpr size_t kReadBudget = 256 * 1024;  // Per connection and wakeup, so one publisher can't starve the loop
+    constexpr int kMaxEvents = 256;
+    constexpr size_t kMaxSlices = 64;
+
+    // Tags for the epoll entries that aren't connections
+    char listenTag;
+    char wakeTag;
+
+    [[noreturn]] void ThrowErrno(const char* what) {
+        throw std::runtime_error(std::string(what) + ": " + std::strerror(errno));
+    }
+
+    struct EpollConnection : RelayConnection {
+        // Unparsed bytes are block[begin, end)
+        std::shared_ptr<RelayBlock> block;
+        size_t begin = 0;
+        size_t end = 0;
+        bool wantsWritable = false;     // EPOLLOUT armed
+    };
+
+    // Readiness based: recv into the connection's own block, sendmsg from
+    // the subscriber queue, EPOLLOUT only while a queue can't drain.
+    class EpollEventLoop : public RelayEventLoop {
+    public:
+        EpollEventLoop(size_t index, const RelayServerOptions& options, RelayChannelRegistry& registry,
+            std::vector<std::unique_ptr<RelayEventLoop>>& loops)
+            : RelayEventLoop(index, options, registry, loops), epollFd(-1) {
+            epollFd = epoll_create1(EPOLL_CLOEXEC);
+            if (epollFd < 0) ThrowErrno("Failed to create epoll instance");
+        }
+
+        ~EpollEventLoop() override {
+            for (auto& entry : connections) {
+                if (!entry.second->closed) ::close(entry.second->fd);
+            }
+            if (epollFd >= 0) ::close(epollFd);
+        }
+
+        void Run() override {
+            Watch(wakeFd, EPOLLIN, &wakeTag, EPOLL_CTL_ADD);
+            Watch(listenFd, EPOLLIN, &listenTag, EPOLL_CTL_ADD);
+
+            epoll_event events[kMaxEvents];
+            while (!IsStopping()) {
+                stats.syscalls++;
+                int count = epoll_wait(epollFd, events, kMaxEvents, -1);
+                if (count < 0) {
+                    if (errno == EINTR) continue;
+                    ThrowErrno("epoll_wait failed");
+                }
+
+                for (int i = 0; i < count; i++) {
+                    void* tag = events[i].data.ptr;
+                    if (tag == &listenTag) {
+                        Accept();
+                        continue;
+                    }
+                    if (tag == &wakeTag) {
+                        uint64_t value;
+                        stats.syscalls++;
+                        ssize_t drained = ::read(wakeFd, &value, sizeof(value));
+                        (void)drained;
+                        DrainInbox();
+                        continue;
+                    }
+                    EpollConnection* connection = static_cast<EpollConnection*>(tag);
+                    if (connection->closed) continue;
+                    if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) OnReadable(connection);
+                    if (!connection->closed && (events[i].events & EPOLLOUT)) Send(connection);
+                }
+
+                // Frames received in this pass go out in as few system calls
+                // as possible: one inbox handoff per loop, one sendmsg per
+                // subscriber
+                PostOutgoing();
+                FlushPending();
+                for (RelayConnection* connection : closing) {
+                    connections.erase(connection);
+                }
+                closing.clear();
+                PublishStats(connections.size());
+            }
+        }
+
+    protected:
+        void Flush(RelayConnection* connection) override {
+            // Connections waiting for EPOLLOUT send when it fires
+            EpollConnection* epollConnection = static_cast<EpollConnection*>(connection);
+            if (!epollConnection->wantsWritable) Send(epollConnection);
+        }
+
+        void Close(RelayConnection* connection) override {
+            if (connection->closed) return;
+            connection->closed = true;
+            epoll_ctl(epollFd, EPOLL_CTL_DEL, connection->fd, nullptr);
+            ::close(connection->fd);
+            stats.syscalls += 2;
+
+            Detach(connection);
+            static_cast<EpollConnection*>(connection)->block.reset();
+            // Freed once this pass is done with its events
+            closing.push_back(connection);
+        }
+
+    private:
+        void Watch(int fd, uint32_t events, void* tag, int operation) {
+            epoll_event event = {};
+            event.events = events;
+            event.data.ptr = tag;
+            stats.syscalls++;
+            if (epoll_ctl(epollFd, operation, fd, &event) != 0) ThrowErrno("epoll_ctl failed");
+        }
+
+        void Accept() {
+            while (true) {
+                stats.syscalls++;
+                int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if (fd < 0) {
+                    if (errno == EINTR) continue;
+                    // EAGAIN when the backlog is empty; out of descriptors or
+                    // memory also ends up here, the rest stay in the backlog
+                    return;
+                }
+                int enable = 1;
+                stats.syscalls++;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+                std::unique_ptr<EpollConnection> connection(new EpollConnection());
+                connection->fd = fd;
+                Watch(fd, EPOLLIN, connection.get(), EPOLL_CTL_ADD);
+                RelayConnection* key = connection.get();
+                connections.emplace(key, std::move(connection));
+            }
+        }
+
+        void OnReadable(EpollConnection* connection) {
+            size_t budget = kReadBudget;
+            while (budget > 0 && !connection->closed) {
+                MakeReceiveSpace(connection);
+                RelayBlock& block = *connection->block;
+                size_t space = block.capacity - connection->end;
+                stats.syscalls++;
+                ssize_t received = ::recv(connection->fd, block.data + connection->end, space, 0);
+                if (received > 0) {
+                    connection->end += static_cast<size_t>(received);
+                    connection->begin += ParseFrames(connection, connection->block,
+                        block.data + connection->begin, connection->end - connection->begin);
+                    if (connection->closed) return;
+                    // Everything parsed and nothing forwarded still points into the block
+                    if (connection->begin == connection->end && connection->block.use_count() == 1) {
+                        connection->begin = 0;
+                        connection->end = 0;
+                    }
+                    budget -= std::min(budget, static_cast<size_t>(received));
+                    // A short read drained the socket
+                    if (static_cast<size_t>(received) < space) return;
+                    continue;
+                }
+                if (received < 0 && errno == EINTR) continue;
+                if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+                Close(connection);
+            }
+        }
+
+        // Frames have to be contiguous. The partial frame at the end of the
+        // buffer moves to the front of the same block if nobody else holds
+        // it, otherwise to a new block; nothing already forwarded is ever
+        // moved.
+        void MakeReceiveSpace(EpollConnection* connection) {
+            size_t pending = connection->end - connection->begin;
+            size_t frameSize = 0;
+            if (connection->block && pending >= kRelayFrameHeaderSize) {
+                frameSize = kRelayFrameHeaderSize +
+                    media_pipeline::net::ReadRelayU32(connection->block->data + connection->begin);
+            }
+
+            if (connection->block) {
+                size_t capacity = connection->block->capacity;
+                // The rest of a known frame fits where it is
+                if (frameSize > 0 && connection->begin + frameSize <= capacity) return;
+                if (frameSize == 0 && capacity - connection->end >= kMinReceiveSpace) return;
+            }
+
+            size_t required = std::max(kBlockSize, frameSize);
+            if (connection->block && connection->block.use_count() == 1 && connection->block->capacity >= required) {
+                uint8_t* data = connection->block->data;
+                std::memmove(data, data + connection->begin, pending);
+            }
+            else {
+                std::shared_ptr<RelayBlock> block = RelayBlock::Allocate(required);
+                if (pending > 0) std::memcpy(block->data, connection->block->data + connection->begin, pending);
+                connection->block = std::move(block);
+            }
+            connection->begin = 0;
+            connection->end = pending;
+        }
+
+        void Send(EpollConnection* connection) {
+            while (!connection->queue.empty()) {
+                iovec slices[kMaxSlices];
+                size_t sliceCount = 0;
+                size_t skip = connection->frontOffset;
+                for (size_t i = 0; i < connection->queue.size() && sliceCount < kMaxSlices; i++) {
+                    const RelayFrame& frame = connection->queue[i];
+                    slices[sliceCount].iov_base = const_cast<uint8_t*>(frame.data + skip);
+                    slices[sliceCount].iov_len = frame.size - skip;
+                    sliceCount++;
+                    skip = 0;
+                }
+
+                msghdr message = {};
+                message.msg_iov = slices;
+                message.msg_iovlen = sliceCount;
+                stats.syscalls++;
+                ssize_t sent = ::sendmsg(connection->fd, &message, MSG_NOSIGNAL);
+                if (sent < 0) {
+                    if (errno == EINTR) continue;
+                    if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+                    Close(connection);
+                    return;
+                }
+
+                size_t remaining = static_cast<size_t>(sent);
+                while (remaining > 0) {
+                    RelayFrame& front = connection->queue.front();
+                    size_t left = front.size - connection->frontOffset;
+                    if (remaining < left) {
+                        connection->frontOffset += remaining;
+                        break;
+                    }
+                    remaining -= left;
+                    stats.framesForwarded++;
+                    stats.bytesForwarded += front.size;
+                    connection->queuedBytes -= front.size;
+                    connection->queue.pop_front();
+                    connection->frontOffset = 0;
+                }
+            }
+
+            // Only ask for writability while there is something left to write
+            bool wantsWritable = !connection->queue.empty();
+            if (wantsWritable != connection->wantsWritable) {
+                connection->wantsWritable = wantsWritable;
+                Watch(connection->fd, wantsWritable ? EPOLLIN | EPOLLOUT : EPOLLIN, connection, EPOLL_CTL_MOD);
+            }
+        }
+
+        int epollFd;
+        std::unordered_map<RelayConnection*, std::unique_ptr<RelayConnection>> connections;
+        std::vector<RelayConnection*> closing;
+    };
+}
+
+std::unique_ptr<RelayEventLoop> CreateEpollEventLoop(size_t index, const RelayServerOptions& options,
+    RelayChannelRegistry& registry, std::vector<std::unique_ptr<RelayEventLoop>>& loops) {
+    return std::unique_ptr<RelayEventLoop>(new EpollEventLoop(index, options, registry, loops));
+}
+#endif
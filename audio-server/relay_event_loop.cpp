@@ -0,0 +1,250 @@
+#include "relay_event_loop.h"
+
+#ifdef __linux__
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <algorithm>
+#include <iterator>
+
+#include "media_pipeline/net/relay_protocol.h"
+
+using media_pipeline::net::RelayJoin;
+using media_pipeline::net::kRelayFrameHeaderSize;
+using media_pipeline::net::kRelayPublish;
+using media_pipeline::net::kRelaySubscribe;
+
+namespace {
+    [[noreturn]] void ThrowErrno(const char* what) {
+        throw std::runtime_error(std::string(what) + ": " + std::strerror(errno));
+    }
+}
+
+std::shared_ptr<RelayBlock> RelayBlock::Allocate(size_t capacity) {
+    std::shared_ptr<RelayBlock> block = std::make_shared<RelayBlock>();
+    block->owned.reset(new uint8_t[capacity]);
+    block->data = block->owned.get();
+    block->capacity = capacity;
+    return block;
+}
+
+RelayChannelRegistry::RelayChannelRegistry(size_t loopCount) : loopCount(loopCount) {
+}
+
+std::shared_ptr<RelayChannel> RelayChannelRegistry::Join(uint32_t id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry& entry = channels[id];
+    if (!entry.channel) entry.channel = std::make_shared<RelayChannel>(id, loopCount);
+    entry.members++;
+    return entry.channel;
+}
+
+void RelayChannelRegistry::Leave(uint32_t id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = channels.find(id);
+    if (it != channels.end() && --it->second.members == 0) channels.erase(it);
+}
+
+RelayEventLoop::RelayEventLoop(size_t index, const RelayServerOptions& options, RelayChannelRegistry& registry,
+    std::vector<std::unique_ptr<RelayEventLoop>>& loops)
+    : index(index), options(options), listenFd(-1), wakeFd(-1)
+    , registry(registry), loops(loops), stopping(false) {
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeFd < 0) ThrowErrno("Failed to create eventfd");
+}
+
+RelayEventLoop::~RelayEventLoop() {
+    if (listenFd >= 0) ::close(listenFd);
+    if (wakeFd >= 0) ::close(wakeFd);
+}
+
+void RelayEventLoop::Listen() {
+    listenFd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
+    if (listenFd < 0) ThrowErrno("Failed to create listening socket");
+    int enable = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+    // Every loop binds the same port, the kernel balances accepts across them
+    if (setsockopt(listenFd, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) != 0) {
+        ThrowErrno("Failed to set SO_REUSEPORT");
+    }
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(options.port);
+    if (::bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        ThrowErrno("Failed to bind relay port");
+    }
+    if (::listen(listenFd, options.listenBacklog) != 0) ThrowErrno("Failed to listen");
+}
+
+void RelayEventLoop::Stop() {
+    stopping.store(true, std::memory_order_release);
+    uint64_t one = 1;
+    ssize_t written = ::write(wakeFd, &one, sizeof(one));
+    (void)written;
+}
+
+bool RelayEventLoop::Post(std::vector<RelayDelivery>& batch) {
+    bool wasEmpty;
+    {
+        std::lock_guard<std::mutex> lock(inboxMutex);
+        wasEmpty = inbox.empty();
+        if (wasEmpty) inbox.swap(batch);
+        else std::move(batch.begin(), batch.end(), std::back_inserter(inbox));
+    }
+    batch.clear();
+    if (wasEmpty) {
+        uint64_t one = 1;
+        ssize_t written = ::write(wakeFd, &one, sizeof(one));
+        (void)written;  // Only fails when the counter is already nonzero, which wakes the loop too
+    }
+    return wasEmpty;
+}
+
+RelayServerStats RelayEventLoop::GetStats() const {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    return published;
+}
+
+bool RelayEventLoop::IsFrameTooLarge(RelayConnection* connection, size_t payloadSize) {
+    if (payloadSize <= options.maxFrameSize) return false;
+    stats.protocolErrors++;
+    Close(connection);
+    return true;
+}
+
+size_t RelayEventLoop::ParseFrames(RelayConnection* connection, const std::shared_ptr<RelayBlock>& block,
+    const uint8_t* data, size_t size) {
+    size_t offset = 0;
+    while (size - offset >= kRelayFrameHeaderSize) {
+        size_t payloadSize = media_pipeline::net::ReadRelayU32(data + offset);
+        if (IsFrameTooLarge(connection, payloadSize)) return offset;
+        size_t frameSize = kRelayFrameHeaderSize + payloadSize;
+        if (size - offset < frameSize) break;
+
+        HandleFrame(connection, block, data + offset, frameSize);
+        if (connection->closed) return offset;
+        offset += frameSize;
+    }
+    return offset;
+}
+
+void RelayEventLoop::HandleFrame(RelayConnection* connection, const std::shared_ptr<RelayBlock>& block,
+    const uint8_t* frame, size_t size) {
+    if (!connection->joined) {
+        RelayJoin join;
+        if (!media_pipeline::net::ParseRelayJoin(frame + kRelayFrameHeaderSize, size - kRelayFrameHeaderSize, join)) {
+            stats.protocolErrors++;
+            Close(connection);
+            return;
+        }
+        Join(connection, join.channel, join.roles);
+        return;
+    }
+    if (!(connection->roles & kRelayPublish)) {
+        stats.protocolErrors++;
+        Close(connection);
+        return;
+    }
+
+    stats.framesReceived++;
+    stats.bytesReceived += size;
+    RelayFrame ref{ block, frame, size };
+    RelayChannel& channel = *connection->channel;
+    if (outgoing.size() != loops.size()) outgoing.resize(loops.size());
+    for (size_t i = 0; i < loops.size(); i++) {
+        if (channel.slots[i].count.load(std::memory_order_relaxed) == 0) continue;
+        if (i == index) Deliver(channel, ref, connection);
+        else outgoing[i].push_back(RelayDelivery{ connection->channel, ref });
+    }
+}
+
+void RelayEventLoop::Join(RelayConnection* connection, uint32_t channel, uint8_t roles) {
+    connection->joined = true;
+    connection->roles = roles;
+    connection->channel = registry.Join(channel);
+    if (roles & kRelaySubscribe) {
+        RelayChannel::Slot& slot = connection->channel->slots[index];
+        slot.subscribers.push_back(connection);
+        slot.count.store(slot.subscribers.size(), std::memory_order_relaxed);
+    }
+}
+
+void RelayEventLoop::Deliver(RelayChannel& channel, const RelayFrame& frame, RelayConnection* publisher) {
+    for (RelayConnection* subscriber : channel.slots[index].subscribers) {
+        if (subscriber != publisher) Enqueue(subscriber, frame);
+    }
+}
+
+void RelayEventLoop::Enqueue(RelayConnection* connection, const RelayFrame& frame) {
+    connection->queue.push_back(frame);
+    connection->queuedBytes += frame.size;
+
+    // Same policy as NetworkSink: the oldest frames that haven't started
+    // sending go first, and the newest always stays
+    size_t oldest = std::max<size_t>(connection->sendingFrames, connection->frontOffset > 0 ? 1 : 0);
+    while (connection->queuedBytes > options.maxQueuedBytes && connection->queue.size() > oldest + 1) {
+        connection->queuedBytes -= connection->queue[oldest].size;
+        connection->queue.erase(connection->queue.begin() + oldest);
+        stats.framesDropped++;
+    }
+
+    if (!connection->pendingFlush) {
+        connection->pendingFlush = true;
+        pending.push_back(connection);
+    }
+}
+
+void RelayEventLoop::FlushPending() {
+    for (RelayConnection* connection : pending) {
+        connection->pendingFlush = false;
+        if (!connection->closed) Flush(connection);
+    }
+    pending.clear();
+}
+
+void RelayEventLoop::PostOutgoing() {
+    for (size_t i = 0; i < outgoing.size(); i++) {
+        if (!outgoing[i].empty() && loops[i]->Post(outgoing[i])) stats.syscalls++;
+    }
+}
+
+void RelayEventLoop::DrainInbox() {
+    {
+        std::lock_guard<std::mutex> lock(inboxMutex);
+        received.swap(inbox);
+    }
+    for (const RelayDelivery& delivery : received) {
+        Deliver(*delivery.channel, delivery.frame, nullptr);
+    }
+    received.clear();
+}
+
+void RelayEventLoop::Detach(RelayConnection* connection) {
+    if (connection->joined) {
+        if (connection->roles & kRelaySubscribe) {
+            RelayChannel::Slot& slot = connection->channel->slots[index];
+            slot.subscribers.erase(std::find(slot.subscribers.begin(), slot.subscribers.end(), connection));
+            slot.count.store(slot.subscribers.size(), std::memory_order_relaxed);
+        }
+        registry.Leave(connection->channel->id);
+    }
+    connection->channel.reset();
+    connection->queue.clear();
+    connection->queuedBytes = 0;
+    connection->frontOffset = 0;
+    connection->sendingFrames = 0;
+}
+
+void RelayEventLoop::PublishStats(size_t connections) {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    published = stats;
+    published.connections = connections;
+}
+#endif
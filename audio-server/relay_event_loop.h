@@ -0,0 +1,166 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "relay_server.h"
+
+
+// Received bytes that frames are forwarded out of. Whoever filled it
+// decides what happens once the last frame referencing it has been sent:
+// heap blocks are freed, io_uring provided buffers go back to their ring.
+struct RelayBlock {
+    uint8_t* data = nullptr;
+    size_t capacity = 0;
+    std::unique_ptr<uint8_t[]> owned;
+
+    static std::shared_ptr<RelayBlock> Allocate(size_t capacity);
+};
+
+struct RelayFrame {
+    std::shared_ptr<RelayBlock> block;
+    const uint8_t* data;            // Size prefix included
+    size_t size;
+};
+
+struct RelayConnection;
+
+// Subscribers are kept per loop and only touched by their own loop; the
+// counts tell other loops whether there is anyone to hand a frame to
+struct RelayChannel {
+    struct Slot {
+        std::vector<RelayConnection*> subscribers;
+        std::atomic<size_t> count{ 0 };
+    };
+
+    RelayChannel(uint32_t id, size_t loopCount) : id(id), slots(new Slot[loopCount]) {}
+    uint32_t id;
+    std::unique_ptr<Slot[]> slots;
+};
+
+// What the routing needs to know about a client. The backends derive from
+// it for their receive state.
+struct RelayConnection {
+    virtual ~RelayConnection() = default;
+
+    int fd = -1;
+    bool closed = false;
+
+    bool joined = false;
+    uint8_t roles = 0;
+    std::shared_ptr<RelayChannel> channel;
+
+    std::deque<RelayFrame> queue;
+    size_t queuedBytes = 0;
+    size_t frontOffset = 0;         // Bytes of queue.front() already sent
+    size_t sendingFrames = 0;       // Frames at the front handed to the kernel, never dropped
+    bool pendingFlush = false;
+};
+
+// A frame handed to another loop for its subscribers
+struct RelayDelivery {
+    std::shared_ptr<RelayChannel> channel;
+    RelayFrame frame;
+};
+
+// Channel lookup, only taken on join and leave
+class RelayChannelRegistry {
+public:
+    explicit RelayChannelRegistry(size_t loopCount);
+
+    std::shared_ptr<RelayChannel> Join(uint32_t id);
+    void Leave(uint32_t id);
+
+private:
+    struct Entry {
+        std::shared_ptr<RelayChannel> channel;
+        size_t members = 0;
+    };
+
+    size_t loopCount;
+    std::mutex mutex;
+    std::unordered_map<uint32_t, Entry> channels;
+};
+
+// One thread's share of the relay. The routing (joins, fan-out, subscriber
+// queues, handoff to other loops) lives here; the backends only move bytes
+// and call back into it.
+class RelayEventLoop {
+public:
+    RelayEventLoop(size_t index, const RelayServerOptions& options, RelayChannelRegistry& registry,
+        std::vector<std::unique_ptr<RelayEventLoop>>& loops);
+    virtual ~RelayEventLoop();
+
+    // Binds this loop's SO_REUSEPORT listener, errors surface from Start
+    void Listen();
+    virtual void Run() = 0;
+    void Stop();
+
+    // Called by other loops. True if the loop had to be woken.
+    bool Post(std::vector<RelayDelivery>& batch);
+
+    RelayServerStats GetStats() const;
+
+protected:
+    // Forwards or handles every complete frame in data and returns the bytes
+    // they took; the rest is the start of a frame still arriving. Stops
+    // early if the connection had to be closed.
+    size_t ParseFrames(RelayConnection* connection, const std::shared_ptr<RelayBlock>& block,
+        const uint8_t* data, size_t size);
+    bool IsFrameTooLarge(RelayConnection* connection, size_t payloadSize);
+
+    // Subscribers that got frames this pass, flushed by the backend
+    void FlushPending();
+    // Hands the frames for other loops over, once per pass
+    void PostOutgoing();
+    // Delivers frames other loops posted
+    void DrainInbox();
+    // Drops the connection from its channel and its queue
+    void Detach(RelayConnection* connection);
+    void PublishStats(size_t connections);
+
+    virtual void Flush(RelayConnection* connection) = 0;
+    virtual void Close(RelayConnection* connection) = 0;
+
+    bool IsStopping() const { return stopping.load(std::memory_order_acquire); }
+
+    size_t index;
+    const RelayServerOptions& options;
+    int listenFd;
+    int wakeFd;
+    RelayServerStats stats;
+
+private:
+    void HandleFrame(RelayConnection* connection, const std::shared_ptr<RelayBlock>& block,
+        const uint8_t* frame, size_t size);
+    void Join(RelayConnection* connection, uint32_t channel, uint8_t roles);
+    void Deliver(RelayChannel& channel, const RelayFrame& frame, RelayConnection* publisher);
+    void Enqueue(RelayConnection* connection, const RelayFrame& frame);
+
+    RelayChannelRegistry& registry;
+    std::vector<std::unique_ptr<RelayEventLoop>>& loops;
+    std::atomic<bool> stopping;
+
+    std::vector<RelayConnection*> pending;
+    std::vector<std::vector<RelayDelivery>> outgoing;
+
+    std::mutex inboxMutex;
+    std::vector<RelayDelivery> inbox;
+    std::vector<RelayDelivery> received;
+
+    mutable std::mutex statsMutex;
+    RelayServerStats published;
+};
+
+std::unique_ptr<RelayEventLoop> CreateEpollEventLoop(size_t index, const RelayServerOptions& options,
+    RelayChannelRegistry& registry, std::vector<std::unique_ptr<RelayEventLoop>>& loops);
+
+// Null when built without MEDIA_PIPELINE_USE_IO_URING or when the kernel
+// lacks what the backend needs (provided buffer rings, 5.19 or later)
+std::unique_ptr<RelayEventLoop> CreateUringEventLoop(size_t index, const RelayServerOptions& options,
+    RelayChannelRegistry& registry, std::vector<std::unique_ptr<RelayEventLoop>>& loops);
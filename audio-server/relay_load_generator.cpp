@@ -0,0 +1,249 @@
+#include "relay_load_generator.h"
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <csignal>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+
+#include "media_pipeline/net/relay_protocol.h"
+
+using media_pipeline::net::RelayJoin;
+using media_pipeline::net::kRelayFrameHeaderSize;
+
+namespace {
+    constexpr int64_t kBucketNs = 10000;        // 10 us latency resolution
+    constexpr size_t kBucketCount = 100000;     // Up to a second, the last bucket takes the rest
+    constexpr size_t kReceiveBufferSize = 64 * 1024;
+    constexpr auto kSettleTime = std::chrono::milliseconds(300);
+
+    [[noreturn]] void ThrowErrno(const char* what) {
+        throw std::runtime_error(std::string(what) + ": " + std::strerror(errno));
+    }
+
+    int64_t NowNanos() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    struct Histogram {
+        std::vector<uint64_t> buckets = std::vector<uint64_t>(kBucketCount, 0);
+        uint64_t count = 0;
+        int64_t maxNanos = 0;
+
+        void Add(int64_t nanos) {
+            size_t bucket = static_cast<size_t>(std::max<int64_t>(nanos, 0) / kBucketNs);
+            buckets[std::min(bucket, kBucketCount - 1)]++;
+            count++;
+            maxNanos = std::max(maxNanos, nanos);
+        }
+
+        void Merge(const Histogram& other) {
+            for (size_t i = 0; i < kBucketCount; i++) buckets[i] += other.buckets[i];
+            count += other.count;
+            maxNanos = std::max(maxNanos, other.maxNanos);
+        }
+
+        // Upper edge of the bucket holding the quantile
+        double QuantileMs(double quantile) const {
+            if (count == 0) return 0.0;
+            uint64_t rank = static_cast<uint64_t>(quantile * static_cast<double>(count - 1)) + 1;
+            uint64_t seen = 0;
+            for (size_t i = 0; i < kBucketCount; i++) {
+                seen += buckets[i];
+                if (seen >= rank) return static_cast<double>((i + 1) * kBucketNs) / 1e6;
+            }
+            return static_cast<double>(maxNanos) / 1e6;
+        }
+    };
+
+    int Connect(const RelayLoadOptions& options) {
+        int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP);
+        if (fd < 0) ThrowErrno("Failed to create socket");
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(options.port);
+        if (inet_pton(AF_INET, options.address.c_str(), &address.sin_addr) != 1) {
+            ::close(fd);
+            throw std::runtime_error("Invalid relay address: " + options.address);
+        }
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            int error = errno;
+            ::close(fd);
+            errno = error;
+            ThrowErrno("Failed to connect to relay");
+        }
+        int enable = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+        return fd;
+    }
+
+    void SendAll(int fd, const uint8_t* data, size_t size) {
+        while (size > 0) {
+            ssize_t sent = ::send(fd, data, size, MSG_NOSIGNAL);
+            if (sent < 0) {
+                if (errno == EINTR) continue;
+                ThrowErrno("Failed to send to relay");
+            }
+            data += sent;
+            size -= static_cast<size_t>(sent);
+        }
+    }
+
+    void SendJoin(int fd, uint32_t channel, uint8_t roles) {
+        uint8_t join[media_pipeline::net::kRelayJoinMessageSize];
+        media_pipeline::net::WriteRelayJoin(join, RelayJoin{ channel, roles });
+        SendAll(fd, join, sizeof(join));
+    }
+
+    struct Subscriber {
+        int fd;
+        std::vector<uint8_t> buffer;
+        size_t used;
+    };
+
+    struct ReceiverState {
+        std::vector<Subscriber> subscribers;
+        Histogram latency;
+        uint64_t framesReceived = 0;
+    };
+
+    // Takes the send time out of every complete frame
+    void ParseReceived(Subscriber& subscriber, ReceiverState& state) {
+        size_t offset = 0;
+        int64_t now = NowNanos();
+        while (subscriber.used - offset >= kRelayFrameHeaderSize) {
+            size_t payloadSize = media_pipeline::net::ReadRelayU32(subscriber.buffer.data() + offset);
+            if (subscriber.used - offset < kRelayFrameHeaderSize + payloadSize) break;
+            if (payloadSize >= sizeof(int64_t)) {
+                int64_t sentAt;
+                std::memcpy(&sentAt, subscriber.buffer.data() + offset + kRelayFrameHeaderSize, sizeof(sentAt));
+                state.latency.Add(now - sentAt);
+            }
+            state.framesReceived++;
+            offset += kRelayFrameHeaderSize + payloadSize;
+        }
+        std::memmove(subscriber.buffer.data(), subscriber.buffer.data() + offset, subscriber.used - offset);
+        subscriber.used -= offset;
+    }
+
+    void ReceiveLoop(ReceiverState& state, const std::atomic<bool>& stopping) {
+        int epollFd = epoll_create1(EPOLL_CLOEXEC);
+        if (epollFd < 0) ThrowErrno("Failed to create epoll instance");
+        for (Subscriber& subscriber : state.subscribers) {
+            epoll_event event = {};
+            event.events = EPOLLIN;
+            event.data.ptr = &subscriber;
+            epoll_ctl(epollFd, EPOLL_CTL_ADD, subscriber.fd, &event);
+        }
+
+        epoll_event events[256];
+        while (!stopping.load(std::memory_order_acquire)) {
+            int count = epoll_wait(epollFd, events, 256, 50);
+            for (int i = 0; i < count; i++) {
+                Subscriber& subscriber = *static_cast<Subscriber*>(events[i].data.ptr);
+                ssize_t received = ::recv(subscriber.fd, subscriber.buffer.data() + subscriber.used,
+                    subscriber.buffer.size() - subscriber.used, MSG_DONTWAIT);
+                if (received <= 0) {
+                    if (received < 0 && (errno == EAGAIN || errno == EINTR)) continue;
+                    epoll_ctl(epollFd, EPOLL_CTL_DEL, subscriber.fd, nullptr);
+                    continue;
+                }
+                subscriber.used += static_cast<size_t>(received);
+                ParseReceived(subscriber, state);
+            }
+        }
+        ::close(epollFd);
+    }
+}
+
+RelayLoadResult RunRelayLoad(const RelayLoadOptions& options) {
+    std::signal(SIGPIPE, SIG_IGN);
+
+    size_t threadCount = std::max<size_t>(options.receiveThreads, 1);
+    std::vector<ReceiverState> receivers(threadCount);
+    size_t bufferSize = std::max(kReceiveBufferSize, 2 * (kRelayFrameHeaderSize + options.payloadSize));
+    size_t next = 0;
+    for (size_t channel = 0; channel < options.channels; channel++) {
+        for (size_t i = 0; i < options.subscribersPerChannel; i++) {
+            int fd = Connect(options);
+            SendJoin(fd, static_cast<uint32_t>(channel + 1), media_pipeline::net::kRelaySubscribe);
+            receivers[next++ % threadCount].subscribers.push_back(Subscriber{ fd, std::vector<uint8_t>(bufferSize), 0 });
+        }
+    }
+
+    std::atomic<bool> stopping(false);
+    std::vector<std::thread> threads;
+    for (ReceiverState& state : receivers) {
+        threads.emplace_back([&state, &stopping]() { ReceiveLoop(state, stopping); });
+    }
+
+    std::vector<int> publishers;
+    for (size_t channel = 0; channel < options.channels; channel++) {
+        int fd = Connect(options);
+        SendJoin(fd, static_cast<uint32_t>(channel + 1), media_pipeline::net::kRelayPublish);
+        publishers.push_back(fd);
+    }
+    // Joins are handled asynchronously, frames sent before them would be lost
+    std::this_thread::sleep_for(kSettleTime);
+
+    std::vector<uint8_t> frame(kRelayFrameHeaderSize + std::max(options.payloadSize, sizeof(int64_t)), 0);
+    media_pipeline::net::WriteRelayU32(frame.data(), static_cast<uint32_t>(frame.size() - kRelayFrameHeaderSize));
+
+    RelayLoadResult result;
+    auto interval = std::chrono::microseconds(std::max(options.packetIntervalUs, 1));
+    auto start = std::chrono::steady_clock::now();
+    auto end = start + std::chrono::seconds(options.seconds);
+    auto tick = start;
+    while (tick < end) {
+        for (int fd : publishers) {
+            int64_t now = NowNanos();
+            std::memcpy(frame.data() + kRelayFrameHeaderSize, &now, sizeof(now));
+            SendAll(fd, frame.data(), frame.size());
+            result.framesSent++;
+        }
+        tick += interval;
+        std::this_thread::sleep_until(tick);
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Let what's in flight arrive before counting
+    std::this_thread::sleep_for(kSettleTime);
+    stopping.store(true, std::memory_order_release);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (int fd : publishers) {
+        ::close(fd);
+    }
+    Histogram latency;
+    for (ReceiverState& state : receivers) {
+        for (Subscriber& subscriber : state.subscribers) {
+            ::close(subscriber.fd);
+        }
+        latency.Merge(state.latency);
+        result.framesReceived += state.framesReceived;
+    }
+
+    result.framesExpected = result.framesSent * options.subscribersPerChannel;
+    result.forwardedPerSecond = result.seconds > 0.0 ? static_cast<double>(result.framesReceived) / result.seconds : 0.0;
+    result.p50LatencyMs = latency.QuantileMs(0.50);
+    result.p99LatencyMs = latency.QuantileMs(0.99);
+    result.p999LatencyMs = latency.QuantileMs(0.999);
+    result.maxLatencyMs = static_cast<double>(latency.maxNanos) / 1e6;
+    return result;
+}
+#endif
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+
+struct RelayLoadOptions {
+    std::string address = "127.0.0.1";
+    uint16_t port = 12345;
+    size_t channels = 10;                   // One publisher each
+    size_t subscribersPerChannel = 20;
+    size_t payloadSize = 160;               // About a 20 ms Opus packet at 64 kbps
+    int packetIntervalUs = 20000;           // Per publisher
+    int seconds = 10;
+    size_t receiveThreads = 2;
+};
+
+struct RelayLoadResult {
+    uint64_t framesSent = 0;
+    uint64_t framesReceived = 0;            // Over all subscribers
+    uint64_t framesExpected = 0;            // framesSent times subscribers per channel
+    double seconds = 0.0;
+    double forwardedPerSecond = 0.0;
+    double p50LatencyMs = 0.0;              // Publisher send to subscriber receive
+    double p99LatencyMs = 0.0;
+    double p999LatencyMs = 0.0;
+    double maxLatencyMs = 0.0;
+};
+
+// Drives a relay server from this host: paced publishers stamp each frame
+// with the send time, subscribers on a few epoll threads measure how long
+// it took to come back. Blocks for the length of the run.
+//
+// Linux only.
+RelayLoadResult RunRelayLoad(const RelayLoadOptions& options);
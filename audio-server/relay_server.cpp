@@ -0,0 +1,98 @@
+#include "relay_server.h"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <time.h>
+#include <csignal>
+#include <stdexcept>
+#include <algorithm>
+#include <iostream>
+
+#include "relay_event_loop.h"
+
+
+RelayServer::RelayServer(RelayServerOptions options)
+    : options(options), backend(RelayBackend::Epoll) {
+}
+
+RelayServer::~RelayServer() {
+    Stop();
+}
+
+void RelayServer::Start() {
+    // Subscribers that hang up mid-send must not kill the process
+    std::signal(SIGPIPE, SIG_IGN);
+
+    size_t count = options.threads;
+    if (count == 0) count = std::max(1u, std::thread::hardware_concurrency());
+
+    registry.reset(new RelayChannelRegistry(count));
+    backend = options.backend;
+    for (size_t i = 0; i < count; i++) {
+        std::unique_ptr<RelayEventLoop> loop;
+        if (backend == RelayBackend::IoUring) {
+            loop = CreateUringEventLoop(i, options, *registry, loops);
+            // All loops run on the same backend, so the first one decides
+            if (!loop && i == 0) backend = RelayBackend::Epoll;
+            else if (!loop) throw std::runtime_error("Failed to create io_uring event loop");
+        }
+        if (!loop) loop = CreateEpollEventLoop(i, options, *registry, loops);
+        loops.push_back(std::move(loop));
+        loops.back()->Listen();
+    }
+    for (auto& loop : loops) {
+        RelayEventLoop* raw = loop.get();
+        threads.emplace_back([raw]() {
+            try {
+                raw->Run();
+            }
+            catch (const std::exception& e) {
+                std::cerr << "Relay event loop failed: " << e.what() << std::endl;
+            }
+        });
+    }
+}
+
+void RelayServer::Stop() {
+    for (auto& loop : loops) {
+        loop->Stop();
+    }
+    for (auto& thread : threads) {
+        if (thread.joinable()) thread.join();
+    }
+    threads.clear();
+    // Frames in flight between loops reference channels and blocks, not
+    // loops or connections, so the loops can go in any order
+    loops.clear();
+    registry.reset();
+}
+
+RelayServerStats RelayServer::GetStats() const {
+    RelayServerStats total;
+    for (size_t i = 0; i < loops.size(); i++) {
+        RelayServerStats stats = loops[i]->GetStats();
+        total.connections += stats.connections;
+        total.framesReceived += stats.framesReceived;
+        total.bytesReceived += stats.bytesReceived;
+        total.framesForwarded += stats.framesForwarded;
+        total.bytesForwarded += stats.bytesForwarded;
+        total.framesDropped += stats.framesDropped;
+        total.protocolErrors += stats.protocolErrors;
+        total.syscalls += stats.syscalls;
+
+        // Read from outside the loop, which would otherwise pay a system call per pass for it
+        clockid_t clock;
+        timespec cpu;
+        if (i < threads.size() &&
+            pthread_getcpuclockid(const_cast<std::thread&>(threads[i]).native_handle(), &clock) == 0 &&
+            clock_gettime(clock, &cpu) == 0) {
+            total.cpuSeconds += static_cast<double>(cpu.tv_sec) + static_cast<double>(cpu.tv_nsec) / 1e9;
+        }
+    }
+    return total;
+}
+
+RelayBackend RelayServer::Backend() const {
+    return backend;
+}
+#endif
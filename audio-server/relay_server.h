@@ -0,0 +1,77 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+
+enum class RelayBackend {
+    Epoll,
+    IoUring                                 // Falls back to epoll where unavailable
+};
+
+struct RelayServerOptions {
+    uint16_t port = 12345;
+    size_t threads = 0;                     // Event loops, 0 for one per core
+    RelayBackend backend = RelayBackend::Epoll;
+    int listenBacklog = 1024;
+    size_t maxFrameSize = 1 << 20;          // Larger frames close the connection
+    size_t maxQueuedBytes = 1 << 20;        // Per subscriber, oldest unsent frames are dropped beyond this
+    size_t receiveBufferCount = 1024;       // io_uring provided buffers per loop
+    size_t receiveBufferSize = 16 * 1024;
+};
+
+struct RelayServerStats {
+    uint64_t connections = 0;               // Open now
+    uint64_t framesReceived = 0;            // From publishers
+    uint64_t bytesReceived = 0;
+    uint64_t framesForwarded = 0;           // One per subscriber a frame went out to
+    uint64_t bytesForwarded = 0;
+    uint64_t framesDropped = 0;             // Subscribers that couldn't keep up
+    uint64_t protocolErrors = 0;
+    uint64_t syscalls = 0;                  // Made by the event loops, io_uring_enter counted once
+    double cpuSeconds = 0.0;                // Event loop threads
+};
+
+class RelayEventLoop;
+class RelayChannelRegistry;
+
+// Selective forwarding relay: clients join a channel as publisher,
+// subscriber or both (relay_protocol.h), and every frame a publisher sends
+// goes to all other subscribers of its channel. Frames are never decoded.
+//
+// One event loop per thread, each with its own SO_REUSEPORT listening
+// socket and epoll instance, so the kernel spreads connections over the
+// loops and nothing is shared on the hot path. A loop receives into large
+// reference counted blocks; subscribers queue references to the frames in
+// them and send with writev, so a frame's bytes are never copied per
+// subscriber. Frames for subscribers on another loop are handed over
+// through that loop's inbox, one eventfd wakeup per batch.
+//
+// With RelayBackend::IoUring (built with MEDIA_PIPELINE_USE_IO_URING) the
+// loops receive through multishot recv into a provided buffer ring and
+// parse frames in place, and a subscriber's sends go out as one linked
+// chain, so a pass over the loop costs a single io_uring_enter.
+//
+// Linux only.
+class RelayServer {
+public:
+    explicit RelayServer(RelayServerOptions options = {});
+    ~RelayServer();
+
+    void Start();
+    void Stop();
+
+    RelayServerStats GetStats() const;
+    // What the loops run on after any fallback
+    RelayBackend Backend() const;
+
+private:
+    RelayServerOptions options;
+    std::unique_ptr<RelayChannelRegistry> registry;
+    std::vector<std::unique_ptr<RelayEventLoop>> loops;
+    std::vector<std::thread> threads;
+    RelayBackend backend;
+};
@@ -0,0 +1,592 @@
+#include "relay_event_loop.h"
+
+#if defined(__linux__) && defined(MEDIA_PIPELINE_USE_IO_URING)
+#include <liburing.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <algorithm>
+#include <deque>
+
+#include "media_pipeline/net/relay_protocol.h"
+
+using media_pipeline::net::kRelayFrameHeaderSize;
+
+namespace {
+    constexpr unsigned kRingEntries = 4096;
+    constexpr size_t kMaxSlices = 64;
+    constexpr size_t kMaxChain = 4;             // Linked sendmsg per subscriber in flight
+    // Frames in flight can't be dropped for newer ones, so a subscriber
+    // with a full socket only pins about a socket buffer's worth
+    constexpr size_t kMaxChainBytes = 256 * 1024;
+    constexpr size_t kMinPartialSize = 4096;
+    constexpr size_t kReceiveBudget = 256 * 1024;   // Per connection and pass, so one publisher can't starve the loop
+    constexpr int kBufferGroup = 0;
+    constexpr int kDrainTimeoutMs = 1000;
+
+    // user_data is the connection with the operation in the low bits, or
+    // one of the tags for the loop's own requests
+    constexpr uint64_t kOpReceive = 0;
+    constexpr uint64_t kOpSend = 1;
+    constexpr uint64_t kOpMask = 7;
+    constexpr uint64_t kAcceptTag = 8;
+    constexpr uint64_t kWakeTag = 16;
+
+    // Memory behind the provided buffer ring. Forwarded frames can outlive
+    // the loop (another loop may still be sending them at shutdown), so the
+    // memory and the list of buffers waiting to go back are shared with
+    // every block handed out.
+    struct ProvidedBuffers {
+        std::unique_ptr<uint8_t[]> memory;
+        size_t bufferSize = 0;
+        std::thread::id owner;
+        std::vector<uint16_t> returned;         // Owner thread only
+        std::mutex mutex;
+        std::vector<uint16_t> remoteReturned;   // From other loops
+        std::atomic<bool> starving{ false };    // Ring empty, the owner waits for returns
+        int wakeFd = -1;
+
+        void Return(uint16_t id) {
+            if (std::this_thread::get_id() == owner) {
+                returned.push_back(id);
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                remoteReturned.push_back(id);
+            }
+            if (starving.exchange(false)) {
+                uint64_t one = 1;
+                ssize_t written = ::write(wakeFd, &one, sizeof(one));
+                (void)written;
+            }
+        }
+    };
+
+    struct UringConnection : RelayConnection {
+        // Start of a frame that continued past the end of a buffer
+        std::shared_ptr<RelayBlock> partial;
+        size_t partialSize = 0;
+
+        // Buffers received past the budget, parsed in the next passes.
+        // They stay out of the ring meanwhile, so a publisher that sends
+        // faster than its subscribers drain runs the ring dry and ends up
+        // throttled by TCP, as with the epoll loop's read budget.
+        struct Received {
+            std::shared_ptr<RelayBlock> block;
+            size_t size;
+        };
+        std::deque<Received> backlog;
+        size_t budget = 0;
+        uint64_t budgetPass = 0;
+
+        bool receiving = false;                 // Multishot recv armed
+        bool needsReceive = false;              // Rearm at the end of the pass
+        int pendingOperations = 0;              // Completions still to come
+
+        // Linked sendmsg chain, the kernel reads these until completion
+        struct SendSlot {
+            msghdr message;
+            iovec slices[kMaxSlices];
+        };
+        SendSlot chain[kMaxChain];
+        size_t sendsInFlight = 0;
+        std::vector<RelayFrame> held;           // In flight when the connection closed
+    };
+
+    // Completion based: one multishot recv per connection picks buffers
+    // from the ring, frames are parsed and forwarded where they landed, and
+    // each subscriber's queue goes out as a chain of linked sendmsg. All
+    // requests of a pass are submitted with the next wait, one
+    // io_uring_enter per pass.
+    class UringEventLoop : public RelayEventLoop {
+    public:
+        UringEventLoop(size_t index, const RelayServerOptions& options, RelayChannelRegistry& registry,
+            std::vector<std::unique_ptr<RelayEventLoop>>& loops)
+            : RelayEventLoop(index, options, registry, loops)
+            , bufferRing(nullptr), bufferCount(1), availableBuffers(0), pass(0)
+            , buffers(std::make_shared<ProvidedBuffers>()) {
+            io_uring_params params = {};
+            params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN;
+            params.cq_entries = kRingEntries * 4;
+            int result = io_uring_queue_init_params(kRingEntries, &ring, &params);
+            if (result < 0) {
+                // Kernels before 5.19 know neither flag
+                params = {};
+                params.flags = IORING_SETUP_CQSIZE;
+                params.cq_entries = kRingEntries * 4;
+                result = io_uring_queue_init_params(kRingEntries, &ring, &params);
+            }
+            if (result < 0) throw std::runtime_error("Failed to create io_uring: " + std::string(std::strerror(-result)));
+
+            // Ring sizes are powers of two, buffer ids 16 bit
+            while (bufferCount < options.receiveBufferCount && bufferCount < 32768) bufferCount <<= 1;
+            buffers->bufferSize = options.receiveBufferSize;
+            buffers->memory.reset(new uint8_t[bufferCount * buffers->bufferSize]);
+            buffers->wakeFd = wakeFd;
+
+            bufferRing = io_uring_setup_buf_ring(&ring, bufferCount, kBufferGroup, 0, &result);
+            if (!bufferRing) {
+                io_uring_queue_exit(&ring);
+                throw std::runtime_error("Failed to register provided buffer ring: " + std::string(std::strerror(-result)));
+            }
+            for (unsigned i = 0; i < bufferCount; i++) {
+                io_uring_buf_ring_add(bufferRing, buffers->memory.get() + i * buffers->bufferSize,
+                    static_cast<unsigned>(buffers->bufferSize), static_cast<unsigned short>(i),
+                    io_uring_buf_ring_mask(bufferCount), static_cast<int>(i));
+            }
+            io_uring_buf_ring_advance(bufferRing, static_cast<int>(bufferCount));
+            availableBuffers = bufferCount;
+        }
+
+        ~UringEventLoop() override {
+            for (auto& entry : connections) {
+                if (entry.second->fd >= 0) ::close(entry.second->fd);
+            }
+            io_uring_free_buf_ring(&ring, bufferRing, bufferCount, kBufferGroup);
+            io_uring_queue_exit(&ring);
+        }
+
+        void Run() override {
+            buffers->owner = std::this_thread::get_id();
+            // A non-blocking file makes io_uring fail with EAGAIN instead of
+            // waiting for the next connection
+            int flags = fcntl(listenFd, F_GETFL);
+            fcntl(listenFd, F_SETFL, flags & ~O_NONBLOCK);
+            ArmAccept();
+            ArmWake();
+
+            while (!IsStopping()) {
+                stats.syscalls++;
+                // A backlog is work already at hand, don't wait for more
+                int result = io_uring_submit_and_wait(&ring, backlogged.empty() ? 1 : 0);
+                if (result < 0 && result != -EINTR && result != -EAGAIN && result != -EBUSY) {
+                    throw std::runtime_error("io_uring_submit_and_wait failed: " + std::string(std::strerror(-result)));
+                }
+                pass++;
+                ConsumeBacklog();
+                ProcessCompletions();
+
+                PostOutgoing();
+                FlushPending();
+                RecycleBuffers();
+                ArmReceives();
+                ReleaseClosed();
+                PublishStats(connections.size() - closing.size());
+            }
+            Drain();
+            buffers->starving.store(false);
+        }
+
+    protected:
+        void Flush(RelayConnection* connection) override {
+            UringConnection* uringConnection = static_cast<UringConnection*>(connection);
+            // The completion of the chain in flight flushes the rest
+            if (uringConnection->sendsInFlight == 0) Send(uringConnection);
+        }
+
+        void Close(RelayConnection* connection) override {
+            if (connection->closed) return;
+            connection->closed = true;
+            UringConnection* uringConnection = static_cast<UringConnection*>(connection);
+            // Completes the outstanding recv and sends; the descriptor is
+            // closed once the last of them is back
+            stats.syscalls++;
+            ::shutdown(connection->fd, SHUT_RDWR);
+
+            // The kernel may still be reading the frames in flight
+            for (size_t i = 0; i < connection->sendingFrames && i < connection->queue.size(); i++) {
+                uringConnection->held.push_back(connection->queue[i]);
+            }
+            Detach(connection);
+            uringConnection->partial.reset();
+            uringConnection->backlog.clear();
+            closing.push_back(uringConnection);
+        }
+
+    private:
+        io_uring_sqe* GetSqe() {
+            io_uring_sqe* sqe = io_uring_get_sqe(&ring);
+            while (!sqe) {
+                // Submission queue full mid pass
+                stats.syscalls++;
+                io_uring_submit(&ring);
+                sqe = io_uring_get_sqe(&ring);
+            }
+            return sqe;
+        }
+
+        void ArmAccept() {
+            io_uring_sqe* sqe = GetSqe();
+            io_uring_prep_multishot_accept(sqe, listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+            io_uring_sqe_set_data64(sqe, kAcceptTag);
+        }
+
+        void ArmWake() {
+            io_uring_sqe* sqe = GetSqe();
+            io_uring_prep_poll_multishot(sqe, wakeFd, POLLIN);
+            io_uring_sqe_set_data64(sqe, kWakeTag);
+        }
+
+        void ArmReceive(UringConnection* connection) {
+            io_uring_sqe* sqe = GetSqe();
+            io_uring_prep_recv_multishot(sqe, connection->fd, nullptr, 0, 0);
+            sqe->flags |= IOSQE_BUFFER_SELECT;
+            sqe->buf_group = kBufferGroup;
+            io_uring_sqe_set_data64(sqe, reinterpret_cast<uint64_t>(connection) | kOpReceive);
+            connection->receiving = true;
+            connection->needsReceive = false;
+            connection->pendingOperations++;
+        }
+
+        void ProcessCompletions() {
+            unsigned head;
+            unsigned seen = 0;
+            io_uring_cqe* cqe;
+            io_uring_for_each_cqe(&ring, head, cqe) {
+                seen++;
+                uint64_t data = io_uring_cqe_get_data64(cqe);
+                if (data == kAcceptTag) {
+                    OnAccept(cqe);
+                }
+                else if (data == kWakeTag) {
+                    uint64_t value;
+                    stats.syscalls++;
+                    ssize_t drained = ::read(wakeFd, &value, sizeof(value));
+                    (void)drained;
+                    if (!(cqe->flags & IORING_CQE_F_MORE) && !IsStopping()) ArmWake();
+                    DrainInbox();
+                }
+                else {
+                    UringConnection* connection = reinterpret_cast<UringConnection*>(data & ~kOpMask);
+                    if ((data & kOpMask) == kOpSend) OnSent(connection, cqe->res);
+                    else OnReceived(connection, cqe);
+                }
+            }
+            io_uring_cq_advance(&ring, seen);
+        }
+
+        void OnAccept(io_uring_cqe* cqe) {
+            if (cqe->res >= 0) {
+                int fd = cqe->res;
+                int enable = 1;
+                stats.syscalls++;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+                std::unique_ptr<UringConnection> connection(new UringConnection());
+                connection->fd = fd;
+                ArmReceive(connection.get());
+                UringConnection* key = connection.get();
+                connections.emplace(key, std::move(connection));
+            }
+            // Out of descriptors or any other error ends the multishot
+            if (!(cqe->flags & IORING_CQE_F_MORE) && !IsStopping()) ArmAccept();
+        }
+
+        void OnReceived(UringConnection* connection, io_uring_cqe* cqe) {
+            if (!(cqe->flags & IORING_CQE_F_MORE)) {
+                connection->receiving = false;
+                connection->pendingOperations--;
+            }
+
+            if (cqe->flags & IORING_CQE_F_BUFFER) {
+                uint16_t id = static_cast<uint16_t>(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+                availableBuffers--;
+                std::shared_ptr<RelayBlock> block = TakeBuffer(id);
+                if (cqe->res > 0 && !connection->closed) Receive(connection, block, static_cast<size_t>(cqe->res));
+                // The buffer goes back now unless a subscriber or the backlog still needs it
+            }
+
+            if (connection->closed) return;
+            if (cqe->res == -ENOBUFS || (cqe->res > 0 && !connection->receiving)) {
+                // Ring ran dry, or the multishot ended for another reason
+                if (!connection->receiving && !connection->needsReceive) {
+                    connection->needsReceive = true;
+                    rearm.push_back(connection);
+                }
+            }
+            else if (cqe->res <= 0) {
+                Close(connection);
+            }
+        }
+
+        std::shared_ptr<RelayBlock> TakeBuffer(uint16_t id) {
+            std::shared_ptr<ProvidedBuffers> owner = buffers;
+            std::shared_ptr<RelayBlock> block(new RelayBlock(), [owner, id](RelayBlock* released) {
+                owner->Return(id);
+                delete released;
+            });
+            block->data = buffers->memory.get() + static_cast<size_t>(id) * buffers->bufferSize;
+            block->capacity = buffers->bufferSize;
+            return block;
+        }
+
+        void Receive(UringConnection* connection, std::shared_ptr<RelayBlock> block, size_t size) {
+            if (connection->budgetPass != pass) {
+                connection->budgetPass = pass;
+                connection->budget = kReceiveBudget;
+            }
+            if (!connection->backlog.empty() || connection->budget == 0) {
+                if (connection->backlog.empty()) backlogged.push_back(connection);
+                connection->backlog.push_back(UringConnection::Received{ std::move(block), size });
+                return;
+            }
+            connection->budget -= std::min(connection->budget, size);
+            Consume(connection, block, size);
+        }
+
+        void ConsumeBacklog() {
+            size_t kept = 0;
+            for (UringConnection* connection : backlogged) {
+                connection->budgetPass = pass;
+                connection->budget = kReceiveBudget;
+                while (!connection->closed && !connection->backlog.empty() && connection->budget > 0) {
+                    UringConnection::Received received = std::move(connection->backlog.front());
+                    connection->backlog.pop_front();
+                    connection->budget -= std::min(connection->budget, received.size);
+                    Consume(connection, received.block, received.size);
+                }
+                if (!connection->closed && !connection->backlog.empty()) backlogged[kept++] = connection;
+            }
+            backlogged.resize(kept);
+        }
+
+        // Frames that lie entirely in the buffer are forwarded from it; one
+        // cut off at the end is copied out and completed from the next
+        void Consume(UringConnection* connection, const std::shared_ptr<RelayBlock>& block, size_t size) {
+            const uint8_t* data = block->data;
+            size_t offset = 0;
+
+            while (connection->partialSize > 0) {
+                size_t target = kRelayFrameHeaderSize;
+                if (connection->partialSize >= kRelayFrameHeaderSize) {
+                    target += media_pipeline::net::ReadRelayU32(connection->partial->data);
+                }
+                if (connection->partialSize < target) {
+                    if (offset == size) return;
+                    size_t take = std::min(target - connection->partialSize, size - offset);
+                    std::memcpy(connection->partial->data + connection->partialSize, data + offset, take);
+                    connection->partialSize += take;
+                    offset += take;
+                    if (target == kRelayFrameHeaderSize && connection->partialSize == kRelayFrameHeaderSize) {
+                        size_t payloadSize = media_pipeline::net::ReadRelayU32(connection->partial->data);
+                        if (IsFrameTooLarge(connection, payloadSize)) return;
+                        ReservePartial(connection, kRelayFrameHeaderSize + payloadSize);
+                    }
+                    continue;
+                }
+
+                size_t frameSize = connection->partialSize;
+                connection->partialSize = 0;
+                ParseFrames(connection, connection->partial, connection->partial->data, frameSize);
+                if (connection->closed) return;
+                // Forwarded frames keep the block, the next partial frame starts a new one
+                if (connection->partial.use_count() > 1) connection->partial.reset();
+            }
+
+            offset += ParseFrames(connection, block, data + offset, size - offset);
+            if (connection->closed || offset == size) return;
+
+            size_t tail = size - offset;
+            size_t frameSize = kRelayFrameHeaderSize;
+            if (tail >= kRelayFrameHeaderSize) frameSize += media_pipeline::net::ReadRelayU32(data + offset);
+            ReservePartial(connection, std::max(tail, frameSize));
+            std::memcpy(connection->partial->data, data + offset, tail);
+            connection->partialSize = tail;
+        }
+
+        void ReservePartial(UringConnection* connection, size_t size) {
+            if (connection->partial && connection->partial->capacity >= size) return;
+            std::shared_ptr<RelayBlock> block = RelayBlock::Allocate(std::max(size, kMinPartialSize));
+            if (connection->partialSize > 0) std::memcpy(block->data, connection->partial->data, connection->partialSize);
+            connection->partial = std::move(block);
+        }
+
+        void Send(UringConnection* connection) {
+            size_t frame = 0;
+            size_t skip = connection->frontOffset;
+            size_t bytes = 0;
+            size_t links = 0;
+            while (links < kMaxChain && frame < connection->queue.size() && bytes < kMaxChainBytes) {
+                UringConnection::SendSlot& slot = connection->chain[links];
+                size_t sliceCount = 0;
+                while (sliceCount < kMaxSlices && frame < connection->queue.size() && bytes < kMaxChainBytes) {
+                    const RelayFrame& queued = connection->queue[frame++];
+                    slot.slices[sliceCount].iov_base = const_cast<uint8_t*>(queued.data + skip);
+                    slot.slices[sliceCount].iov_len = queued.size - skip;
+                    bytes += queued.size - skip;
+                    sliceCount++;
+                    skip = 0;
+                }
+                slot.message = {};
+                slot.message.msg_iov = slot.slices;
+                slot.message.msg_iovlen = sliceCount;
+                links++;
+            }
+            if (links == 0) return;
+
+            // Without MSG_WAITALL a send completes as soon as the socket took
+            // anything and the next link goes out behind the gap, splitting
+            // frames. With it the kernel keeps sending the remainder (5.18
+            // and later) or fails the request, and a failed link cancels the
+            // rest of the chain. Either way the stream stays in order and
+            // completions arrive in chain order; what's left goes out with
+            // the next chain.
+            for (size_t i = 0; i < links; i++) {
+                io_uring_sqe* sqe = GetSqe();
+                io_uring_prep_sendmsg(sqe, connection->fd, &connection->chain[i].message, MSG_NOSIGNAL | MSG_WAITALL);
+                if (i + 1 < links) sqe->flags |= IOSQE_IO_LINK;
+                io_uring_sqe_set_data64(sqe, reinterpret_cast<uint64_t>(connection) | kOpSend);
+            }
+            connection->sendingFrames = frame;
+            connection->sendsInFlight = links;
+            connection->pendingOperations += static_cast<int>(links);
+        }
+
+        void OnSent(UringConnection* connection, int result) {
+            connection->sendsInFlight--;
+            connection->pendingOperations--;
+            if (connection->closed) {
+                if (connection->sendsInFlight == 0) connection->held.clear();
+                return;
+            }
+
+            if (result > 0) {
+                size_t remaining = static_cast<size_t>(result);
+                while (remaining > 0) {
+                    RelayFrame& front = connection->queue.front();
+                    size_t left = front.size - connection->frontOffset;
+                    if (remaining < left) {
+                        connection->frontOffset += remaining;
+                        break;
+                    }
+                    remaining -= left;
+                    stats.framesForwarded++;
+                    stats.bytesForwarded += front.size;
+                    connection->queuedBytes -= front.size;
+                    connection->queue.pop_front();
+                    connection->frontOffset = 0;
+                    connection->sendingFrames--;
+                }
+            }
+            else if (result != -ECANCELED) {
+                Close(connection);
+                return;
+            }
+
+            if (connection->sendsInFlight == 0) {
+                connection->sendingFrames = 0;
+                if (!connection->queue.empty()) Send(connection);
+            }
+        }
+
+        void RecycleBuffers() {
+            {
+                std::lock_guard<std::mutex> lock(buffers->mutex);
+                buffers->returned.insert(buffers->returned.end(),
+                    buffers->remoteReturned.begin(), buffers->remoteReturned.end());
+                buffers->remoteReturned.clear();
+            }
+            std::vector<uint16_t>& returned = buffers->returned;
+            if (returned.empty()) return;
+            for (size_t i = 0; i < returned.size(); i++) {
+                uint16_t id = returned[i];
+                io_uring_buf_ring_add(bufferRing, buffers->memory.get() + static_cast<size_t>(id) * buffers->bufferSize,
+                    static_cast<unsigned>(buffers->bufferSize), id, io_uring_buf_ring_mask(bufferCount), static_cast<int>(i));
+            }
+            io_uring_buf_ring_advance(bufferRing, static_cast<int>(returned.size()));
+            availableBuffers += returned.size();
+            returned.clear();
+        }
+
+        void ArmReceives() {
+            if (rearm.empty()) return;
+            if (availableBuffers == 0) {
+                // Everything is queued at subscribers; whoever returns the
+                // next buffer from another loop wakes this one
+                buffers->starving.store(true);
+                return;
+            }
+            size_t kept = 0;
+            for (UringConnection* connection : rearm) {
+                // Not before the backlog is through
+                if (!connection->closed && !connection->backlog.empty()) {
+                    rearm[kept++] = connection;
+                    continue;
+                }
+                if (!connection->closed && !connection->receiving) ArmReceive(connection);
+                connection->needsReceive = false;
+            }
+            rearm.resize(kept);
+        }
+
+        void ReleaseClosed() {
+            size_t kept = 0;
+            for (UringConnection* connection : closing) {
+                if (connection->pendingOperations > 0) {
+                    closing[kept++] = connection;
+                    continue;
+                }
+                rearm.erase(std::remove(rearm.begin(), rearm.end(), connection), rearm.end());
+                backlogged.erase(std::remove(backlogged.begin(), backlogged.end(), connection), backlogged.end());
+                stats.syscalls++;
+                ::close(connection->fd);
+                connection->fd = -1;
+                connections.erase(connection);
+            }
+            closing.resize(kept);
+        }
+
+        // Shuts every connection down and waits for their requests, so no
+        // send is still reading a frame when the queues go away
+        void Drain() {
+            for (auto& entry : connections) {
+                Close(entry.second.get());
+            }
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(kDrainTimeoutMs);
+            while (!closing.empty() && std::chrono::steady_clock::now() < deadline) {
+                __kernel_timespec timeout = { 0, 10 * 1000 * 1000 };
+                io_uring_cqe* cqe;
+                io_uring_submit_and_wait_timeout(&ring, &cqe, 1, &timeout, nullptr);
+                ProcessCompletions();
+                ReleaseClosed();
+            }
+        }
+
+        io_uring ring;
+        io_uring_buf_ring* bufferRing;
+        unsigned bufferCount;
+        size_t availableBuffers;
+        uint64_t pass;
+        std::shared_ptr<ProvidedBuffers> buffers;
+
+        std::unordered_map<RelayConnection*, std::unique_ptr<UringConnection>> connections;
+        std::vector<UringConnection*> rearm;
+        std::vector<UringConnection*> backlogged;
+        std::vector<UringConnection*> closing;
+    };
+}
+
+std::unique_ptr<RelayEventLoop> CreateUringEventLoop(size_t index, const RelayServerOptions& options,
+    RelayChannelRegistry& registry, std::vector<std::unique_ptr<RelayEventLoop>>& loops) {
+    try {
+        return std::unique_ptr<RelayEventLoop>(new UringEventLoop(index, options, registry, loops));
+    }
+    catch (const std::runtime_error&) {
+        return nullptr;
+    }
+}
+#elif defined(__linux__)
+std::unique_ptr<RelayEventLoop> CreateUringEventLoop(size_t, const RelayServerOptions&,
+    RelayChannelRegistry&, std::vector<std::unique_ptr<RelayEventLoop>>&) {
+    return nullptr;
+}
+#endif
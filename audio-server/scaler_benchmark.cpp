@@ -0,0 +1,99 @@
+#include "scaler_benchmark.h"
+
+#include <chrono>
+#include <random>
+#include <utility>
+
+#include "media_pipeline/processors/video/scaler_kernels.h"
+
+namespace kernels = media_pipeline::processors::video::kernels;
+using kernels::Isa;
+using kernels::ScaleFilter;
+using kernels::ScaleMode;
+
+namespace {
+    constexpr uint8_t kFlatValue = 137;
+
+    const std::pair<ScaleMode, const char*> kModes[] = {
+        { ScaleMode::Box, "box" },
+        { ScaleMode::Bilinear, "bilinear" },
+        { ScaleMode::Bicubic, "bicubic" },
+    };
+
+    // Sources are allocated exactly, without row padding, so a read past
+    // the last row is a read past the buffer
+    void Scale(const std::vector<uint8_t>& src, int srcWidth, int srcHeight,
+        std::vector<uint8_t>& dst, int dstWidth, int dstHeight, ScaleMode mode, Isa isa) {
+        ScaleFilter horizontal = kernels::BuildScaleFilter(srcWidth, dstWidth, mode);
+        ScaleFilter vertical = kernels::BuildScaleFilter(srcHeight, dstHeight, mode);
+        dst.assign(static_cast<size_t>(dstWidth) * dstHeight, 0);
+        kernels::ScalePlaneRows(src.data(), srcWidth, srcWidth, dst.data(), dstWidth, dstWidth,
+            horizontal, vertical, 0, dstHeight, isa);
+    }
+
+    size_t Mismatches(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b) {
+        size_t count = 0;
+        for (size_t i = 0; i < a.size(); i++) count += a[i] != b[i];
+        return count;
+    }
+}
+
+ScalerBenchmarkResult RunScalerBenchmark(const ScalerBenchmarkOptions& options) {
+    ScalerBenchmarkResult result;
+    Isa isa = kernels::SelectIsa();
+
+    std::mt19937 random(1);
+    std::vector<uint8_t> src(static_cast<size_t>(options.srcWidth) * options.srcHeight);
+    for (uint8_t& value : src) value = static_cast<uint8_t>(random());
+    std::vector<uint8_t> scalarOut;
+    std::vector<uint8_t> simdOut;
+
+    for (const auto& mode : kModes) {
+        ScalerBenchmarkRow row;
+        row.mode = mode.second;
+        for (Isa with : { Isa::Scalar, isa }) {
+            std::vector<uint8_t>& out = with == Isa::Scalar ? scalarOut : simdOut;
+            Scale(src, options.srcWidth, options.srcHeight, out, options.dstWidth, options.dstHeight, mode.first, with);
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < options.iterations; i++) {
+                Scale(src, options.srcWidth, options.srcHeight, out, options.dstWidth, options.dstHeight, mode.first, with);
+            }
+            double micros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() /
+                static_cast<double>(options.iterations);
+            (with == Isa::Scalar ? row.scalarMicros : row.simdMicros) = micros;
+        }
+        row.mismatchedBytes = Mismatches(scalarOut, simdOut);
+        result.rows.push_back(row);
+    }
+
+    // 1 and 2 are the degenerate sizes, 7 and 9 straddle the 8 byte SIMD
+    // loads, 33 leaves a scalar tail after the 16 pixel AVX2 loop
+    const int sizes[] = { 1, 2, 3, 7, 9, 16, 33 };
+    std::vector<uint8_t> flat;
+    std::vector<uint8_t> noise;
+    for (int srcWidth : sizes) {
+        for (int srcHeight : sizes) {
+            size_t srcSize = static_cast<size_t>(srcWidth) * srcHeight;
+            flat.assign(srcSize, kFlatValue);
+            noise.resize(srcSize);
+            for (uint8_t& value : noise) value = static_cast<uint8_t>(random());
+            for (int dstWidth : sizes) {
+                for (int dstHeight : sizes) {
+                    for (const auto& mode : kModes) {
+                        bool failed = false;
+                        for (Isa with : { Isa::Scalar, isa }) {
+                            Scale(flat, srcWidth, srcHeight, simdOut, dstWidth, dstHeight, mode.first, with);
+                            for (uint8_t value : simdOut) failed = failed || value != kFlatValue;
+                        }
+                        Scale(noise, srcWidth, srcHeight, scalarOut, dstWidth, dstHeight, mode.first, Isa::Scalar);
+                        Scale(noise, srcWidth, srcHeight, simdOut, dstWidth, dstHeight, mode.first, isa);
+                        failed = failed || Mismatches(scalarOut, simdOut) > 0;
+                        result.edgeCases++;
+                        result.edgeFailures += failed;
+                    }
+                }
+            }
+        }
+    }
+    return result;
+}
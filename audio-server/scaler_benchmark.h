@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+
+struct ScalerBenchmarkOptions {
+    int srcWidth = 1920;
+    int srcHeight = 1080;
+    int dstWidth = 1280;
+    int dstHeight = 720;
+    size_t iterations = 100;
+};
+
+struct ScalerBenchmarkRow {
+    std::string mode;                       // Box, bilinear or bicubic
+    double scalarMicros = 0.0;              // Per luma plane
+    double simdMicros = 0.0;
+    size_t mismatchedBytes = 0;             // SIMD output differing from scalar
+};
+
+struct ScalerBenchmarkResult {
+    std::vector<ScalerBenchmarkRow> rows;
+    size_t edgeCases = 0;                   // Size pairs checked, 1xN sources included
+    size_t edgeFailures = 0;                // Must stay 0
+};
+
+// Times one plane scaled with each filter, scalar against the best SIMD
+// kernels, then runs every filter over a sweep of small and degenerate
+// sizes (one pixel wide or high sources up- and downscaled). A flat source
+// must come out flat and SIMD must match scalar; reads past a row show up
+// as either, or under AddressSanitizer.
+ScalerBenchmarkResult RunScalerBenchmark(const ScalerBenchmarkOptions& options);
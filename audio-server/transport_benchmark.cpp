@@ -0,0 +1,403 @@
+#include "transport_benchmark.h"
+
+#ifdef __linux__
+#include <sched.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <linux/if_tun.h>
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "media_pipeline/core/media_data.h"
+#include "media_pipeline/net/socket.h"
+#include "media_pipeline/net/wire_protocol.h"
+#include "media_pipeline/sinks/audio/rtp_opus_sink.h"
+#include "media_pipeline/sinks/general/network_sink.h"
+#include "media_pipeline/sources/audio/rtp_opus_source.h"
+
+using media_pipeline::core::AudioFormat;
+using media_pipeline::core::MediaData;
+using media_pipeline::net::Socket;
+using media_pipeline::sinks::audio::RtpOpusSink;
+using media_pipeline::sinks::audio::RtpOpusSinkOptions;
+using media_pipeline::sinks::general::NetworkSink;
+using media_pipeline::sinks::general::NetworkSinkOptions;
+using media_pipeline::sources::audio::RtpOpusSource;
+using media_pipeline::sources::audio::RtpOpusSourceOptions;
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    constexpr const char* kSenderAddress = "10.201.0.1";
+    constexpr const char* kReceiverAddress = "10.201.0.2";
+    constexpr uint16_t kRtpPort = 5004;
+    constexpr uint16_t kTcpPort = 12345;
+    constexpr size_t kMaxIpPacket = 65536;
+    // Longest a run waits for stragglers after its last packet
+    constexpr auto kDrainTimeout = std::chrono::seconds(3);
+
+    // Opus TOC byte for one 20 ms CELT fullband frame, so the receiver
+    // takes the payload for a real packet; the index and send time follow
+    constexpr uint8_t kOpusToc = 0xF8;
+    constexpr size_t kStampSize = 1 + 4 + 8;
+    constexpr uint32_t kOpusFrames = 960;
+
+    void ThrowErrno(const std::string& what) {
+        throw std::runtime_error(what + ": " + std::strerror(errno));
+    }
+
+    int64_t NowNanos() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+    }
+
+    int OpenTun(const char* name) {
+        int fd = open("/dev/net/tun", O_RDWR | O_NONBLOCK | O_CLOEXEC);
+        if (fd < 0) ThrowErrno("Failed to open /dev/net/tun");
+        ifreq request = {};
+        request.ifr_flags = IFF_TUN | IFF_NO_PI;
+        std::strncpy(request.ifr_name, name, IFNAMSIZ - 1);
+        if (ioctl(fd, TUNSETIFF, &request) < 0) {
+            close(fd);
+            ThrowErrno(std::string("Failed to create TUN device ") + name);
+        }
+        return fd;
+    }
+
+    // Point to point address, which also routes the peer through the device
+    void ConfigureTun(const char* name, const char* local, const char* peer) {
+        int control = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        if (control < 0) ThrowErrno("Failed to open a control socket");
+        ifreq request = {};
+        std::strncpy(request.ifr_name, name, IFNAMSIZ - 1);
+        sockaddr_in* address = reinterpret_cast<sockaddr_in*>(&request.ifr_addr);
+        address->sin_family = AF_INET;
+
+        bool ok = inet_pton(AF_INET, local, &address->sin_addr) == 1 && ioctl(control, SIOCSIFADDR, &request) == 0;
+        ok = ok && inet_pton(AF_INET, peer, &address->sin_addr) == 1 && ioctl(control, SIOCSIFDSTADDR, &request) == 0;
+        request.ifr_flags = IFF_UP | IFF_RUNNING;
+        ok = ok && ioctl(control, SIOCSIFFLAGS, &request) == 0;
+        int error = errno;
+        close(control);
+        if (!ok) {
+            errno = error;
+            ThrowErrno(std::string("Failed to configure ") + name);
+        }
+    }
+
+    // Two TUN devices, the receiver's in a network namespace of its own,
+    // joined by a thread that delays both directions and drops packets
+    // from the sender at random
+    class ImpairedLink {
+    public:
+        explicit ImpairedLink(const TransportBenchmarkOptions& options)
+            : delay(std::chrono::milliseconds(options.delayMs))
+            , lossRate(std::clamp(options.lossPercent / 100.0, 0.0, 1.0))
+            , seed(options.seed)
+            , random(options.seed)
+            , dropped(0)
+            , running(true) {
+            rootNamespace = open("/proc/thread-self/ns/net", O_RDONLY | O_CLOEXEC);
+            if (rootNamespace < 0) ThrowErrno("Failed to open the network namespace");
+            try {
+                senderTun = OpenTun("mpbench0");
+                ConfigureTun("mpbench0", kSenderAddress, kReceiverAddress);
+
+                // Only this thread moves, and it moves back below
+                if (unshare(CLONE_NEWNET) != 0) ThrowErrno("Failed to create a network namespace");
+                peerNamespace = open("/proc/thread-self/ns/net", O_RDONLY | O_CLOEXEC);
+                receiverTun = OpenTun("mpbench1");
+                ConfigureTun("mpbench1", kReceiverAddress, kSenderAddress);
+                if (setns(rootNamespace, CLONE_NEWNET) != 0) ThrowErrno("Failed to return to the network namespace");
+            }
+            catch (...) {
+                Close();
+                throw;
+            }
+            forwarder = std::thread(&ImpairedLink::Forward, this);
+        }
+
+        ~ImpairedLink() {
+            running = false;
+            if (forwarder.joinable()) forwarder.join();
+            Close();
+        }
+
+        // Sockets keep the namespace they were created in, so receivers
+        // are set up here and used from any thread afterwards
+        template <typename Setup>
+        void InReceiverNamespace(Setup setup) {
+            if (setns(peerNamespace, CLONE_NEWNET) != 0) ThrowErrno("Failed to enter the receiver namespace");
+            try {
+                setup();
+            }
+            catch (...) {
+                setns(rootNamespace, CLONE_NEWNET);
+                throw;
+            }
+            if (setns(rootNamespace, CLONE_NEWNET) != 0) ThrowErrno("Failed to return to the network namespace");
+        }
+
+        // Every run sees the same sequence of drop decisions
+        void Reset() {
+            std::lock_guard<std::mutex> lock(randomMutex);
+            random.seed(seed);
+            dropped = 0;
+        }
+
+        uint64_t Dropped() const { return dropped.load(); }
+
+    private:
+        struct Delayed {
+            Clock::time_point release;
+            std::vector<uint8_t> packet;
+        };
+
+        void Close() {
+            for (int* fd : { &senderTun, &receiverTun, &peerNamespace, &rootNamespace }) {
+                if (*fd >= 0) close(*fd);
+                *fd = -1;
+            }
+        }
+
+        void ReadAll(int from, std::deque<Delayed>& to, bool lossy, std::vector<uint8_t>& buffer) {
+            while (true) {
+                ssize_t size = read(from, buffer.data(), buffer.size());
+                if (size <= 0) return;
+                if (lossy) {
+                    std::lock_guard<std::mutex> lock(randomMutex);
+                    if (std::bernoulli_distribution(lossRate)(random)) {
+                        dropped++;
+                        continue;
+                    }
+                }
+                to.push_back(Delayed{ Clock::now() + delay, std::vector<uint8_t>(buffer.begin(), buffer.begin() + size) });
+            }
+        }
+
+        // The delay is the same for every packet, so each queue is in
+        // release order
+        static void ReleaseDue(std::deque<Delayed>& queue, int to, Clock::time_point now) {
+            while (!queue.empty() && queue.front().release <= now) {
+                ssize_t written = write(to, queue.front().packet.data(), queue.front().packet.size());
+                (void)written;  // A full device drops, as a full link would
+                queue.pop_front();
+            }
+        }
+
+        void Forward() {
+            std::vector<uint8_t> buffer(kMaxIpPacket);
+            std::deque<Delayed> toReceiver;
+            std::deque<Delayed> toSender;
+            pollfd fds[2] = { { senderTun, POLLIN, 0 }, { receiverTun, POLLIN, 0 } };
+            while (running) {
+                Clock::time_point now = Clock::now();
+                Clock::duration wait = std::chrono::milliseconds(10);
+                for (const std::deque<Delayed>* queue : { &toReceiver, &toSender }) {
+                    if (!queue->empty()) wait = std::min(wait, std::max(Clock::duration::zero(), queue->front().release - now));
+                }
+                auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(wait).count();
+                timespec timeout{ static_cast<time_t>(nanos / 1000000000), static_cast<long>(nanos % 1000000000) };
+                ppoll(fds, 2, &timeout, nullptr);
+
+                ReadAll(senderTun, toReceiver, true, buffer);
+                ReadAll(receiverTun, toSender, false, buffer);
+                now = Clock::now();
+                ReleaseDue(toReceiver, receiverTun, now);
+                ReleaseDue(toSender, senderTun, now);
+            }
+        }
+
+        Clock::duration delay;
+        double lossRate;
+        uint32_t seed;
+        std::mutex randomMutex;
+        std::mt19937 random;
+        std::atomic<uint64_t> dropped;
+
+        int rootNamespace = -1;
+        int peerNamespace = -1;
+        int senderTun = -1;
+        int receiverTun = -1;
+        std::atomic<bool> running;
+        std::thread forwarder;
+    };
+
+    // Receiver side bookkeeping, touched by the receiving thread only
+    // until the run is over
+    struct LatencyLog {
+        explicit LatencyLog(size_t packets) : seen(packets, false) {}
+
+        // payload is the Opus packet the sender built
+        void Record(const uint8_t* payload, size_t size) {
+            if (size < kStampSize || payload[0] != kOpusToc) return;
+            uint32_t index;
+            int64_t sentAt;
+            std::memcpy(&index, payload + 1, sizeof(index));
+            std::memcpy(&sentAt, payload + 5, sizeof(sentAt));
+            if (index >= seen.size() || seen[index]) return;
+            seen[index] = true;
+            latencyMs.push_back(static_cast<double>(NowNanos() - sentAt) / 1e6);
+            received++;
+        }
+
+        std::vector<bool> seen;
+        std::vector<double> latencyMs;
+        std::atomic<size_t> received{ 0 };
+    };
+
+    MediaData MakePacket(const TransportBenchmarkOptions& options, uint32_t index) {
+        // OpusProcessor's layout: frame count, then the Opus packet
+        std::vector<uint8_t> data(sizeof(kOpusFrames) + std::max(options.payloadSize, kStampSize), 0);
+        uint8_t* payload = data.data() + sizeof(kOpusFrames);
+        int64_t sentAt = NowNanos();
+        std::memcpy(data.data(), &kOpusFrames, sizeof(kOpusFrames));
+        payload[0] = kOpusToc;
+        std::memcpy(payload + 1, &index, sizeof(index));
+        std::memcpy(payload + 5, &sentAt, sizeof(sentAt));
+
+        AudioFormat format = {};
+        format.sampleRate = 48000;
+        format.channels = 2;
+        format.format = AudioFormat::SampleFormat::OPUS;
+        MediaData packet = MediaData::createAudio(std::move(data), format);
+        packet.timestamp = static_cast<uint64_t>(index) * options.packetIntervalMs * 1000000ull;
+        return packet;
+    }
+
+    // Paces the packets into the sink, then waits for the receiver to
+    // catch up or give up
+    template <typename Sink>
+    void SendPackets(const TransportBenchmarkOptions& options, Sink& sink, const LatencyLog& log) {
+        Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < options.packets; i++) {
+            std::this_thread::sleep_until(start + std::chrono::milliseconds(options.packetIntervalMs) * i);
+            sink.ConsumeMediaData(MakePacket(options, static_cast<uint32_t>(i)));
+        }
+        Clock::time_point deadline = Clock::now() + kDrainTimeout;
+        while (log.received < options.packets && Clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    }
+
+    TransportBenchmarkRow Summarize(const char* transport, const TransportBenchmarkOptions& options,
+        LatencyLog& log, uint64_t linkDropped) {
+        TransportBenchmarkRow row;
+        row.transport = transport;
+        row.packetsSent = options.packets;
+        row.packetsReceived = log.received;
+        row.linkDropped = linkDropped;
+
+        std::vector<double>& latency = log.latencyMs;
+        if (latency.empty()) return row;
+        std::sort(latency.begin(), latency.end());
+        double sum = 0.0;
+        for (double value : latency) sum += value;
+        auto quantile = [&](double q) { return latency[static_cast<size_t>(q * (latency.size() - 1))]; };
+        row.meanLatencyMs = sum / latency.size();
+        row.p50LatencyMs = quantile(0.50);
+        row.p99LatencyMs = quantile(0.99);
+        row.maxLatencyMs = latency.back();
+        return row;
+    }
+
+    TransportBenchmarkRow RunRtp(const TransportBenchmarkOptions& options, ImpairedLink& link, bool recover) {
+        RtpOpusSourceOptions sourceOptions;
+        sourceOptions.address = kReceiverAddress;
+        sourceOptions.port = kRtpPort;
+        if (recover) {
+            // A NACK and its retransmission take one round trip, plus a
+            // packet interval to notice the gap
+            sourceOptions.feedback.maxRecoveryDelay = std::chrono::milliseconds(options.delayMs * 2 + options.packetIntervalMs * 2);
+        }
+        RtpOpusSource source(sourceOptions);
+        link.InReceiverNamespace([&] { source.Start(); });
+
+        RtpOpusSinkOptions sinkOptions;
+        sinkOptions.address = kReceiverAddress;
+        sinkOptions.port = kRtpPort;
+        RtpOpusSink sink(sinkOptions);
+        sink.Start();
+
+        link.Reset();
+        LatencyLog log(options.packets);
+        std::atomic<bool> receiving{ true };
+        std::thread receiver([&] {
+            while (receiving) {
+                MediaData data = source.GetMediaData();
+                if (data.data.size() > sizeof(uint32_t)) {
+                    log.Record(data.data.data() + sizeof(uint32_t), data.data.size() - sizeof(uint32_t));
+                }
+            }
+        });
+        SendPackets(options, sink, log);
+        receiving = false;
+        receiver.join();
+        uint64_t dropped = link.Dropped();
+        sink.Stop();
+        source.Stop();
+        return Summarize(recover ? "rtp+nack" : "rtp", options, log, dropped);
+    }
+
+    TransportBenchmarkRow RunTcp(const TransportBenchmarkOptions& options, ImpairedLink& link) {
+        Socket listener;
+        link.InReceiverNamespace([&] { listener = Socket::ListenTcp(kReceiverAddress, kTcpPort); });
+
+        NetworkSinkOptions sinkOptions;
+        sinkOptions.address = kReceiverAddress;
+        sinkOptions.port = kTcpPort;
+        NetworkSink sink(sinkOptions);
+
+        link.Reset();
+        LatencyLog log(options.packets);
+        std::thread receiver([&] {
+            // Parsed the way OpusPlaybackServer reads the stream
+            Socket connection = listener.Accept();
+            std::vector<uint8_t> buffer;
+            std::vector<uint8_t> chunk(64 * 1024);
+            while (true) {
+                ptrdiff_t size = connection.Receive(chunk.data(), chunk.size());
+                if (size <= 0) break;
+                buffer.insert(buffer.end(), chunk.begin(), chunk.begin() + size);
+
+                size_t offset = 0;
+                media_pipeline::net::WireFrame frame;
+                while (media_pipeline::net::ParseWireFrame(buffer.data() + offset, buffer.size() - offset, frame) ==
+                    media_pipeline::net::WireParseResult::Ok) {
+                    log.Record(frame.payload, frame.payloadSize);
+                    offset += frame.frameSize;
+                }
+                buffer.erase(buffer.begin(), buffer.begin() + offset);
+            }
+        });
+        sink.Start();
+        SendPackets(options, sink, log);
+        uint64_t dropped = link.Dropped();
+        sink.Stop();
+        receiver.join();
+        return Summarize("tcp", options, log, dropped);
+    }
+}
+
+std::vector<TransportBenchmarkRow> RunTransportBenchmark(const TransportBenchmarkOptions& options) {
+    ImpairedLink link(options);
+    std::vector<TransportBenchmarkRow> rows;
+    rows.push_back(RunRtp(options, link, false));
+    rows.push_back(RunRtp(options, link, true));
+    rows.push_back(RunTcp(options, link));
+    return rows;
+}
+#endif
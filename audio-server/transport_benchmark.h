@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+
+struct TransportBenchmarkOptions {
+    double lossPercent = 1.0;               // Sender to receiver only, feedback and ACKs get through
+    int delayMs = 20;                       // Each way
+    size_t packets = 1500;
+    int packetIntervalMs = 10;
+    size_t payloadSize = 160;               // About a 20 ms Opus packet at 64 kbps
+    uint32_t seed = 1;                      // Each run restarts the drop sequence from it
+};
+
+struct TransportBenchmarkRow {
+    const char* transport = "";
+    uint64_t packetsSent = 0;
+    uint64_t packetsReceived = 0;           // Each sequence number once
+    uint64_t linkDropped = 0;               // IP packets the link threw away, retransmissions included
+    double meanLatencyMs = 0.0;             // ConsumeMediaData to the receiver having the packet
+    double p50LatencyMs = 0.0;
+    double p99LatencyMs = 0.0;
+    double maxLatencyMs = 0.0;
+};
+
+// End-to-end audio latency over a lossy link, RTP against TCP. Paced
+// Opus-shaped packets go into RtpOpusSink and NetworkSink, and come out of
+// RtpOpusSource and a reader that parses the wire protocol as
+// OpusPlaybackServer does. Rows: RTP as RtpOpusSource is configured by
+// default (no waiting for retransmissions), RTP with NACK recovery, TCP.
+//
+// The link is a pair of TUN devices with the receiver in a network
+// namespace of its own; the benchmark moves IP packets between them,
+// delaying each direction and dropping the sender's packets at random,
+// the way netem would. Both transports run the kernel's own UDP and TCP,
+// so TCP's retransmissions and head-of-line blocking are real.
+//
+// Linux only, needs CAP_NET_ADMIN (root) for the devices and namespace.
+std::vector<TransportBenchmarkRow> RunTransportBenchmark(const TransportBenchmarkOptions& options);
@@ -0,0 +1,150 @@
+#include "udp_fanout_benchmark.h"
+
+#ifdef __linux__
+#include <time.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "media_pipeline/net/socket.h"
+#include "media_pipeline/net/udp_fanout.h"
+
+using media_pipeline::net::Datagram;
+using media_pipeline::net::IoSlice;
+using media_pipeline::net::Socket;
+using media_pipeline::net::SocketAddress;
+using media_pipeline::net::UdpFanout;
+using media_pipeline::net::UdpFanoutOptions;
+
+namespace {
+    constexpr int kSendBufferSize = 4 * 1024 * 1024;
+    constexpr size_t kBurstsPerClockCheck = 16;
+    // Small enough for a listener's default receive buffer
+    constexpr size_t kCheckPackets = 16;
+    constexpr auto kCheckTimeout = std::chrono::milliseconds(200);
+
+    double ThreadCpuSeconds() {
+        timespec cpu;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu);
+        return static_cast<double>(cpu.tv_sec) + static_cast<double>(cpu.tv_nsec) / 1e9;
+    }
+
+    // Packet i of the check burst is filled with byte i + 1; the last one
+    // is shorter, which ends a segmented run
+    size_t CheckPacketSize(const UdpFanoutBenchmarkOptions& options, size_t packet, size_t packets) {
+        return packets > 1 && packet == packets - 1 ? std::max<size_t>(options.packetSize / 2, 1) : options.packetSize;
+    }
+
+    // Sends one numbered burst through the same path as the benchmark and
+    // reads it back on every listener
+    void CheckDelivery(const UdpFanoutBenchmarkOptions& options, UdpFanoutMethod method, Socket& sender,
+        UdpFanout& fanout, std::vector<Socket>& listeners, const std::vector<SocketAddress>& destinations,
+        UdpFanoutBenchmarkResult& result) {
+        size_t packets = std::min(options.packetsPerBurst, kCheckPackets);
+        std::vector<uint8_t> payload(options.packetSize);
+        for (size_t packet = 0; packet < packets; packet++) {
+            size_t size = CheckPacketSize(options, packet, packets);
+            std::fill(payload.begin(), payload.begin() + size, static_cast<uint8_t>(packet + 1));
+            if (method == UdpFanoutMethod::SendTo) {
+                for (const SocketAddress& destination : destinations) {
+                    sender.SendTo(payload.data(), size, destination);
+                }
+            }
+            else {
+                IoSlice slice{ payload.data(), size };
+                fanout.Queue(&slice, 1);
+            }
+        }
+        if (method != UdpFanoutMethod::SendTo) fanout.Flush(sender);
+
+        // One byte more than sent, so a datagram that kept the whole GSO
+        // payload shows up as too long rather than truncated to fit
+        std::vector<uint8_t> buffer((options.packetSize + 1) * packets);
+        std::vector<Datagram> datagrams(packets);
+        for (Socket& listener : listeners) {
+            size_t received = 0;
+            auto deadline = std::chrono::steady_clock::now() + kCheckTimeout;
+            while (received < packets && std::chrono::steady_clock::now() < deadline) {
+                for (size_t i = received; i < packets; i++) {
+                    datagrams[i].data = buffer.data() + i * (options.packetSize + 1);
+                    datagrams[i].capacity = options.packetSize + 1;
+                }
+                received += listener.ReceiveBatch(datagrams.data() + received, packets - received);
+            }
+
+            result.checkedDatagrams += packets;
+            result.wrongDatagrams += packets - received;
+            for (size_t packet = 0; packet < received; packet++) {
+                const Datagram& datagram = datagrams[packet];
+                bool matches = datagram.size == CheckPacketSize(options, packet, packets) &&
+                    std::all_of(datagram.data, datagram.data + datagram.size,
+                        [&](uint8_t byte) { return byte == static_cast<uint8_t>(packet + 1); });
+                if (!matches) result.wrongDatagrams++;
+            }
+        }
+    }
+}
+
+UdpFanoutBenchmarkResult RunUdpFanoutBenchmark(const UdpFanoutBenchmarkOptions& options, UdpFanoutMethod method) {
+    std::vector<Socket> listeners;
+    std::vector<SocketAddress> destinations;
+    for (size_t i = 0; i < options.listeners; i++) {
+        listeners.push_back(Socket::OpenUdp("127.0.0.1", 0));
+        destinations.push_back(media_pipeline::net::ResolveSocketAddress("127.0.0.1", listeners.back().LocalPort()));
+    }
+
+    Socket sender = Socket::OpenUdp("127.0.0.1", 0);
+    sender.SetSendBufferSize(kSendBufferSize);
+
+    UdpFanoutOptions fanoutOptions;
+    fanoutOptions.maxPackets = options.packetsPerBurst;
+    fanoutOptions.maxPacketSize = options.packetSize;
+    fanoutOptions.useSegmentation = method == UdpFanoutMethod::SendMmsgGso;
+    UdpFanout fanout(fanoutOptions);
+    for (const SocketAddress& destination : destinations) {
+        fanout.AddDestination(destination);
+    }
+
+    std::vector<uint8_t> payload(options.packetSize, 0x5a);
+    IoSlice slice{ payload.data(), payload.size() };
+
+    UdpFanoutBenchmarkResult result;
+    CheckDelivery(options, method, sender, fanout, listeners, destinations, result);
+    uint64_t checkCalls = fanout.GetStats().sendCalls;
+
+    uint64_t sendCalls = 0;
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::duration<double>(options.seconds);
+    double cpuStart = ThreadCpuSeconds();
+    for (size_t burst = 0;; burst++) {
+        if (burst % kBurstsPerClockCheck == 0 && std::chrono::steady_clock::now() >= deadline) break;
+
+        if (method == UdpFanoutMethod::SendTo) {
+            for (size_t packet = 0; packet < options.packetsPerBurst; packet++) {
+                for (const SocketAddress& destination : destinations) {
+                    sender.SendTo(payload.data(), payload.size(), destination);
+                }
+            }
+            result.datagrams += options.packetsPerBurst * destinations.size();
+            sendCalls += options.packetsPerBurst * destinations.size();
+            continue;
+        }
+        for (size_t packet = 0; packet < options.packetsPerBurst; packet++) {
+            fanout.Queue(&slice, 1);
+        }
+        result.datagrams += fanout.Flush(sender);
+    }
+    result.cpuSeconds = ThreadCpuSeconds() - cpuStart;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (method != UdpFanoutMethod::SendTo) {
+        sendCalls = fanout.GetStats().sendCalls - checkCalls;
+        result.segmented = method == UdpFanoutMethod::SendMmsgGso && sender.SupportsSegmentation() && options.packetsPerBurst > 1;
+    }
+    double datagrams = static_cast<double>(result.datagrams);
+    result.datagramsPerSecond = datagrams / result.seconds;
+    result.datagramsPerCoreSecond = result.cpuSeconds > 0.0 ? datagrams / result.cpuSeconds : 0.0;
+    result.sendCallsPerDatagram = datagrams > 0.0 ? static_cast<double>(sendCalls) / datagrams : 0.0;
+    return result;
+}
+#endif
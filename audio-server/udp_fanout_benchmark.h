@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+
+enum class UdpFanoutMethod {
+    SendTo,                                 // One sendto per packet and listener
+    SendMmsg,                               // UdpFanout without segmentation
+    SendMmsgGso                             // UdpFanout, a burst per listener as one GSO datagram
+};
+
+struct UdpFanoutBenchmarkOptions {
+    size_t listeners = 200;
+    size_t packetsPerBurst = 1;             // 1 for an audio packet, more for a video frame
+    size_t packetSize = 1200;
+    double seconds = 2.0;
+};
+
+struct UdpFanoutBenchmarkResult {
+    uint64_t datagrams = 0;                 // Packets times listeners
+    double seconds = 0.0;
+    double cpuSeconds = 0.0;                // Sending thread
+    double datagramsPerSecond = 0.0;
+    double datagramsPerCoreSecond = 0.0;    // Per second of sender CPU
+    double sendCallsPerDatagram = 0.0;
+    bool segmented = false;                 // GSO was used
+    uint64_t checkedDatagrams = 0;          // Expected by the receive check
+    uint64_t wrongDatagrams = 0;            // Missing, or not the size and bytes sent
+};
+
+// One sender fanning bursts out to listeners on loopback, as fast as it
+// can, on the calling thread. The listeners are bound UDP sockets nobody
+// reads: once their buffers are full the kernel drops at delivery, which
+// costs the sender the same.
+//
+// Before timing, one short burst with numbered packets and a shorter last
+// packet is sent and read back on every listener, so a segmented datagram
+// must arrive as the original packets, in order and at their own sizes.
+//
+// Linux only.
+UdpFanoutBenchmarkResult RunUdpFanoutBenchmark(const UdpFanoutBenchmarkOptions& options, UdpFanoutMethod method);
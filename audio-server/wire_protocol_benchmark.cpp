@@ -0,0 +1,134 @@
+#include "wire_protocol_benchmark.h"
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "media_pipeline/net/wire_protocol.h"
+
+using namespace media_pipeline::net;
+
+namespace {
+    constexpr size_t kMaxPayload = 1200;
+    constexpr size_t kMaxMutations = 8;
+    constexpr size_t kMaxFragments = 4;
+
+    // Roughly a call: mostly small audio frames, some video frames, and
+    // keyframes with format extensions split into fragments
+    std::vector<uint8_t> BuildFrames(size_t count, std::mt19937& random, std::vector<size_t>& offsets) {
+        std::vector<uint8_t> buffer;
+        uint8_t header[kWireHeaderSize + kWireMaxExtensionsSize];
+        uint32_t sequences[2] = {};
+        for (size_t i = 0; i < count; i++) {
+            bool isVideo = random() % 4 == 0;
+            WireHeader wire;
+            wire.mediaType = isVideo ? WireMediaType::Video : WireMediaType::Audio;
+            wire.codec = isVideo ? WireCodec::Hevc : WireCodec::Opus;
+            wire.streamId = isVideo ? 1 : 0;
+            wire.sequence = sequences[wire.streamId]++;
+            wire.timestamp = i * 20000000ull;
+
+            size_t extensionsSize = 0;
+            size_t fragments = 1;
+            if (isVideo && random() % 8 == 0) {
+                wire.flags = kWireKeyFrame;
+                uint8_t format[4] = { 0x80, 0x07, 0x38, 0x04 };
+                extensionsSize += WriteWireExtension(header + kWireHeaderSize, kWireExtVideoFormat, format, sizeof(format));
+                fragments = 2 + random() % (kMaxFragments - 1);
+            }
+            size_t payloadSize = isVideo ? 200 + random() % (kMaxPayload - 200) : 40 + random() % 120;
+
+            for (size_t fragment = 0; fragment < fragments; fragment++) {
+                size_t fragmentExtensionsSize = fragment == 0 ? extensionsSize : 0;
+                if (fragments > 1) {
+                    fragmentExtensionsSize += WriteWireFragment(header + kWireHeaderSize + fragmentExtensionsSize,
+                        static_cast<uint32_t>(fragment * payloadSize), static_cast<uint32_t>(fragments * payloadSize));
+                }
+                WriteWireHeader(header, wire, fragmentExtensionsSize, payloadSize);
+                offsets.push_back(buffer.size());
+                buffer.insert(buffer.end(), header, header + kWireHeaderSize + fragmentExtensionsSize);
+                buffer.resize(buffer.size() + payloadSize, static_cast<uint8_t>(i));
+            }
+        }
+        return buffer;
+    }
+
+    bool Inside(const uint8_t* pointer, size_t size, const uint8_t* begin, const uint8_t* end) {
+        return pointer >= begin && pointer <= end && size <= static_cast<size_t>(end - pointer);
+    }
+}
+
+WireProtocolBenchmarkResult RunWireProtocolBenchmark(const WireProtocolBenchmarkOptions& options) {
+    WireProtocolBenchmarkResult result;
+    std::mt19937 random(options.seed);
+    std::vector<size_t> offsets;
+    std::vector<uint8_t> buffer = BuildFrames(options.frames, random, offsets);
+
+    // What a receive loop does: parse, look at the header, check for a format
+    uint64_t checksum = 0;
+    uint64_t parsed = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t pass = 0; pass < options.passes; pass++) {
+        size_t offset = 0;
+        WireFrame frame;
+        while (ParseWireFrame(buffer.data() + offset, buffer.size() - offset, frame) == WireParseResult::Ok) {
+            const uint8_t* format;
+            size_t formatSize;
+            if (FindWireExtension(frame, kWireExtVideoFormat, format, formatSize)) checksum += format[0];
+            checksum += frame.header.sequence + frame.payloadSize + frame.header.flags;
+            offset += frame.frameSize;
+            parsed++;
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.nanosPerFrame = seconds * 1e9 / static_cast<double>(parsed > 0 ? parsed : 1);
+    result.gigabytesPerSecond = static_cast<double>(buffer.size()) * static_cast<double>(options.passes) / seconds / 1e9;
+    if (checksum == 0) result.nanosPerFrame = -1.0;   // Keeps the loop from being optimized away
+
+    // Mutate a window of the buffer and parse it to the end. Most windows
+    // start on a frame, so mutations reach past the size check.
+    std::vector<uint8_t> input;
+    for (size_t i = 0; i < options.fuzzInputs; i++) {
+        size_t begin = random() % 4 == 0 ? random() % buffer.size() : offsets[random() % offsets.size()];
+        size_t size = random() % 4096;
+        if (size > buffer.size() - begin) size = buffer.size() - begin;
+        input.assign(buffer.begin() + begin, buffer.begin() + begin + size);
+        size_t mutations = input.empty() ? 0 : random() % kMaxMutations;
+        for (size_t m = 0; m < mutations; m++) {
+            input[random() % input.size()] = static_cast<uint8_t>(random());
+        }
+
+        const uint8_t* data = input.data();
+        const uint8_t* end = data + input.size();
+        size_t offset = 0;
+        WireFrame frame;
+        WireFrame whole;
+        WireFragmentAssembler assembler;
+        WireParseResult parse;
+        while ((parse = ParseWireFrame(data + offset, input.size() - offset, frame)) == WireParseResult::Ok) {
+            bool inside = Inside(frame.payload, frame.payloadSize, data, end) &&
+                Inside(frame.extensions, frame.extensionsSize, data, end) &&
+                frame.frameSize <= input.size() - offset;
+            const uint8_t* value;
+            size_t valueSize;
+            for (uint8_t id = kWireExtAudioFormat; id <= kWireExtLayers; id++) {
+                if (FindWireExtension(frame, id, value, valueSize)) {
+                    inside = inside && Inside(value, valueSize, frame.extensions, frame.extensions + frame.extensionsSize);
+                }
+            }
+            if (assembler.Add(frame, whole) && whole.payload != frame.payload) {
+                inside = inside && whole.payloadSize == assembler.payload.size() &&
+                    Inside(whole.extensions, whole.extensionsSize, assembler.extensions.data(), assembler.extensions.data() + assembler.extensions.size());
+            }
+            if (!inside) {
+                result.fuzzOutOfBounds++;
+                break;
+            }
+            result.fuzzFramesParsed++;
+            offset += frame.frameSize;
+        }
+        if (parse == WireParseResult::Invalid) result.fuzzRejected++;
+        result.fuzzInputs++;
+    }
+    return result;
+}
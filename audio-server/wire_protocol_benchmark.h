@@ -0,0 +1,26 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+
+struct WireProtocolBenchmarkOptions {
+    size_t frames = 100000;                 // Back to back in one buffer, parsed repeatedly
+    size_t passes = 50;
+    size_t fuzzInputs = 200000;             // Mutated and truncated copies of the frames
+    uint32_t seed = 1;
+};
+
+struct WireProtocolBenchmarkResult {
+    double nanosPerFrame = 0.0;             // Parse plus one extension lookup
+    double gigabytesPerSecond = 0.0;
+    uint64_t fuzzInputs = 0;
+    uint64_t fuzzFramesParsed = 0;          // Frames that still parsed after mutation
+    uint64_t fuzzRejected = 0;              // Inputs that ended in Invalid
+    uint64_t fuzzOutOfBounds = 0;           // Parsed pointers outside the input, must stay 0
+};
+
+// Parses a buffer of mixed audio and video frames, as a receiver would
+// off a socket, then feeds the parser random mutations of it and checks
+// that nothing it returns, or reassembles from fragments, points outside
+// the input.
+WireProtocolBenchmarkResult RunWireProtocolBenchmark(const WireProtocolBenchmarkOptions& options);